@@ -28,16 +28,205 @@ GQuark tracker_date_error_quark (void) {
 	return g_quark_from_static_string ("tracker_date_error-quark");
 }
 
+static inline gint64
+floor_div (gint64 a,
+           gint64 b)
+{
+	return (a >= 0) ? a / b : ((a + 1) / b) - 1;
+}
+
+/* Proleptic gregorian calendar conversions from/to days since the
+ * epoch, these only use integer arithmetic.
+ */
+static gint64
+days_from_civil (gint year,
+                 gint month,
+                 gint day)
+{
+	gint era, year_of_era, day_of_year, day_of_era;
+
+	year -= month <= 2;
+	era = (year >= 0 ? year : year - 399) / 400;
+	year_of_era = year - era * 400;
+	day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+	return (gint64) era * 146097 + day_of_era - 719468;
+}
+
+static void
+civil_from_days (gint64  days,
+                 gint   *year,
+                 gint   *month,
+                 gint   *day)
+{
+	gint64 era;
+	gint day_of_era, year_of_era, day_of_year, mp;
+
+	days += 719468;
+	era = floor_div (days, 146097);
+	day_of_era = days - era * 146097;
+	year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	mp = (5 * day_of_year + 2) / 153;
+
+	*day = day_of_year - (153 * mp + 2) / 5 + 1;
+	*month = mp < 10 ? mp + 3 : mp - 9;
+	*year = year_of_era + era * 400 + (*month <= 2);
+}
+
+static inline gboolean
+parse_digits (const gchar **str,
+              gint          n_digits,
+              gint         *value)
+{
+	gint i, v = 0;
+
+	for (i = 0; i < n_digits; i++) {
+		if (!g_ascii_isdigit ((*str)[i]))
+			return FALSE;
+		v = (v * 10) + ((*str)[i] - '0');
+	}
+
+	*str += n_digits;
+	*value = v;
+
+	return TRUE;
+}
+
+/* Handles the CCYY-MM-DDThh:mm:ss[.ssssss](Z|(+|-)hh[:mm]) form we
+ * produce ourselves. Anything else (no timezone, extra precision,
+ * week dates...) is left to GDateTime.
+ */
+static gboolean
+parse_iso8601_fast (const gchar *str,
+                    gint64      *usec,
+                    gint32      *offset)
+{
+	gint year, month, day, hour, minute, second;
+	gint fraction = 0, n_fraction = 0, tz = 0;
+	const gchar *p = str;
+
+	if (!parse_digits (&p, 4, &year) || *p++ != '-' ||
+	    !parse_digits (&p, 2, &month) || *p++ != '-' ||
+	    !parse_digits (&p, 2, &day) || *p++ != 'T' ||
+	    !parse_digits (&p, 2, &hour) || *p++ != ':' ||
+	    !parse_digits (&p, 2, &minute) || *p++ != ':' ||
+	    !parse_digits (&p, 2, &second))
+		return FALSE;
+
+	if (*p == '.') {
+		p++;
+
+		while (g_ascii_isdigit (*p)) {
+			if (n_fraction == 6)
+				return FALSE;
+			fraction = (fraction * 10) + (*p - '0');
+			n_fraction++;
+			p++;
+		}
+
+		if (n_fraction == 0)
+			return FALSE;
+
+		for (; n_fraction < 6; n_fraction++)
+			fraction *= 10;
+	}
+
+	if (*p == 'Z') {
+		p++;
+	} else if (*p == '+' || *p == '-') {
+		gint sign = (*p == '-') ? -1 : 1;
+		gint tz_hour, tz_minute = 0;
+
+		p++;
+
+		if (!parse_digits (&p, 2, &tz_hour))
+			return FALSE;
+
+		if (*p == ':') {
+			p++;
+			if (!parse_digits (&p, 2, &tz_minute))
+				return FALSE;
+		} else if (g_ascii_isdigit (*p)) {
+			if (!parse_digits (&p, 2, &tz_minute))
+				return FALSE;
+		}
+
+		if (tz_hour > 23 || tz_minute > 59)
+			return FALSE;
+
+		tz = sign * ((tz_hour * 3600) + (tz_minute * 60));
+	} else {
+		return FALSE;
+	}
+
+	if (*p != '\0')
+		return FALSE;
+
+	if (year < 1 || month < 1 || month > 12 ||
+	    day < 1 || day > g_date_get_days_in_month (month, year) ||
+	    hour > 23 || minute > 59 || second > 59)
+		return FALSE;
+
+	*usec = ((days_from_civil (year, month, day) * 86400 +
+	          hour * 3600 + minute * 60 + second - tz) * G_USEC_PER_SEC) + fraction;
+	*offset = tz;
+
+	return TRUE;
+}
+
+static GDateTime *
+date_time_new (gint64 usec,
+               gint32 offset)
+{
+	GDateTime *utc, *datetime = NULL;
+	GTimeZone *tz;
+	gint64 seconds, remainder;
+
+	seconds = floor_div (usec, G_USEC_PER_SEC);
+	remainder = usec - (seconds * G_USEC_PER_SEC);
+
+	utc = g_date_time_new_from_unix_utc (seconds);
+	if (!utc)
+		return NULL;
+
+	if (offset != 0) {
+		tz = g_time_zone_new_offset (offset);
+		datetime = g_date_time_to_timezone (utc, tz);
+		g_time_zone_unref (tz);
+		g_date_time_unref (utc);
+	} else {
+		datetime = utc;
+	}
+
+	if (datetime && remainder > 0) {
+		GDateTime *copy = datetime;
+
+		datetime = g_date_time_add (copy, remainder);
+		g_date_time_unref (copy);
+	}
+
+	return datetime;
+}
+
 GDateTime *
 tracker_date_new_from_iso8601 (const gchar  *string,
 			       GError      **error)
 {
-	GDateTime *datetime;
+	GDateTime *datetime = NULL;
 	GTimeZone *tz;
+	gint64 usec;
+	gint32 offset;
 
-	tz = g_time_zone_new_local ();
-	datetime = g_date_time_new_from_iso8601 (string, tz);
-	g_time_zone_unref (tz);
+	if (parse_iso8601_fast (string, &usec, &offset))
+		datetime = date_time_new (usec, offset);
+
+	if (!datetime) {
+		tz = g_time_zone_new_local ();
+		datetime = g_date_time_new_from_iso8601 (string, tz);
+		g_time_zone_unref (tz);
+	}
 
 	if (!datetime) {
 		g_set_error (error,
@@ -54,17 +243,209 @@ tracker_date_new_from_iso8601 (const gchar  *string,
 gchar *
 tracker_date_format_iso8601 (GDateTime *datetime)
 {
-	gboolean has_offset, has_subsecond;
+	gchar buf[TRACKER_DATE_TIME_ISO8601_SIZE];
+
+	/* GDateTime is limited to years 1-9999, so this cannot fail */
+	tracker_date_time_to_iso8601 (tracker_date_time_get_usec (datetime),
+	                              tracker_date_time_get_offset (datetime),
+	                              buf);
+
+	return g_strdup (buf);
+}
+
+/* Allocation free variant of tracker_date_new_from_iso8601(), returns
+ * the microseconds since the epoch and the UTC offset in seconds.
+ */
+gboolean
+tracker_date_time_from_iso8601 (const gchar *string,
+                                gint64      *usec,
+                                gint32      *offset)
+{
+	GDateTime *datetime;
+	GTimeZone *tz;
+
+	if (!string)
+		return FALSE;
+
+	if (parse_iso8601_fast (string, usec, offset))
+		return TRUE;
+
+	tz = g_time_zone_new_local ();
+	datetime = g_date_time_new_from_iso8601 (string, tz);
+	g_time_zone_unref (tz);
+
+	if (!datetime)
+		return FALSE;
+
+	*usec = tracker_date_time_get_usec (datetime);
+	*offset = tracker_date_time_get_offset (datetime);
+	g_date_time_unref (datetime);
+
+	return TRUE;
+}
+
+static inline gchar *
+put_digits (gchar *buf,
+            gint   value,
+            gint   n_digits)
+{
+	gint i;
+
+	for (i = n_digits - 1; i >= 0; i--) {
+		buf[i] = '0' + (value % 10);
+		value /= 10;
+	}
+
+	return &buf[n_digits];
+}
+
+/* Formats into a TRACKER_DATE_TIME_ISO8601_SIZE buffer, with the same
+ * output as tracker_date_format_iso8601(). Returns the string length,
+ * or 0 if the year is out of the 1-9999 range.
+ */
+gsize
+tracker_date_time_to_iso8601 (gint64  usec,
+                              gint32  offset,
+                              gchar  *buf)
+{
+	gint64 seconds, days, remainder;
+	gint year, month, day, second_of_day;
+	gchar *p = buf;
+
+	seconds = floor_div (usec, G_USEC_PER_SEC);
+	remainder = usec - (seconds * G_USEC_PER_SEC);
+	seconds += offset;
+	days = floor_div (seconds, 86400);
+	second_of_day = seconds - (days * 86400);
+
+	civil_from_days (days, &year, &month, &day);
+
+	if (year < 1 || year > 9999) {
+		buf[0] = '\0';
+		return 0;
+	}
+
+	p = put_digits (p, year, 4);
+	*p++ = '-';
+	p = put_digits (p, month, 2);
+	*p++ = '-';
+	p = put_digits (p, day, 2);
+	*p++ = 'T';
+	p = put_digits (p, second_of_day / 3600, 2);
+	*p++ = ':';
+	p = put_digits (p, second_of_day % 3600 / 60, 2);
+	*p++ = ':';
+	p = put_digits (p, second_of_day % 60, 2);
+
+	if (remainder != 0) {
+		*p++ = '.';
+		p = put_digits (p, remainder, 6);
+	}
+
+	if (offset == 0) {
+		*p++ = 'Z';
+	} else {
+		*p++ = offset > 0 ? '+' : '-';
+		p = put_digits (p, ABS (offset) / 3600, 2);
+		*p++ = ':';
+		p = put_digits (p, ABS (offset) % 3600 / 60, 2);
+	}
+
+	*p = '\0';
+
+	return p - buf;
+}
+
+gint64
+tracker_date_time_get_usec (GDateTime *datetime)
+{
+	return (g_date_time_to_unix (datetime) * G_USEC_PER_SEC) +
+		g_date_time_get_microsecond (datetime);
+}
+
+gint32
+tracker_date_time_get_offset (GDateTime *datetime)
+{
+	return g_date_time_get_utc_offset (datetime) / G_USEC_PER_SEC;
+}
+
+/* Datetimes that can't be stored losslessly as unix timestamps are
+ * kept in this packed form. Comparing two packed values with memcmp()
+ * gives the same order as comparing the instants they represent, values
+ * with the same instant are further sorted by offset.
+ */
+void
+tracker_date_time_pack (gint64  usec,
+                        gint32  offset,
+                        guint8 *buf)
+{
+	guint64 packed_usec;
+	guint32 packed_offset;
+	gint i;
+
+	/* Flip the sign bits, so negative values sort first */
+	packed_usec = ((guint64) usec) ^ G_GUINT64_CONSTANT (0x8000000000000000);
+	packed_offset = ((guint32) offset) ^ 0x80000000;
+
+	for (i = 0; i < 8; i++)
+		buf[i] = (packed_usec >> (56 - (i * 8))) & 0xff;
+	for (i = 0; i < 4; i++)
+		buf[8 + i] = (packed_offset >> (24 - (i * 8))) & 0xff;
+}
+
+gboolean
+tracker_date_time_unpack (gconstpointer  data,
+                          gsize          len,
+                          gint64        *usec,
+                          gint32        *offset)
+{
+	const guint8 *buf = data;
+	guint64 packed_usec = 0;
+	guint32 packed_offset = 0;
+	gint i;
+
+	if (!buf || len != TRACKER_DATE_TIME_PACKED_SIZE)
+		return FALSE;
 
-	has_offset = g_date_time_get_utc_offset (datetime) != 0;
-	has_subsecond = g_date_time_get_microsecond (datetime) != 0;
+	for (i = 0; i < 8; i++)
+		packed_usec = (packed_usec << 8) | buf[i];
+	for (i = 0; i < 4; i++)
+		packed_offset = (packed_offset << 8) | buf[8 + i];
 
-	if (has_offset && has_subsecond)
-		return g_date_time_format (datetime, "%C%y-%m-%dT%H:%M:%S.%f%:z");
-	else if (has_offset)
-		return g_date_time_format (datetime, "%C%y-%m-%dT%T%:z");
-	else if (has_subsecond)
-		return g_date_time_format (datetime, "%C%y-%m-%dT%H:%M:%S.%fZ");
-	else
-		return g_date_time_format (datetime, "%C%y-%m-%dT%TZ");
+	if (usec)
+		*usec = (gint64) (packed_usec ^ G_GUINT64_CONSTANT (0x8000000000000000));
+	if (offset)
+		*offset = (gint32) (packed_offset ^ 0x80000000);
+
+	return TRUE;
+}
+
+GDateTime *
+tracker_date_new_from_packed (gconstpointer   data,
+                              gsize           len,
+                              GError        **error)
+{
+	GDateTime *datetime;
+	gint64 usec;
+	gint32 offset;
+
+	if (!tracker_date_time_unpack (data, len, &usec, &offset)) {
+		g_set_error (error,
+		             TRACKER_DATE_ERROR,
+		             TRACKER_DATE_ERROR_INVALID_PACKED,
+		             "Invalid packed date (%" G_GSIZE_FORMAT " bytes)",
+		             len);
+		return NULL;
+	}
+
+	datetime = date_time_new (usec, offset);
+
+	if (!datetime) {
+		g_set_error (error,
+		             TRACKER_DATE_ERROR,
+		             TRACKER_DATE_ERROR_INVALID_PACKED,
+		             "Packed date is out of range");
+	}
+
+	return datetime;
 }
@@ -33,18 +33,48 @@ G_BEGIN_DECLS
 typedef enum  {
 	TRACKER_DATE_ERROR_OFFSET,
 	TRACKER_DATE_ERROR_INVALID_ISO8601,
-	TRACKER_DATE_ERROR_EMPTY
+	TRACKER_DATE_ERROR_EMPTY,
+	TRACKER_DATE_ERROR_INVALID_PACKED
 } TrackerDateError;
 
 #define TRACKER_TYPE_DATE_TIME                 (tracker_date_time_get_type ())
 #define TRACKER_DATE_ERROR                     tracker_date_error_quark ()
 
+/* Microseconds since the epoch (8 bytes) followed by the UTC offset
+ * in seconds (4 bytes), both big endian with the sign bit flipped.
+ */
+#define TRACKER_DATE_TIME_PACKED_SIZE          12
+
+/* Large enough for CCYY-MM-DDThh:mm:ss.ssssss+hh:mm and a nul byte */
+#define TRACKER_DATE_TIME_ISO8601_SIZE         40
+
 GQuark   tracker_date_error_quark              (void);
 
 GDateTime * tracker_date_new_from_iso8601 (const gchar  *string,
 					   GError      **error);
 gchar * tracker_date_format_iso8601 (GDateTime *datetime);
 
+gboolean tracker_date_time_from_iso8601 (const gchar *string,
+                                         gint64      *usec,
+                                         gint32      *offset);
+gsize tracker_date_time_to_iso8601 (gint64  usec,
+                                    gint32  offset,
+                                    gchar  *buf);
+
+gint64 tracker_date_time_get_usec (GDateTime *datetime);
+gint32 tracker_date_time_get_offset (GDateTime *datetime);
+
+void tracker_date_time_pack (gint64  usec,
+                             gint32  offset,
+                             guint8 *buf);
+gboolean tracker_date_time_unpack (gconstpointer  data,
+                                   gsize          len,
+                                   gint64        *usec,
+                                   gint32        *offset);
+GDateTime * tracker_date_new_from_packed (gconstpointer   data,
+                                          gsize           len,
+                                          GError        **error);
+
 G_END_DECLS
 
 #endif /* __LIBTRACKER_COMMON_DATE_TIME_H__ */
@@ -31,6 +31,7 @@
 #include <unicode/uchar.h>
 #include <unicode/unorm.h>
 #include <unicode/ucol.h>
+#include <unicode/uloc.h>
 
 #include "tracker-language.h"
 #include "tracker-debug.h"
@@ -44,6 +45,13 @@ typedef enum {
 	TRACKER_PARSER_WORD_TYPE_OTHER_NO_UNAC,
 } TrackerParserWordType;
 
+/* Type of text segments */
+typedef enum {
+	TRACKER_PARSER_SEGMENT_NONE,
+	TRACKER_PARSER_SEGMENT_ASCII,
+	TRACKER_PARSER_SEGMENT_ICU,
+} TrackerParserSegmentType;
+
 typedef UCollator TrackerCollator;
 
 /* Max possible length of a UChar encoded string (just a safety limit) */
@@ -54,6 +62,15 @@ typedef UCollator TrackerCollator;
  */
 #define WORD_BUFFER_LENGTH_UTF8 (2 * WORD_BUFFER_LENGTH * sizeof (UChar) + 1)
 
+/* Minimum length of an ASCII run between non-ASCII text for it to be
+ * parsed on its own, shorter runs are left to the word-break iterator
+ * together with the surrounding text.
+ */
+#define ASCII_SEGMENT_MIN_LENGTH 64
+
+#define BYTES_ONES  G_GUINT64_CONSTANT (0x0101010101010101)
+#define BYTES_HIGHS G_GUINT64_CONSTANT (0x8080808080808080)
+
 struct TrackerParser {
 	const gchar           *txt;
 	gint                   txt_size;
@@ -64,17 +81,28 @@ struct TrackerParser {
 	gboolean               enable_unaccent;
 	gboolean               ignore_numbers;
 	gboolean               enable_forced_wordbreaks;
+	gboolean               enable_ascii_fast_path;
+	gboolean               disable_ascii_fast_path;
 
 	/* Private members */
 	gchar                  word[WORD_BUFFER_LENGTH_UTF8];
 	gint                   word_length;
 	guint                  word_position;
 
-	/* Text as UChars */
+	/* Segment of txt currently being parsed, as byte offsets */
+	TrackerParserSegmentType segment_type;
+	gsize                  segment_start;
+	gsize                  segment_end;
+
+	/* Cursor, as byte offset in txt (ASCII segments) */
+	gsize                  txt_cursor;
+
+	/* Segment text as UChars (ICU segments) */
 	UConverter *converter;
 	UChar                 *utxt;
 	gsize                  utxt_size;
-	/* Original offset of each UChar in the input txt string */
+	gsize                  utxt_alloc;
+	/* Original offset of each UChar in the input txt segment */
 	gint32                *offsets;
 
 	/* The word-break iterator */
@@ -405,19 +433,14 @@ parser_check_forced_wordbreaks (const UChar *buffer,
 }
 
 static gboolean
-parser_next (TrackerParser *parser,
-             gint          *byte_offset_start,
-             gint          *byte_offset_end)
+parser_next_icu (TrackerParser *parser,
+                 gint          *byte_offset_start,
+                 gint          *byte_offset_end)
 {
 	gsize word_length_uchar = 0;
 	gsize word_length_utf8 = 0;
 	gsize current_word_offset_utf8 = 0;
 
-	*byte_offset_start = 0;
-	*byte_offset_end = 0;
-
-	g_return_val_if_fail (parser, FALSE);
-
 	/* Loop to look for next valid word */
 	while (parser->cursor < parser->utxt_size) {
 		TrackerParserWordType type;
@@ -427,7 +450,8 @@ parser_next (TrackerParser *parser,
 		gsize truncated_length;
 
 		/* Set current word offset in the original UTF-8 string */
-		current_word_offset_utf8 = parser->offsets[parser->cursor];
+		current_word_offset_utf8 = parser->segment_start +
+			parser->offsets[parser->cursor];
 
 		/* Find next word break. */
 		next_word_offset_uchar = ubrk_next (parser->bi);
@@ -447,9 +471,10 @@ parser_next (TrackerParser *parser,
 		if (next_word_offset_uchar >= parser->utxt_size) {
 			/* Last word support... */
 			next_word_offset_uchar = parser->utxt_size;
-			next_word_offset_utf8 = parser->txt_size;
+			next_word_offset_utf8 = parser->segment_end;
 		} else {
-			next_word_offset_utf8 = parser->offsets[next_word_offset_uchar];
+			next_word_offset_utf8 = parser->segment_start +
+				parser->offsets[next_word_offset_uchar];
 		}
 
 		/* Word end is the first byte after the word, which is either the
@@ -522,6 +547,357 @@ parser_next (TrackerParser *parser,
 	return FALSE;
 }
 
+/* Bytes that are handled by the word-break iterator: non-ASCII text,
+ * and characters whose word-break properties are tailored by some
+ * locales (e.g. ':' in Swedish, or '@' in POSIX).
+ */
+static inline gboolean
+needs_icu (guchar c)
+{
+	return c >= 0x80 || c == ':' || c == '@';
+}
+
+/* ASCII letters, digits and underscore, all of these join together
+ * into a single word as per UAX#29 (WB5, WB8-10, WB13a-b).
+ */
+static inline gboolean
+is_ascii_word_char (guchar c)
+{
+	return g_ascii_isalnum (c) || c == '_';
+}
+
+/* ASCII characters that never join with the surrounding text into a
+ * word, so the text can be split at them without changing the words
+ * found by the word-break iterator.
+ */
+static inline gboolean
+is_ascii_word_break (guchar c)
+{
+	if (c >= 0x80 || is_ascii_word_char (c))
+		return FALSE;
+
+	switch (c) {
+	case '\'':
+	case ',':
+	case ';':
+	case '.':
+	case ':':
+	case '@':
+	case '\r':
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+static gsize
+find_icu_byte (const guchar *txt,
+               gsize         start,
+               gsize         end)
+{
+	gsize i = start;
+
+	/* Look for non-ASCII bytes, colons and at signs 8 bytes at a time */
+	while (i + sizeof (guint64) <= end) {
+		guint64 chunk, colons, ats;
+
+		memcpy (&chunk, &txt[i], sizeof (guint64));
+		colons = chunk ^ (BYTES_ONES * ':');
+		ats = chunk ^ (BYTES_ONES * '@');
+
+		if (((chunk |
+		      ((colons - BYTES_ONES) & ~colons) |
+		      ((ats - BYTES_ONES) & ~ats)) & BYTES_HIGHS) != 0)
+			break;
+
+		i += sizeof (guint64);
+	}
+
+	while (i < end && !needs_icu (txt[i]))
+		i++;
+
+	return i;
+}
+
+static gsize
+find_ascii_word_end (const guchar *txt,
+                     gsize         start,
+                     gsize         end)
+{
+	gsize i = start + 1;
+
+	while (i < end) {
+		guchar prev, next;
+
+		if (is_ascii_word_char (txt[i])) {
+			i++;
+			continue;
+		}
+
+		if (i + 1 >= end)
+			break;
+
+		/* Apostrophes join letters with letters (WB6-7), apostrophes,
+		 * commas and semicolons join digits with digits (WB11-12).
+		 * Dots would do too, but are forced word breaks.
+		 */
+		prev = txt[i - 1];
+		next = txt[i + 1];
+
+		if (txt[i] == '\'' &&
+		    g_ascii_isalpha (prev) && g_ascii_isalpha (next)) {
+			i += 2;
+		} else if ((txt[i] == '\'' || txt[i] == ',' || txt[i] == ';') &&
+		           g_ascii_isdigit (prev) && g_ascii_isdigit (next)) {
+			i += 2;
+		} else {
+			break;
+		}
+	}
+
+	return i;
+}
+
+static gboolean
+parser_next_ascii (TrackerParser *parser,
+                   gint          *byte_offset_start,
+                   gint          *byte_offset_end)
+{
+	const guchar *txt = (const guchar *) parser->txt;
+
+	while (parser->txt_cursor < parser->segment_end) {
+		gsize word_start, word_length, i;
+
+		word_start = parser->txt_cursor;
+
+		/* Anything else than letters, digits and underscores
+		 * stands on its own, and is not an allowed word start.
+		 */
+		if (!is_ascii_word_char (txt[word_start])) {
+			parser->txt_cursor++;
+			continue;
+		}
+
+		parser->txt_cursor = find_ascii_word_end (txt,
+		                                          word_start,
+		                                          parser->segment_end);
+		word_length = parser->txt_cursor - word_start;
+
+		/* Ignore the word if longer than the maximum allowed, or if
+		 * it would not fit in the buffers of the ICU path.
+		 */
+		if (word_length >= parser->max_word_length ||
+		    word_length > WORD_BUFFER_LENGTH)
+			continue;
+
+		if (parser->ignore_numbers && g_ascii_isdigit (txt[word_start]))
+			continue;
+
+		for (i = 0; i < word_length; i++)
+			parser->word[i] = g_ascii_tolower (txt[word_start + i]);
+
+		parser->word[word_length] = '\0';
+		parser->word_length = word_length;
+
+		tracker_parser_message_hex (" After lowercase",
+		                            parser->word,
+		                            parser->word_length);
+
+		if (parser->enable_stemmer) {
+			tracker_language_stem_word (parser->language,
+			                            (gchar *) &parser->word,
+			                            &parser->word_length,
+			                            WORD_BUFFER_LENGTH_UTF8);
+
+			tracker_parser_message_hex ("    After stemming",
+			                            &parser->word,
+			                            parser->word_length);
+		}
+
+		*byte_offset_start = word_start;
+		*byte_offset_end = parser->txt_cursor;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+parser_set_icu_segment (TrackerParser *parser,
+                        gsize          start,
+                        gsize          end)
+{
+	UErrorCode error = U_ZERO_ERROR;
+	UChar *last_uchar;
+	const gchar *last_utf8;
+	gsize size = end - start;
+
+	parser->segment_type = TRACKER_PARSER_SEGMENT_ICU;
+	parser->segment_start = start;
+	parser->segment_end = end;
+	parser->utxt_size = 0;
+	parser->cursor = 0;
+
+	/* Open converter UTF-8 to UChar */
+	if (!parser->converter) {
+		parser->converter = ucnv_open ("UTF-8", &error);
+		if (!parser->converter) {
+			g_warning ("Cannot open UTF-8 converter: '%s'",
+			           U_FAILURE (error) ? u_errorName (error) : "none");
+			return;
+		}
+	}
+
+	/* Allocate UChars and offsets buffers */
+	if (parser->utxt_alloc < size + 1) {
+		parser->utxt_alloc = size + 1;
+		parser->utxt = g_renew (UChar, parser->utxt, parser->utxt_alloc);
+		parser->offsets = g_renew (gint32, parser->offsets, parser->utxt_alloc);
+	}
+
+	/* last_uchar and last_utf8 will be also an output parameter! */
+	last_uchar = parser->utxt;
+	last_utf8 = &parser->txt[start];
+
+	/* Convert to UChars storing offsets */
+	ucnv_reset (parser->converter);
+	ucnv_toUnicode (parser->converter,
+	                &last_uchar,
+	                &parser->utxt[size],
+	                &last_utf8,
+	                &parser->txt[end],
+	                parser->offsets,
+	                FALSE,
+	                &error);
+	if (U_SUCCESS (error)) {
+		/* Proper UChar array size is now given by 'last_uchar' */
+		parser->utxt_size = last_uchar - parser->utxt;
+
+		/* Open word-break iterator, or point it to the new text */
+		if (!parser->bi) {
+			parser->bi = ubrk_open (UBRK_WORD,
+			                        setlocale (LC_CTYPE, NULL),
+			                        parser->utxt,
+			                        parser->utxt_size,
+			                        &error);
+		} else {
+			ubrk_setText (parser->bi,
+			              parser->utxt,
+			              parser->utxt_size,
+			              &error);
+		}
+
+		if (U_SUCCESS (error)) {
+			/* Find FIRST word in the UChar array */
+			parser->cursor = ubrk_first (parser->bi);
+		}
+	}
+
+	/* If any error happened, skip this segment */
+	if (U_FAILURE (error)) {
+		g_warning ("Error initializing libicu support: '%s'",
+		           u_errorName (error));
+		g_clear_pointer (&parser->bi, ubrk_close);
+		parser->utxt_size = 0;
+	}
+}
+
+static void
+parser_next_segment (TrackerParser *parser)
+{
+	const guchar *txt = (const guchar *) parser->txt;
+	gsize txt_size = parser->txt_size;
+	gsize start, end, icu_start;
+
+	start = parser->segment_end;
+
+	if (!parser->enable_ascii_fast_path) {
+		parser_set_icu_segment (parser, start, txt_size);
+		return;
+	}
+
+	icu_start = find_icu_byte (txt, start, txt_size);
+	end = icu_start;
+
+	/* Leave the word containing the first non-ASCII byte to the
+	 * word-break iterator.
+	 */
+	if (end < txt_size) {
+		while (end > start && !is_ascii_word_break (txt[end - 1]))
+			end--;
+	}
+
+	if (end > start) {
+		parser->segment_type = TRACKER_PARSER_SEGMENT_ASCII;
+		parser->segment_start = start;
+		parser->segment_end = end;
+		parser->txt_cursor = start;
+		return;
+	}
+
+	/* Extend the segment up to the next ASCII run that is long enough
+	 * to be worth splitting off.
+	 */
+	end = icu_start;
+
+	while (end < txt_size) {
+		gsize next;
+
+		while (end < txt_size && !is_ascii_word_break (txt[end]))
+			end++;
+
+		next = find_icu_byte (txt, end, txt_size);
+		if (next == txt_size ||
+		    next - end >= ASCII_SEGMENT_MIN_LENGTH)
+			break;
+
+		end = next;
+	}
+
+	parser_set_icu_segment (parser, start, end);
+}
+
+static gboolean
+parser_next (TrackerParser *parser,
+             gint          *byte_offset_start,
+             gint          *byte_offset_end)
+{
+	*byte_offset_start = 0;
+	*byte_offset_end = 0;
+
+	g_return_val_if_fail (parser, FALSE);
+
+	while (TRUE) {
+		if (parser->segment_type == TRACKER_PARSER_SEGMENT_ASCII &&
+		    parser_next_ascii (parser, byte_offset_start, byte_offset_end))
+			return TRUE;
+
+		if (parser->segment_type == TRACKER_PARSER_SEGMENT_ICU &&
+		    parser_next_icu (parser, byte_offset_start, byte_offset_end))
+			return TRUE;
+
+		if (parser->segment_end >= (gsize) parser->txt_size)
+			return FALSE;
+
+		parser_next_segment (parser);
+	}
+}
+
+static gboolean
+locale_lowercases_ascii (void)
+{
+	gchar language[ULOC_LANG_CAPACITY];
+	UErrorCode error = U_ZERO_ERROR;
+
+	uloc_getLanguage (uloc_getDefault (), language, sizeof (language), &error);
+	if (U_FAILURE (error))
+		return FALSE;
+
+	/* Turkic languages lowercase 'I' to a dotless 'ı' */
+	return strcmp (language, "tr") != 0 && strcmp (language, "az") != 0;
+}
+
 TrackerParser *
 tracker_parser_new (void)
 {
@@ -557,10 +933,6 @@ tracker_parser_reset (TrackerParser *parser,
                       gboolean       enable_unaccent,
                       gboolean       ignore_numbers)
 {
-	UErrorCode error = U_ZERO_ERROR;
-	UChar *last_uchar;
-	const gchar *last_utf8;
-
 	g_return_if_fail (parser != NULL);
 	g_return_if_fail (txt != NULL);
 
@@ -574,6 +946,12 @@ tracker_parser_reset (TrackerParser *parser,
 	 * is to enable FTS searches matching file extension. */
 	parser->enable_forced_wordbreaks = TRUE;
 
+	/* ASCII text is split into words and lowercased without
+	 * going through ICU, as long as lowercasing is plain ASCII
+	 * lowercasing in the current locale. */
+	parser->enable_ascii_fast_path =
+		!parser->disable_ascii_fast_path && locale_lowercases_ascii ();
+
 	parser->txt_size = txt_size;
 	parser->txt = txt;
 
@@ -582,67 +960,25 @@ tracker_parser_reset (TrackerParser *parser,
 	g_clear_pointer (&parser->bi, ubrk_close);
 	g_clear_pointer (&parser->utxt, g_free);
 	g_clear_pointer (&parser->offsets, g_free);
+	parser->utxt_size = 0;
+	parser->utxt_alloc = 0;
+
+	parser->segment_type = TRACKER_PARSER_SEGMENT_NONE;
+	parser->segment_start = 0;
+	parser->segment_end = 0;
+	parser->txt_cursor = 0;
 
 	parser->word_position = 0;
 	parser->cursor = 0;
+}
 
-	if (parser->txt_size == 0)
-		return;
-
-	/* Open converter UTF-8 to UChar */
-	if (!parser->converter) {
-		parser->converter = ucnv_open ("UTF-8", &error);
-		if (!parser->converter) {
-			g_warning ("Cannot open UTF-8 converter: '%s'",
-			           U_FAILURE (error) ? u_errorName (error) : "none");
-			return;
-		}
-	}
-
-	/* Allocate UChars and offsets buffers */
-	parser->utxt_size = txt_size + 1;
-	parser->utxt = g_malloc (parser->utxt_size * sizeof (UChar));
-	parser->offsets = g_malloc (parser->utxt_size * sizeof (gint32));
-
-	/* last_uchar and last_utf8 will be also an output parameter! */
-	last_uchar = parser->utxt;
-	last_utf8 = parser->txt;
-
-	/* Convert to UChars storing offsets */
-	ucnv_toUnicode (parser->converter,
-	                &last_uchar,
-	                &parser->utxt[txt_size],
-	                &last_utf8,
-	                &parser->txt[txt_size],
-	                parser->offsets,
-	                FALSE,
-	                &error);
-	if (U_SUCCESS (error)) {
-		/* Proper UChar array size is now given by 'last_uchar' */
-		parser->utxt_size = last_uchar - parser->utxt;
-
-		/* Open word-break iterator */
-		parser->bi = ubrk_open(UBRK_WORD,
-		                       setlocale (LC_CTYPE, NULL),
-		                       parser->utxt,
-		                       parser->utxt_size,
-		                       &error);
-		if (U_SUCCESS (error)) {
-			/* Find FIRST word in the UChar array */
-			parser->cursor = ubrk_first (parser->bi);
-		}
-	}
+void
+tracker_parser_set_ascii_fast_path (TrackerParser *parser,
+                                    gboolean       enabled)
+{
+	g_return_if_fail (parser != NULL);
 
-	/* If any error happened, reset buffers */
-	if (U_FAILURE (error)) {
-		g_warning ("Error initializing libicu support: '%s'",
-		           u_errorName (error));
-		/* Reset buffers */
-		g_clear_pointer (&parser->utxt, g_free);
-		g_clear_pointer (&parser->offsets, g_free);
-		g_clear_pointer (&parser->bi, ubrk_close);
-		parser->utxt_size = 0;
-	}
+	parser->disable_ascii_fast_path = !enabled;
 }
 
 const gchar *
@@ -736,6 +1072,60 @@ tracker_collation_utf8 (gpointer      collator,
 	return 0;
 }
 
+guint8 *
+tracker_collation_get_sort_key (gpointer      collator,
+                                gint          len,
+                                gconstpointer str,
+                                gsize        *key_len)
+{
+	UErrorCode status = U_ZERO_ERROR;
+	UChar ustr_stack[256], *ustr = ustr_stack;
+	int32_t ulen, size, key_size;
+	guint8 *key;
+
+	/* Collator must be created before trying to collate */
+	g_return_val_if_fail (collator, NULL);
+
+	/* Invalid UTF-8 is replaced the same way ucol_strcollIter() does */
+	u_strFromUTF8WithSub (ustr, G_N_ELEMENTS (ustr_stack), &ulen,
+	                      str, len, 0xFFFD, NULL, &status);
+	if (status == U_BUFFER_OVERFLOW_ERROR) {
+		status = U_ZERO_ERROR;
+		ustr = g_new (UChar, ulen);
+		u_strFromUTF8WithSub (ustr, ulen, &ulen,
+		                      str, len, 0xFFFD, NULL, &status);
+	}
+
+	if (U_FAILURE (status)) {
+		g_critical ("Error converting to UTF-16: %s", u_errorName (status));
+		if (ustr != ustr_stack)
+			g_free (ustr);
+		return NULL;
+	}
+
+	/* Sort keys are usually a bit longer than the UTF-16 string,
+	 * avoid preflighting for the common case.
+	 */
+	key_size = ulen * 3 + 16;
+	key = g_malloc (key_size);
+	size = ucol_getSortKey ((UCollator *) collator, ustr, ulen,
+	                        key, key_size);
+	if (size > key_size) {
+		key_size = size;
+		key = g_realloc (key, key_size);
+		size = ucol_getSortKey ((UCollator *) collator, ustr, ulen,
+		                        key, key_size);
+	}
+
+	if (ustr != ustr_stack)
+		g_free (ustr);
+
+	/* The returned size accounts for the nul terminator */
+	*key_len = size > 0 ? size - 1 : 0;
+
+	return key;
+}
+
 gunichar2 *
 tracker_parser_tolower (const gunichar2 *input,
 			gsize            len,
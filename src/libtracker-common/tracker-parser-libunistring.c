@@ -546,6 +546,33 @@ tracker_collation_utf8 (gpointer      collator,
 	return result;
 }
 
+guint8 *
+tracker_collation_get_sort_key (gpointer      collator,
+                                gint          len,
+                                gconstpointer str,
+                                gsize        *key_len)
+{
+	gchar *locale_str;
+	guint8 *key;
+	gsize size;
+
+	/* Transform the string in the same locale encoding
+	 * u8_strcoll() would compare it in.
+	 */
+	locale_str = g_locale_from_utf8 (str, len, NULL, NULL, NULL);
+	if (!locale_str)
+		locale_str = g_strndup (str, len);
+
+	size = strxfrm (NULL, locale_str, 0);
+	key = g_malloc (size + 1);
+	strxfrm ((gchar *) key, locale_str, size + 1);
+	g_free (locale_str);
+
+	*key_len = size;
+
+	return key;
+}
+
 gunichar2 *
 tracker_parser_tolower (const gunichar2 *input,
 			gsize            len,
@@ -37,6 +37,8 @@ static void (*parser_reset) (TrackerParser *parser,
                              gboolean       enable_stemmer,
                              gboolean       enable_unaccent,
                              gboolean       ignore_numbers);
+static void (*parser_set_ascii_fast_path) (TrackerParser *parser,
+                                           gboolean       enabled);
 static const gchar * (*parser_next) (TrackerParser *parser,
                                      gint          *position,
                                      gint          *byte_offset_start,
@@ -124,6 +126,11 @@ ensure_init_parser (void)
 			            g_module_error ());
 		}
 
+		/* Optional, only the libicu parser has an ASCII fast path */
+		if (!g_module_symbol (module, "tracker_parser_set_ascii_fast_path",
+		                      (gpointer *) &parser_set_ascii_fast_path))
+			parser_set_ascii_fast_path = NULL;
+
 		TRACKER_NOTE (COLLATION, g_message ("Initialized collator %s", g_module_name (module)));
 
 		g_module_make_resident (module);
@@ -161,6 +168,14 @@ tracker_parser_reset (TrackerParser *parser,
 	              ignore_numbers);
 }
 
+void
+tracker_parser_set_ascii_fast_path (TrackerParser *parser,
+                                    gboolean       enabled)
+{
+	if (parser_set_ascii_fast_path)
+		parser_set_ascii_fast_path (parser, enabled);
+}
+
 const gchar *
 tracker_parser_next (TrackerParser *parser,
                      gint          *position,
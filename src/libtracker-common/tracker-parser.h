@@ -55,6 +55,10 @@ const gchar *  tracker_parser_next            (TrackerParser   *parser,
 
 void           tracker_parser_free            (TrackerParser   *parser);
 
+/* For tests, parsers that are not ICU based have no fast path */
+void           tracker_parser_set_ascii_fast_path (TrackerParser *parser,
+                                                   gboolean       enabled);
+
 /* Collation */
 gpointer tracker_collation_init (void);
 
@@ -66,6 +70,11 @@ gint tracker_collation_utf8 (gpointer      collator,
                              gint          len2,
                              gconstpointer str2);
 
+guint8 * tracker_collation_get_sort_key (gpointer      collator,
+                                         gint          len,
+                                         gconstpointer str,
+                                         gsize        *key_len);
+
 /* Other helper methods */
 
 gunichar2 * tracker_parser_tolower (const gunichar2 *input,
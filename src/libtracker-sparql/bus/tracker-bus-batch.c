@@ -156,12 +156,33 @@ tracker_bus_batch_add_resource (TrackerBatch    *batch,
                                 const gchar     *graph,
                                 TrackerResource *resource)
 {
+	TrackerBusBatch *bus_batch = TRACKER_BUS_BATCH (batch);
 	TrackerSparqlConnection *conn;
 	TrackerNamespaceManager *namespaces;
 	GInputStream *istream;
 	gchar *trig;
 
 	conn = tracker_batch_get_connection (batch);
+
+	if (tracker_bus_connection_supports_update_batch (TRACKER_BUS_CONNECTION (conn))) {
+		GBytes *bytes;
+
+		/* The endpoint inserts the resource directly, including
+		 * the deletion of overwritten properties.
+		 */
+		bytes = tracker_resource_serialize_graph (resource);
+
+		if (bytes) {
+			TrackerBusOp op = { 0, };
+
+			op.type = TRACKER_BUS_OP_RESOURCE;
+			op.d.resource.graph = g_strdup (graph);
+			op.d.resource.data = bytes;
+			g_array_append_val (bus_batch->ops, op);
+			return;
+		}
+	}
+
 	namespaces = tracker_sparql_connection_get_namespace_manager (conn);
 
 	append_property_clear_ops (batch, graph, resource);
@@ -375,6 +396,9 @@ batch_op_clear (TrackerBusOp *op)
 	} else if (op->type == TRACKER_BUS_OP_RDF) {
 		g_free (op->d.rdf.default_graph);
 		g_clear_object (&op->d.rdf.stream);
+	} else if (op->type == TRACKER_BUS_OP_RESOURCE) {
+		g_free (op->d.resource.graph);
+		g_clear_pointer (&op->d.resource.data, g_bytes_unref);
 	}
 }
 
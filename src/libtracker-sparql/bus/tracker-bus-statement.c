@@ -138,6 +138,24 @@ tracker_bus_statement_bind_langstring (TrackerSparqlStatement *stmt,
 	                     g_variant_ref_sink (variant));
 }
 
+static void
+tracker_bus_statement_bind_int_array (TrackerSparqlStatement *stmt,
+                                      const gchar            *name,
+                                      const gint64           *values,
+                                      gsize                   n_values)
+{
+	TrackerBusStatement *bus_stmt = TRACKER_BUS_STATEMENT (stmt);
+	GVariant *variant;
+
+	variant = g_variant_new_fixed_array (G_VARIANT_TYPE_INT64,
+	                                     values, n_values,
+	                                     sizeof (gint64));
+
+	g_hash_table_insert (bus_stmt->arguments,
+	                     g_strdup (name),
+	                     g_variant_ref_sink (variant));
+}
+
 static void
 tracker_bus_statement_clear_bindings (TrackerSparqlStatement *stmt)
 {
@@ -181,6 +199,24 @@ tracker_bus_statement_execute (TrackerSparqlStatement  *stmt,
 						     cancellable, error);
 }
 
+static GVariant *
+tracker_bus_statement_explain (TrackerSparqlStatement  *stmt,
+                               TrackerExplainFlags      flags,
+                               GCancellable            *cancellable,
+                               GError                 **error)
+{
+	TrackerBusStatement *bus_stmt = TRACKER_BUS_STATEMENT (stmt);
+	TrackerSparqlConnection *conn;
+
+	conn = tracker_sparql_statement_get_connection (stmt);
+
+	return tracker_bus_connection_perform_explain (TRACKER_BUS_CONNECTION (conn),
+						       tracker_sparql_statement_get_sparql (stmt),
+						       get_arguments (bus_stmt),
+						       flags,
+						       cancellable, error);
+}
+
 static void
 execute_cb (GObject      *source,
 	    GAsyncResult *res,
@@ -415,6 +451,7 @@ tracker_bus_statement_class_init (TrackerBusStatementClass *klass)
 	stmt_class->bind_string = tracker_bus_statement_bind_string;
 	stmt_class->bind_datetime = tracker_bus_statement_bind_datetime;
 	stmt_class->bind_langstring = tracker_bus_statement_bind_langstring;
+	stmt_class->bind_int_array = tracker_bus_statement_bind_int_array;
 	stmt_class->clear_bindings = tracker_bus_statement_clear_bindings;
 	stmt_class->execute = tracker_bus_statement_execute;
 	stmt_class->execute_async = tracker_bus_statement_execute_async;
@@ -424,6 +461,7 @@ tracker_bus_statement_class_init (TrackerBusStatementClass *klass)
 	stmt_class->update = tracker_bus_statement_update;
 	stmt_class->update_async = tracker_bus_statement_update_async;
 	stmt_class->update_finish = tracker_bus_statement_update_finish;
+	stmt_class->explain = tracker_bus_statement_explain;
 }
 
 static void
@@ -32,7 +32,7 @@
 #include "tracker-bus-cursor.h"
 #include "tracker-bus-statement.h"
 
-#define DBUS_PEER_IFACE "org.freedesktop.DBus.Peer"
+#define DBUS_INTROSPECTABLE_IFACE "org.freedesktop.DBus.Introspectable"
 
 #define PORTAL_NAME "org.freedesktop.portal.Tracker"
 #define PORTAL_PATH "/org/freedesktop/portal/Tracker"
@@ -50,6 +50,7 @@ struct _TrackerBusConnection {
 	gchar *dbus_name;
 	gchar *object_path;
 	gboolean sandboxed;
+	gboolean update_batch;
 };
 
 enum {
@@ -83,6 +84,11 @@ typedef struct {
 	GVariant *retval;
 } UpdateTaskData;
 
+typedef struct {
+	GArray *ops;
+	gboolean update_batch;
+} WriteOpsData;
+
 static void tracker_bus_connection_async_initable_iface_init (GAsyncInitableIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (TrackerBusConnection, tracker_bus_connection,
@@ -181,6 +187,28 @@ create_serialize_message (TrackerBusConnection  *conn,
 	return message;
 }
 
+static GDBusMessage *
+create_explain_message (TrackerBusConnection *conn,
+			const gchar          *sparql,
+			GVariant             *arguments,
+			TrackerExplainFlags   flags)
+{
+	GDBusMessage *message;
+	GVariant *body;
+
+	if (!arguments)
+		arguments = g_variant_new ("a{sv}", NULL);
+
+	message = g_dbus_message_new_method_call (conn->dbus_name,
+						  conn->object_path,
+						  ENDPOINT_IFACE,
+						  "Explain");
+	body = g_variant_new ("(s@a{sv}u)", sparql, arguments, flags);
+	g_dbus_message_set_body (message, body);
+
+	return message;
+}
+
 static GDBusMessage *
 create_update_message (TrackerBusConnection *conn,
 		       const gchar          *request,
@@ -305,6 +333,72 @@ convert_params (GHashTable *parameters)
 	return g_variant_ref_sink (g_variant_builder_end (&builder));
 }
 
+static gboolean
+write_statement_op (GDataOutputStream  *data,
+                    TrackerBusOp       *op,
+                    GHashTable         *statement_ids,
+                    GCancellable       *cancellable,
+                    GError            **error)
+{
+	gpointer value;
+	gboolean known;
+	guint id;
+
+	/* Each distinct SPARQL string is only sent once, the
+	 * following ops refer to it by its ID.
+	 */
+	known = g_hash_table_lookup_extended (statement_ids,
+	                                      op->d.sparql.sparql,
+	                                      NULL, &value);
+	if (known) {
+		id = GPOINTER_TO_UINT (value);
+	} else {
+		id = g_hash_table_size (statement_ids);
+		g_hash_table_insert (statement_ids, op->d.sparql.sparql,
+		                     GUINT_TO_POINTER (id));
+	}
+
+	if (!g_data_output_stream_put_int32 (data, TRACKER_BUS_OP_STATEMENT, cancellable, error))
+		return FALSE;
+	if (!g_data_output_stream_put_uint32 (data, id, cancellable, error))
+		return FALSE;
+
+	if (known) {
+		if (!g_data_output_stream_put_int32 (data, 0, cancellable, error))
+			return FALSE;
+	} else {
+		if (!g_data_output_stream_put_int32 (data,
+		                                     strlen (op->d.sparql.sparql),
+		                                     cancellable, error))
+			return FALSE;
+		if (!g_data_output_stream_put_string (data, op->d.sparql.sparql,
+		                                      cancellable, error))
+			return FALSE;
+	}
+
+	/* Parameters are sent in GVariant serialized form */
+	if (op->d.sparql.parameters) {
+		GVariant *variant;
+		gboolean retval;
+
+		variant = convert_params (op->d.sparql.parameters);
+		retval = g_data_output_stream_put_uint32 (data,
+		                                          g_variant_get_size (variant),
+		                                          cancellable, error) &&
+			g_output_stream_write_all (G_OUTPUT_STREAM (data),
+			                           g_variant_get_data (variant),
+			                           g_variant_get_size (variant),
+			                           NULL,
+			                           cancellable,
+			                           error);
+		g_variant_unref (variant);
+
+		return retval;
+	}
+
+	return g_data_output_stream_put_uint32 (data, 0, cancellable, error);
+}
+
 static void
 write_sparql_queries_in_thread (GTask        *task,
                                 gpointer      source_object,
@@ -312,24 +406,38 @@ write_sparql_queries_in_thread (GTask        *task,
                                 GCancellable *cancellable)
 {
 	GOutputStream *ostream = source_object;
+	WriteOpsData *write_data;
 	GArray *op_array;
 	GDataOutputStream *data;
 	GOutputStream *rdf_stream = NULL;
+	GHashTable *statement_ids = NULL;
 	GBytes *bytes = NULL;
 	gchar *params_str = NULL;
 	GError *error = NULL;
 	guint i;
 
-	op_array = g_task_get_task_data (task);
+	write_data = g_task_get_task_data (task);
+	op_array = write_data->ops;
 	data = g_data_output_stream_new (ostream);
 	g_data_output_stream_set_byte_order (data, G_DATA_STREAM_BYTE_ORDER_HOST_ENDIAN);
 
+	if (write_data->update_batch)
+		statement_ids = g_hash_table_new (g_str_hash, g_str_equal);
+
 	if (!g_data_output_stream_put_int32 (data, op_array->len, cancellable, &error))
 		goto error;
 
 	for (i = 0; i < op_array->len; i++) {
 		TrackerBusOp *op = &g_array_index (op_array, TrackerBusOp, i);
 
+		if (op->type == TRACKER_BUS_OP_SPARQL && statement_ids) {
+			if (!write_statement_op (data, op, statement_ids,
+			                         cancellable, &error))
+				goto error;
+
+			continue;
+		}
+
 		if (!g_data_output_stream_put_int32 (data, op->type, cancellable, &error))
 			goto error;
 
@@ -404,6 +512,31 @@ write_sparql_queries_in_thread (GTask        *task,
 				goto error;
 
 			g_clear_pointer (&bytes, g_bytes_unref);
+		} else if (op->type == TRACKER_BUS_OP_RESOURCE) {
+			if (op->d.resource.graph) {
+				if (!g_data_output_stream_put_int32 (data,
+				                                     strlen (op->d.resource.graph),
+				                                     cancellable, &error))
+					goto error;
+				if (!g_data_output_stream_put_string (data, op->d.resource.graph,
+				                                      cancellable, &error))
+					goto error;
+			} else {
+				if (!g_data_output_stream_put_int32 (data, 0, cancellable, &error))
+					goto error;
+			}
+
+			if (!g_data_output_stream_put_uint32 (data,
+			                                      g_bytes_get_size (op->d.resource.data),
+			                                      cancellable, &error))
+				goto error;
+			if (!g_output_stream_write_all (G_OUTPUT_STREAM (data),
+			                                g_bytes_get_data (op->d.resource.data, NULL),
+			                                g_bytes_get_size (op->d.resource.data),
+			                                NULL,
+			                                cancellable,
+			                                &error))
+				goto error;
 		}
 	}
 
@@ -411,6 +544,7 @@ write_sparql_queries_in_thread (GTask        *task,
 	g_clear_object (&rdf_stream);
 	g_clear_pointer (&bytes, g_bytes_unref);
 	g_clear_pointer (&params_str, g_free);
+	g_clear_pointer (&statement_ids, g_hash_table_unref);
 	g_object_unref (data);
 
 	if (error)
@@ -419,17 +553,30 @@ write_sparql_queries_in_thread (GTask        *task,
 		g_task_return_boolean (task, TRUE);
 }
 
+static void
+write_ops_data_free (WriteOpsData *data)
+{
+	g_array_unref (data->ops);
+	g_free (data);
+}
+
 static void
 write_sparql_queries_async (GOutputStream       *ostream,
                             GArray              *ops,
+                            gboolean             update_batch,
                             GCancellable        *cancellable,
                             GAsyncReadyCallback  cb,
                             gpointer             user_data)
 {
+	WriteOpsData *data;
 	GTask *task;
 
+	data = g_new0 (WriteOpsData, 1);
+	data->ops = g_array_ref (ops);
+	data->update_batch = update_batch;
+
 	task = g_task_new (ostream, cancellable, cb, user_data);
-	g_task_set_task_data (task, g_array_ref (ops), (GDestroyNotify) g_array_unref);
+	g_task_set_task_data (task, data, (GDestroyNotify) write_ops_data_free);
 	g_task_run_in_thread (task, write_sparql_queries_in_thread);
 	g_object_unref (task);
 }
@@ -542,6 +689,36 @@ init_sandbox (TrackerBusConnection *conn,
 	g_object_unref (message);
 }
 
+static void
+check_update_batch (TrackerBusConnection *bus,
+                    GDBusMessage         *reply)
+{
+	GDBusNodeInfo *node_info;
+	GDBusInterfaceInfo *iface_info;
+	const gchar *xml;
+
+	/* Failing to introspect the endpoint is not fatal, it just
+	 * means the batch operations added in newer versions are not
+	 * used.
+	 */
+	if (g_dbus_message_get_message_type (reply) != G_DBUS_MESSAGE_TYPE_METHOD_RETURN ||
+	    !g_variant_is_of_type (g_dbus_message_get_body (reply), G_VARIANT_TYPE ("(s)")))
+		return;
+
+	g_variant_get (g_dbus_message_get_body (reply), "(&s)", &xml);
+	node_info = g_dbus_node_info_new_for_xml (xml, NULL);
+	if (!node_info)
+		return;
+
+	iface_info = g_dbus_node_info_lookup_interface (node_info, ENDPOINT_IFACE);
+
+	if (iface_info &&
+	    g_dbus_interface_info_lookup_method (iface_info, "UpdateBatch"))
+		bus->update_batch = TRUE;
+
+	g_dbus_node_info_unref (node_info);
+}
+
 static void
 ping_peer_cb (GObject      *source,
               GAsyncResult *res,
@@ -556,7 +733,14 @@ ping_peer_cb (GObject      *source,
 	reply = g_dbus_connection_send_message_with_reply_finish (G_DBUS_CONNECTION (source),
 	                                                          res, &error);
 
-	if (!reply || g_dbus_message_to_gerror (reply, &error)) {
+	/* Errors raised by the peer itself still mean it can be reached */
+	if (reply && g_dbus_message_to_gerror (reply, &error) &&
+	    (g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD) ||
+	     g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_INTERFACE) ||
+	     g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_OBJECT)))
+		g_clear_error (&error);
+
+	if (error) {
 		if (g_file_test ("/.flatpak-info", G_FILE_TEST_EXISTS)) {
 			/* We do not see the endpoint directly but this is a sandbox.
 			 * Check for portal existence.
@@ -570,6 +754,7 @@ ping_peer_cb (GObject      *source,
 			g_object_unref (task);
 		}
 	} else {
+		check_update_batch (bus, reply);
 		init_namespaces (bus, task);
 	}
 
@@ -584,10 +769,13 @@ ping_peer (TrackerBusConnection *bus,
 	if (g_getenv ("TRACKER_TEST_PORTAL_FLATPAK_INFO") == NULL) {
 		GDBusMessage *message;
 
+		/* Introspecting the endpoint checks it is reachable, and
+		 * tells the supported methods in the same round trip.
+		 */
 		message = g_dbus_message_new_method_call (bus->dbus_name,
 		                                          bus->object_path,
-		                                          DBUS_PEER_IFACE,
-		                                          "Ping");
+		                                          DBUS_INTROSPECTABLE_IFACE,
+		                                          "Introspect");
 		g_dbus_connection_send_message_with_reply (bus->dbus_conn,
 		                                           message,
 		                                           G_DBUS_SEND_MESSAGE_FLAGS_NONE,
@@ -1851,6 +2039,41 @@ tracker_bus_connection_perform_query (TrackerBusConnection  *conn,
 	return TRACKER_SPARQL_CURSOR (data.retval);
 }
 
+GVariant *
+tracker_bus_connection_perform_explain (TrackerBusConnection  *conn,
+					const gchar           *sparql,
+					GVariant              *arguments,
+					TrackerExplainFlags    flags,
+					GCancellable          *cancellable,
+					GError               **error)
+{
+	GDBusMessage *message, *reply;
+	GVariant *result = NULL;
+	GError *inner_error = NULL;
+
+	message = create_explain_message (conn, sparql, arguments, flags);
+	reply = g_dbus_connection_send_message_with_reply_sync (conn->dbus_conn,
+								message,
+								G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+								G_MAXINT,
+								NULL,
+								cancellable,
+								&inner_error);
+	g_object_unref (message);
+
+	if (reply && !g_dbus_message_to_gerror (reply, &inner_error))
+		result = g_variant_get_child_value (g_dbus_message_get_body (reply), 0);
+
+	g_clear_object (&reply);
+
+	if (inner_error) {
+		g_dbus_error_strip_remote_error (inner_error);
+		g_propagate_error (error, inner_error);
+	}
+
+	return result;
+}
+
 static void
 serialize_call_cb (GObject      *source,
 		   GAsyncResult *res,
@@ -1972,13 +2195,14 @@ tracker_bus_connection_perform_update_async (TrackerBusConnection  *self,
 	}
 
 	perform_update_async (TRACKER_BUS_CONNECTION (self),
-	                      "UpdateArray",
+	                      self->update_batch ? "UpdateBatch" : "UpdateArray",
 	                      fd_list, fd_idx,
 	                      cancellable,
 	                      update_cb,
 	                      task);
 
 	write_sparql_queries_async (ostream, ops,
+	                            self->update_batch,
 	                            cancellable, write_queries_cb,
 	                            task);
 
@@ -2004,3 +2228,9 @@ tracker_bus_connection_perform_update_finish (TrackerBusConnection  *self,
 
 	return TRUE;
 }
+
+gboolean
+tracker_bus_connection_supports_update_batch (TrackerBusConnection *conn)
+{
+	return conn->update_batch;
+}
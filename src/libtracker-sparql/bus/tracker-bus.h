@@ -27,6 +27,8 @@ typedef enum
 {
 	TRACKER_BUS_OP_SPARQL,
 	TRACKER_BUS_OP_RDF,
+	TRACKER_BUS_OP_RESOURCE,
+	TRACKER_BUS_OP_STATEMENT,
 } TrackerBusOpType;
 
 typedef struct _TrackerBusOp TrackerBusOp;
@@ -47,6 +49,11 @@ struct _TrackerBusOp
 			gchar *default_graph;
 			GInputStream *stream;
 		} rdf;
+
+		struct {
+			gchar *graph;
+			GBytes *data;
+		} resource;
 	} d;
 };
 
@@ -89,6 +96,13 @@ TrackerSparqlCursor * tracker_bus_connection_perform_query (TrackerBusConnection
 							    GCancellable          *cancellable,
 							    GError               **error);
 
+GVariant * tracker_bus_connection_perform_explain (TrackerBusConnection  *conn,
+						   const gchar           *sparql,
+						   GVariant              *arguments,
+						   TrackerExplainFlags    flags,
+						   GCancellable          *cancellable,
+						   GError               **error);
+
 void tracker_bus_connection_perform_serialize_async (TrackerBusConnection  *conn,
 						     TrackerSerializeFlags  flags,
 						     TrackerRdfFormat       format,
@@ -112,4 +126,6 @@ gboolean tracker_bus_connection_perform_update_finish (TrackerBusConnection  *se
                                                        GAsyncResult          *res,
                                                        GError               **error);
 
+gboolean tracker_bus_connection_supports_update_batch (TrackerBusConnection *conn);
+
 #endif /* __TRACKER_BUS_H__ */
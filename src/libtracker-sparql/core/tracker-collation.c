@@ -91,6 +91,59 @@ check_remove_prefix (const gchar  *str,
 	return TRUE;
 }
 
+static const gchar * const *
+get_title_beginnings (void)
+{
+	static gchar **title_beginnings = NULL;
+
+	if (g_once_init_enter (&title_beginnings)) {
+		const gchar *title_beginnings_str;
+		gchar **beginnings;
+		gint i;
+
+		/* Translators: this is a '|' (U+007C) separated list of common
+		 * title beginnings. Meant to be skipped for sorting purposes,
+		 * case doesn't matter. Given English media is quite common, it is
+		 * advised to leave the untranslated articles in addition to
+		 * the translated ones.
+		 */
+		title_beginnings_str = N_("the|a|an");
+
+		beginnings = g_strsplit (_(title_beginnings_str), "|", -1);
+
+		/* Casefold these once, instead of on every comparison */
+		for (i = 0; beginnings[i]; i++) {
+			gchar *prefix = beginnings[i];
+
+			beginnings[i] = g_utf8_casefold (prefix, -1);
+			g_free (prefix);
+		}
+
+		g_once_init_leave (&title_beginnings, beginnings);
+	}
+
+	return (const gchar * const *) title_beginnings;
+}
+
+static void
+skip_title_beginning (const gchar **str,
+                      gint         *len)
+{
+	const gchar * const *title_beginnings;
+	gint i;
+
+	skip_non_alphanumeric (str, len);
+	title_beginnings = get_title_beginnings ();
+
+	for (i = 0; title_beginnings[i]; i++) {
+		if (check_remove_prefix (*str, *len,
+		                         title_beginnings[i],
+		                         strlen (title_beginnings[i]),
+		                         str, len))
+			break;
+	}
+}
+
 /* Helper function valid for all implementations */
 gint
 tracker_collation_utf8_title (gpointer      collator,
@@ -99,45 +152,19 @@ tracker_collation_utf8_title (gpointer      collator,
                               gint          len2,
                               gconstpointer str2)
 {
-	const gchar *title_beginnings_str;
-	static gchar **title_beginnings = NULL;
-	const gchar *res1 = NULL, *res2 = NULL;
-	gint i;
-
-	skip_non_alphanumeric ((const gchar **) &str1, &len1);
-	skip_non_alphanumeric ((const gchar **) &str2, &len2);
+	skip_title_beginning ((const gchar **) &str1, &len1);
+	skip_title_beginning ((const gchar **) &str2, &len2);
 
-	/* Translators: this is a '|' (U+007C) separated list of common
-	 * title beginnings. Meant to be skipped for sorting purposes,
-	 * case doesn't matter. Given English media is quite common, it is
-	 * advised to leave the untranslated articles in addition to
-	 * the translated ones.
-	 */
-	title_beginnings_str = N_("the|a|an");
-
-	if (!title_beginnings)
-		title_beginnings = g_strsplit (_(title_beginnings_str), "|", -1);
-
-	for (i = 0; title_beginnings[i]; i++) {
-		gchar *prefix;
-		gint prefix_len;
-
-		prefix = g_utf8_casefold (title_beginnings[i], -1);
-		prefix_len = strlen (prefix);
-
-		if (!res1)
-			check_remove_prefix (str1, len1, prefix, prefix_len,
-			                     &res1, &len1);
-		if (!res2)
-			check_remove_prefix (str2, len2, prefix, prefix_len,
-			                     &res2, &len2);
-		g_free (prefix);
-	}
+	return tracker_collation_utf8 (collator, len1, str1, len2, str2);
+}
 
-	if (!res1)
-		res1 = str1;
-	if (!res2)
-		res2 = str2;
+guint8 *
+tracker_collation_get_title_sort_key (gpointer      collator,
+                                      gint          len,
+                                      gconstpointer str,
+                                      gsize        *key_len)
+{
+	skip_title_beginning ((const gchar **) &str, &len);
 
-	return tracker_collation_utf8 (collator, len1, res1, len2, res2);
+	return tracker_collation_get_sort_key (collator, len, str, key_len);
 }
@@ -30,6 +30,11 @@ gint     tracker_collation_utf8_title (gpointer      collator,
                                        gint          len2,
                                        gconstpointer str2);
 
+guint8 * tracker_collation_get_title_sort_key (gpointer      collator,
+                                               gint          len,
+                                               gconstpointer str,
+                                               gsize        *key_len);
+
 #define TRACKER_COLLATION_LAST_CHAR ((gunichar) 0x10fffd)
 
 G_END_DECLS
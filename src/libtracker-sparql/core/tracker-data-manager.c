@@ -55,6 +55,12 @@
 
 #define NRL_LAST_MODIFIED           TRACKER_PREFIX_NRL "lastModified"
 
+/* Empty graph database, copied on graph creation */
+#define GRAPH_TEMPLATE_NAME ".graph-template"
+
+/* How often readonly connections reload table statistics */
+#define TABLE_ROWS_REFRESH_INTERVAL (5 * G_USEC_PER_SEC)
+
 struct _TrackerDataManager {
 	GObject parent_instance;
 
@@ -64,6 +70,8 @@ struct _TrackerDataManager {
 	guint flags;
 
 	gint select_cache_size;
+	/* Database tuning options, a{sv} */
+	GVariant *options;
 	guint generation;
 
 	TrackerDBManager *db_manager;
@@ -72,7 +80,29 @@ struct _TrackerDataManager {
 
 	GHashTable *transaction_graphs;
 	GHashTable *graphs;
+	/* Graph name -> set of tables created in that graph */
+	GHashTable *transaction_graph_tables;
+	GHashTable *graph_tables;
+	/* Graph name -> last seen PRAGMA schema_version */
+	GHashTable *graph_schema_versions;
+	/* Bumped whenever the graph tables change */
+	guint graph_tables_serial;
+	/* Graph name -> table name -> row count, for class and
+	 * multi-valued property tables. Kept up to date by the writer,
+	 * and periodically reloaded by readonly connections.
+	 */
+	GHashTable *table_rows;
+	/* Graph name -> TableRowsChange, for the current transaction */
+	GHashTable *transaction_table_rows;
+	gint64 table_rows_timestamp;
 	GMutex graphs_lock;
+	guint update_graph_template : 1;
+
+	/* Set while ontology changes are applied to shadow copies of
+	 * the graph databases, holds the properties whose indexes need
+	 * fixing there.
+	 */
+	GHashTable *shadow_index_fixes;
 
 	/* Cached remote connections */
 	GMutex connections_lock;
@@ -83,6 +113,13 @@ struct _TrackerDataManagerClass {
 	GObjectClass parent_instance;
 };
 
+enum {
+	MIGRATION_PROGRESS,
+	N_SIGNALS
+};
+
+static guint signals[N_SIGNALS] = { 0 };
+
 typedef struct {
 	const gchar *from;
 	const gchar *to;
@@ -120,6 +157,7 @@ static gboolean tracker_data_manager_update_fts (TrackerDataManager  *manager,
                                                  TrackerDBInterface  *iface,
                                                  const gchar         *database,
                                                  GError             **error);
+static gint get_main_schema_version (TrackerDBInterface *iface);
 
 static void tracker_data_manager_initable_iface_init (GInitableIface *iface);
 
@@ -750,15 +788,14 @@ ensure_inverse_functional_property (TrackerDataManager  *manager,
 
 static void
 fix_indexed_on_db (TrackerDataManager  *manager,
+                   TrackerDBInterface  *iface,
                    const gchar         *database,
                    TrackerProperty     *property,
                    GError             **error)
 {
 	GError *internal_error = NULL;
-	TrackerDBInterface *iface;
 	TrackerClass *class;
 
-	iface = tracker_db_manager_get_writable_db_interface (manager->db_manager);
 	class = tracker_property_get_domain (property);
 
 	if (tracker_property_get_multiple_values (property)) {
@@ -804,14 +841,24 @@ fix_indexed (TrackerDataManager  *manager,
 {
 	GHashTable *graphs;
 	GHashTableIter iter;
+	TrackerDBInterface *iface;
 	GError *internal_error = NULL;
 	gpointer value;
 
+	if (manager->shadow_index_fixes) {
+		/* Graphs are being migrated in shadow databases, the
+		 * indexes are fixed there before those are swapped in.
+		 */
+		g_hash_table_add (manager->shadow_index_fixes, g_object_ref (property));
+		return;
+	}
+
+	iface = tracker_db_manager_get_writable_db_interface (manager->db_manager);
 	graphs = tracker_data_manager_get_graphs (manager, FALSE);
 	g_hash_table_iter_init (&iter, graphs);
 
 	while (g_hash_table_iter_next (&iter, &value, NULL)) {
-		fix_indexed_on_db (manager, value, property, &internal_error);
+		fix_indexed_on_db (manager, iface, value, property, &internal_error);
 		if (internal_error) {
 			g_propagate_error (error, internal_error);
 			break;
@@ -907,6 +954,7 @@ tracker_data_ontology_load_statement (TrackerDataManager  *manager,
 					tracker_property_set_is_inverse_functional_property (property, FALSE);
 					tracker_property_set_multiple_values (property, TRUE);
 					tracker_property_set_fulltext_indexed (property, FALSE);
+					tracker_property_set_closure_indexed (property, FALSE);
 					tracker_property_set_ontology_path (property, ontology_path);
 					tracker_property_set_definition_line_no (property, object_line_no);
 					tracker_property_set_definition_column_no (property, object_column_no);
@@ -1407,6 +1455,22 @@ tracker_data_ontology_load_statement (TrackerDataManager  *manager,
 
 		tracker_property_set_fulltext_indexed (property,
 		                                       strcmp (object, "true") == 0);
+	} else if (g_strcmp0 (predicate, TRACKER_PREFIX_NRL "closureIndexed") == 0) {
+		TrackerProperty *property;
+
+		property = tracker_ontologies_get_property_by_uri (manager->ontologies, subject);
+		if (property == NULL) {
+			print_parsing_err ("%s: Unknown property %s", object_location, subject);
+			goto fail;
+		}
+
+		if (tracker_property_get_data_type (property) != TRACKER_PROPERTY_TYPE_RESOURCE) {
+			print_parsing_err ("%s: nrl:closureIndexed only applies to properties with a resource range", object_location);
+			goto fail;
+		}
+
+		tracker_property_set_closure_indexed (property,
+		                                      strcmp (object, "true") == 0);
 	} else if (g_strcmp0 (predicate, TRACKER_PREFIX_NRL "weight") == 0) {
 		TrackerProperty *property;
 
@@ -2012,6 +2076,22 @@ tracker_data_ontology_process_changes_post_db (TrackerDataManager  *manager,
 				g_propagate_error (error, n_error);
 				return;
 			}
+
+			/* Closure tables are reconciled with the ontology after
+			 * all changes are applied, see update_closure_tables().
+			 */
+			update_property_value (manager,
+			                       "nrl:closureIndexed",
+			                       subject,
+			                       TRACKER_PREFIX_NRL "closureIndexed",
+			                       tracker_property_get_closure_indexed (property) ?
+			                       "true" : NULL,
+			                       NULL, NULL, property, &n_error);
+
+			if (n_error) {
+				g_propagate_error (error, n_error);
+				return;
+			}
 		}
 	}
 }
@@ -2304,7 +2384,8 @@ tracker_data_ontology_process_statement (TrackerDataManager *manager,
 	           g_strcmp0 (predicate, RDFS_RANGE) == 0                    ||
 	           /* g_strcmp0 (predicate, NRL_MAX_CARDINALITY) == 0        || */
 	           g_strcmp0 (predicate, TRACKER_PREFIX_NRL "indexed") == 0      ||
-	           g_strcmp0 (predicate, TRACKER_PREFIX_NRL "fulltextIndexed") == 0) {
+	           g_strcmp0 (predicate, TRACKER_PREFIX_NRL "fulltextIndexed") == 0 ||
+	           g_strcmp0 (predicate, TRACKER_PREFIX_NRL "closureIndexed") == 0) {
 		TrackerProperty *prop;
 
 		prop = tracker_ontologies_get_property_by_uri (manager->ontologies, subject);
@@ -2805,6 +2886,33 @@ db_get_static_data (TrackerDBInterface  *iface,
 		cursor = NULL;
 	}
 
+	if (!internal_error) {
+		/* Databases created before nrl:closureIndexed existed do
+		 * not have this column until the ontology is updated.
+		 */
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, NULL,
+		                                              "SELECT (SELECT Uri FROM Resource WHERE ID = \"rdf:Property\".ID) "
+		                                              "FROM \"rdf:Property\" WHERE \"nrl:closureIndexed\" = 1");
+		if (stmt) {
+			cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, &internal_error));
+			g_object_unref (stmt);
+		}
+
+		if (cursor) {
+			while (tracker_sparql_cursor_next (cursor, NULL, &internal_error)) {
+				TrackerProperty *property;
+
+				property = tracker_ontologies_get_property_by_uri (manager->ontologies,
+				                                                   tracker_sparql_cursor_get_string (cursor, 0, NULL));
+				if (property)
+					tracker_property_set_closure_indexed (property, TRUE);
+			}
+
+			g_object_unref (cursor);
+			cursor = NULL;
+		}
+	}
+
 	/* Now that the properties are loaded we can do this foreach class */
 	classes = tracker_ontologies_get_classes (manager->ontologies, &n_classes);
 	for (i = 0; i < n_classes; i++) {
@@ -3294,40 +3402,6 @@ create_decomposed_metadata_tables (TrackerDataManager  *manager,
 		}
 	}
 
-	/* create index for single-valued fields */
-	for (field_it = class_properties; field_it != NULL; field_it = field_it->next) {
-		TrackerProperty *field, *secondary_index;
-		gboolean is_domain_index;
-
-		field = field_it->data;
-
-		/* This is implicit for all domain-specific-indices */
-		is_domain_index = is_a_domain_index (domain_indexes, field);
-
-		if (!tracker_property_get_multiple_values (field)
-		    && (tracker_property_get_indexed (field) || is_domain_index)) {
-
-			secondary_index = tracker_property_get_secondary_index (field);
-			if (secondary_index == NULL) {
-				set_index_for_single_value_property (iface, database, service,
-				                                     field, TRUE,
-				                                     &internal_error);
-				if (internal_error) {
-					g_propagate_error (error, internal_error);
-					goto error_out;
-				}
-			} else {
-				set_secondary_index_for_single_value_property (iface, database, service, field,
-				                                               secondary_index,
-				                                               TRUE, &internal_error);
-				if (internal_error) {
-					g_propagate_error (error, internal_error);
-					goto error_out;
-				}
-			}
-		}
-	}
-
 	if (!tracker_class_get_is_new (service) && in_change && sel_col_sql && in_col_sql) {
 		guint i;
 		gchar *query;
@@ -3411,7 +3485,44 @@ create_decomposed_metadata_tables (TrackerDataManager  *manager,
 
 			if (internal_error) {
 				g_propagate_error (error, internal_error);
-				break;
+				goto error_out;
+			}
+		}
+	}
+
+	/* create index for single-valued fields, this happens after the
+	 * table got populated, as building indexes in one go is much cheaper
+	 * than updating them row by row.
+	 */
+	for (field_it = class_properties; field_it != NULL; field_it = field_it->next) {
+		TrackerProperty *field, *secondary_index;
+		gboolean is_domain_index;
+
+		field = field_it->data;
+
+		/* This is implicit for all domain-specific-indices */
+		is_domain_index = is_a_domain_index (domain_indexes, field);
+
+		if (!tracker_property_get_multiple_values (field)
+		    && (tracker_property_get_indexed (field) || is_domain_index)) {
+
+			secondary_index = tracker_property_get_secondary_index (field);
+			if (secondary_index == NULL) {
+				set_index_for_single_value_property (iface, database, service,
+				                                     field, TRUE,
+				                                     &internal_error);
+				if (internal_error) {
+					g_propagate_error (error, internal_error);
+					goto error_out;
+				}
+			} else {
+				set_secondary_index_for_single_value_property (iface, database, service, field,
+				                                               secondary_index,
+				                                               TRUE, &internal_error);
+				if (internal_error) {
+					g_propagate_error (error, internal_error);
+					goto error_out;
+				}
 			}
 		}
 	}
@@ -3460,6 +3571,28 @@ tracker_data_ontology_import_finished (TrackerDataManager *manager)
 	}
 }
 
+static gboolean
+create_table_stats (TrackerDBInterface  *iface,
+                    GError             **error)
+{
+	GError *internal_error = NULL;
+
+	/* Row counts of the class and multi-valued property tables
+	 * in every graph, used to order joins in queries.
+	 */
+	tracker_db_interface_execute_query (iface, &internal_error,
+	                                    "CREATE TABLE TableStats (Graph TEXT NOT NULL,"
+	                                    " Name TEXT NOT NULL, Rows INTEGER NOT NULL,"
+	                                    " PRIMARY KEY (Graph, Name)) WITHOUT ROWID");
+
+	if (internal_error) {
+		g_propagate_error (error, internal_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static gboolean
 create_base_tables (TrackerDataManager  *manager,
                     TrackerDBInterface  *iface,
@@ -3467,9 +3600,35 @@ create_base_tables (TrackerDataManager  *manager,
 {
 	GError *internal_error = NULL;
 
-	tracker_db_interface_execute_query (iface, &internal_error,
-	                                    "CREATE TABLE Resource (ID INTEGER NOT NULL PRIMARY KEY,"
-	                                    " Uri TEXT, BlankNode INTEGER DEFAULT 0, UNIQUE (Uri))");
+	if ((tracker_db_manager_get_flags (manager->db_manager) & TRACKER_DB_MANAGER_COMPRESS_URIS) != 0) {
+		/* URIs are split in a prefix from a shared dictionary, and
+		 * a suffix. The tracker_resource virtual table puts them
+		 * back together behind the usual Resource columns.
+		 */
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "CREATE TABLE ResourcePrefix (ID INTEGER NOT NULL PRIMARY KEY,"
+		                                    " Prefix TEXT NOT NULL, UNIQUE (Prefix))");
+		if (internal_error) {
+			g_propagate_error (error, internal_error);
+			return FALSE;
+		}
+
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "CREATE TABLE ResourceData (ID INTEGER NOT NULL PRIMARY KEY,"
+		                                    " Prefix INTEGER, Suffix TEXT, BlankNode INTEGER DEFAULT 0,"
+		                                    " UNIQUE (Suffix, Prefix))");
+		if (internal_error) {
+			g_propagate_error (error, internal_error);
+			return FALSE;
+		}
+
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "CREATE VIRTUAL TABLE Resource USING tracker_resource");
+	} else {
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "CREATE TABLE Resource (ID INTEGER NOT NULL PRIMARY KEY,"
+		                                    " Uri TEXT, BlankNode INTEGER DEFAULT 0, UNIQUE (Uri))");
+	}
 
 	if (internal_error) {
 		g_propagate_error (error, internal_error);
@@ -3492,7 +3651,66 @@ create_base_tables (TrackerDataManager  *manager,
 		return FALSE;
 	}
 
-	return TRUE;
+	return create_table_stats (iface, error);
+}
+
+static GHashTable *
+query_graph_tables (TrackerDBInterface  *iface,
+                    const gchar         *database,
+                    GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor;
+	GHashTable *tables;
+
+	stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, error,
+	                                               "SELECT name FROM \"%s\".sqlite_master "
+	                                               "WHERE type = 'table'",
+	                                               database);
+	if (!stmt)
+		return NULL;
+
+	cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, error));
+	g_object_unref (stmt);
+
+	if (!cursor)
+		return NULL;
+
+	tables = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+		g_hash_table_add (tables,
+		                  g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL)));
+	}
+
+	g_object_unref (cursor);
+
+	return tables;
+}
+
+static gboolean
+class_is_resident (TrackerDataManager *manager,
+                   TrackerClass       *class)
+{
+	TrackerProperty **properties;
+	guint i, n_props;
+
+	/* rdfs:Resource holds rdf:type, and the FTS view joins the
+	 * tables of all fulltext-indexed properties. These tables must
+	 * exist in every graph.
+	 */
+	if (g_strcmp0 (tracker_class_get_uri (class), TRACKER_PREFIX_RDFS "Resource") == 0)
+		return TRUE;
+
+	properties = tracker_ontologies_get_properties (manager->ontologies, &n_props);
+
+	for (i = 0; i < n_props; i++) {
+		if (tracker_property_get_fulltext_indexed (properties[i]) &&
+		    tracker_property_get_domain (properties[i]) == class)
+			return TRUE;
+	}
+
+	return FALSE;
 }
 
 static gboolean
@@ -3503,6 +3721,7 @@ tracker_data_ontology_setup_db (TrackerDataManager  *manager,
                                 GError             **error)
 {
 	GError *internal_error = NULL;
+	GHashTable *existing = NULL;
 	TrackerClass **classes;
 	guint i, n_classes;
 
@@ -3517,114 +3736,369 @@ tracker_data_ontology_setup_db (TrackerDataManager  *manager,
 		return FALSE;
 	}
 
+	/* Named graphs are created with the resident tables only, the
+	 * rest are created on first write to the graph, see
+	 * tracker_data_manager_ensure_graph_table().
+	 */
+	if (strcmp (database, "main") != 0) {
+		existing = query_graph_tables (iface, database, error);
+		if (!existing)
+			return FALSE;
+	}
+
 	classes = tracker_ontologies_get_classes (manager->ontologies, &n_classes);
 
 	/* create tables */
 	for (i = 0; i < n_classes; i++) {
+		gboolean class_in_update = in_update;
+
+		if (existing &&
+		    !g_hash_table_contains (existing, tracker_class_get_name (classes[i]))) {
+			if (!class_is_resident (manager, classes[i]))
+				continue;
+
+			class_in_update = FALSE;
+		}
+
 		/* Also !is_new classes are processed, they might have new properties */
-		create_decomposed_metadata_tables (manager, iface, database, classes[i], in_update,
+		create_decomposed_metadata_tables (manager, iface, database, classes[i], class_in_update,
 		                                   &internal_error);
 
 		if (internal_error) {
+			g_clear_pointer (&existing, g_hash_table_unref);
 			g_propagate_error (error, internal_error);
 			return FALSE;
 		}
 	}
 
+	g_clear_pointer (&existing, g_hash_table_unref);
+
 	return TRUE;
 }
 
-static gint
-compare_file_names (GFile *file_a,
-                    GFile *file_b)
+static GHashTable *
+load_graph_tables (TrackerDataManager  *manager,
+                   TrackerDBInterface  *iface,
+                   GError             **error)
 {
-	gchar *name_a, *name_b;
-	gint return_val;
-
-	name_a = g_file_get_basename (file_a);
-	name_b = g_file_get_basename (file_b);
-	return_val = strcmp (name_a, name_b);
-
-	g_free (name_a);
-	g_free (name_b);
-
-	return return_val;
-}
+	GHashTable *graph_tables;
+	GHashTableIter iter;
+	gpointer graph;
 
-static GList*
-get_ontologies (TrackerDataManager  *manager,
-                GFile               *ontologies,
-                GError             **error)
-{
-	GFileEnumerator *enumerator;
-	GList *sorted = NULL;
+	graph_tables = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                      (GDestroyNotify) g_hash_table_unref);
 
-	enumerator = g_file_enumerate_children (ontologies,
-	                                        G_FILE_ATTRIBUTE_STANDARD_NAME,
-	                                        G_FILE_QUERY_INFO_NONE,
-	                                        NULL, error);
-	if (!enumerator)
-		return NULL;
+	g_hash_table_iter_init (&iter, manager->graphs);
 
-	while (TRUE) {
-		GFileInfo *info;
-		GFile *child;
-		const gchar *name;
+	while (g_hash_table_iter_next (&iter, &graph, NULL)) {
+		GHashTable *tables;
 
-		if (!g_file_enumerator_iterate (enumerator, &info, &child, NULL, error)) {
-			g_list_free_full (sorted, g_object_unref);
-			g_object_unref (enumerator);
+		tables = query_graph_tables (iface, graph, error);
+		if (!tables) {
+			g_hash_table_unref (graph_tables);
 			return NULL;
 		}
 
-		if (!info)
-			break;
-
-		name = g_file_info_get_name (info);
-		if (g_str_has_suffix (name, ".ontology"))
-			sorted = g_list_prepend (sorted, g_object_ref (child));
+		g_hash_table_insert (graph_tables, g_strdup (graph), tables);
 	}
 
-	sorted = g_list_sort (sorted, (GCompareFunc) compare_file_names);
+	return graph_tables;
+}
 
-	/* Add our builtin ontologies so they are loaded first */
-	sorted = g_list_prepend (sorted, g_file_new_for_uri ("resource://org/freedesktop/tracker/ontology/20-dc.ontology"));
-	sorted = g_list_prepend (sorted, g_file_new_for_uri ("resource://org/freedesktop/tracker/ontology/12-nrl.ontology"));
-	sorted = g_list_prepend (sorted, g_file_new_for_uri ("resource://org/freedesktop/tracker/ontology/11-rdf.ontology"));
-	sorted = g_list_prepend (sorted, g_file_new_for_uri ("resource://org/freedesktop/tracker/ontology/10-xsd.ontology"));
+static gboolean
+tracker_data_manager_initialize_graph_tables (TrackerDataManager  *manager,
+                                              TrackerDBInterface  *iface,
+                                              GError             **error)
+{
+	GHashTable *graph_tables;
+
+	graph_tables = load_graph_tables (manager, iface, error);
+	if (!graph_tables)
+		return FALSE;
+
+	g_mutex_lock (&manager->graphs_lock);
+	g_clear_pointer (&manager->graph_tables, g_hash_table_unref);
+	manager->graph_tables = graph_tables;
+	g_mutex_unlock (&manager->graphs_lock);
+
+	return TRUE;
+}
+
+static GHashTable *
+copy_graph_tables (GHashTable *graph_tables)
+{
+	GHashTable *copy;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	copy = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                              (GDestroyNotify) g_hash_table_unref);
+
+	if (!graph_tables)
+		return copy;
+
+	/* Table sets are not modified once added, share them */
+	g_hash_table_iter_init (&iter, graph_tables);
+
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_hash_table_insert (copy, g_strdup (key), g_hash_table_ref (value));
+
+	return copy;
+}
+
+static gboolean
+update_transaction_graph_tables (TrackerDataManager  *manager,
+                                 TrackerDBInterface  *iface,
+                                 const gchar         *graph,
+                                 GError             **error)
+{
+	GHashTable *tables;
+
+	tables = query_graph_tables (iface, graph, error);
+	if (!tables)
+		return FALSE;
+
+	g_mutex_lock (&manager->graphs_lock);
+
+	if (!manager->transaction_graph_tables)
+		manager->transaction_graph_tables = copy_graph_tables (manager->graph_tables);
+
+	g_hash_table_insert (manager->transaction_graph_tables,
+	                     g_strdup (graph), tables);
+	manager->graph_tables_serial++;
+
+	g_mutex_unlock (&manager->graphs_lock);
+
+	return TRUE;
+}
+
+static gint
+compare_file_names (GFile *file_a,
+                    GFile *file_b)
+{
+	gchar *name_a, *name_b;
+	gint return_val;
+
+	name_a = g_file_get_basename (file_a);
+	name_b = g_file_get_basename (file_b);
+	return_val = strcmp (name_a, name_b);
+
+	g_free (name_a);
+	g_free (name_b);
+
+	return return_val;
+}
+
+static GList*
+get_ontologies (TrackerDataManager  *manager,
+                GFile               *ontologies,
+                GError             **error)
+{
+	GFileEnumerator *enumerator;
+	GList *sorted = NULL;
+
+	enumerator = g_file_enumerate_children (ontologies,
+	                                        G_FILE_ATTRIBUTE_STANDARD_NAME,
+	                                        G_FILE_QUERY_INFO_NONE,
+	                                        NULL, error);
+	if (!enumerator)
+		return NULL;
+
+	while (TRUE) {
+		GFileInfo *info;
+		GFile *child;
+		const gchar *name;
+
+		if (!g_file_enumerator_iterate (enumerator, &info, &child, NULL, error)) {
+			g_list_free_full (sorted, g_object_unref);
+			g_object_unref (enumerator);
+			return NULL;
+		}
+
+		if (!info)
+			break;
+
+		name = g_file_info_get_name (info);
+		if (g_str_has_suffix (name, ".ontology"))
+			sorted = g_list_prepend (sorted, g_object_ref (child));
+	}
+
+	sorted = g_list_sort (sorted, (GCompareFunc) compare_file_names);
+
+	/* Add our builtin ontologies so they are loaded first */
+	sorted = g_list_prepend (sorted, g_file_new_for_uri ("resource://org/freedesktop/tracker/ontology/20-dc.ontology"));
+	sorted = g_list_prepend (sorted, g_file_new_for_uri ("resource://org/freedesktop/tracker/ontology/12-nrl.ontology"));
+	sorted = g_list_prepend (sorted, g_file_new_for_uri ("resource://org/freedesktop/tracker/ontology/11-rdf.ontology"));
+	sorted = g_list_prepend (sorted, g_file_new_for_uri ("resource://org/freedesktop/tracker/ontology/10-xsd.ontology"));
 
 	g_object_unref (enumerator);
 
 	return sorted;
 }
 
+typedef struct {
+	TrackerDataManager *manager;
+	TrackerProperty **properties;
+	guint n_properties;
+	guint n_databases;
+	gint n_done;
+	GMutex mutex;
+	GError *error;
+} RecreateIndexesData;
+
 static void
-tracker_data_manager_recreate_indexes (TrackerDataManager  *manager,
-                                       GError             **error)
+recreate_indexes_set_error (RecreateIndexesData *data,
+                            GError              *error)
+{
+	/* Keep the first error, further ones are likely a consequence */
+	g_mutex_lock (&data->mutex);
+	if (!data->error)
+		data->error = g_steal_pointer (&error);
+	g_mutex_unlock (&data->mutex);
+
+	g_clear_error (&error);
+}
+
+static gboolean
+recreate_indexes_failed (RecreateIndexesData *data)
+{
+	gboolean failed;
+
+	g_mutex_lock (&data->mutex);
+	failed = data->error != NULL;
+	g_mutex_unlock (&data->mutex);
+
+	return failed;
+}
+
+static void
+recreate_indexes_on_db (RecreateIndexesData *data,
+                        TrackerDBInterface  *iface,
+                        const gchar         *database)
 {
 	GError *internal_error = NULL;
-	TrackerProperty **properties;
-	guint n_properties;
 	guint i;
 
-	properties = tracker_ontologies_get_properties (manager->ontologies, &n_properties);
-	if (!properties) {
-		g_critical ("Couldn't get all properties to recreate indexes");
-		return;
-	}
+	for (i = 0; i < data->n_properties; i++) {
+		if (recreate_indexes_failed (data))
+			return;
 
-	TRACKER_NOTE (ONTOLOGY_CHANGES, g_message ("Starting index re-creation..."));
-	for (i = 0; i < n_properties; i++) {
-		fix_indexed (manager, properties [i], &internal_error);
+		fix_indexed_on_db (data->manager, iface, database,
+		                   data->properties[i], &internal_error);
 
 		if (internal_error) {
-			g_critical ("Unable to create index for %s: %s",
-			            tracker_property_get_name (properties[i]),
-			            internal_error->message);
-			g_clear_error (&internal_error);
+			g_prefix_error (&internal_error,
+			                "Unable to create index for %s in %s: ",
+			                tracker_property_get_name (data->properties[i]),
+			                database);
+			recreate_indexes_set_error (data, internal_error);
+			return;
 		}
 	}
+
+	TRACKER_NOTE (ONTOLOGY_CHANGES,
+	              g_message ("  Recreated indexes in graph %s (%d/%u)",
+	                         database,
+	                         g_atomic_int_add (&data->n_done, 1) + 1,
+	                         data->n_databases));
+}
+
+static void
+recreate_indexes_thread_func (gpointer data,
+                              gpointer user_data)
+{
+	RecreateIndexesData *recreate_data = user_data;
+	TrackerDBManager *db_manager = recreate_data->manager->db_manager;
+	TrackerDBInterface *iface;
+	const gchar *database = data;
+	GError *error = NULL;
+
+	if (recreate_indexes_failed (recreate_data))
+		return;
+
+	/* Each database is handled on its own connection, so
+	 * indexes are built in parallel across databases.
+	 */
+	iface = tracker_db_manager_create_writable_db_interface (db_manager, &error);
+
+	if (iface &&
+	    tracker_db_manager_attach_database (db_manager, iface, database,
+	                                        FALSE, &error)) {
+		recreate_indexes_on_db (recreate_data, iface, database);
+		tracker_db_manager_detach_database (db_manager, iface, database, NULL);
+	}
+
+	if (error) {
+		g_prefix_error (&error, "Unable to recreate indexes in %s: ", database);
+		recreate_indexes_set_error (recreate_data, error);
+	}
+
+	g_clear_object (&iface);
+}
+
+static gboolean
+tracker_data_manager_recreate_indexes (TrackerDataManager  *manager,
+                                       GError             **error)
+{
+	RecreateIndexesData data = { 0, };
+	TrackerDBInterface *iface;
+	GThreadPool *pool = NULL;
+	GHashTable *graphs;
+	GHashTableIter iter;
+	gpointer value;
+	guint n_threads;
+
+	data.manager = manager;
+	data.properties = tracker_ontologies_get_properties (manager->ontologies,
+	                                                     &data.n_properties);
+	if (!data.properties) {
+		g_set_error (error, TRACKER_DATA_ONTOLOGY_ERROR,
+		             TRACKER_DATA_UNSUPPORTED_ONTOLOGY_CHANGE,
+		             "Couldn't get all properties to recreate indexes");
+		return FALSE;
+	}
+
+	g_mutex_init (&data.mutex);
+
+	iface = tracker_db_manager_get_writable_db_interface (manager->db_manager);
+	graphs = tracker_data_manager_get_graphs (manager, FALSE);
+	data.n_databases = g_hash_table_size (graphs);
+	n_threads = MIN (data.n_databases, g_get_num_processors ());
+
+	/* In-memory databases are not reachable from other connections */
+	if (n_threads > 1 &&
+	    (manager->flags & TRACKER_DB_MANAGER_IN_MEMORY) == 0) {
+		pool = g_thread_pool_new (recreate_indexes_thread_func, &data,
+		                          n_threads, TRUE, NULL);
+	}
+
+	TRACKER_NOTE (ONTOLOGY_CHANGES,
+	              g_message ("Starting index re-creation in %u graphs, using %u threads...",
+	                         data.n_databases, pool ? n_threads : 1));
+
+	g_hash_table_iter_init (&iter, graphs);
+
+	while (g_hash_table_iter_next (&iter, &value, NULL)) {
+		if (pool)
+			g_thread_pool_push (pool, value, NULL);
+		else
+			recreate_indexes_on_db (&data, iface, value);
+	}
+
+	if (pool)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
 	TRACKER_NOTE (ONTOLOGY_CHANGES, g_message ("  Finished index re-creation..."));
+
+	g_hash_table_unref (graphs);
+	g_mutex_clear (&data.mutex);
+
+	if (data.error) {
+		g_propagate_error (error, data.error);
+		return FALSE;
+	}
+
+	return TRUE;
 }
 
 static gboolean
@@ -3669,74 +4143,592 @@ load_ontologies_gvdb (TrackerDataManager  *manager,
 	g_free (filename);
 }
 
-static gboolean
-tracker_data_manager_fts_changed (TrackerDataManager *manager)
+/* The ontology snapshot holds everything db_get_static_data() would
+ * otherwise query from the database, so writable connections can be
+ * opened without a query per class and property. It is only trusted
+ * if it was written for the same database version and schema, and
+ * for the same set of ontologies that are recorded in the database.
+ */
+#define ONTOLOGY_SNAPSHOT_FILENAME "ontologies.snapshot"
+#define ONTOLOGY_SNAPSHOT_VERSION 2
+#define ONTOLOGY_SNAPSHOT_TYPE "(uuisay)"
+#define ONTOLOGY_SNAPSHOT_PAYLOAD_TYPE "(a(sx)a(ss)a(xsbasas)a(xsssbbsbbbas))"
+
+static gchar *
+get_ontology_snapshot_path (TrackerDataManager *manager)
 {
-	TrackerProperty **properties;
-	gboolean has_changed = FALSE;
-	guint i, len;
+	gchar *filename;
+	GFile *child;
 
-	properties = tracker_ontologies_get_properties (manager->ontologies, &len);
+	if ((manager->flags & TRACKER_DB_MANAGER_IN_MEMORY) != 0)
+		return NULL;
+	if (!manager->cache_location)
+		return NULL;
 
-	for (i = 0; i < len; i++) {
-		TrackerClass *class;
+	child = g_file_get_child (manager->cache_location, ONTOLOGY_SNAPSHOT_FILENAME);
+	filename = g_file_get_path (child);
+	g_object_unref (child);
 
-		if (tracker_property_get_fulltext_indexed (properties[i]) !=
-		    tracker_property_get_orig_fulltext_indexed (properties[i])) {
-			has_changed |= TRUE;
-		}
+	return filename;
+}
 
-		if (!tracker_property_get_fulltext_indexed (properties[i])) {
-			continue;
-		}
+static GVariant *
+serialize_ontology_snapshot (TrackerOntologies *ontologies)
+{
+	GVariantBuilder builder, uris;
+	TrackerOntology **ontos;
+	TrackerNamespace **namespaces;
+	TrackerClass **classes;
+	TrackerProperty **properties;
+	guint n_ontos, n_namespaces, n_classes, n_properties, i, j;
 
-		has_changed |= tracker_property_get_is_new (properties[i]);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE (ONTOLOGY_SNAPSHOT_PAYLOAD_TYPE));
 
-		/* We must also regenerate FTS if any table in the view
-		 * updated its schema.
-		 */
-		class = tracker_property_get_domain (properties[i]);
-		has_changed |= tracker_class_get_db_schema_changed (class);
+	ontos = tracker_ontologies_get_ontologies (ontologies, &n_ontos);
+	g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(sx)"));
+	for (i = 0; i < n_ontos; i++) {
+		g_variant_builder_add (&builder, "(sx)",
+		                       tracker_ontology_get_uri (ontos[i]),
+		                       tracker_ontology_get_last_modified (ontos[i]));
 	}
+	g_variant_builder_close (&builder);
 
-	return has_changed;
-}
+	namespaces = tracker_ontologies_get_namespaces (ontologies, &n_namespaces);
+	g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ss)"));
+	for (i = 0; i < n_namespaces; i++) {
+		const gchar *prefix = tracker_namespace_get_prefix (namespaces[i]);
 
-static gboolean
-rebuild_fts_tokens (TrackerDataManager  *manager,
-                    TrackerDBInterface  *iface,
-                    GError             **error)
-{
-	TrackerProperty **properties;
-	GHashTableIter iter;
-	gchar *graph;
-	gboolean has_fts = FALSE;
-	guint len, i;
+		g_variant_builder_add (&builder, "(ss)",
+		                       tracker_namespace_get_uri (namespaces[i]),
+		                       prefix ? prefix : "");
+	}
+	g_variant_builder_close (&builder);
 
-	properties = tracker_ontologies_get_properties (manager->ontologies, &len);
+	classes = tracker_ontologies_get_classes (ontologies, &n_classes);
+	g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(xsbasas)"));
+	for (i = 0; i < n_classes; i++) {
+		TrackerClass **super_classes;
+		TrackerProperty **domain_indexes;
 
-	for (i = 0; i < len; i++) {
-		has_fts |= tracker_property_get_fulltext_indexed (properties[i]);
-		if (has_fts)
-			break;
-	}
+		g_variant_builder_open (&builder, G_VARIANT_TYPE ("(xsbasas)"));
+		g_variant_builder_add (&builder, "x", tracker_class_get_id (classes[i]));
+		g_variant_builder_add (&builder, "s", tracker_class_get_uri (classes[i]));
+		g_variant_builder_add (&builder, "b", tracker_class_get_notify (classes[i]));
 
-	if (has_fts) {
-		g_debug ("Rebuilding FTS tokens, this may take a moment...");
-		if (!tracker_db_interface_sqlite_fts_rebuild_tokens (iface, "main", error))
-			return FALSE;
+		g_variant_builder_init (&uris, G_VARIANT_TYPE_STRING_ARRAY);
+		super_classes = tracker_class_get_super_classes (classes[i]);
+		for (j = 0; super_classes && super_classes[j]; j++)
+			g_variant_builder_add (&uris, "s", tracker_class_get_uri (super_classes[j]));
+		g_variant_builder_add_value (&builder, g_variant_builder_end (&uris));
 
-		g_hash_table_iter_init (&iter, manager->graphs);
-		while (g_hash_table_iter_next (&iter, (gpointer*) &graph, NULL)) {
-			if (!tracker_db_interface_sqlite_fts_rebuild_tokens (iface, graph, error))
-				return FALSE;
-		}
+		g_variant_builder_init (&uris, G_VARIANT_TYPE_STRING_ARRAY);
+		domain_indexes = tracker_class_get_domain_indexes (classes[i]);
+		for (j = 0; domain_indexes && domain_indexes[j]; j++)
+			g_variant_builder_add (&uris, "s", tracker_property_get_uri (domain_indexes[j]));
+		g_variant_builder_add_value (&builder, g_variant_builder_end (&uris));
 
-		g_debug ("FTS tokens rebuilt");
+		g_variant_builder_close (&builder);
 	}
+	g_variant_builder_close (&builder);
 
-	/* Update the stamp file */
-	tracker_db_manager_tokenizer_update (manager->db_manager);
+	properties = tracker_ontologies_get_properties (ontologies, &n_properties);
+	g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(xsssbbsbbbas)"));
+	for (i = 0; i < n_properties; i++) {
+		TrackerClass *domain, *range;
+		TrackerProperty *secondary_index;
+		TrackerProperty **super_properties;
+
+		domain = tracker_property_get_domain (properties[i]);
+		range = tracker_property_get_range (properties[i]);
+		secondary_index = tracker_property_get_secondary_index (properties[i]);
+
+		g_variant_builder_open (&builder, G_VARIANT_TYPE ("(xsssbbsbbbas)"));
+		g_variant_builder_add (&builder, "x", tracker_property_get_id (properties[i]));
+		g_variant_builder_add (&builder, "s", tracker_property_get_uri (properties[i]));
+		g_variant_builder_add (&builder, "s", domain ? tracker_class_get_uri (domain) : "");
+		g_variant_builder_add (&builder, "s", range ? tracker_class_get_uri (range) : "");
+		g_variant_builder_add (&builder, "b", tracker_property_get_multiple_values (properties[i]));
+		g_variant_builder_add (&builder, "b", tracker_property_get_indexed (properties[i]));
+		g_variant_builder_add (&builder, "s", secondary_index ? tracker_property_get_uri (secondary_index) : "");
+		g_variant_builder_add (&builder, "b", tracker_property_get_fulltext_indexed (properties[i]));
+		g_variant_builder_add (&builder, "b", tracker_property_get_is_inverse_functional_property (properties[i]));
+		g_variant_builder_add (&builder, "b", tracker_property_get_closure_indexed (properties[i]));
+
+		g_variant_builder_init (&uris, G_VARIANT_TYPE_STRING_ARRAY);
+		super_properties = tracker_property_get_super_properties (properties[i]);
+		for (j = 0; super_properties && super_properties[j]; j++)
+			g_variant_builder_add (&uris, "s", tracker_property_get_uri (super_properties[j]));
+		g_variant_builder_add_value (&builder, g_variant_builder_end (&uris));
+
+		g_variant_builder_close (&builder);
+	}
+	g_variant_builder_close (&builder);
+
+	return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static gboolean
+write_ontology_snapshot (TrackerDataManager  *manager,
+                         TrackerDBInterface  *iface,
+                         GError             **error)
+{
+	GVariant *payload, *snapshot;
+	gchar *filename, *checksum;
+	gboolean retval;
+
+	filename = get_ontology_snapshot_path (manager);
+	if (!filename)
+		return TRUE;
+
+	payload = serialize_ontology_snapshot (manager->ontologies);
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+	                                        g_variant_get_data (payload),
+	                                        g_variant_get_size (payload));
+
+	snapshot = g_variant_new ("(uuis@ay)",
+	                          ONTOLOGY_SNAPSHOT_VERSION,
+	                          TRACKER_DB_VERSION_NOW,
+	                          get_main_schema_version (iface),
+	                          checksum,
+	                          g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+	                                                     g_variant_get_data (payload),
+	                                                     g_variant_get_size (payload),
+	                                                     sizeof (guchar)));
+	g_variant_ref_sink (snapshot);
+
+	retval = g_file_set_contents (filename,
+	                              g_variant_get_data (snapshot),
+	                              g_variant_get_size (snapshot),
+	                              error);
+	g_variant_unref (snapshot);
+	g_variant_unref (payload);
+	g_free (checksum);
+	g_free (filename);
+
+	return retval;
+}
+
+static gboolean
+check_ontology_snapshot_ontologies (TrackerDBInterface  *iface,
+                                    GVariantIter        *ontos,
+                                    GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor = NULL;
+	GHashTable *ontos_table;
+	const gchar *uri;
+	gint64 last_mod;
+	gboolean matches = TRUE;
+	GError *internal_error = NULL;
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &internal_error,
+	                                              "SELECT Resource.Uri, \"nrl:Ontology\".\"nrl:lastModified\" FROM \"nrl:Ontology\" "
+	                                              "INNER JOIN Resource ON Resource.ID = \"nrl:Ontology\".ID ");
+
+	if (stmt) {
+		cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, &internal_error));
+		g_object_unref (stmt);
+	}
+
+	ontos_table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	if (cursor) {
+		while (tracker_sparql_cursor_next (cursor, NULL, &internal_error)) {
+			const gchar *onto_uri = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+			gint value = tracker_sparql_cursor_get_integer (cursor, 1);
+
+			g_hash_table_insert (ontos_table, g_strdup (onto_uri),
+			                     GINT_TO_POINTER (value));
+		}
+
+		g_object_unref (cursor);
+	}
+
+	if (internal_error) {
+		g_hash_table_unref (ontos_table);
+		g_propagate_error (error, internal_error);
+		return FALSE;
+	}
+
+	if (g_variant_iter_n_children (ontos) != g_hash_table_size (ontos_table))
+		matches = FALSE;
+
+	while (matches && g_variant_iter_next (ontos, "(&sx)", &uri, &last_mod)) {
+		gpointer value;
+
+		/* Stored as an int in the database, see the ontology
+		 * update checks in tracker_data_manager_initable_init().
+		 */
+		if (!g_hash_table_lookup_extended (ontos_table, uri, NULL, &value) ||
+		    GPOINTER_TO_INT (value) != (gint) last_mod)
+			matches = FALSE;
+	}
+
+	g_hash_table_unref (ontos_table);
+
+	if (!matches) {
+		g_set_error (error,
+		             TRACKER_DATA_ONTOLOGY_ERROR,
+		             TRACKER_DATA_UNSUPPORTED_ONTOLOGY_CHANGE,
+		             "Ontology snapshot is out of date");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static TrackerOntologies *
+deserialize_ontology_snapshot (GVariant  *payload,
+                               GError   **error)
+{
+	TrackerOntologies *ontologies;
+	GVariantIter *ontos, *namespaces, *classes, *properties, *uris = NULL;
+	const gchar *uri, *prefix, *domain_uri, *range_uri, *secondary_index_uri, *link_uri;
+	gboolean notify, multi_valued, indexed, fulltext_indexed, inverse_functional;
+	gboolean closure_indexed;
+	gint64 last_mod;
+	TrackerRowid id;
+
+	ontologies = tracker_ontologies_new ();
+	g_variant_get (payload, ONTOLOGY_SNAPSHOT_PAYLOAD_TYPE,
+	               &ontos, &namespaces, &classes, &properties);
+
+	while (g_variant_iter_next (ontos, "(&sx)", &uri, &last_mod)) {
+		TrackerOntology *ontology;
+
+		ontology = tracker_ontology_new ();
+		tracker_ontology_set_ontologies (ontology, ontologies);
+		tracker_ontology_set_is_new (ontology, FALSE);
+		tracker_ontology_set_uri (ontology, uri);
+		tracker_ontology_set_last_modified (ontology, last_mod);
+		tracker_ontologies_add_ontology (ontologies, ontology);
+		g_object_unref (ontology);
+	}
+
+	while (g_variant_iter_next (namespaces, "(&s&s)", &uri, &prefix)) {
+		TrackerNamespace *namespace;
+
+		namespace = tracker_namespace_new (FALSE);
+		tracker_namespace_set_ontologies (namespace, ontologies);
+		tracker_namespace_set_is_new (namespace, FALSE);
+		tracker_namespace_set_uri (namespace, uri);
+		if (*prefix)
+			tracker_namespace_set_prefix (namespace, prefix);
+		tracker_ontologies_add_namespace (ontologies, namespace);
+		g_object_unref (namespace);
+	}
+
+	/* Classes and properties are created first, and linked to each
+	 * other by URI in a second pass once all of them exist.
+	 */
+	while (g_variant_iter_next (classes, "(x&sbasas)", &id, &uri, &notify, NULL, NULL)) {
+		TrackerClass *class;
+
+		class = tracker_class_new (FALSE);
+		tracker_class_set_ontologies (class, ontologies);
+		tracker_class_set_db_schema_changed (class, FALSE);
+		tracker_class_set_is_new (class, FALSE);
+		tracker_class_set_uri (class, uri);
+		tracker_class_set_notify (class, notify);
+		tracker_ontologies_add_class (ontologies, class);
+		tracker_ontologies_add_id_uri_pair (ontologies, id, uri);
+		tracker_class_set_id (class, id);
+		g_object_unref (class);
+	}
+
+	while (g_variant_iter_next (properties, "(x&s&s&sbb&sbbbas)",
+	                            &id, &uri, &domain_uri, &range_uri,
+	                            &multi_valued, &indexed, NULL,
+	                            &fulltext_indexed, &inverse_functional,
+	                            &closure_indexed, NULL)) {
+		TrackerProperty *property;
+
+		property = tracker_property_new (FALSE);
+		tracker_property_set_ontologies (property, ontologies);
+		tracker_property_set_is_new (property, FALSE);
+		tracker_property_set_cardinality_changed (property, FALSE);
+		tracker_property_set_uri (property, uri);
+		tracker_property_set_id (property, id);
+		tracker_property_set_domain (property, tracker_ontologies_get_class_by_uri (ontologies, domain_uri));
+		tracker_property_set_range (property, tracker_ontologies_get_class_by_uri (ontologies, range_uri));
+		tracker_property_set_multiple_values (property, multi_valued);
+		tracker_property_set_orig_multiple_values (property, multi_valued);
+		tracker_property_set_indexed (property, indexed);
+		tracker_property_set_db_schema_changed (property, FALSE);
+		tracker_property_set_orig_fulltext_indexed (property, fulltext_indexed);
+		tracker_property_set_fulltext_indexed (property, fulltext_indexed);
+		tracker_property_set_is_inverse_functional_property (property, inverse_functional);
+		tracker_property_set_closure_indexed (property, closure_indexed);
+		tracker_ontologies_add_property (ontologies, property);
+		tracker_ontologies_add_id_uri_pair (ontologies, id, uri);
+		g_object_unref (property);
+	}
+
+	g_variant_iter_free (classes);
+	g_variant_iter_free (properties);
+	g_variant_get (payload, ONTOLOGY_SNAPSHOT_PAYLOAD_TYPE,
+	               NULL, NULL, &classes, &properties);
+
+	while (g_variant_iter_next (classes, "(x&sbasas)", NULL, &uri, NULL, &uris, NULL)) {
+		TrackerClass *class;
+
+		class = tracker_ontologies_get_class_by_uri (ontologies, uri);
+
+		while (g_variant_iter_next (uris, "&s", &link_uri)) {
+			TrackerClass *super_class;
+
+			super_class = tracker_ontologies_get_class_by_uri (ontologies, link_uri);
+			if (!super_class)
+				goto error;
+
+			tracker_class_add_super_class (class, super_class);
+		}
+
+		g_variant_iter_free (uris);
+	}
+
+	g_variant_iter_free (classes);
+	g_variant_get (payload, ONTOLOGY_SNAPSHOT_PAYLOAD_TYPE,
+	               NULL, NULL, &classes, NULL);
+
+	while (g_variant_iter_next (classes, "(x&sbasas)", NULL, &uri, NULL, NULL, &uris)) {
+		TrackerClass *class;
+
+		class = tracker_ontologies_get_class_by_uri (ontologies, uri);
+
+		while (g_variant_iter_next (uris, "&s", &link_uri)) {
+			TrackerProperty *domain_index;
+
+			domain_index = tracker_ontologies_get_property_by_uri (ontologies, link_uri);
+			if (!domain_index)
+				goto error;
+
+			tracker_class_add_domain_index (class, domain_index);
+			tracker_property_add_domain_index (domain_index, class);
+		}
+
+		g_variant_iter_free (uris);
+	}
+
+	while (g_variant_iter_next (properties, "(x&s&s&sbb&sbbbas)",
+	                            NULL, &uri, NULL, NULL, NULL, NULL,
+	                            &secondary_index_uri, NULL, NULL, NULL, &uris)) {
+		TrackerProperty *property;
+
+		property = tracker_ontologies_get_property_by_uri (ontologies, uri);
+
+		if (*secondary_index_uri) {
+			TrackerProperty *secondary_index;
+
+			secondary_index = tracker_ontologies_get_property_by_uri (ontologies, secondary_index_uri);
+			if (!secondary_index) {
+				link_uri = secondary_index_uri;
+				goto error;
+			}
+
+			tracker_property_set_secondary_index (property, secondary_index);
+		}
+
+		while (g_variant_iter_next (uris, "&s", &link_uri)) {
+			TrackerProperty *super_property;
+
+			super_property = tracker_ontologies_get_property_by_uri (ontologies, link_uri);
+			if (!super_property)
+				goto error;
+
+			tracker_property_add_super_property (property, super_property);
+		}
+
+		g_variant_iter_free (uris);
+	}
+
+	g_variant_iter_free (ontos);
+	g_variant_iter_free (namespaces);
+	g_variant_iter_free (classes);
+	g_variant_iter_free (properties);
+
+	return ontologies;
+
+error:
+	g_clear_pointer (&uris, g_variant_iter_free);
+	g_variant_iter_free (ontos);
+	g_variant_iter_free (namespaces);
+	g_variant_iter_free (classes);
+	g_variant_iter_free (properties);
+	g_object_unref (ontologies);
+	g_set_error (error,
+	             TRACKER_DATA_ONTOLOGY_ERROR,
+	             TRACKER_DATA_UNSUPPORTED_ONTOLOGY_CHANGE,
+	             "Ontology snapshot refers to unknown element '%s'",
+	             link_uri);
+	return NULL;
+}
+
+static gboolean
+load_ontology_snapshot (TrackerDataManager  *manager,
+                        TrackerDBInterface  *iface,
+                        gint                *schema_version_out,
+                        GError             **error)
+{
+	GMappedFile *mapped_file;
+	GBytes *bytes;
+	GVariant *snapshot = NULL, *payload_data = NULL, *payload = NULL;
+	GVariantIter *ontos = NULL;
+	TrackerOntologies *ontologies;
+	const gchar *checksum;
+	gchar *filename, *computed_checksum = NULL;
+	guint32 format_version, db_version;
+	gint schema_version;
+	gboolean retval = FALSE;
+
+	filename = get_ontology_snapshot_path (manager);
+	if (!filename) {
+		g_set_error (error,
+		             TRACKER_DATA_ONTOLOGY_ERROR,
+		             TRACKER_DATA_UNSUPPORTED_LOCATION,
+		             "Ontology snapshots are not stored for this database");
+		return FALSE;
+	}
+
+	mapped_file = g_mapped_file_new (filename, FALSE, error);
+	g_free (filename);
+
+	if (!mapped_file)
+		return FALSE;
+
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	g_mapped_file_unref (mapped_file);
+	snapshot = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (ONTOLOGY_SNAPSHOT_TYPE),
+	                                                         bytes, FALSE));
+	g_bytes_unref (bytes);
+
+	g_variant_get (snapshot, "(uui&s@ay)",
+	               &format_version, &db_version, &schema_version,
+	               &checksum, &payload_data);
+
+	if (format_version != ONTOLOGY_SNAPSHOT_VERSION ||
+	    db_version != tracker_db_manager_get_version (manager->db_manager) ||
+	    schema_version != get_main_schema_version (iface)) {
+		g_set_error (error,
+		             TRACKER_DATA_ONTOLOGY_ERROR,
+		             TRACKER_DATA_UNSUPPORTED_ONTOLOGY_CHANGE,
+		             "Ontology snapshot is out of date");
+		goto out;
+	}
+
+	computed_checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+	                                                 g_variant_get_data (payload_data),
+	                                                 g_variant_get_size (payload_data));
+
+	if (g_strcmp0 (checksum, computed_checksum) != 0) {
+		g_set_error (error,
+		             TRACKER_DATA_ONTOLOGY_ERROR,
+		             TRACKER_DATA_UNSUPPORTED_ONTOLOGY_CHANGE,
+		             "Ontology snapshot checksum mismatch");
+		goto out;
+	}
+
+	bytes = g_variant_get_data_as_bytes (payload_data);
+	payload = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (ONTOLOGY_SNAPSHOT_PAYLOAD_TYPE),
+	                                                        bytes, FALSE));
+	g_bytes_unref (bytes);
+
+	g_variant_get (payload, ONTOLOGY_SNAPSHOT_PAYLOAD_TYPE,
+	               &ontos, NULL, NULL, NULL);
+
+	if (!check_ontology_snapshot_ontologies (iface, ontos, error))
+		goto out;
+
+	ontologies = deserialize_ontology_snapshot (payload, error);
+	if (!ontologies)
+		goto out;
+
+	g_object_unref (manager->ontologies);
+	manager->ontologies = ontologies;
+
+	if (schema_version_out)
+		*schema_version_out = schema_version;
+
+	retval = TRUE;
+
+out:
+	g_clear_pointer (&ontos, g_variant_iter_free);
+	g_clear_pointer (&payload, g_variant_unref);
+	g_clear_pointer (&payload_data, g_variant_unref);
+	g_clear_pointer (&snapshot, g_variant_unref);
+	g_free (computed_checksum);
+
+	return retval;
+}
+
+static gboolean
+tracker_data_manager_fts_changed (TrackerDataManager *manager)
+{
+	TrackerProperty **properties;
+	gboolean has_changed = FALSE;
+	guint i, len;
+
+	properties = tracker_ontologies_get_properties (manager->ontologies, &len);
+
+	for (i = 0; i < len; i++) {
+		TrackerClass *class;
+
+		if (tracker_property_get_fulltext_indexed (properties[i]) !=
+		    tracker_property_get_orig_fulltext_indexed (properties[i])) {
+			has_changed |= TRUE;
+		}
+
+		if (!tracker_property_get_fulltext_indexed (properties[i])) {
+			continue;
+		}
+
+		has_changed |= tracker_property_get_is_new (properties[i]);
+
+		/* We must also regenerate FTS if any table in the view
+		 * updated its schema.
+		 */
+		class = tracker_property_get_domain (properties[i]);
+		has_changed |= tracker_class_get_db_schema_changed (class);
+	}
+
+	return has_changed;
+}
+
+static gboolean
+rebuild_fts_tokens (TrackerDataManager  *manager,
+                    TrackerDBInterface  *iface,
+                    GError             **error)
+{
+	TrackerProperty **properties;
+	GHashTableIter iter;
+	gchar *graph;
+	gboolean has_fts = FALSE;
+	guint len, i;
+
+	properties = tracker_ontologies_get_properties (manager->ontologies, &len);
+
+	for (i = 0; i < len; i++) {
+		has_fts |= tracker_property_get_fulltext_indexed (properties[i]);
+		if (has_fts)
+			break;
+	}
+
+	if (has_fts) {
+		g_debug ("Rebuilding FTS tokens, this may take a moment...");
+		if (!tracker_db_interface_sqlite_fts_rebuild_tokens (iface, "main", error))
+			return FALSE;
+
+		g_hash_table_iter_init (&iter, manager->graphs);
+		while (g_hash_table_iter_next (&iter, (gpointer*) &graph, NULL)) {
+			if (!tracker_db_interface_sqlite_fts_rebuild_tokens (iface, graph, error))
+				return FALSE;
+		}
+
+		g_debug ("FTS tokens rebuilt");
+	}
+
+	/* Update the stamp file */
+	tracker_db_manager_tokenizer_update (manager->db_manager);
 
 	return TRUE;
 }
@@ -3768,7 +4760,8 @@ TrackerDataManager *
 tracker_data_manager_new (TrackerDBManagerFlags   flags,
                           GFile                  *cache_location,
                           GFile                  *ontology_location,
-                          guint                   select_cache_size)
+                          guint                   select_cache_size,
+                          GVariant               *options)
 {
 	TrackerDataManager *manager;
 
@@ -3785,6 +4778,9 @@ tracker_data_manager_new (TrackerDBManagerFlags   flags,
 	manager->flags = flags;
 	manager->select_cache_size = select_cache_size;
 
+	if (options)
+		manager->options = g_variant_ref_sink (options);
+
 	return manager;
 }
 
@@ -3907,170 +4903,1411 @@ update_attached_databases (TrackerDBInterface  *iface,
 		} else if (tracker_sparql_cursor_get_integer (cursor, 2)) {
 			TrackerRowid id;
 
-			if (!tracker_db_manager_attach_database (data_manager->db_manager,
-			                                         iface, name, FALSE, error)) {
-				retval = FALSE;
-				break;
-			}
+			if (!tracker_db_manager_attach_database (data_manager->db_manager,
+			                                         iface, name, FALSE, error)) {
+				retval = FALSE;
+				break;
+			}
+
+			id = tracker_sparql_cursor_get_integer (cursor, 3);
+			g_hash_table_insert (data_manager->graphs, g_strdup (name),
+			                     tracker_rowid_copy (&id));
+			*changed = TRUE;
+		}
+	}
+
+	g_object_unref (cursor);
+
+	return retval;
+}
+
+static gint
+query_graph_schema_version (TrackerDBInterface  *iface,
+                            const gchar         *graph,
+                            GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor;
+	gint version = -1;
+
+	stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, error,
+	                                               "PRAGMA \"%s\".schema_version",
+	                                               graph);
+	if (!stmt)
+		return -1;
+
+	cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, error));
+	g_object_unref (stmt);
+
+	if (!cursor)
+		return -1;
+
+	if (tracker_sparql_cursor_next (cursor, NULL, error))
+		version = tracker_sparql_cursor_get_integer (cursor, 0);
+
+	g_object_unref (cursor);
+
+	return version;
+}
+
+static gboolean
+update_graph_tables (TrackerDBInterface  *iface,
+                     TrackerDataManager  *data_manager,
+                     gboolean            *changed,
+                     GError             **error)
+{
+	GHashTable *versions, *reloaded, *graph_tables;
+	GHashTableIter iter;
+	gpointer graph, value;
+
+	*changed = FALSE;
+
+	/* SQLite bumps the schema version of a database on every schema
+	 * change, so only the tables of graphs whose version changed since
+	 * the last check need to be looked up again.
+	 */
+	versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	reloaded = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                  (GDestroyNotify) g_hash_table_unref);
+
+	g_hash_table_iter_init (&iter, data_manager->graphs);
+
+	while (g_hash_table_iter_next (&iter, &graph, NULL)) {
+		GHashTable *tables;
+		gpointer known;
+		gboolean up_to_date;
+		gint version;
+
+		version = query_graph_schema_version (iface, graph, error);
+		if (version < 0)
+			goto error;
+
+		g_hash_table_insert (versions, g_strdup (graph), GINT_TO_POINTER (version));
+
+		g_mutex_lock (&data_manager->graphs_lock);
+		up_to_date = (data_manager->graph_schema_versions &&
+		              data_manager->graph_tables &&
+		              g_hash_table_contains (data_manager->graph_tables, graph) &&
+		              g_hash_table_lookup_extended (data_manager->graph_schema_versions,
+		                                            graph, NULL, &known) &&
+		              GPOINTER_TO_INT (known) == version);
+		g_mutex_unlock (&data_manager->graphs_lock);
+
+		if (up_to_date)
+			continue;
+
+		tables = query_graph_tables (iface, graph, error);
+		if (!tables)
+			goto error;
+
+		g_hash_table_insert (reloaded, g_strdup (graph), tables);
+	}
+
+	g_mutex_lock (&data_manager->graphs_lock);
+
+	/* Also catch graphs that were detached */
+	if (g_hash_table_size (reloaded) > 0 ||
+	    !data_manager->graph_schema_versions ||
+	    g_hash_table_size (versions) != g_hash_table_size (data_manager->graph_schema_versions)) {
+		graph_tables = copy_graph_tables (data_manager->graph_tables);
+
+		g_hash_table_iter_init (&iter, graph_tables);
+		while (g_hash_table_iter_next (&iter, &graph, NULL)) {
+			if (!g_hash_table_contains (versions, graph))
+				g_hash_table_iter_remove (&iter);
+		}
+
+		g_hash_table_iter_init (&iter, reloaded);
+		while (g_hash_table_iter_next (&iter, &graph, &value)) {
+			g_hash_table_insert (graph_tables, g_strdup (graph),
+			                     g_hash_table_ref (value));
+		}
+
+		g_clear_pointer (&data_manager->graph_tables, g_hash_table_unref);
+		data_manager->graph_tables = graph_tables;
+		data_manager->graph_tables_serial++;
+		*changed = TRUE;
+	}
+
+	g_clear_pointer (&data_manager->graph_schema_versions, g_hash_table_unref);
+	data_manager->graph_schema_versions = versions;
+
+	g_mutex_unlock (&data_manager->graphs_lock);
+
+	g_hash_table_unref (reloaded);
+
+	return TRUE;
+
+ error:
+	g_hash_table_unref (versions);
+	g_hash_table_unref (reloaded);
+
+	return FALSE;
+}
+
+typedef struct {
+	/* Whether the graph row counts start over from zero */
+	gboolean reset;
+	/* Table name -> gint64 */
+	GHashTable *rows;
+} TableRowsChange;
+
+static GHashTable *
+table_rows_new (void)
+{
+	return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+}
+
+static GHashTable *
+graph_table_rows_new (void)
+{
+	return g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                              (GDestroyNotify) g_hash_table_unref);
+}
+
+static void
+table_rows_add (GHashTable  *rows,
+                const gchar *table,
+                gint64       delta)
+{
+	gint64 *value;
+
+	value = g_hash_table_lookup (rows, table);
+
+	if (!value) {
+		value = g_new0 (gint64, 1);
+		g_hash_table_insert (rows, g_strdup (table), value);
+	}
+
+	*value += delta;
+}
+
+static void
+table_rows_change_free (TableRowsChange *change)
+{
+	g_hash_table_unref (change->rows);
+	g_free (change);
+}
+
+static gboolean
+has_table_stats (TrackerDBInterface *iface)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor;
+	gboolean found = FALSE;
+
+	stmt = tracker_db_interface_create_statement (iface,
+	                                              TRACKER_DB_STATEMENT_CACHE_TYPE_NONE,
+	                                              NULL,
+	                                              "SELECT 1 FROM \"main\".sqlite_master "
+	                                              "WHERE type = 'table' AND name = 'TableStats'");
+	if (!stmt)
+		return FALSE;
+
+	cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, NULL));
+	g_object_unref (stmt);
+
+	if (cursor) {
+		found = tracker_sparql_cursor_next (cursor, NULL, NULL);
+		g_object_unref (cursor);
+	}
+
+	return found;
+}
+
+static GHashTable *
+query_table_rows (TrackerDBInterface  *iface,
+                  GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor;
+	GHashTable *table_rows;
+	GError *inner_error = NULL;
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, error,
+	                                              "SELECT Graph, Name, Rows FROM \"main\".TableStats");
+	if (!stmt)
+		return NULL;
+
+	cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, error));
+	g_object_unref (stmt);
+
+	if (!cursor)
+		return NULL;
+
+	table_rows = graph_table_rows_new ();
+
+	while (tracker_sparql_cursor_next (cursor, NULL, &inner_error)) {
+		const gchar *graph;
+		GHashTable *rows;
+
+		graph = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+		rows = g_hash_table_lookup (table_rows, graph);
+
+		if (!rows) {
+			rows = table_rows_new ();
+			g_hash_table_insert (table_rows, g_strdup (graph), rows);
+		}
+
+		table_rows_add (rows,
+		                tracker_sparql_cursor_get_string (cursor, 1, NULL),
+		                tracker_sparql_cursor_get_integer (cursor, 2));
+	}
+
+	g_object_unref (cursor);
+
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		g_hash_table_unref (table_rows);
+		return NULL;
+	}
+
+	return table_rows;
+}
+
+static void
+initialize_table_rows (TrackerDataManager *manager,
+                       TrackerDBInterface *iface)
+{
+	GHashTable *table_rows;
+	GError *error = NULL;
+
+	/* Databases not yet updated to keep statistics just
+	 * go without them.
+	 */
+	if (!has_table_stats (iface))
+		return;
+
+	table_rows = query_table_rows (iface, &error);
+
+	if (!table_rows) {
+		g_warning ("Could not load table statistics: %s", error->message);
+		g_error_free (error);
+		return;
+	}
+
+	g_mutex_lock (&manager->graphs_lock);
+	g_clear_pointer (&manager->table_rows, g_hash_table_unref);
+	manager->table_rows = table_rows;
+	manager->table_rows_timestamp = g_get_monotonic_time ();
+	g_mutex_unlock (&manager->graphs_lock);
+}
+
+/* Readonly connections pick up the row counts written by the
+ * writer every now and then, they are only used as estimates.
+ */
+static void
+update_table_rows (TrackerDBInterface *iface,
+                   TrackerDataManager *data_manager)
+{
+	GHashTable *table_rows;
+	GError *error = NULL;
+	gint64 now;
+
+	now = g_get_monotonic_time ();
+
+	g_mutex_lock (&data_manager->graphs_lock);
+
+	if (!data_manager->table_rows ||
+	    now - data_manager->table_rows_timestamp < TABLE_ROWS_REFRESH_INTERVAL) {
+		g_mutex_unlock (&data_manager->graphs_lock);
+		return;
+	}
+
+	data_manager->table_rows_timestamp = now;
+	g_mutex_unlock (&data_manager->graphs_lock);
+
+	table_rows = query_table_rows (iface, &error);
+
+	if (!table_rows) {
+		g_debug ("Could not reload table statistics: %s", error->message);
+		g_error_free (error);
+		return;
+	}
+
+	g_mutex_lock (&data_manager->graphs_lock);
+	g_clear_pointer (&data_manager->table_rows, g_hash_table_unref);
+	data_manager->table_rows = table_rows;
+	g_mutex_unlock (&data_manager->graphs_lock);
+}
+
+static TableRowsChange *
+ensure_table_rows_change (TrackerDataManager *manager,
+                          const gchar        *graph)
+{
+	TableRowsChange *change;
+
+	if (!graph)
+		graph = "main";
+
+	if (!manager->transaction_table_rows) {
+		manager->transaction_table_rows =
+			g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+			                       (GDestroyNotify) table_rows_change_free);
+	}
+
+	change = g_hash_table_lookup (manager->transaction_table_rows, graph);
+
+	if (!change) {
+		change = g_new0 (TableRowsChange, 1);
+		change->rows = table_rows_new ();
+		g_hash_table_insert (manager->transaction_table_rows,
+		                     g_strdup (graph), change);
+	}
+
+	return change;
+}
+
+static void
+reset_table_rows (TrackerDataManager *manager,
+                  const gchar        *graph)
+{
+	TableRowsChange *change;
+
+	if (!manager->table_rows)
+		return;
+
+	change = ensure_table_rows_change (manager, graph);
+	change->reset = TRUE;
+	g_hash_table_remove_all (change->rows);
+}
+
+static gboolean
+count_table_rows (TrackerDataManager  *manager,
+                  TrackerDBInterface  *iface,
+                  const gchar         *graph,
+                  const gchar         *table,
+                  GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor;
+	GError *inner_error = NULL;
+	gint64 rows = 0;
+
+	if (!tracker_data_manager_graph_has_table (manager, graph, table, TRUE))
+		return TRUE;
+
+	stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, error,
+	                                               "SELECT count(*) FROM \"%s\".\"%s\"",
+	                                               graph, table);
+	if (!stmt)
+		return FALSE;
+
+	cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, error));
+	g_object_unref (stmt);
+
+	if (!cursor)
+		return FALSE;
+
+	if (tracker_sparql_cursor_next (cursor, NULL, &inner_error))
+		rows = tracker_sparql_cursor_get_integer (cursor, 0);
+
+	g_object_unref (cursor);
+
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	tracker_data_manager_add_table_rows (manager, graph, table, rows);
+
+	return TRUE;
+}
+
+/* Replaces the row counts of a graph with those of its tables */
+static gboolean
+count_graph_table_rows (TrackerDataManager  *manager,
+                        TrackerDBInterface  *iface,
+                        const gchar         *graph,
+                        GError             **error)
+{
+	TrackerClass **classes;
+	TrackerProperty **properties;
+	guint i, n_classes, n_properties;
+
+	if (!manager->table_rows)
+		return TRUE;
+
+	if (!graph)
+		graph = "main";
+
+	reset_table_rows (manager, graph);
+
+	classes = tracker_ontologies_get_classes (manager->ontologies, &n_classes);
+	properties = tracker_ontologies_get_properties (manager->ontologies, &n_properties);
+
+	for (i = 0; i < n_classes; i++) {
+		if (g_str_has_prefix (tracker_class_get_name (classes[i]), "xsd:"))
+			continue;
+
+		if (!count_table_rows (manager, iface, graph,
+		                       tracker_class_get_name (classes[i]),
+		                       error))
+			return FALSE;
+	}
+
+	for (i = 0; i < n_properties; i++) {
+		if (!tracker_property_get_multiple_values (properties[i]))
+			continue;
+
+		if (!count_table_rows (manager, iface, graph,
+		                       tracker_property_get_table_name (properties[i]),
+		                       error))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Counts the rows of all tables again, after ontology changes
+ * moved data around.
+ */
+static gboolean
+recount_table_rows (TrackerDataManager  *manager,
+                    TrackerDBInterface  *iface,
+                    GError             **error)
+{
+	GHashTable *graphs;
+	GHashTableIter iter;
+	gpointer graph;
+	GError *inner_error = NULL;
+
+	tracker_data_begin_transaction (manager->data_update, &inner_error);
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	/* Forget about graphs that are no longer there */
+	g_hash_table_iter_init (&iter, manager->table_rows);
+	while (g_hash_table_iter_next (&iter, &graph, NULL))
+		reset_table_rows (manager, graph);
+
+	if (!count_graph_table_rows (manager, iface, "main", &inner_error))
+		goto error;
+
+	graphs = tracker_data_manager_get_graphs (manager, FALSE);
+	g_hash_table_iter_init (&iter, graphs);
+
+	while (g_hash_table_iter_next (&iter, &graph, NULL)) {
+		if (!count_graph_table_rows (manager, iface, graph, &inner_error))
+			break;
+	}
+
+	g_hash_table_unref (graphs);
+
+	if (inner_error)
+		goto error;
+
+	tracker_db_manager_set_table_stats_outdated (manager->db_manager, FALSE);
+
+	tracker_data_commit_transaction (manager->data_update, &inner_error);
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	return TRUE;
+
+ error:
+	tracker_data_rollback_transaction (manager->data_update);
+	g_propagate_error (error, inner_error);
+	return FALSE;
+}
+
+static void
+update_interface_cb (TrackerDBManager   *db_manager,
+                     TrackerDBInterface *iface,
+                     TrackerDataManager *data_manager)
+{
+	GError *error = NULL;
+	guint iface_generation;
+	gboolean update = FALSE, attached_changed = FALSE, changed, readonly;
+
+	readonly = (tracker_db_manager_get_flags (db_manager) & TRACKER_DB_MANAGER_READONLY) != 0;
+
+	if (readonly) {
+		update = TRUE;
+	} else {
+		iface_generation = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (iface),
+		                                                        "tracker-data-iface-generation"));
+		update = (iface_generation != data_manager->generation);
+	}
+
+	if (update) {
+		if (update_attached_databases (iface, data_manager, &attached_changed, &error)) {
+			/* This is where we bump the generation for the readonly case, in response to
+			 * tables being attached or detached due to graph changes.
+			 */
+			if (readonly && attached_changed)
+				data_manager->generation++;
+		} else {
+			g_critical ("Could not update attached databases: %s\n",
+			            error->message);
+			g_clear_error (&error);
+		}
+
+		/* Graphs may also get new tables from other connections, and
+		 * newly attached graphs must have their tables known before
+		 * queries are built for them.
+		 */
+		if (readonly || attached_changed) {
+			if (update_graph_tables (iface, data_manager, &changed, &error)) {
+				if (readonly && changed)
+					data_manager->generation++;
+			} else {
+				g_critical ("Could not update graph tables: %s\n",
+				            error->message);
+				g_clear_error (&error);
+			}
+		}
+
+		if (readonly)
+			update_table_rows (iface, data_manager);
+
+		g_object_set_data (G_OBJECT (iface), "tracker-data-iface-generation",
+		                   GUINT_TO_POINTER (data_manager->generation));
+	}
+}
+
+static gboolean
+tracker_data_manager_attempt_repair (TrackerDataManager  *data_manager,
+                                     TrackerDBInterface  *iface,
+                                     GError             **error)
+{
+	TrackerProperty **properties;
+	guint len, i;
+	gboolean has_fts = FALSE;
+	GError *inner_error = NULL;
+
+	tracker_db_interface_execute_query (iface, &inner_error, "REINDEX");
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	properties = tracker_ontologies_get_properties (data_manager->ontologies, &len);
+
+	for (i = 0; i < len; i++) {
+		has_fts |= tracker_property_get_fulltext_indexed (properties[i]);
+		if (has_fts)
+			break;
+	}
+
+	if (has_fts) {
+		GHashTableIter iter;
+		const gchar *graph;
+
+		g_hash_table_iter_init (&iter, data_manager->graphs);
+		while (g_hash_table_iter_next (&iter, (gpointer*) &graph, NULL)) {
+			if (!tracker_db_interface_sqlite_fts_integrity_check (iface, graph)) {
+				if (!tracker_db_interface_sqlite_fts_rebuild_tokens (iface, graph, error))
+					return FALSE;
+			}
+		}
+
+		if (!tracker_db_interface_sqlite_fts_integrity_check (iface, "main")) {
+			if (!tracker_db_interface_sqlite_fts_rebuild_tokens (iface, "main", error))
+				return FALSE;
+		}
+	}
+
+	if (!tracker_db_manager_check_integrity (data_manager->db_manager, error))
+		return FALSE;
+
+	return TRUE;
+}
+
+static gboolean
+pack_datetime_columns (TrackerDataManager  *manager,
+                       TrackerDBInterface  *iface,
+                       const gchar         *database,
+                       GError             **error)
+{
+	TrackerProperty **properties;
+	GError *inner_error = NULL;
+	guint n_properties, i;
+
+	properties = tracker_ontologies_get_properties (manager->ontologies, &n_properties);
+
+	for (i = 0; i < n_properties; i++) {
+		const gchar *table_name, *field_name;
+
+		if (tracker_property_get_data_type (properties[i]) != TRACKER_PROPERTY_TYPE_DATETIME)
+			continue;
+
+		table_name = tracker_property_get_table_name (properties[i]);
+		field_name = tracker_property_get_name (properties[i]);
+
+		if (g_strcmp0 (database, "main") != 0 &&
+		    !tracker_data_manager_graph_has_table (manager, database,
+		                                           table_name, TRUE))
+			continue;
+
+		/* Older databases stored these as ISO 8601 strings */
+		tracker_db_interface_execute_query (iface, &inner_error,
+		                                    "UPDATE \"%s\".\"%s\" "
+		                                    "SET \"%s\" = SparqlPackDateTime (\"%s\") "
+		                                    "WHERE typeof (\"%s\") = 'text'",
+		                                    database, table_name,
+		                                    field_name, field_name, field_name);
+		if (inner_error) {
+			g_propagate_error (error, inner_error);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+tracker_data_manager_update_from_version (TrackerDataManager  *manager,
+                                          TrackerDBVersion     version,
+                                          GError             **error)
+{
+	TrackerDBInterface *iface;
+	GError *internal_error = NULL;
+
+	iface = tracker_data_manager_get_writable_db_interface (manager);
+
+	if (version < TRACKER_DB_VERSION_3_3) {
+		/* Anonymous blank nodes, remove "NOT NULL" restriction
+		 * from Resource.Uri.
+		 */
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "CREATE TABLE Resource_TEMP (ID INTEGER NOT NULL PRIMARY KEY,"
+		                                    " Uri TEXT, BlankNode INTEGER DEFAULT 0, UNIQUE (Uri))");
+		if (internal_error)
+			goto error;
+
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "INSERT INTO Resource_TEMP SELECT * FROM Resource");
+		if (internal_error)
+			goto error;
+
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "DROP TABLE Resource");
+		if (internal_error)
+			goto error;
+
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "ALTER TABLE Resource_TEMP RENAME TO Resource");
+		if (internal_error)
+			goto error;
+	}
+
+	if (version < TRACKER_DB_VERSION_3_6) {
+		GHashTableIter iter;
+		const gchar *graph;
+
+		if (!tracker_db_interface_sqlite_fts_delete_table (iface, "main", &internal_error))
+			goto error;
+		if (!tracker_data_manager_update_fts (manager, iface, "main", &internal_error))
+			goto error;
+
+		g_hash_table_iter_init (&iter, manager->graphs);
+
+		while (g_hash_table_iter_next (&iter, (gpointer *) &graph, NULL)) {
+			if (!tracker_db_interface_sqlite_fts_delete_table (iface, graph, &internal_error))
+				goto error;
+			if (!tracker_data_manager_update_fts (manager, iface, graph, &internal_error))
+				goto error;
+		}
+	}
+
+	if (version < TRACKER_DB_VERSION_3_8) {
+		GHashTableIter iter;
+		const gchar *graph;
+
+		if (!pack_datetime_columns (manager, iface, "main", &internal_error))
+			goto error;
+
+		g_hash_table_iter_init (&iter, manager->graphs);
+
+		while (g_hash_table_iter_next (&iter, (gpointer *) &graph, NULL)) {
+			if (!pack_datetime_columns (manager, iface, graph, &internal_error))
+				goto error;
+		}
+	}
+
+	if (version < TRACKER_DB_VERSION_3_10) {
+		if (!create_table_stats (iface, &internal_error))
+			goto error;
+
+		/* Filled in once the database is up to date */
+		if (!manager->table_rows)
+			manager->table_rows = graph_table_rows_new ();
+
+		tracker_db_manager_set_table_stats_outdated (manager->db_manager, TRUE);
+	}
+
+	tracker_db_manager_update_version (manager->db_manager);
+	return TRUE;
+
+error:
+	g_propagate_error (error, internal_error);
+	return FALSE;
+}
+
+static gchar *
+build_closure_edges_query (TrackerDataManager *manager,
+                           TrackerProperty    *property)
+{
+	GHashTable *graphs;
+	GHashTableIter iter;
+	gpointer value;
+	GString *str;
+
+	str = g_string_new (NULL);
+	g_string_append_printf (str,
+	                        "SELECT ID, \"%s\" FROM \"main\".\"%s\" "
+	                        "WHERE \"%s\" IS NOT NULL",
+	                        tracker_property_get_name (property),
+	                        tracker_property_get_table_name (property),
+	                        tracker_property_get_name (property));
+
+	graphs = tracker_data_manager_get_graphs (manager, TRUE);
+	g_hash_table_iter_init (&iter, graphs);
+
+	while (g_hash_table_iter_next (&iter, &value, NULL)) {
+		if (!tracker_data_manager_graph_has_table (manager, value,
+		                                           tracker_property_get_table_name (property),
+		                                           TRUE))
+			continue;
+
+		g_string_append_printf (str,
+		                        " UNION ALL SELECT ID, \"%s\" FROM \"%s\".\"%s\" "
+		                        "WHERE \"%s\" IS NOT NULL",
+		                        tracker_property_get_name (property),
+		                        (const gchar *) value,
+		                        tracker_property_get_table_name (property),
+		                        tracker_property_get_name (property));
+	}
+
+	g_hash_table_unref (graphs);
+
+	return g_string_free (str, FALSE);
+}
+
+/* Recomputes the ancestors of the given resources, and of all the
+ * resources that had them as ancestors. If @ids is %NULL, the whole
+ * closure table is rebuilt.
+ */
+gboolean
+tracker_data_manager_update_closure (TrackerDataManager  *manager,
+                                     TrackerDBInterface  *iface,
+                                     TrackerProperty     *property,
+                                     GHashTable          *ids,
+                                     GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor;
+	GHashTable *affected;
+	GHashTableIter iter;
+	TrackerRowid *id;
+	GError *inner_error = NULL;
+	gchar *edges;
+
+	g_assert (tracker_property_get_closure_indexed (property));
+
+	/* Closure tables are filled after ontologies are imported */
+	if (ids && !manager->initialized)
+		return TRUE;
+
+	edges = build_closure_edges_query (manager, property);
+
+	if (!ids) {
+		tracker_db_interface_execute_query (iface, &inner_error,
+		                                    "DELETE FROM \"main\".\"%s_closure\"",
+		                                    tracker_property_get_name (property));
+		if (!inner_error) {
+			tracker_db_interface_execute_query (iface, &inner_error,
+			                                    "WITH RECURSIVE "
+			                                    "edges (ID, value) AS (%s), "
+			                                    "closure (ID, ancestor) AS ("
+			                                    "SELECT ID, value FROM edges "
+			                                    "UNION "
+			                                    "SELECT closure.ID, edges.value FROM closure, edges "
+			                                    "WHERE edges.ID = closure.ancestor) "
+			                                    "INSERT INTO \"main\".\"%s_closure\" (ID, ancestor) "
+			                                    "SELECT ID, ancestor FROM closure",
+			                                    edges,
+			                                    tracker_property_get_name (property));
+		}
+
+		g_free (edges);
+
+		if (inner_error) {
+			g_propagate_error (error, inner_error);
+			return FALSE;
+		}
+
+		return TRUE;
+	}
+
+	/* Descendants of the changed resources are affected too */
+	affected = g_hash_table_new_full (tracker_rowid_hash, tracker_rowid_equal,
+	                                  (GDestroyNotify) tracker_rowid_free, NULL);
+
+	stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &inner_error,
+	                                               "SELECT ID FROM \"main\".\"%s_closure\" "
+	                                               "WHERE ancestor = ?",
+	                                               tracker_property_get_name (property));
+	if (!stmt)
+		goto out;
+
+	g_hash_table_iter_init (&iter, ids);
+
+	while (!inner_error && g_hash_table_iter_next (&iter, (gpointer *) &id, NULL)) {
+		g_hash_table_add (affected, tracker_rowid_copy (id));
+
+		tracker_db_statement_bind_int (stmt, 0, *id);
+		cursor = tracker_db_statement_start_cursor (stmt, &inner_error);
+		if (!cursor)
+			break;
+
+		while (tracker_sparql_cursor_next (TRACKER_SPARQL_CURSOR (cursor), NULL, &inner_error)) {
+			TrackerRowid descendant;
+
+			descendant = tracker_sparql_cursor_get_integer (TRACKER_SPARQL_CURSOR (cursor), 0);
+			g_hash_table_add (affected, tracker_rowid_copy (&descendant));
+		}
+
+		g_object_unref (cursor);
+	}
+
+	g_object_unref (stmt);
+
+	if (inner_error)
+		goto out;
+
+	stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &inner_error,
+	                                               "DELETE FROM \"main\".\"%s_closure\" "
+	                                               "WHERE ID = ?",
+	                                               tracker_property_get_name (property));
+	if (!stmt)
+		goto out;
+
+	g_hash_table_iter_init (&iter, affected);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *) &id, NULL)) {
+		tracker_db_statement_bind_int (stmt, 0, *id);
+		if (!tracker_db_statement_execute (stmt, &inner_error))
+			break;
+	}
+
+	g_object_unref (stmt);
+
+	if (inner_error)
+		goto out;
+
+	stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &inner_error,
+	                                               "WITH RECURSIVE "
+	                                               "edges (ID, value) AS (%s), "
+	                                               "closure (ID, ancestor) AS ("
+	                                               "SELECT ID, value FROM edges WHERE ID = ?1 "
+	                                               "UNION "
+	                                               "SELECT closure.ID, edges.value FROM closure, edges "
+	                                               "WHERE edges.ID = closure.ancestor) "
+	                                               "INSERT INTO \"main\".\"%s_closure\" (ID, ancestor) "
+	                                               "SELECT ID, ancestor FROM closure",
+	                                               edges,
+	                                               tracker_property_get_name (property));
+	if (!stmt)
+		goto out;
+
+	g_hash_table_iter_init (&iter, affected);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *) &id, NULL)) {
+		tracker_db_statement_bind_int (stmt, 0, *id);
+		if (!tracker_db_statement_execute (stmt, &inner_error))
+			break;
+	}
+
+	g_object_unref (stmt);
+
+out:
+	g_hash_table_unref (affected);
+	g_free (edges);
+
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+rebuild_closure_tables (TrackerDataManager  *manager,
+                        TrackerDBInterface  *iface,
+                        GError             **error)
+{
+	TrackerProperty **properties;
+	guint i, n_properties;
+
+	properties = tracker_ontologies_get_properties (manager->ontologies, &n_properties);
+
+	for (i = 0; i < n_properties; i++) {
+		if (!tracker_property_get_closure_indexed (properties[i]))
+			continue;
+
+		if (!tracker_data_manager_update_closure (manager, iface, properties[i],
+		                                          NULL, error))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Creates and fills the closure tables of nrl:closureIndexed
+ * properties, and drops the ones that are no longer needed.
+ */
+static gboolean
+update_closure_tables (TrackerDataManager  *manager,
+                       TrackerDBInterface  *iface,
+                       GError             **error)
+{
+	TrackerProperty **properties;
+	GError *inner_error = NULL;
+	guint i, n_properties;
+
+	properties = tracker_ontologies_get_properties (manager->ontologies, &n_properties);
+
+	for (i = 0; !inner_error && i < n_properties; i++) {
+		const gchar *name;
+
+		name = tracker_property_get_name (properties[i]);
+
+		if (!tracker_property_get_closure_indexed (properties[i])) {
+			tracker_db_interface_execute_query (iface, &inner_error,
+			                                    "DROP TABLE IF EXISTS \"main\".\"%s_closure\"",
+			                                    name);
+			continue;
+		}
+
+		tracker_db_interface_execute_query (iface, &inner_error,
+		                                    "CREATE TABLE IF NOT EXISTS \"main\".\"%s_closure\" ("
+		                                    "ID INTEGER NOT NULL, "
+		                                    "ancestor INTEGER NOT NULL, "
+		                                    "PRIMARY KEY (ID, ancestor)) "
+		                                    "WITHOUT ROWID",
+		                                    name);
+		if (inner_error)
+			break;
+
+		tracker_db_interface_execute_query (iface, &inner_error,
+		                                    "CREATE INDEX IF NOT EXISTS \"main\".\"%s_closure_ancestor\" "
+		                                    "ON \"%s_closure\" (ancestor, ID)",
+		                                    name, name);
+		if (inner_error)
+			break;
+
+		tracker_data_manager_update_closure (manager, iface, properties[i],
+		                                     NULL, &inner_error);
+	}
+
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+apply_ontology_changes_to_graph (TrackerDataManager  *manager,
+                                 TrackerDBInterface  *iface,
+                                 const gchar         *graph,
+                                 gpointer             user_data,
+                                 GError             **error)
+{
+	gboolean update_fts = GPOINTER_TO_INT (user_data);
+
+	if (update_fts &&
+	    !tracker_db_interface_sqlite_fts_delete_table (iface, graph, error))
+		return FALSE;
+
+	if (!tracker_data_ontology_setup_db (manager, iface, graph, TRUE, error))
+		return FALSE;
+
+	if (update_fts &&
+	    !tracker_data_manager_update_fts (manager, iface, graph, error))
+		return FALSE;
+
+	return TRUE;
+}
+
+static gboolean
+fix_indexes_in_graph (TrackerDataManager  *manager,
+                      TrackerDBInterface  *iface,
+                      const gchar         *graph,
+                      gpointer             user_data,
+                      GError             **error)
+{
+	GPtrArray *properties = user_data;
+	GError *internal_error = NULL;
+	guint i;
+
+	for (i = 0; i < properties->len; i++) {
+		fix_indexed_on_db (manager, iface, graph,
+		                   g_ptr_array_index (properties, i),
+		                   &internal_error);
+
+		if (internal_error) {
+			g_propagate_error (error, internal_error);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+migrate_graphs_in_place (TrackerDataManager  *manager,
+                         TrackerDBInterface  *iface,
+                         GHashTable          *graphs,
+                         gboolean             update_fts,
+                         GError             **error)
+{
+	GHashTableIter iter;
+	gpointer value;
+	guint n_graphs, n_done = 0;
+
+	n_graphs = g_hash_table_size (graphs);
+	g_hash_table_iter_init (&iter, graphs);
+
+	while (g_hash_table_iter_next (&iter, &value, NULL)) {
+		if (!apply_ontology_changes_to_graph (manager, iface, value,
+		                                      GINT_TO_POINTER (update_fts),
+		                                      error))
+			return FALSE;
+
+		if (!update_transaction_graph_tables (manager, iface, value, error))
+			return FALSE;
+
+		n_done++;
+		TRACKER_NOTE (ONTOLOGY_CHANGES,
+		              g_message ("  Applied ontology changes to graph %s (%u/%u)",
+		                         (const gchar *) value, n_done, n_graphs));
+		g_signal_emit (manager, signals[MIGRATION_PROGRESS], 0,
+		               value, n_done, n_graphs);
+	}
+
+	return TRUE;
+}
+
+typedef gboolean (* ShadowGraphFunc) (TrackerDataManager  *manager,
+                                      TrackerDBInterface  *iface,
+                                      const gchar         *graph,
+                                      gpointer             user_data,
+                                      GError             **error);
+
+typedef struct {
+	TrackerDataManager *manager;
+	ShadowGraphFunc func;
+	gpointer user_data;
+	gboolean create;
+	GAsyncQueue *done;
+	GMutex mutex;
+	GError *error;
+} ShadowGraphsData;
+
+static void
+shadow_graphs_set_error (ShadowGraphsData *data,
+                         GError           *error)
+{
+	/* Keep the first error, further ones are likely a consequence */
+	g_mutex_lock (&data->mutex);
+	if (!data->error)
+		data->error = g_steal_pointer (&error);
+	g_mutex_unlock (&data->mutex);
+
+	g_clear_error (&error);
+}
+
+static gboolean
+shadow_graphs_failed (ShadowGraphsData *data)
+{
+	gboolean failed;
+
+	g_mutex_lock (&data->mutex);
+	failed = data->error != NULL;
+	g_mutex_unlock (&data->mutex);
+
+	return failed;
+}
+
+static gboolean
+run_on_shadow_graph (ShadowGraphsData    *data,
+                     TrackerDBInterface  *iface,
+                     const gchar         *graph,
+                     GError             **error)
+{
+	TrackerDBManager *db_manager = data->manager->db_manager;
+	gboolean retval;
+
+	if (data->create) {
+		/* The writable connection leaves graph databases untouched
+		 * while they are migrated, so this copies the last committed
+		 * state.
+		 */
+		if (!tracker_db_manager_attach_database (db_manager, iface, graph,
+		                                         FALSE, error))
+			return FALSE;
+
+		retval = tracker_db_manager_create_shadow_database (db_manager, iface,
+		                                                    graph, error);
+		tracker_db_manager_detach_database (db_manager, iface, graph, NULL);
+
+		if (!retval)
+			return FALSE;
+	}
+
+	/* The copy is attached with the graph name, so the usual
+	 * schema code applies to it.
+	 */
+	if (!tracker_db_manager_attach_shadow_database (db_manager, iface,
+	                                                graph, error))
+		return FALSE;
+
+	if (!tracker_db_interface_start_transaction (iface)) {
+		g_set_error (error, TRACKER_DB_INTERFACE_ERROR, TRACKER_DB_QUERY_ERROR,
+		             "Could not start transaction");
+		retval = FALSE;
+	} else {
+		retval = (data->func (data->manager, iface, graph,
+		                      data->user_data, error) &&
+		          tracker_db_interface_end_db_transaction (iface, error));
 
-			id = tracker_sparql_cursor_get_integer (cursor, 3);
-			g_hash_table_insert (data_manager->graphs, g_strdup (name),
-			                     tracker_rowid_copy (&id));
-			*changed = TRUE;
-		}
+		if (!retval)
+			tracker_db_interface_execute_query (iface, NULL, "ROLLBACK");
 	}
 
-	g_object_unref (cursor);
+	tracker_db_manager_detach_database (db_manager, iface, graph, NULL);
 
 	return retval;
 }
 
 static void
-update_interface_cb (TrackerDBManager   *db_manager,
-                     TrackerDBInterface *iface,
-                     TrackerDataManager *data_manager)
+shadow_graphs_thread_func (gpointer data,
+                           gpointer user_data)
 {
+	ShadowGraphsData *shadow_data = user_data;
+	TrackerDBManager *db_manager = shadow_data->manager->db_manager;
+	TrackerDBInterface *iface = NULL;
+	const gchar *graph = data;
 	GError *error = NULL;
-	guint iface_generation;
-	gboolean update = FALSE, changed, readonly;
 
-	readonly = (tracker_db_manager_get_flags (db_manager) & TRACKER_DB_MANAGER_READONLY) != 0;
+	if (!shadow_graphs_failed (shadow_data)) {
+		/* Each graph is handled on its own connection, so
+		 * ontology changes are applied in parallel.
+		 */
+		iface = tracker_db_manager_create_writable_db_interface (db_manager, &error);
 
-	if (readonly) {
-		update = TRUE;
-	} else {
-		iface_generation = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (iface),
-		                                                        "tracker-data-iface-generation"));
-		update = (iface_generation != data_manager->generation);
+		if (iface)
+			run_on_shadow_graph (shadow_data, iface, graph, &error);
 	}
 
-	if (update) {
-		if (update_attached_databases (iface, data_manager, &changed, &error)) {
-			/* This is where we bump the generation for the readonly case, in response to
-			 * tables being attached or detached due to graph changes.
-			 */
-			if (readonly && changed)
-				data_manager->generation++;
-		} else {
-			g_critical ("Could not update attached databases: %s\n",
-			            error->message);
-			g_error_free (error);
-		}
-
-		g_object_set_data (G_OBJECT (iface), "tracker-data-iface-generation",
-		                   GUINT_TO_POINTER (data_manager->generation));
+	if (error) {
+		g_prefix_error (&error, "Unable to apply ontology changes to %s: ", graph);
+		shadow_graphs_set_error (shadow_data, error);
 	}
+
+	g_clear_object (&iface);
+
+	/* Always report back, the initializing thread waits for all graphs */
+	g_async_queue_push (shadow_data->done, (gpointer) graph);
 }
 
 static gboolean
-tracker_data_manager_attempt_repair (TrackerDataManager  *data_manager,
-                                     TrackerDBInterface  *iface,
-                                     GError             **error)
+run_on_shadow_graphs (TrackerDataManager  *manager,
+                      GHashTable          *graphs,
+                      gboolean             create,
+                      ShadowGraphFunc      func,
+                      gpointer             user_data,
+                      GError             **error)
 {
-	TrackerProperty **properties;
-	guint len, i;
-	gboolean has_fts = FALSE;
-	GError *inner_error = NULL;
+	ShadowGraphsData data = { 0, };
+	GThreadPool *pool;
+	GHashTableIter iter;
+	gpointer value;
+	guint n_graphs, n_threads, i;
 
-	tracker_db_interface_execute_query (iface, &inner_error, "REINDEX");
-	if (inner_error) {
-		g_propagate_error (error, inner_error);
-		return FALSE;
-	}
+	data.manager = manager;
+	data.func = func;
+	data.user_data = user_data;
+	data.create = create;
+	data.done = g_async_queue_new ();
+	g_mutex_init (&data.mutex);
 
-	properties = tracker_ontologies_get_properties (data_manager->ontologies, &len);
+	n_graphs = g_hash_table_size (graphs);
+	n_threads = CLAMP (n_graphs, 1, g_get_num_processors ());
+	pool = g_thread_pool_new (shadow_graphs_thread_func, &data,
+	                          n_threads, TRUE, NULL);
 
-	for (i = 0; i < len; i++) {
-		has_fts |= tracker_property_get_fulltext_indexed (properties[i]);
-		if (has_fts)
-			break;
-	}
+	g_hash_table_iter_init (&iter, graphs);
 
-	if (has_fts) {
-		GHashTableIter iter;
+	while (g_hash_table_iter_next (&iter, &value, NULL))
+		g_thread_pool_push (pool, value, NULL);
+
+	for (i = 0; i < n_graphs; i++) {
 		const gchar *graph;
 
-		g_hash_table_iter_init (&iter, data_manager->graphs);
-		while (g_hash_table_iter_next (&iter, (gpointer*) &graph, NULL)) {
-			if (!tracker_db_interface_sqlite_fts_integrity_check (iface, graph)) {
-				if (!tracker_db_interface_sqlite_fts_rebuild_tokens (iface, graph, error))
-					return FALSE;
-			}
-		}
+		graph = g_async_queue_pop (data.done);
 
-		if (!tracker_db_interface_sqlite_fts_integrity_check (iface, "main")) {
-			if (!tracker_db_interface_sqlite_fts_rebuild_tokens (iface, "main", error))
-				return FALSE;
+		/* Progress is only reported for building the copies, the
+		 * bulk of the work.
+		 */
+		if (create && !shadow_graphs_failed (&data)) {
+			TRACKER_NOTE (ONTOLOGY_CHANGES,
+			              g_message ("  Applied ontology changes to graph %s (%u/%u)",
+			                         graph, i + 1, n_graphs));
+			g_signal_emit (manager, signals[MIGRATION_PROGRESS], 0,
+			               graph, i + 1, n_graphs);
 		}
 	}
 
-	if (!tracker_db_manager_check_integrity (data_manager->db_manager, error))
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_async_queue_unref (data.done);
+	g_mutex_clear (&data.mutex);
+
+	if (data.error) {
+		g_propagate_error (error, data.error);
 		return FALSE;
+	}
 
 	return TRUE;
 }
 
 static gboolean
-tracker_data_manager_update_from_version (TrackerDataManager  *manager,
-                                          TrackerDBVersion     version,
-                                          GError             **error)
+migrate_graphs_in_shadow (TrackerDataManager  *manager,
+                          GHashTable          *graphs,
+                          gboolean             update_fts,
+                          GError             **error)
 {
-	TrackerDBInterface *iface;
-	GError *internal_error = NULL;
+	/* From here on, index changes in the ontology are deferred
+	 * to the shadow databases, see fix_indexed().
+	 */
+	manager->shadow_index_fixes =
+		g_hash_table_new_full (NULL, NULL, g_object_unref, NULL);
 
-	iface = tracker_data_manager_get_writable_db_interface (manager);
+	TRACKER_NOTE (ONTOLOGY_CHANGES,
+	              g_message ("  Applying ontology changes to %u graphs in shadow databases",
+	                         g_hash_table_size (graphs)));
 
-	if (version < TRACKER_DB_VERSION_3_3) {
-		/* Anonymous blank nodes, remove "NOT NULL" restriction
-		 * from Resource.Uri.
-		 */
-		tracker_db_interface_execute_query (iface, &internal_error,
-		                                    "CREATE TABLE Resource_TEMP (ID INTEGER NOT NULL PRIMARY KEY,"
-		                                    " Uri TEXT, BlankNode INTEGER DEFAULT 0, UNIQUE (Uri))");
-		if (internal_error)
-			goto error;
+	return run_on_shadow_graphs (manager, graphs, TRUE,
+	                             apply_ontology_changes_to_graph,
+	                             GINT_TO_POINTER (update_fts),
+	                             error);
+}
 
-		tracker_db_interface_execute_query (iface, &internal_error,
-		                                    "INSERT INTO Resource_TEMP SELECT * FROM Resource");
-		if (internal_error)
-			goto error;
+static gboolean
+prepare_shadow_graphs_swap (TrackerDataManager  *manager,
+                            GError             **error)
+{
+	if (g_hash_table_size (manager->shadow_index_fixes) > 0) {
+		GHashTable *graphs;
+		GPtrArray *properties;
+		GHashTableIter iter;
+		gpointer property;
+		gboolean retval;
 
-		tracker_db_interface_execute_query (iface, &internal_error,
-		                                    "DROP TABLE Resource");
-		if (internal_error)
-			goto error;
+		properties = g_ptr_array_new ();
+		g_hash_table_iter_init (&iter, manager->shadow_index_fixes);
 
-		tracker_db_interface_execute_query (iface, &internal_error,
-		                                    "ALTER TABLE Resource_TEMP RENAME TO Resource");
-		if (internal_error)
-			goto error;
+		while (g_hash_table_iter_next (&iter, &property, NULL))
+			g_ptr_array_add (properties, property);
+
+		graphs = tracker_data_manager_get_graphs (manager, FALSE);
+		retval = run_on_shadow_graphs (manager, graphs, FALSE,
+		                               fix_indexes_in_graph, properties,
+		                               error);
+		g_hash_table_unref (graphs);
+		g_ptr_array_unref (properties);
+
+		if (!retval)
+			return FALSE;
 	}
 
-	if (version < TRACKER_DB_VERSION_3_6) {
-		GHashTableIter iter;
-		const gchar *graph;
+	/* This is committed along with the ontology changes in the main
+	 * database, the copies are swapped in right after that, or on the
+	 * next startup if that gets interrupted.
+	 */
+	tracker_db_manager_set_shadow_databases_pending (manager->db_manager, TRUE);
 
-		if (!tracker_db_interface_sqlite_fts_delete_table (iface, "main", &internal_error))
-			goto error;
-		if (!tracker_data_manager_update_fts (manager, iface, "main", &internal_error))
-			goto error;
+	return TRUE;
+}
 
-		g_hash_table_iter_init (&iter, manager->graphs);
+static gboolean
+swap_shadow_graphs (TrackerDataManager  *manager,
+                    TrackerDBInterface  *iface,
+                    gboolean             attached,
+                    GError             **error)
+{
+	TrackerDBManager *db_manager = manager->db_manager;
+	GHashTable *graphs;
+	GHashTableIter iter;
+	gpointer value;
+	gboolean retval = TRUE;
 
-		while (g_hash_table_iter_next (&iter, (gpointer *) &graph, NULL)) {
-			if (!tracker_db_interface_sqlite_fts_delete_table (iface, graph, &internal_error))
-				goto error;
-			if (!tracker_data_manager_update_fts (manager, iface, graph, &internal_error))
-				goto error;
+	/* Pooled connections must not keep the replaced files open */
+	if (attached)
+		tracker_db_manager_release_memory (db_manager);
+
+	graphs = tracker_data_manager_get_graphs (manager, FALSE);
+	g_hash_table_iter_init (&iter, graphs);
+
+	while (retval && g_hash_table_iter_next (&iter, &value, NULL)) {
+		if (attached) {
+			retval = tracker_db_manager_detach_database (db_manager, iface,
+			                                             value, error);
 		}
+
+		if (retval)
+			retval = tracker_db_manager_swap_shadow_database (db_manager, value, error);
+	}
+
+	g_hash_table_unref (graphs);
+
+	if (!retval)
+		return FALSE;
+
+	tracker_db_manager_set_shadow_databases_pending (db_manager, FALSE);
+
+	TRACKER_NOTE (ONTOLOGY_CHANGES, g_message ("  Swapped in migrated graph databases"));
+
+	if (attached) {
+		if (!tracker_data_manager_initialize_iface (manager, iface, error))
+			return FALSE;
+
+		/* Schema versions of the replaced files are meaningless */
+		g_mutex_lock (&manager->graphs_lock);
+		g_clear_pointer (&manager->graph_schema_versions, g_hash_table_unref);
+		manager->graph_tables_serial++;
+		g_mutex_unlock (&manager->graphs_lock);
+
+		if (!tracker_data_manager_initialize_graph_tables (manager, iface, error))
+			return FALSE;
 	}
 
-	tracker_db_manager_update_version (manager->db_manager);
 	return TRUE;
+}
 
-error:
-	g_propagate_error (error, internal_error);
-	return FALSE;
+static void
+discard_shadow_graphs (TrackerDataManager *manager)
+{
+	GHashTable *graphs;
+	GHashTableIter iter;
+	gpointer value;
+
+	graphs = tracker_data_manager_get_graphs (manager, FALSE);
+	g_hash_table_iter_init (&iter, graphs);
+
+	while (g_hash_table_iter_next (&iter, &value, NULL))
+		tracker_db_manager_delete_shadow_database (manager->db_manager, value);
+
+	g_hash_table_unref (graphs);
 }
 
 static gboolean
@@ -4086,7 +6323,8 @@ tracker_data_manager_initable_init (GInitable     *initable,
 	GHashTable *ontos_table;
 	GHashTable *graphs = NULL;
 	GList *sorted = NULL, *l;
-	gboolean read_only;
+	gboolean read_only, snapshot_outdated = TRUE;
+	gint snapshot_schema_version = 0;
 	GError *internal_error = NULL;
 
 	if (manager->initialized) {
@@ -4110,6 +6348,7 @@ tracker_data_manager_initable_init (GInitable     *initable,
 	manager->db_manager = tracker_db_manager_new (manager->flags,
 	                                              manager->cache_location,
 	                                              manager->select_cache_size,
+	                                              manager->options,
 	                                              G_OBJECT (manager),
 	                                              &internal_error);
 	if (!manager->db_manager) {
@@ -4170,6 +6409,8 @@ tracker_data_manager_initable_init (GInitable     *initable,
 			return FALSE;
 		}
 
+		manager->table_rows = graph_table_rows_new ();
+
 		tracker_db_manager_update_version (manager->db_manager);
 
 		for (l = sorted; l; l = l->next) {
@@ -4227,12 +6468,22 @@ tracker_data_manager_initable_init (GInitable     *initable,
 			goto rollback_newly_created_db;
 		}
 
+		if (!update_closure_tables (manager, iface, &internal_error)) {
+			g_propagate_error (error, internal_error);
+			goto rollback_newly_created_db;
+		}
+
 		tracker_data_manager_initialize_iface (manager, iface, &internal_error);
 		if (internal_error) {
 			g_propagate_error (error, internal_error);
 			goto rollback_newly_created_db;
 		}
 
+		if (!tracker_data_manager_initialize_graph_tables (manager, iface, &internal_error)) {
+			g_propagate_error (error, internal_error);
+			goto rollback_newly_created_db;
+		}
+
 		/* store ontology in database */
 		for (l = sorted; l; l = l->next) {
 			import_ontology_file (manager, l->data, FALSE, &internal_error);
@@ -4285,6 +6536,20 @@ tracker_data_manager_initable_init (GInitable     *initable,
 			} else {
 				load_from_db = FALSE;
 			}
+		} else {
+			GError *snapshot_error = NULL;
+
+			g_debug ("Loading cached ontologies from snapshot");
+
+			if (load_ontology_snapshot (manager, iface,
+			                            &snapshot_schema_version,
+			                            &snapshot_error)) {
+				snapshot_outdated = FALSE;
+				load_from_db = FALSE;
+			} else {
+				g_debug ("Error loading ontology snapshot: %s. ", snapshot_error->message);
+				g_clear_error (&snapshot_error);
+			}
 		}
 
 		if (load_from_db) {
@@ -4309,12 +6574,31 @@ tracker_data_manager_initable_init (GInitable     *initable,
 			return FALSE;
 		}
 
+		/* Finish or undo ontology changes to graphs that got interrupted */
+		if (!read_only) {
+			if (tracker_db_manager_get_shadow_databases_pending (manager->db_manager)) {
+				if (!swap_shadow_graphs (manager, iface, FALSE, &internal_error)) {
+					g_propagate_error (error, internal_error);
+					return FALSE;
+				}
+			} else if (tracker_db_manager_supports_shadow_databases (manager->db_manager)) {
+				discard_shadow_graphs (manager);
+			}
+		}
+
 		tracker_data_manager_initialize_iface (manager, iface, &internal_error);
 		if (internal_error) {
 			g_propagate_error (error, internal_error);
 			return FALSE;
 		}
 
+		if (!tracker_data_manager_initialize_graph_tables (manager, iface, &internal_error)) {
+			g_propagate_error (error, internal_error);
+			return FALSE;
+		}
+
+		initialize_table_rows (manager, iface);
+
 		if (!read_only && tracker_db_manager_needs_repair (manager->db_manager)) {
 			if (!tracker_data_manager_attempt_repair (manager, iface, error))
 				return FALSE;
@@ -4543,28 +6827,16 @@ tracker_data_manager_initable_init (GInitable     *initable,
 					graphs = tracker_data_manager_get_graphs (manager, FALSE);
 
 				if (graphs) {
-					GHashTableIter iter;
-					gpointer value;
-
-					g_hash_table_iter_init (&iter, graphs);
-
-					while (g_hash_table_iter_next (&iter, &value, NULL)) {
-						if (update_fts)
-							tracker_db_interface_sqlite_fts_delete_table (iface, value, &ontology_error);
-
-						if (ontology_error)
-							break;
-
-						tracker_data_ontology_setup_db (manager, iface, value, TRUE,
-						                                &ontology_error);
-						if (ontology_error)
-							break;
-
-						if (update_fts)
-							tracker_data_manager_update_fts (manager, iface, value, &ontology_error);
-
-						if (ontology_error)
-							break;
+					/* Graph databases are migrated in parallel on
+					 * copies, unless those can't be made.
+					 */
+					if (g_hash_table_size (graphs) > 0 &&
+					    tracker_db_manager_supports_shadow_databases (manager->db_manager)) {
+						migrate_graphs_in_shadow (manager, graphs, update_fts,
+						                          &ontology_error);
+					} else {
+						migrate_graphs_in_place (manager, iface, graphs, update_fts,
+						                         &ontology_error);
 					}
 
 					g_hash_table_unref (graphs);
@@ -4581,6 +6853,9 @@ tracker_data_manager_initable_init (GInitable     *initable,
 					                                               seen_properties,
 					                                               &ontology_error);
 				}
+
+				if (!ontology_error && manager->shadow_index_fixes)
+					prepare_shadow_graphs_swap (manager, &ontology_error);
 			}
 
 			if (ontology_error) {
@@ -4607,7 +6882,16 @@ tracker_data_manager_initable_init (GInitable     *initable,
 			}
 			g_list_free (to_reload);
 
+			if (!update_closure_tables (manager, iface, &internal_error)) {
+				g_propagate_error (error, internal_error);
+				goto rollback_db_changes;
+			}
+
 			tracker_data_ontology_process_changes_post_import (seen_classes, seen_properties);
+			snapshot_outdated = TRUE;
+
+			/* Data may have moved between tables */
+			tracker_db_manager_set_table_stats_outdated (manager->db_manager, TRUE);
 
 			if (!write_ontologies_gvdb (manager, TRUE /* overwrite */, &internal_error)) {
 				g_propagate_error (error, internal_error);
@@ -4629,6 +6913,15 @@ tracker_data_manager_initable_init (GInitable     *initable,
 			}
 		}
 
+		if (manager->shadow_index_fixes) {
+			g_clear_pointer (&manager->shadow_index_fixes, g_hash_table_unref);
+
+			if (!swap_shadow_graphs (manager, iface, TRUE, &internal_error)) {
+				g_propagate_error (error, internal_error);
+				return FALSE;
+			}
+		}
+
 		g_hash_table_unref (ontos_table);
 		g_list_free_full (ontos, g_object_unref);
 
@@ -4642,9 +6935,7 @@ tracker_data_manager_initable_init (GInitable     *initable,
 		 * No need to reset the collator in the db interface,
 		 * as this is only executed during startup, which should
 		 * already have the proper locale set in the collator */
-		tracker_data_manager_recreate_indexes (manager, &internal_error);
-
-		if (internal_error) {
+		if (!tracker_data_manager_recreate_indexes (manager, &internal_error)) {
 			g_propagate_error (error, internal_error);
 			return FALSE;
 		}
@@ -4660,6 +6951,29 @@ tracker_data_manager_initable_init (GInitable     *initable,
 
 	if (!read_only) {
 		tracker_ontologies_sort (manager->ontologies);
+
+		/* Refresh the snapshot after ontology changes, or if e.g.
+		 * index re-creation changed the schema it was written for.
+		 */
+		if (snapshot_outdated ||
+		    snapshot_schema_version != get_main_schema_version (iface)) {
+			if (!write_ontology_snapshot (manager, iface, &internal_error)) {
+				g_debug ("Could not write ontology snapshot: %s", internal_error->message);
+				g_clear_error (&internal_error);
+			}
+		}
+	}
+
+	if (!read_only && manager->table_rows &&
+	    tracker_db_manager_get_table_stats_outdated (manager->db_manager)) {
+		/* Statistics only guide query planning, stay usable
+		 * without them being up to date.
+		 */
+		if (!recount_table_rows (manager, iface, &internal_error)) {
+			g_warning ("Could not update table statistics: %s",
+			           internal_error->message);
+			g_clear_error (&internal_error);
+		}
 	}
 
 	manager->initialized = TRUE;
@@ -4670,16 +6984,47 @@ rollback_db_changes:
 	tracker_data_ontology_import_finished (manager);
 	tracker_data_rollback_transaction (manager->data_update);
 
-	if (ontos_table) {
-		g_hash_table_unref (ontos_table);
+	if (manager->shadow_index_fixes) {
+		g_clear_pointer (&manager->shadow_index_fixes, g_hash_table_unref);
+		discard_shadow_graphs (manager);
+	}
+
+	if (ontos_table) {
+		g_hash_table_unref (ontos_table);
+	}
+
+	return FALSE;
+
+rollback_newly_created_db:
+	tracker_data_rollback_transaction (manager->data_update);
+	tracker_db_manager_rollback_db_creation (manager->db_manager);
+	return FALSE;
+}
+
+static gboolean
+has_compressed_uris (TrackerDBInterface *iface)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor;
+	gboolean found = FALSE;
+
+	stmt = tracker_db_interface_create_statement (iface,
+	                                              TRACKER_DB_STATEMENT_CACHE_TYPE_NONE,
+	                                              NULL,
+	                                              "SELECT 1 FROM \"main\".sqlite_master "
+	                                              "WHERE type = 'table' AND name = 'ResourcePrefix'");
+	if (!stmt)
+		return FALSE;
+
+	cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, NULL));
+	g_object_unref (stmt);
+
+	if (cursor) {
+		found = tracker_sparql_cursor_next (cursor, NULL, NULL);
+		g_object_unref (cursor);
 	}
 
-	return FALSE;
-
-rollback_newly_created_db:
-	tracker_data_rollback_transaction (manager->data_update);
-	tracker_db_manager_rollback_db_creation (manager->db_manager);
-	return FALSE;
+	return found;
 }
 
 static gboolean
@@ -4726,6 +7071,17 @@ data_manager_perform_cleanup (TrackerDataManager  *manager,
 	tracker_db_statement_execute (stmt, &internal_error);
 	g_object_unref (stmt);
 
+	if (internal_error)
+		goto fail;
+
+	if (has_compressed_uris (iface)) {
+		/* Drop prefixes no longer used by any resource */
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "DELETE FROM ResourcePrefix "
+		                                    "WHERE ID NOT IN (SELECT Prefix FROM ResourceData "
+		                                    "WHERE Prefix IS NOT NULL)");
+	}
+
 fail:
 	if (internal_error) {
 		g_propagate_error (error, internal_error);
@@ -4779,7 +7135,13 @@ tracker_data_manager_finalize (GObject *object)
 	g_clear_object (&manager->ontologies);
 	g_clear_object (&manager->ontology_location);
 	g_clear_object (&manager->cache_location);
+	g_clear_pointer (&manager->options, g_variant_unref);
 	g_clear_pointer (&manager->graphs, g_hash_table_unref);
+	g_clear_pointer (&manager->graph_tables, g_hash_table_unref);
+	g_clear_pointer (&manager->graph_schema_versions, g_hash_table_unref);
+	g_clear_pointer (&manager->table_rows, g_hash_table_unref);
+	g_clear_pointer (&manager->transaction_table_rows, g_hash_table_unref);
+	g_clear_pointer (&manager->shadow_index_fixes, g_hash_table_unref);
 	g_mutex_clear (&manager->connections_lock);
 	g_mutex_clear (&manager->graphs_lock);
 
@@ -4799,6 +7161,17 @@ tracker_data_manager_class_init (TrackerDataManagerClass *klass)
 
 	object_class->dispose = tracker_data_manager_dispose;
 	object_class->finalize = tracker_data_manager_finalize;
+
+	/* Emitted from the initializing thread as ontology changes
+	 * are applied to each graph database.
+	 */
+	signals[MIGRATION_PROGRESS] =
+		g_signal_new ("migration-progress",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST, 0,
+		              NULL, NULL, NULL,
+		              G_TYPE_NONE, 3,
+		              G_TYPE_STRING, G_TYPE_UINT, G_TYPE_UINT);
 }
 
 TrackerOntologies *
@@ -4884,6 +7257,154 @@ copy_graphs (GHashTable *graphs)
 	return copy;
 }
 
+static gint
+get_main_schema_version (TrackerDBInterface *iface)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor;
+	gint version = 0;
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE,
+	                                              NULL, "PRAGMA main.schema_version");
+	if (!stmt)
+		return 0;
+
+	cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, NULL));
+	g_object_unref (stmt);
+
+	if (cursor) {
+		if (tracker_sparql_cursor_next (cursor, NULL, NULL))
+			version = tracker_sparql_cursor_get_integer (cursor, 0);
+		g_object_unref (cursor);
+	}
+
+	return version;
+}
+
+static gint
+get_database_file_user_version (GFile *file)
+{
+	GFileInputStream *stream;
+	guchar header[64];
+	gsize bytes_read;
+	gboolean retval;
+
+	stream = g_file_read (file, NULL, NULL);
+	if (!stream)
+		return 0;
+
+	retval = g_input_stream_read_all (G_INPUT_STREAM (stream),
+	                                  header, sizeof (header),
+	                                  &bytes_read, NULL, NULL);
+	g_object_unref (stream);
+
+	if (!retval || bytes_read != sizeof (header))
+		return 0;
+
+	/* The user version is stored as a big-endian 32 bit
+	 * integer at offset 60 of the SQLite file header.
+	 */
+	return (gint) (((guint32) header[60] << 24) |
+	               ((guint32) header[61] << 16) |
+	               ((guint32) header[62] << 8) |
+	               ((guint32) header[63]));
+}
+
+static gboolean
+copy_graph_template (TrackerDataManager *manager,
+                     TrackerDBInterface *iface,
+                     const gchar        *name)
+{
+	GFile *template, *file;
+	gint schema_version;
+	gboolean retval = FALSE;
+
+	template = tracker_db_manager_get_database_file (manager->db_manager,
+	                                                 GRAPH_TEMPLATE_NAME);
+	if (!template)
+		return FALSE;
+
+	/* The template is only valid for the main database schema it
+	 * was created from, ontology changes bump the schema version.
+	 */
+	schema_version = get_main_schema_version (iface);
+
+	if (schema_version != 0 &&
+	    get_database_file_user_version (template) == schema_version) {
+		file = tracker_db_manager_get_database_file (manager->db_manager, name);
+		retval = g_file_copy (template, file, G_FILE_COPY_OVERWRITE,
+		                      NULL, NULL, NULL, NULL);
+		g_object_unref (file);
+	}
+
+	g_object_unref (template);
+
+	return retval;
+}
+
+static void
+tracker_data_manager_update_graph_template (TrackerDataManager *manager)
+{
+	TrackerDBInterface *iface;
+	GError *error = NULL;
+	GFile *template;
+
+	iface = tracker_db_manager_get_writable_db_interface (manager->db_manager);
+
+	if (!tracker_db_manager_attach_database (manager->db_manager, iface,
+	                                         GRAPH_TEMPLATE_NAME, TRUE, &error))
+		goto error;
+
+	if (!tracker_db_interface_start_transaction (iface)) {
+		g_set_error (&error, TRACKER_DB_INTERFACE_ERROR, TRACKER_DB_QUERY_ERROR,
+		             "Could not start transaction");
+		goto detach;
+	}
+
+	if (!tracker_data_ontology_setup_db (manager, iface, GRAPH_TEMPLATE_NAME,
+	                                     FALSE, &error) ||
+	    !tracker_data_manager_init_fts (manager, iface, GRAPH_TEMPLATE_NAME, &error)) {
+		tracker_db_interface_execute_query (iface, NULL, "ROLLBACK");
+		goto detach;
+	}
+
+	if (!tracker_db_interface_end_db_transaction (iface, &error))
+		goto detach;
+
+	/* Leave a self-contained file behind, tagged with the schema
+	 * version it was created from.
+	 */
+	tracker_db_interface_execute_query (iface, &error,
+	                                    "PRAGMA \"%s\".user_version = %d",
+	                                    GRAPH_TEMPLATE_NAME,
+	                                    get_main_schema_version (iface));
+	if (!error) {
+		tracker_db_interface_execute_query (iface, &error,
+		                                    "PRAGMA \"%s\".journal_mode = DELETE",
+		                                    GRAPH_TEMPLATE_NAME);
+	}
+
+detach:
+	tracker_db_manager_detach_database (manager->db_manager, iface,
+	                                    GRAPH_TEMPLATE_NAME, NULL);
+error:
+	if (error) {
+		g_debug ("Could not create graph template: %s", error->message);
+		g_error_free (error);
+
+		template = tracker_db_manager_get_database_file (manager->db_manager,
+		                                                 GRAPH_TEMPLATE_NAME);
+		g_file_delete (template, NULL, NULL);
+		g_object_unref (template);
+	}
+}
+
+/* Each named graph lives in its own attached database, so the number
+ * of graphs is bound by SQLite's attached database limit and queries
+ * over the union graph still UNION ALL across all of them. The schema
+ * template only makes creating those databases cheap, it does not
+ * change that layout.
+ */
 gboolean
 tracker_data_manager_create_graph (TrackerDataManager  *manager,
                                    const gchar         *name,
@@ -4894,15 +7415,31 @@ tracker_data_manager_create_graph (TrackerDataManager  *manager,
 
 	iface = tracker_db_manager_get_writable_db_interface (manager->db_manager);
 
-	if (!tracker_db_manager_attach_database (manager->db_manager, iface,
-	                                         name, TRUE, error))
-		return FALSE;
+	if (copy_graph_template (manager, iface, name)) {
+		/* The copied template has the full schema in place */
+		if (!tracker_db_manager_attach_database (manager->db_manager, iface,
+		                                         name, FALSE, error))
+			return FALSE;
+	} else {
+		if (!tracker_db_manager_attach_database (manager->db_manager, iface,
+		                                         name, TRUE, error))
+			return FALSE;
 
-	if (!tracker_data_ontology_setup_db (manager, iface, name,
-	                                     FALSE, error))
-		goto detach;
+		if (!tracker_data_ontology_setup_db (manager, iface, name,
+		                                     FALSE, error))
+			goto detach;
+
+		if (!tracker_data_manager_init_fts (manager, iface, name, error))
+			goto detach;
+
+		/* Create a template after commit, so further graphs are
+		 * created by copying it.
+		 */
+		if (manager->cache_location)
+			manager->update_graph_template = TRUE;
+	}
 
-	if (!tracker_data_manager_init_fts (manager, iface, name, error))
+	if (!update_transaction_graph_tables (manager, iface, name, error))
 		goto detach;
 
 	id = tracker_data_ensure_graph (manager->data_update, name, error);
@@ -4946,12 +7483,24 @@ tracker_data_manager_drop_graph (TrackerDataManager  *manager,
 	if (!tracker_data_delete_graph (manager->data_update, name, error))
 		return FALSE;
 
+	reset_table_rows (manager, name);
+
 	if (!manager->transaction_graphs)
 		manager->transaction_graphs = copy_graphs (manager->graphs);
 
 	g_hash_table_remove (manager->transaction_graphs, name);
 
-	return TRUE;
+	g_mutex_lock (&manager->graphs_lock);
+
+	if (!manager->transaction_graph_tables)
+		manager->transaction_graph_tables = copy_graph_tables (manager->graph_tables);
+
+	g_hash_table_remove (manager->transaction_graph_tables, name);
+	manager->graph_tables_serial++;
+
+	g_mutex_unlock (&manager->graphs_lock);
+
+	return rebuild_closure_tables (manager, iface, error);
 }
 
 TrackerRowid
@@ -4969,6 +7518,79 @@ tracker_data_manager_find_graph (TrackerDataManager *manager,
 	return graph_id;
 }
 
+gboolean
+tracker_data_manager_graph_has_table (TrackerDataManager *manager,
+                                      const gchar        *graph,
+                                      const gchar        *table_name,
+                                      gboolean            in_transaction)
+{
+	GHashTable *graph_tables, *tables = NULL;
+	gboolean retval = TRUE;
+
+	if (!graph || strcmp (graph, "main") == 0)
+		return TRUE;
+
+	g_mutex_lock (&manager->graphs_lock);
+
+	if (manager->transaction_graph_tables && in_transaction)
+		graph_tables = manager->transaction_graph_tables;
+	else
+		graph_tables = manager->graph_tables;
+
+	/* Graphs with unknown tables are not queried, rather than
+	 * referencing tables that might not exist.
+	 */
+	if (graph_tables) {
+		tables = g_hash_table_lookup (graph_tables, graph);
+		retval = tables && g_hash_table_contains (tables, table_name);
+	}
+
+	g_mutex_unlock (&manager->graphs_lock);
+
+	return retval;
+}
+
+gboolean
+tracker_data_manager_ensure_graph_table (TrackerDataManager  *manager,
+                                         const gchar         *graph,
+                                         TrackerClass        *class,
+                                         GError             **error)
+{
+	TrackerDBInterface *iface;
+	GError *inner_error = NULL;
+
+	if (tracker_data_manager_graph_has_table (manager, graph,
+	                                          tracker_class_get_name (class),
+	                                          TRUE))
+		return TRUE;
+
+	TRACKER_NOTE (SQL_STATEMENTS,
+	              g_message ("Creating tables for class '%s' in graph '%s'",
+	                         tracker_class_get_name (class), graph));
+
+	iface = tracker_db_manager_get_writable_db_interface (manager->db_manager);
+	create_decomposed_metadata_tables (manager, iface, graph, class,
+	                                   FALSE, &inner_error);
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	return update_transaction_graph_tables (manager, iface, graph, error);
+}
+
+guint
+tracker_data_manager_get_graph_tables_serial (TrackerDataManager *manager)
+{
+	guint serial;
+
+	g_mutex_lock (&manager->graphs_lock);
+	serial = manager->graph_tables_serial;
+	g_mutex_unlock (&manager->graphs_lock);
+
+	return serial;
+}
+
 gboolean
 tracker_data_manager_clear_graph (TrackerDataManager  *manager,
                                   const gchar         *graph,
@@ -4992,6 +7614,10 @@ tracker_data_manager_clear_graph (TrackerDataManager  *manager,
 	for (i = 0; !inner_error && i < n_classes; i++) {
 		if (g_str_has_prefix (tracker_class_get_name (classes[i]), "xsd:"))
 			continue;
+		if (!tracker_data_manager_graph_has_table (manager, graph,
+		                                           tracker_class_get_name (classes[i]),
+		                                           TRUE))
+			continue;
 
 		stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &inner_error,
 		                                               "DELETE FROM \"%s\".\"%s\"",
@@ -5010,6 +7636,11 @@ tracker_data_manager_clear_graph (TrackerDataManager  *manager,
 		if (!tracker_property_get_multiple_values (properties[i]))
 			continue;
 
+		if (!tracker_data_manager_graph_has_table (manager, graph,
+		                                           tracker_property_get_table_name (properties[i]),
+		                                           TRUE))
+			continue;
+
 		service = tracker_property_get_domain (properties[i]);
 		stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &inner_error,
 		                                               "DELETE FROM \"%s\".\"%s_%s\"",
@@ -5027,6 +7658,12 @@ tracker_data_manager_clear_graph (TrackerDataManager  *manager,
 					    &inner_error,
 					    "DELETE FROM \"%s\".Refcount",
 					    graph);
+	if (inner_error)
+		goto out;
+
+	reset_table_rows (manager, graph);
+
+	rebuild_closure_tables (manager, iface, &inner_error);
 out:
 
 	if (inner_error) {
@@ -5066,6 +7703,13 @@ tracker_data_manager_copy_graph (TrackerDataManager  *manager,
 	for (i = 0; !inner_error && i < n_classes; i++) {
 		if (g_str_has_prefix (tracker_class_get_name (classes[i]), "xsd:"))
 			continue;
+		if (!tracker_data_manager_graph_has_table (manager, source,
+		                                           tracker_class_get_name (classes[i]),
+		                                           TRUE))
+			continue;
+		if (!tracker_data_manager_ensure_graph_table (manager, destination,
+		                                              classes[i], &inner_error))
+			break;
 
 		stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &inner_error,
 		                                               "INSERT OR REPLACE INTO \"%s\".\"%s\" "
@@ -5087,6 +7731,11 @@ tracker_data_manager_copy_graph (TrackerDataManager  *manager,
 		if (!tracker_property_get_multiple_values (properties[i]))
 			continue;
 
+		if (!tracker_data_manager_graph_has_table (manager, source,
+		                                           tracker_property_get_table_name (properties[i]),
+		                                           TRUE))
+			continue;
+
 		service = tracker_property_get_domain (properties[i]);
 		stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &inner_error,
 		                                               "INSERT OR REPLACE INTO \"%s\".\"%s_%s\" "
@@ -5121,6 +7770,13 @@ tracker_data_manager_copy_graph (TrackerDataManager  *manager,
 	                                    "(SELECT Refcount FROM \"%s\".Refcount AS A "
 	                                    "WHERE B.ID = A.ID)",
 	                                    destination, source);
+	if (inner_error)
+		goto out;
+
+	if (!count_graph_table_rows (manager, iface, destination, &inner_error))
+		goto out;
+
+	rebuild_closure_tables (manager, iface, &inner_error);
 out:
 	if (inner_error) {
 		g_propagate_error (error, inner_error);
@@ -5136,6 +7792,175 @@ tracker_data_manager_get_generation (TrackerDataManager *manager)
 	return manager->generation;
 }
 
+void
+tracker_data_manager_add_table_rows (TrackerDataManager *manager,
+                                     const gchar        *graph,
+                                     const gchar        *table,
+                                     gint64              delta)
+{
+	TableRowsChange *change;
+
+	if (!manager->table_rows || delta == 0)
+		return;
+
+	change = ensure_table_rows_change (manager, graph);
+	table_rows_add (change->rows, table, delta);
+}
+
+/* Stores the row count changes of the current transaction */
+gboolean
+tracker_data_manager_flush_table_rows (TrackerDataManager  *manager,
+                                       TrackerDBInterface  *iface,
+                                       GError             **error)
+{
+	GHashTableIter iter, rows_iter;
+	TableRowsChange *change;
+	TrackerDBStatement *stmt;
+	GError *inner_error = NULL;
+	gpointer graph, table, value;
+
+	if (!manager->transaction_table_rows)
+		return TRUE;
+
+	g_hash_table_iter_init (&iter, manager->transaction_table_rows);
+
+	while (!inner_error &&
+	       g_hash_table_iter_next (&iter, &graph, (gpointer *) &change)) {
+		if (change->reset) {
+			stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &inner_error,
+			                                              "DELETE FROM \"main\".TableStats WHERE Graph = ?");
+			if (!stmt)
+				break;
+
+			tracker_db_statement_bind_text (stmt, 0, graph);
+			tracker_db_statement_execute (stmt, &inner_error);
+			g_object_unref (stmt);
+		}
+
+		g_hash_table_iter_init (&rows_iter, change->rows);
+
+		while (!inner_error &&
+		       g_hash_table_iter_next (&rows_iter, &table, &value)) {
+			gint64 delta = *((gint64 *) value);
+
+			if (delta == 0)
+				continue;
+
+			stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &inner_error,
+			                                              "INSERT OR IGNORE INTO \"main\".TableStats (Graph, Name, Rows) "
+			                                              "VALUES (?, ?, 0)");
+			if (!stmt)
+				break;
+
+			tracker_db_statement_bind_text (stmt, 0, graph);
+			tracker_db_statement_bind_text (stmt, 1, table);
+			tracker_db_statement_execute (stmt, &inner_error);
+			g_object_unref (stmt);
+
+			if (inner_error)
+				break;
+
+			stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &inner_error,
+			                                              "UPDATE \"main\".TableStats SET Rows = MAX (Rows + ?, 0) "
+			                                              "WHERE Graph = ? AND Name = ?");
+			if (!stmt)
+				break;
+
+			tracker_db_statement_bind_int (stmt, 0, delta);
+			tracker_db_statement_bind_text (stmt, 1, graph);
+			tracker_db_statement_bind_text (stmt, 2, table);
+			tracker_db_statement_execute (stmt, &inner_error);
+			g_object_unref (stmt);
+		}
+	}
+
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Returns the number of rows of a table in a graph, or in the union
+ * graph if @graph is %NULL. %FALSE is returned if no statistics are
+ * kept for this database.
+ */
+gboolean
+tracker_data_manager_get_table_rows (TrackerDataManager *manager,
+                                     const gchar        *graph,
+                                     const gchar        *table,
+                                     gint64             *rows)
+{
+	GHashTable *graph_rows;
+	gint64 *value;
+	gboolean retval = FALSE;
+
+	*rows = 0;
+
+	g_mutex_lock (&manager->graphs_lock);
+
+	if (manager->table_rows) {
+		if (graph) {
+			graph_rows = g_hash_table_lookup (manager->table_rows, graph);
+			value = graph_rows ? g_hash_table_lookup (graph_rows, table) : NULL;
+			if (value)
+				*rows = *value;
+		} else {
+			GHashTableIter iter;
+
+			g_hash_table_iter_init (&iter, manager->table_rows);
+
+			while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &graph_rows)) {
+				value = g_hash_table_lookup (graph_rows, table);
+				if (value)
+					*rows += *value;
+			}
+		}
+
+		retval = TRUE;
+	}
+
+	g_mutex_unlock (&manager->graphs_lock);
+
+	return retval;
+}
+
+static void
+apply_table_rows_changes (TrackerDataManager *manager)
+{
+	GHashTableIter iter, rows_iter;
+	TableRowsChange *change;
+	GHashTable *graph_rows;
+	gpointer graph, table, value;
+
+	g_hash_table_iter_init (&iter, manager->transaction_table_rows);
+
+	while (g_hash_table_iter_next (&iter, &graph, (gpointer *) &change)) {
+		if (change->reset)
+			g_hash_table_remove (manager->table_rows, graph);
+
+		graph_rows = g_hash_table_lookup (manager->table_rows, graph);
+		g_hash_table_iter_init (&rows_iter, change->rows);
+
+		while (g_hash_table_iter_next (&rows_iter, &table, &value)) {
+			gint64 *rows;
+
+			if (!graph_rows) {
+				graph_rows = table_rows_new ();
+				g_hash_table_insert (manager->table_rows,
+				                     g_strdup (graph), graph_rows);
+			}
+
+			table_rows_add (graph_rows, table, *((gint64 *) value));
+
+			rows = g_hash_table_lookup (graph_rows, table);
+			if (*rows < 0)
+				*rows = 0;
+		}
+	}
+}
+
 void
 tracker_data_manager_commit_graphs (TrackerDataManager *manager)
 {
@@ -5148,13 +7973,45 @@ tracker_data_manager_commit_graphs (TrackerDataManager *manager)
 		manager->generation++;
 	}
 
+	if (manager->transaction_graph_tables) {
+		g_clear_pointer (&manager->graph_tables, g_hash_table_unref);
+		manager->graph_tables = manager->transaction_graph_tables;
+		manager->transaction_graph_tables = NULL;
+		manager->generation++;
+	}
+
+	if (manager->transaction_table_rows) {
+		if (manager->table_rows)
+			apply_table_rows_changes (manager);
+		g_clear_pointer (&manager->transaction_table_rows, g_hash_table_unref);
+	}
+
 	g_mutex_unlock (&manager->graphs_lock);
+
+	/* Must happen outside of a transaction */
+	if (manager->update_graph_template) {
+		manager->update_graph_template = FALSE;
+		tracker_data_manager_update_graph_template (manager);
+	}
 }
 
 void
 tracker_data_manager_rollback_graphs (TrackerDataManager *manager)
 {
 	g_clear_pointer (&manager->transaction_graphs, g_hash_table_unref);
+	g_clear_pointer (&manager->transaction_table_rows, g_hash_table_unref);
+	manager->update_graph_template = FALSE;
+
+	if (manager->transaction_graph_tables) {
+		g_mutex_lock (&manager->graphs_lock);
+		g_clear_pointer (&manager->transaction_graph_tables, g_hash_table_unref);
+		g_mutex_unlock (&manager->graphs_lock);
+
+		/* Updates compiled during the transaction may refer to
+		 * tables that are now gone.
+		 */
+		manager->generation++;
+	}
 }
 
 void
@@ -60,7 +60,8 @@ GQuark   tracker_data_ontology_error_quark           (void);
 TrackerDataManager * tracker_data_manager_new        (TrackerDBManagerFlags   flags,
                                                       GFile                  *cache_location,
                                                       GFile                  *ontology_location,
-                                                      guint                   select_cache_size);
+                                                      guint                   select_cache_size,
+                                                      GVariant               *options);
 
 void                 tracker_data_manager_shutdown            (TrackerDataManager *manager);
 
@@ -97,6 +98,34 @@ TrackerRowid         tracker_data_manager_find_graph       (TrackerDataManager *
                                                             const gchar        *name,
                                                             gboolean            in_transaction);
 
+gboolean             tracker_data_manager_graph_has_table    (TrackerDataManager  *manager,
+                                                              const gchar         *graph,
+                                                              const gchar         *table_name,
+                                                              gboolean             in_transaction);
+gboolean             tracker_data_manager_ensure_graph_table (TrackerDataManager  *manager,
+                                                              const gchar         *graph,
+                                                              TrackerClass        *class,
+                                                              GError             **error);
+guint                tracker_data_manager_get_graph_tables_serial (TrackerDataManager *manager);
+
+void                 tracker_data_manager_add_table_rows     (TrackerDataManager  *manager,
+                                                              const gchar         *graph,
+                                                              const gchar         *table,
+                                                              gint64               delta);
+gboolean             tracker_data_manager_flush_table_rows   (TrackerDataManager  *manager,
+                                                              TrackerDBInterface  *iface,
+                                                              GError             **error);
+gboolean             tracker_data_manager_get_table_rows     (TrackerDataManager  *manager,
+                                                              const gchar         *graph,
+                                                              const gchar         *table,
+                                                              gint64              *rows);
+
+gboolean             tracker_data_manager_update_closure     (TrackerDataManager  *manager,
+                                                              TrackerDBInterface  *iface,
+                                                              TrackerProperty     *property,
+                                                              GHashTable          *ids,
+                                                              GError             **error);
+
 guint                tracker_data_manager_get_generation   (TrackerDataManager *manager);
 void                 tracker_data_manager_rollback_graphs (TrackerDataManager *manager);
 void                 tracker_data_manager_commit_graphs (TrackerDataManager *manager);
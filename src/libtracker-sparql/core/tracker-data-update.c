@@ -51,6 +51,9 @@ typedef struct _TrackerCommitDelegate TrackerCommitDelegate;
 
 #define UPDATE_LOG_SIZE 64
 
+/* Upper bound for blobs read from update streams */
+#define MAX_MESSAGE_DATA_SIZE (256 * 1024 * 1024)
+
 typedef enum {
 	TRACKER_LOG_CLASS_INSERT,
 	TRACKER_LOG_CLASS_UPDATE,
@@ -64,6 +67,8 @@ typedef enum
 {
 	TRACKER_BUS_OP_SPARQL,
 	TRACKER_BUS_OP_RDF,
+	TRACKER_BUS_OP_RESOURCE,
+	TRACKER_BUS_OP_STATEMENT,
 } TrackerBusOpType;
 
 typedef struct {
@@ -109,6 +114,8 @@ struct _TrackerDataUpdateBuffer {
 	 * coalesce single-valued property changes.
 	 */
 	GHashTable *class_updates;
+	/* TrackerProperty -> set of IDs, for nrl:closureIndexed properties */
+	GHashTable *closure_updates;
 
 	TrackerDBStatementMru stmt_mru;
 };
@@ -132,6 +139,7 @@ struct _TrackerDataUpdateBufferGraph {
 	TrackerDBStatement *query_rdf_types;
 	TrackerDBStatement *fts_delete;
 	TrackerDBStatement *fts_insert;
+	TrackerDBStatement *fts_select;
 	TrackerDBStatementMru values_mru;
 };
 
@@ -658,6 +666,7 @@ tracker_data_finalize (GObject *object)
 	g_clear_pointer (&data->update_buffer.properties, g_array_unref);
 	g_clear_pointer (&data->update_buffer.update_log, g_array_unref);
 	g_clear_pointer (&data->update_buffer.class_updates, g_hash_table_unref);
+	g_clear_pointer (&data->update_buffer.closure_updates, g_hash_table_unref);
 	g_clear_object (&data->update_buffer.insert_resource);
 	g_clear_object (&data->update_buffer.query_resource);
 	tracker_db_statement_mru_finish (&data->update_buffer.stmt_mru);
@@ -1053,22 +1062,8 @@ statement_bind_gvalue (TrackerDBStatement *stmt,
 		break;
 	default:
 		if (type == G_TYPE_DATE_TIME) {
-			GDateTime *datetime = g_value_get_boxed (value);
-
-			/* If we have anything that prevents a unix timestamp to be
-			 * lossless, we use the ISO8601 string.
-			 */
-			if (g_date_time_get_utc_offset (datetime) != 0 ||
-			    g_date_time_get_microsecond (datetime) != 0) {
-				gchar *str;
-
-				str = tracker_date_format_iso8601 (datetime);
-				tracker_db_statement_bind_text (stmt, idx, str);
-				g_free (str);
-			} else {
-				tracker_db_statement_bind_int (stmt, idx,
-				                               g_date_time_to_unix (datetime));
-			}
+			tracker_db_statement_bind_datetime (stmt, idx,
+			                                    g_value_get_boxed (value));
 		} else if (type == G_TYPE_BYTES) {
 			GBytes *bytes;
 			gconstpointer data;
@@ -1100,6 +1095,7 @@ tracker_data_ensure_update_statement (TrackerData          *data,
 {
 	TrackerDBStatement *stmt;
 	TrackerDBInterface *iface;
+	TrackerClass *class;
 	const gchar *database;
 
 	stmt = tracker_db_statement_mru_lookup (&data->update_buffer.stmt_mru, entry);
@@ -1111,6 +1107,18 @@ tracker_data_ensure_update_statement (TrackerData          *data,
 	iface = tracker_data_manager_get_writable_db_interface (data->manager);
 	database = entry->graph->graph ? entry->graph->graph : "main";
 
+	if (entry->type == TRACKER_LOG_MULTIVALUED_PROPERTY_CLEAR ||
+	    entry->type == TRACKER_LOG_MULTIVALUED_PROPERTY_DELETE ||
+	    entry->type == TRACKER_LOG_MULTIVALUED_PROPERTY_INSERT)
+		class = tracker_property_get_domain (entry->table.multivalued.property);
+	else
+		class = entry->table.class.class;
+
+	/* Named graphs get their tables created on first write */
+	if (!tracker_data_manager_ensure_graph_table (data->manager, database,
+	                                              class, error))
+		return NULL;
+
 	if (entry->type == TRACKER_LOG_MULTIVALUED_PROPERTY_CLEAR) {
 		stmt = tracker_db_interface_create_vstatement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, error,
 		                                               "DELETE FROM \"%s\".\"%s\" WHERE ID = ?",
@@ -1221,6 +1229,84 @@ tracker_data_ensure_update_statement (TrackerData          *data,
 	return stmt;
 }
 
+static void
+tracker_data_log_closure_update (TrackerData     *data,
+                                 TrackerProperty *property,
+                                 TrackerRowid     id)
+{
+	GHashTable *ids;
+
+	if (!tracker_property_get_closure_indexed (property))
+		return;
+
+	ids = g_hash_table_lookup (data->update_buffer.closure_updates, property);
+
+	if (!ids) {
+		ids = g_hash_table_new_full (tracker_rowid_hash, tracker_rowid_equal,
+		                             (GDestroyNotify) tracker_rowid_free, NULL);
+		g_hash_table_insert (data->update_buffer.closure_updates, property, ids);
+	}
+
+	g_hash_table_add (ids, tracker_rowid_copy (&id));
+}
+
+static gboolean
+tracker_data_flush_closures (TrackerData  *data,
+                             GError      **error)
+{
+	TrackerDBInterface *iface;
+	TrackerProperty *property;
+	GHashTableIter iter;
+	GHashTable *ids;
+
+	if (g_hash_table_size (data->update_buffer.closure_updates) == 0)
+		return TRUE;
+
+	iface = tracker_data_manager_get_writable_db_interface (data->manager);
+	g_hash_table_iter_init (&iter, data->update_buffer.closure_updates);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *) &property, (gpointer *) &ids)) {
+		if (!tracker_data_manager_update_closure (data->manager, iface,
+		                                          property, ids, error))
+			return FALSE;
+	}
+
+	g_hash_table_remove_all (data->update_buffer.closure_updates);
+
+	return TRUE;
+}
+
+/* Keeps track of the number of rows in each table */
+static void
+tracker_data_log_table_rows (TrackerData         *data,
+                             TrackerDataLogEntry *entry)
+{
+	TrackerDBInterface *iface;
+	const gchar *table;
+	gint changes;
+
+	if (entry->type == TRACKER_LOG_CLASS_UPDATE)
+		return;
+
+	iface = tracker_data_manager_get_writable_db_interface (data->manager);
+	changes = tracker_db_interface_sqlite_get_changes (iface);
+
+	if (entry->type == TRACKER_LOG_CLASS_INSERT ||
+	    entry->type == TRACKER_LOG_CLASS_DELETE)
+		table = tracker_class_get_name (entry->table.class.class);
+	else
+		table = tracker_property_get_table_name (entry->table.multivalued.property);
+
+	if (entry->type == TRACKER_LOG_CLASS_DELETE ||
+	    entry->type == TRACKER_LOG_MULTIVALUED_PROPERTY_DELETE ||
+	    entry->type == TRACKER_LOG_MULTIVALUED_PROPERTY_CLEAR)
+		changes = -changes;
+
+	tracker_data_manager_add_table_rows (data->manager,
+	                                     entry->graph->graph,
+	                                     table, changes);
+}
+
 static gboolean
 tracker_data_flush_log (TrackerData  *data,
                         GError      **error)
@@ -1240,12 +1326,17 @@ tracker_data_flush_log (TrackerData  *data,
 		if (!stmt)
 			return FALSE;
 
-		if (entry->type == TRACKER_LOG_CLASS_DELETE ||
-		    entry->type == TRACKER_LOG_MULTIVALUED_PROPERTY_CLEAR) {
+		if (entry->type == TRACKER_LOG_CLASS_DELETE) {
+			tracker_db_statement_bind_int (stmt, 0, entry->id);
+		} else if (entry->type == TRACKER_LOG_MULTIVALUED_PROPERTY_CLEAR) {
 			tracker_db_statement_bind_int (stmt, 0, entry->id);
+			tracker_data_log_closure_update (data, entry->table.multivalued.property,
+			                                 entry->id);
 		} else if (entry->type == TRACKER_LOG_MULTIVALUED_PROPERTY_DELETE ||
 		           entry->type == TRACKER_LOG_MULTIVALUED_PROPERTY_INSERT) {
 			tracker_db_statement_bind_int (stmt, 0, entry->id);
+			tracker_data_log_closure_update (data, entry->table.multivalued.property,
+			                                 entry->id);
 
 			property_entry = &g_array_index (entry->properties_ptr,
 			                                 TrackerDataPropertyEntry,
@@ -1278,6 +1369,8 @@ tracker_data_flush_log (TrackerData  *data,
 					statement_bind_gvalue (stmt, param++, &property_entry->value);
 				}
 
+				tracker_data_log_closure_update (data, property_entry->property,
+				                                 entry->id);
 				visited_properties = g_list_prepend (visited_properties, property_entry->property);
 			}
 
@@ -1291,6 +1384,8 @@ tracker_data_flush_log (TrackerData  *data,
 			g_propagate_error (error, inner_error);
 			return FALSE;
 		}
+
+		tracker_data_log_table_rows (data, entry);
 	}
 
 	return TRUE;
@@ -1480,6 +1575,7 @@ graph_buffer_free (TrackerDataUpdateBufferGraph *graph)
 	g_clear_object (&graph->query_rdf_types);
 	g_clear_object (&graph->fts_delete);
 	g_clear_object (&graph->fts_insert);
+	g_clear_object (&graph->fts_select);
 	g_hash_table_unref (graph->resources);
 	g_array_unref (graph->refcounts);
 	g_free (graph->graph);
@@ -1529,7 +1625,7 @@ tracker_data_ensure_graph_fts_stmts (TrackerData                   *data,
 	const gchar *database;
 	GPtrArray *properties;
 
-	if (G_LIKELY (graph->fts_insert && graph->fts_delete))
+	if (G_LIKELY (graph->fts_insert && graph->fts_delete && graph->fts_select))
 		return TRUE;
 
 	database = graph->graph ? graph->graph : "main";
@@ -1552,9 +1648,145 @@ tracker_data_ensure_graph_fts_stmts (TrackerData                   *data,
 			                                                  error);
 	}
 
+	if (graph->fts_insert && !graph->fts_select) {
+		graph->fts_select =
+			tracker_db_interface_sqlite_fts_select_text_stmt (iface,
+			                                                  database,
+			                                                  (const gchar **) properties->pdata,
+			                                                  error);
+	}
+
 	g_ptr_array_free (properties, TRUE);
 
-	return graph->fts_insert && graph->fts_delete;
+	return graph->fts_insert && graph->fts_delete && graph->fts_select;
+}
+
+static inline gboolean
+resource_needs_fts_update (TrackerDataUpdateBufferResource *resource,
+                           gboolean                         old_text)
+{
+	/* Old text is only removed from the index for existing resources */
+	return resource->fts_update && !(old_text && resource->create);
+}
+
+static gboolean
+tracker_data_flush_fts_batch (TrackerData                   *data,
+                              TrackerDataUpdateBufferGraph  *graph,
+                              GArray                        *ids,
+                              gboolean                       old_text,
+                              gboolean                       tokenize,
+                              GError                       **error)
+{
+	TrackerDBInterface *iface;
+	TrackerDBStatement *stmt;
+	gboolean success = TRUE;
+	guint i;
+
+	if (ids->len == 0)
+		return TRUE;
+
+	iface = tracker_data_manager_get_writable_db_interface (data->manager);
+
+	if (tokenize)
+		tracker_db_interface_sqlite_fts_tokenize_documents (iface);
+
+	stmt = old_text ? graph->fts_delete : graph->fts_insert;
+
+	for (i = 0; i < ids->len && success; i++) {
+		tracker_db_statement_bind_int (stmt, 0, g_array_index (ids, gint64, i));
+		success = tracker_db_statement_execute (stmt, error);
+	}
+
+	tracker_db_interface_sqlite_fts_clear_documents (iface);
+	g_array_set_size (ids, 0);
+
+	return success;
+}
+
+static gboolean
+tracker_data_update_graph_fts (TrackerData                   *data,
+                               TrackerDataUpdateBufferGraph  *graph,
+                               gboolean                       old_text,
+                               gboolean                       tokenize,
+                               gboolean                      *updated,
+                               GError                       **error)
+{
+	TrackerDataUpdateBufferResource *resource;
+	TrackerDBInterface *iface;
+	GHashTableIter iter;
+	GArray *ids;
+	gboolean success = FALSE;
+
+	iface = tracker_data_manager_get_writable_db_interface (data->manager);
+	ids = g_array_new (FALSE, FALSE, sizeof (gint64));
+	g_hash_table_iter_init (&iter, graph->resources);
+
+	/* When tokenizing, the text that FTS5 is about to add to (or
+	 * remove from) the index is fetched and tokenized in parallel
+	 * ahead of the index writes, which then just replay the
+	 * resulting tokens. This happens in batches, so the memory
+	 * held by the pending tokens is bounded.
+	 */
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &resource)) {
+		if (!resource_needs_fts_update (resource, old_text))
+			continue;
+
+		if (!tracker_data_ensure_graph_fts_stmts (data,
+		                                          graph,
+		                                          error))
+			goto out;
+
+		if (tokenize &&
+		    !tracker_db_interface_sqlite_fts_add_documents (iface,
+		                                                    graph->fts_select,
+		                                                    resource->id,
+		                                                    error))
+			goto out;
+
+		g_array_append_val (ids, resource->id);
+		*updated = TRUE;
+
+		if (tokenize &&
+		    tracker_db_interface_sqlite_fts_documents_full (iface) &&
+		    !tracker_data_flush_fts_batch (data, graph, ids,
+		                                   old_text, tokenize,
+		                                   error))
+			goto out;
+	}
+
+	success = tracker_data_flush_fts_batch (data, graph, ids,
+	                                        old_text, tokenize,
+	                                        error);
+out:
+	g_array_unref (ids);
+
+	return success;
+}
+
+static gboolean
+tracker_data_needs_fts_tokenization (TrackerData *data,
+                                     gboolean     old_text)
+{
+	TrackerDataUpdateBufferGraph *graph;
+	TrackerDataUpdateBufferResource *resource;
+	GHashTableIter iter;
+	guint i, n_resources = 0;
+
+	for (i = 0; i < data->update_buffer.graphs->len; i++) {
+		graph = g_ptr_array_index (data->update_buffer.graphs, i);
+		g_hash_table_iter_init (&iter, graph->resources);
+
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &resource)) {
+			if (resource_needs_fts_update (resource, old_text))
+				n_resources++;
+
+			/* Otherwise there is nothing to spread across threads */
+			if (n_resources >= 2)
+				return TRUE;
+		}
+	}
+
+	return FALSE;
 }
 
 void
@@ -1562,56 +1794,41 @@ tracker_data_update_buffer_flush (TrackerData  *data,
                                   GError      **error)
 {
 	TrackerDataUpdateBufferGraph *graph;
-	TrackerDataUpdateBufferResource *resource;
-	GHashTableIter iter;
+	TrackerDBInterface *iface;
 	GError *actual_error = NULL;
 	G_GNUC_UNUSED gboolean fts_updated = FALSE;
+	gboolean tokenize;
 	guint i;
 
 	if (data->update_buffer.update_log->len == 0)
 		return;
 
-	for (i = 0; i < data->update_buffer.graphs->len; i++) {
-		graph = g_ptr_array_index (data->update_buffer.graphs, i);
-		g_hash_table_iter_init (&iter, graph->resources);
+	iface = tracker_data_manager_get_writable_db_interface (data->manager);
 
-		while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &resource)) {
-			if (resource->fts_update && !resource->create) {
-				fts_updated = TRUE;
-				if (!tracker_data_ensure_graph_fts_stmts (data,
-				                                          graph,
-				                                          error))
-					goto out;
+	tokenize = tracker_data_needs_fts_tokenization (data, TRUE);
 
-				tracker_db_statement_bind_int (graph->fts_delete, 0, resource->id);
+	for (i = 0; i < data->update_buffer.graphs->len; i++) {
+		graph = g_ptr_array_index (data->update_buffer.graphs, i);
 
-				if (!tracker_db_statement_execute (graph->fts_delete, error))
-					goto out;
-			}
-		}
+		if (!tracker_data_update_graph_fts (data, graph, TRUE, tokenize,
+		                                    &fts_updated, error))
+			goto out;
 	}
 
 	if (!tracker_data_flush_log (data, error))
 		goto out;
 
-	for (i = 0; i < data->update_buffer.graphs->len; i++) {
-		graph = g_ptr_array_index (data->update_buffer.graphs, i);
-		g_hash_table_iter_init (&iter, graph->resources);
+	if (!tracker_data_flush_closures (data, error))
+		goto out;
 
-		while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &resource)) {
-			if (resource->fts_update) {
-				fts_updated = TRUE;
-				if (!tracker_data_ensure_graph_fts_stmts (data,
-				                                          graph,
-				                                          error))
-					goto out;
+	tokenize = tracker_data_needs_fts_tokenization (data, FALSE);
 
-				tracker_db_statement_bind_int (graph->fts_insert, 0, resource->id);
+	for (i = 0; i < data->update_buffer.graphs->len; i++) {
+		graph = g_ptr_array_index (data->update_buffer.graphs, i);
 
-				if (!tracker_db_statement_execute (graph->fts_insert, error))
-					goto out;
-			}
-		}
+		if (!tracker_data_update_graph_fts (data, graph, FALSE, tokenize,
+		                                    &fts_updated, error))
+			goto out;
 
 		tracker_data_flush_graph_refcounts (data, graph, &actual_error);
 		if (actual_error) {
@@ -1625,10 +1842,6 @@ tracker_data_update_buffer_flush (TrackerData  *data,
 
 #ifdef G_ENABLE_DEBUG
 	if (fts_updated && TRACKER_DEBUG_CHECK (FTS_INTEGRITY)) {
-		TrackerDBInterface *iface;
-
-		iface = tracker_data_manager_get_writable_db_interface (data->manager);
-
 		for (i = 0; i < data->update_buffer.graphs->len; i++) {
 			const gchar *database;
 
@@ -1648,8 +1861,10 @@ tracker_data_update_buffer_flush (TrackerData  *data,
 #endif
 
 out:
+	tracker_db_interface_sqlite_fts_clear_documents (iface);
 	g_hash_table_remove_all (data->update_buffer.new_resources);
 	g_hash_table_remove_all (data->update_buffer.class_updates);
+	g_hash_table_remove_all (data->update_buffer.closure_updates);
 	g_array_set_size (data->update_buffer.properties, 0);
 	g_array_set_size (data->update_buffer.update_log, 0);
 	data->resource_buffer = NULL;
@@ -1678,6 +1893,7 @@ tracker_data_update_buffer_clear (TrackerData *data)
 	g_hash_table_remove_all (data->update_buffer.new_resources);
 	g_hash_table_remove_all (data->update_buffer.resource_cache);
 	g_hash_table_remove_all (data->update_buffer.class_updates);
+	g_hash_table_remove_all (data->update_buffer.closure_updates);
 	g_array_set_size (data->update_buffer.properties, 0);
 	g_array_set_size (data->update_buffer.update_log, 0);
 	data->resource_buffer = NULL;
@@ -1940,7 +2156,10 @@ get_property_values (TrackerData      *data,
 	graph = data->resource_buffer->graph;
 	database = graph->graph ? graph->graph : "main";
 
-	if (!data->resource_buffer->create) {
+	if (!data->resource_buffer->create &&
+	    tracker_data_manager_graph_has_table (data->manager, database,
+	                                          tracker_property_get_table_name (property),
+	                                          TRUE)) {
 		TrackerDBStatement *stmt;
 
 		stmt = tracker_db_statement_mru_lookup (&graph->values_mru, property);
@@ -3115,6 +3334,8 @@ tracker_data_begin_transaction (TrackerData  *data,
 		data->update_buffer.update_log = g_array_sized_new (FALSE, TRUE, sizeof (TrackerDataLogEntry), UPDATE_LOG_SIZE);
 		data->update_buffer.class_updates = g_hash_table_new (tracker_data_log_entry_hash,
 								      tracker_data_log_entry_equal);
+		data->update_buffer.closure_updates = g_hash_table_new_full (NULL, NULL, NULL,
+		                                                             (GDestroyNotify) g_hash_table_unref);
 		tracker_db_statement_mru_init (&data->update_buffer.stmt_mru, 100,
 		                               tracker_data_log_entry_schema_hash,
 		                               tracker_data_log_entry_schema_equal,
@@ -3125,7 +3346,8 @@ tracker_data_begin_transaction (TrackerData  *data,
 
 	iface = tracker_data_manager_get_writable_db_interface (data->manager);
 
-	tracker_db_interface_execute_query (iface, NULL, "PRAGMA cache_size = %d", TRACKER_DB_CACHE_SIZE_UPDATE);
+	tracker_db_interface_execute_query (iface, NULL, "PRAGMA cache_size = %d",
+	                                    tracker_db_manager_get_update_cache_size (db_manager));
 
 	tracker_db_interface_start_transaction (iface);
 
@@ -3158,6 +3380,12 @@ tracker_data_commit_transaction (TrackerData  *data,
 		return;
 	}
 
+	if (!tracker_data_manager_flush_table_rows (data->manager, iface, &actual_error)) {
+		tracker_data_rollback_transaction (data);
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
 	tracker_db_interface_end_db_transaction (iface,
 	                                         &actual_error);
 
@@ -3189,6 +3417,7 @@ tracker_data_rollback_transaction (TrackerData *data)
 {
 	TrackerDBInterface *iface;
 	GError *ignorable = NULL;
+	guint i;
 
 	g_return_if_fail (data->in_transaction);
 
@@ -3199,6 +3428,16 @@ tracker_data_rollback_transaction (TrackerData *data)
 
 	tracker_data_update_buffer_clear (data);
 
+	/* Cached statements may refer to tables created in this transaction */
+	tracker_db_statement_mru_clear (&data->update_buffer.stmt_mru);
+
+	for (i = 0; i < data->update_buffer.graphs->len; i++) {
+		TrackerDataUpdateBufferGraph *graph;
+
+		graph = g_ptr_array_index (data->update_buffer.graphs, i);
+		tracker_db_statement_mru_clear (&graph->values_mru);
+	}
+
 	tracker_db_interface_execute_query (iface, &ignorable, "ROLLBACK");
 
 	if (ignorable) {
@@ -3449,6 +3688,43 @@ convert_format (TrackerRdfFormat format)
 	}
 }
 
+static GBytes *
+read_bytes (GDataInputStream  *istream,
+            GCancellable      *cancellable,
+            GError           **error)
+{
+	GError *inner_error = NULL;
+	gpointer buf;
+	guint32 len;
+
+	len = g_data_input_stream_read_uint32 (istream, cancellable, &inner_error);
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return NULL;
+	}
+
+	/* The length comes from the peer, do not trust it blindly */
+	if (len > MAX_MESSAGE_DATA_SIZE) {
+		g_set_error (error,
+		             TRACKER_SPARQL_ERROR,
+		             TRACKER_SPARQL_ERROR_PARSE,
+		             "Message data of %u bytes exceeds the maximum size",
+		             len);
+		return NULL;
+	}
+
+	buf = g_malloc (len);
+
+	if (!g_input_stream_read_all (G_INPUT_STREAM (istream),
+	                              buf, len, NULL,
+	                              cancellable, error)) {
+		g_free (buf);
+		return NULL;
+	}
+
+	return g_bytes_new_take (buf, len);
+}
+
 static gchar *
 read_string (GDataInputStream  *istream,
              gsize             *len_out,
@@ -3462,6 +3738,15 @@ read_string (GDataInputStream  *istream,
 	if (len == 0)
 		return NULL;
 
+	if (len > MAX_MESSAGE_DATA_SIZE) {
+		g_set_error (error,
+		             TRACKER_SPARQL_ERROR,
+		             TRACKER_SPARQL_ERROR_PARSE,
+		             "String of %u bytes exceeds the maximum size",
+		             len);
+		return NULL;
+	}
+
 	buf = g_new0 (gchar, len + 1);
 
 	if (!g_input_stream_read_all (G_INPUT_STREAM (istream),
@@ -3535,21 +3820,13 @@ value_free (gpointer data)
 }
 
 static GHashTable *
-extract_parameters (const gchar  *str,
-                    GError      **error)
+parameters_from_variant (GVariant *variant)
 {
 	GHashTable *parameters;
-	GVariant *variant, *value;
+	GVariant *value;
 	GVariantIter iter;
 	gchar *key;
 
-	variant = g_variant_parse (G_VARIANT_TYPE ("a{sv}"),
-	                           str, NULL,
-	                           NULL,
-	                           error);
-	if (!variant)
-		return FALSE;
-
 	parameters = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, value_free);
 
 	g_variant_iter_init (&iter, variant);
@@ -3557,7 +3834,9 @@ extract_parameters (const gchar  *str,
 		GValue *gvalue = g_new0 (GValue, 1);
 
 		if (!value_from_variant (gvalue, value)) {
+			g_variant_unref (value);
 			g_free (gvalue);
+			g_free (key);
 			continue;
 		}
 
@@ -3565,6 +3844,24 @@ extract_parameters (const gchar  *str,
 		g_variant_unref (value);
 	}
 
+	return parameters;
+}
+
+static GHashTable *
+extract_parameters (const gchar  *str,
+                    GError      **error)
+{
+	GHashTable *parameters;
+	GVariant *variant;
+
+	variant = g_variant_parse (G_VARIANT_TYPE ("a{sv}"),
+	                           str, NULL,
+	                           NULL,
+	                           error);
+	if (!variant)
+		return NULL;
+
+	parameters = parameters_from_variant (variant);
 	g_variant_unref (variant);
 
 	return parameters;
@@ -3583,7 +3880,7 @@ handle_update_sparql (TrackerData       *data,
 	GHashTable *parameters = NULL;
 	GError *inner_error = NULL;
 
-	buffer = read_string (istream, NULL, cancellable, error);
+	buffer = read_string (istream, NULL, cancellable, &inner_error);
 	if (!buffer)
 		goto error;
 
@@ -3625,6 +3922,87 @@ handle_update_sparql (TrackerData       *data,
 	return TRUE;
 }
 
+static gboolean
+handle_update_statement (TrackerData       *data,
+                         GDataInputStream  *istream,
+                         GHashTable        *bnodes,
+                         GHashTable        *update_cache,
+                         GPtrArray         *statements,
+                         GCancellable      *cancellable,
+                         GError           **error)
+{
+	TrackerSparql *update;
+	GHashTable *parameters = NULL;
+	gchar *buffer = NULL;
+	GBytes *params = NULL;
+	GError *inner_error = NULL;
+	guint32 id;
+
+	id = g_data_input_stream_read_uint32 (istream, cancellable, &inner_error);
+	if (inner_error)
+		goto error;
+
+	/* The SPARQL string is only sent the first time a statement is
+	 * referenced in the stream, further uses just refer to its ID.
+	 */
+	buffer = read_string (istream, NULL, cancellable, &inner_error);
+	if (inner_error)
+		goto error;
+
+	if (buffer && id == statements->len) {
+		update = g_hash_table_lookup (update_cache, buffer);
+		if (!update) {
+			update = tracker_sparql_new_update (data->manager, buffer, &inner_error);
+			if (!update)
+				goto error;
+
+			g_hash_table_insert (update_cache, g_steal_pointer (&buffer), update);
+		}
+
+		g_ptr_array_add (statements, update);
+	} else if (!buffer && id < statements->len) {
+		update = g_ptr_array_index (statements, id);
+	} else {
+		g_set_error (&inner_error,
+		             TRACKER_SPARQL_ERROR,
+		             TRACKER_SPARQL_ERROR_INTERNAL,
+		             "Invalid statement ID %u", id);
+		goto error;
+	}
+
+	params = read_bytes (istream, cancellable, &inner_error);
+	if (!params)
+		goto error;
+
+	if (g_bytes_get_size (params) > 0) {
+		GVariant *variant;
+
+		variant = g_variant_new_from_bytes (G_VARIANT_TYPE ("a{sv}"),
+		                                    params, FALSE);
+		g_variant_ref_sink (variant);
+		parameters = parameters_from_variant (variant);
+		g_variant_unref (variant);
+	}
+
+	tracker_sparql_execute_update (update,
+	                               parameters,
+	                               bnodes,
+	                               NULL,
+	                               &inner_error);
+
+ error:
+	g_clear_pointer (&parameters, g_hash_table_unref);
+	g_clear_pointer (&params, g_bytes_unref);
+	g_free (buffer);
+
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static gboolean
 handle_update_rdf (TrackerData       *data,
                    GDataInputStream  *istream,
@@ -3682,6 +4060,51 @@ handle_update_rdf (TrackerData       *data,
 	return TRUE;
 }
 
+static gboolean
+handle_update_resource (TrackerData       *data,
+                        GDataInputStream  *istream,
+                        GHashTable        *bnodes,
+                        GCancellable      *cancellable,
+                        GError           **error)
+{
+	GPtrArray *resource_graph = NULL;
+	GHashTable *visited = NULL;
+	gchar *graph = NULL;
+	GBytes *bytes = NULL;
+	GError *inner_error = NULL;
+
+	graph = read_string (istream, NULL, cancellable, &inner_error);
+	if (inner_error)
+		goto error;
+
+	bytes = read_bytes (istream, cancellable, &inner_error);
+	if (!bytes)
+		goto error;
+
+	resource_graph = tracker_resource_deserialize_graph (bytes, &inner_error);
+	if (!resource_graph)
+		goto error;
+
+	visited = g_hash_table_new_full (NULL, NULL, NULL,
+	                                 (GDestroyNotify) tracker_rowid_free);
+	tracker_data_update_resource (data, graph,
+	                              g_ptr_array_index (resource_graph, 0),
+	                              bnodes, visited, &inner_error);
+
+ error:
+	g_clear_pointer (&visited, g_hash_table_unref);
+	g_clear_pointer (&resource_graph, g_ptr_array_unref);
+	g_clear_pointer (&bytes, g_bytes_unref);
+	g_free (graph);
+
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 gboolean
 tracker_data_load_from_dbus_fd (TrackerData   *data,
                                 GInputStream  *istream,
@@ -3693,6 +4116,7 @@ tracker_data_load_from_dbus_fd (TrackerData   *data,
 	gint num_queries, i;
 	GError *inner_error = NULL;
 	GHashTable *update_cache;
+	GPtrArray *statements;
 
 	stream = g_data_input_stream_new (istream);
 	g_buffered_input_stream_set_buffer_size (G_BUFFERED_INPUT_STREAM (stream),
@@ -3705,6 +4129,7 @@ tracker_data_load_from_dbus_fd (TrackerData   *data,
 		goto error;
 
 	update_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	statements = g_ptr_array_new ();
 
 	for (i = 0; i < num_queries; i++) {
 		TrackerBusOpType op_type;
@@ -3722,11 +4147,22 @@ tracker_data_load_from_dbus_fd (TrackerData   *data,
 			if (!handle_update_rdf (data, stream, bnodes,
 			                        cancellable, &inner_error))
 				break;
+		} else if (op_type == TRACKER_BUS_OP_RESOURCE) {
+			if (!handle_update_resource (data, stream, bnodes,
+			                             cancellable, &inner_error))
+				break;
+		} else if (op_type == TRACKER_BUS_OP_STATEMENT) {
+			if (!handle_update_statement (data, stream,
+			                              bnodes, update_cache,
+			                              statements,
+			                              cancellable, &inner_error))
+				break;
 		} else {
 			g_assert_not_reached ();
 		}
 	}
 
+	g_ptr_array_unref (statements);
 	g_hash_table_unref (update_cache);
 
  error:
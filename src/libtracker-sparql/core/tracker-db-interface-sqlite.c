@@ -40,18 +40,37 @@
 #include "tracker-db-manager.h"
 #include "tracker-data-enum-types.h"
 #include "tracker-uuid.h"
+#include "tracker-vtab-array.h"
+#include "tracker-vtab-resource.h"
 #include "tracker-vtab-service.h"
 #include "tracker-vtab-triples.h"
 
 /* Avoid casts everywhere. */
 #define sqlite3_value_text(x) ((const gchar *) sqlite3_value_text(x))
 
+#define TRACKER_DB_REGEX_CACHE_SIZE 64
+
 typedef struct {
 	GRegex *syntax_check;
 	GRegex *replacement;
 	GRegex *unescape;
 } TrackerDBReplaceFuncChecks;
 
+typedef struct {
+	gchar *pattern;
+	GRegexCompileFlags flags;
+	GRegex *regex;
+	/* Substring that any match must contain, if known */
+	gchar *required_literal;
+	gboolean matches_empty;
+	GList link;
+} TrackerDBRegex;
+
+typedef struct {
+	GHashTable *regexes;
+	GQueue lru;
+} TrackerDBRegexCache;
+
 struct TrackerDBInterface {
 	GObject parent_instance;
 
@@ -61,9 +80,15 @@ struct TrackerDBInterface {
 
 	/* Compiled regular expressions */
 	TrackerDBReplaceFuncChecks replace_func_checks;
+	TrackerDBRegexCache regex_cache;
+
+	/* FTS5 tokenizer data, owned by the connection */
+	TrackerTokenizerData *fts_tokenizer;
 
 	/* Number of users (e.g. active cursors) */
 	gint n_users;
+	/* Whether a cursor iterates without taking the lock, protected by mutex */
+	gboolean exclusive;
 
 	guint flags;
 	GCancellable *cancellable;
@@ -86,6 +111,7 @@ struct TrackerDBCursor {
 	sqlite3_stmt *stmt;
 	TrackerDBStatement *ref_stmt;
 	gboolean finished;
+	gboolean exclusive;
 	guint n_columns;
 };
 
@@ -116,6 +142,9 @@ static TrackerDBCursor    *tracker_db_cursor_sqlite_new             (TrackerDBSt
                                                                      guint                  n_columns);
 static gboolean            tracker_db_cursor_get_boolean            (TrackerSparqlCursor   *cursor,
                                                                      gint                   column);
+static gint                tracker_db_cursor_get_values             (TrackerSparqlCursor      *cursor,
+                                                                     TrackerSparqlCursorValue *values,
+                                                                     gint                      n_values);
 static gboolean            db_cursor_iter_next                      (TrackerDBCursor       *cursor,
                                                                      GCancellable          *cancellable,
                                                                      GError               **error);
@@ -396,6 +425,44 @@ function_sparql_uri_is_descendant (sqlite3_context *context,
 	sqlite3_result_int (context, match);
 }
 
+static gboolean
+value_get_date_time (sqlite3_value *value,
+                     gint64        *usec,
+                     gint32        *offset)
+{
+	gint64 value_usec;
+	gint32 value_offset;
+
+	if (sqlite3_value_type (value) == SQLITE_BLOB) {
+		return tracker_date_time_unpack (sqlite3_value_blob (value),
+		                                 sqlite3_value_bytes (value),
+		                                 usec, offset);
+	} else if (sqlite3_value_type (value) == SQLITE_TEXT) {
+		if (!tracker_date_time_from_iso8601 ((const gchar *) sqlite3_value_text (value),
+		                                     &value_usec, &value_offset))
+			return FALSE;
+
+		if (usec)
+			*usec = value_usec;
+		if (offset)
+			*offset = value_offset;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static inline gint64
+usec_to_unix_seconds (gint64 usec)
+{
+	/* Round towards the past, as g_date_time_to_unix() does */
+	if (usec < 0)
+		return ((usec + 1) / G_USEC_PER_SEC) - 1;
+
+	return usec / G_USEC_PER_SEC;
+}
+
 static void
 function_sparql_timestamp (sqlite3_context *context,
                            int              argc,
@@ -406,6 +473,7 @@ function_sparql_timestamp (sqlite3_context *context,
 	TRACKER_RETURN_IF_FAIL (argc == 1, fn, "Invalid argument count");
 	TRACKER_RETURN_IF_FAIL (sqlite3_value_type (argv[0]) == SQLITE_INTEGER ||
 	                        sqlite3_value_type (argv[0]) == SQLITE_TEXT ||
+	                        sqlite3_value_type (argv[0]) == SQLITE_BLOB ||
 	                        sqlite3_value_type (argv[0]) == SQLITE_NULL,
 	                        fn, "Invalid argument type");
 
@@ -416,23 +484,16 @@ function_sparql_timestamp (sqlite3_context *context,
 
 		seconds = sqlite3_value_double (argv[0]);
 		sqlite3_result_double (context, seconds);
-	} else if (sqlite3_value_type (argv[0]) == SQLITE_TEXT) {
-		GError *error = NULL;
-		GDateTime *datetime;
-		const gchar *str;
+	} else {
+		gint64 usec;
+		gint32 offset;
 
-		str = sqlite3_value_text (argv[0]);
-		datetime = tracker_date_new_from_iso8601 (str, &error);
-		if (error) {
+		if (!value_get_date_time (argv[0], &usec, &offset)) {
 			result_context_function_error (context, fn, "Failed time string conversion");
-			g_error_free (error);
 			return;
 		}
 
-		sqlite3_result_int64 (context,
-				      g_date_time_to_unix (datetime) +
-				      (g_date_time_get_utc_offset (datetime) / G_USEC_PER_SEC));
-		g_date_time_unref (datetime);
+		sqlite3_result_int64 (context, usec_to_unix_seconds (usec) + offset);
 	}
 }
 
@@ -448,6 +509,7 @@ function_sparql_time_sort (sqlite3_context *context,
 	TRACKER_RETURN_IF_FAIL (sqlite3_value_numeric_type (argv[0]) == SQLITE_INTEGER ||
 	                        sqlite3_value_numeric_type (argv[0]) == SQLITE_FLOAT ||
 	                        sqlite3_value_type (argv[0]) == SQLITE_TEXT ||
+	                        sqlite3_value_type (argv[0]) == SQLITE_BLOB ||
 	                        sqlite3_value_type (argv[0]) == SQLITE_NULL,
 	                        fn, "Invalid argument type");
 
@@ -461,23 +523,13 @@ function_sparql_time_sort (sqlite3_context *context,
 		value = sqlite3_value_double (argv[0]);
 		sort_key = (gint64) (value * G_USEC_PER_SEC);
 		sqlite3_result_int64 (context, sort_key);
-	} else if (sqlite3_value_type (argv[0]) == SQLITE_TEXT) {
-		GDateTime *datetime;
-		const gchar *value;
-		GError *error = NULL;
-
-		value = sqlite3_value_text (argv[0]);
-		datetime = tracker_date_new_from_iso8601 (value, &error);
-		if (error) {
-			result_context_function_error (context, fn, error->message);
-			g_error_free (error);
+	} else {
+		if (!value_get_date_time (argv[0], &sort_key, NULL)) {
+			result_context_function_error (context, fn, "Invalid date");
 			return;
 		}
 
-		sort_key = ((g_date_time_to_unix (datetime) * G_USEC_PER_SEC) +
-			    g_date_time_get_microsecond (datetime));
 		sqlite3_result_int64 (context, sort_key);
-		g_date_time_unref (datetime);
 	}
 }
 
@@ -491,6 +543,7 @@ function_sparql_time_zone_duration (sqlite3_context *context,
 	TRACKER_RETURN_IF_FAIL (argc == 1, fn, "Invalid argument count");
 	TRACKER_RETURN_IF_FAIL (sqlite3_value_numeric_type (argv[0]) == SQLITE_INTEGER ||
 	                        sqlite3_value_type (argv[0]) == SQLITE_TEXT ||
+	                        sqlite3_value_type (argv[0]) == SQLITE_BLOB ||
 	                        sqlite3_value_type (argv[0]) == SQLITE_NULL,
 	                        fn, "Invalid argument type");
 
@@ -498,23 +551,15 @@ function_sparql_time_zone_duration (sqlite3_context *context,
 		sqlite3_result_null (context);
 	} else if (sqlite3_value_numeric_type (argv[0]) == SQLITE_INTEGER) {
 		sqlite3_result_int (context, 0);
-	} else if (sqlite3_value_type (argv[0]) == SQLITE_TEXT) {
-		GError *error = NULL;
-		GDateTime *datetime;
-		const gchar *str;
+	} else {
+		gint32 offset;
 
-		str = sqlite3_value_text (argv[0]);
-		datetime = tracker_date_new_from_iso8601 (str, &error);
-		if (error) {
+		if (!value_get_date_time (argv[0], NULL, &offset)) {
 			result_context_function_error (context, fn, "Invalid date");
-			g_error_free (error);
 			return;
 		}
 
-		sqlite3_result_int64 (context,
-				      g_date_time_get_utc_offset (datetime) /
-				      G_USEC_PER_SEC);
-		g_date_time_unref (datetime);
+		sqlite3_result_int64 (context, offset);
 	}
 }
 
@@ -526,6 +571,7 @@ function_sparql_time_zone_substr (sqlite3_context *context,
 	TRACKER_RETURN_IF_FAIL (argc == 1, "TZ", "Invalid argument count");
 	TRACKER_RETURN_IF_FAIL (sqlite3_value_numeric_type (argv[0]) == SQLITE_INTEGER ||
 	                        sqlite3_value_type (argv[0]) == SQLITE_TEXT ||
+	                        sqlite3_value_type (argv[0]) == SQLITE_BLOB ||
 	                        sqlite3_value_type (argv[0]) == SQLITE_NULL,
 	                        "TZ", "Invalid argument type");
 
@@ -533,6 +579,24 @@ function_sparql_time_zone_substr (sqlite3_context *context,
 		sqlite3_result_null (context);
 	} else if (sqlite3_value_numeric_type (argv[0]) == SQLITE_INTEGER) {
 		sqlite3_result_text (context, "", -1, NULL);
+	} else if (sqlite3_value_type (argv[0]) == SQLITE_BLOB) {
+		gint32 offset;
+
+		if (!value_get_date_time (argv[0], NULL, &offset)) {
+			result_context_function_error (context, "TZ", "Invalid date");
+			return;
+		}
+
+		if (offset == 0) {
+			sqlite3_result_text (context, "Z", -1, NULL);
+		} else {
+			sqlite3_result_text (context,
+			                     g_strdup_printf ("%c%.2d:%.2d",
+			                                      offset > 0 ? '+' : '-',
+			                                      ABS (offset) / 3600,
+			                                      ABS (offset) % 3600 / 60),
+			                     -1, g_free);
+		}
 	} else if (sqlite3_value_type (argv[0]) == SQLITE_TEXT) {
 		const gchar *str;
 		gsize len;
@@ -595,6 +659,7 @@ function_sparql_time_zone (sqlite3_context *context,
 	TRACKER_RETURN_IF_FAIL (argc == 1, fn, "Invalid argument count");
 	TRACKER_RETURN_IF_FAIL (sqlite3_value_numeric_type (argv[0]) == SQLITE_INTEGER ||
 	                        sqlite3_value_type (argv[0]) == SQLITE_TEXT ||
+	                        sqlite3_value_type (argv[0]) == SQLITE_BLOB ||
 	                        sqlite3_value_type (argv[0]) == SQLITE_NULL,
 	                        fn, "Invalid argument type");
 
@@ -602,24 +667,51 @@ function_sparql_time_zone (sqlite3_context *context,
 		sqlite3_result_null (context);
 	} else if (sqlite3_value_numeric_type (argv[0]) == SQLITE_INTEGER) {
 		sqlite3_result_text (context, "PT0S", -1, NULL);
-	} else if (sqlite3_value_type (argv[0]) == SQLITE_TEXT) {
-		GError *error = NULL;
-		GDateTime *datetime;
-		const gchar *str;
-		gchar *duration;
+	} else {
+		gint32 offset;
 
-		str = sqlite3_value_text (argv[0]);
-		datetime = tracker_date_new_from_iso8601 (str, &error);
-		if (error) {
+		if (!value_get_date_time (argv[0], NULL, &offset)) {
 			result_context_function_error (context, fn, "Invalid date");
-			g_error_free (error);
 			return;
 		}
 
-		duration = offset_to_duration (g_date_time_get_utc_offset (datetime) /
-					       G_USEC_PER_SEC);
-		sqlite3_result_text (context, g_strdup (duration), -1, g_free);
-		g_date_time_unref (datetime);
+		if (offset == 0)
+			sqlite3_result_text (context, "PT0S", -1, NULL);
+		else
+			sqlite3_result_text (context, offset_to_duration (offset), -1, g_free);
+	}
+}
+
+static void
+function_sparql_pack_date_time (sqlite3_context *context,
+                                int              argc,
+                                sqlite3_value   *argv[])
+{
+	const gchar *fn = "SparqlPackDateTime helper";
+	guint8 buf[TRACKER_DATE_TIME_PACKED_SIZE];
+	gint64 usec;
+	gint32 offset;
+
+	TRACKER_RETURN_IF_FAIL (argc == 1, fn, "Invalid argument count");
+
+	/* Only ISO 8601 strings need conversion, integer timestamps
+	 * and already packed values are left as is.
+	 */
+	if (sqlite3_value_type (argv[0]) != SQLITE_TEXT) {
+		sqlite3_result_value (context, argv[0]);
+		return;
+	}
+
+	if (!value_get_date_time (argv[0], &usec, &offset)) {
+		result_context_function_error (context, fn, "Invalid date");
+		return;
+	}
+
+	if (offset == 0 && usec % G_USEC_PER_SEC == 0) {
+		sqlite3_result_int64 (context, usec / G_USEC_PER_SEC);
+	} else {
+		tracker_date_time_pack (usec, offset, buf);
+		sqlite3_result_blob (context, buf, sizeof (buf), SQLITE_TRANSIENT);
 	}
 }
 
@@ -693,74 +785,309 @@ function_sparql_haversine_distance (sqlite3_context *context,
 	sqlite3_result_double (context, d);
 }
 
+static TrackerDBRegex *
+tracker_db_regex_ref (TrackerDBRegex *regex)
+{
+	return g_rc_box_acquire (regex);
+}
+
 static void
-function_sparql_regex (sqlite3_context *context,
-                       int              argc,
-                       sqlite3_value   *argv[])
+tracker_db_regex_clear (TrackerDBRegex *regex)
 {
-	const gchar *fn = "fn:matches";
-	gboolean ret;
-	const gchar *text, *pattern, *flags = "";
-	GRegexCompileFlags regex_flags;
-	GRegex *regex;
+	g_free (regex->pattern);
+	g_free (regex->required_literal);
+	g_regex_unref (regex->regex);
+}
 
-	TRACKER_RETURN_IF_FAIL (argc == 2 || argc == 3, fn, "Invalid argument count");
+static void
+tracker_db_regex_unref (TrackerDBRegex *regex)
+{
+	g_rc_box_release_full (regex, (GDestroyNotify) tracker_db_regex_clear);
+}
 
-	regex = sqlite3_get_auxdata (context, 1);
+static guint
+tracker_db_regex_hash (gconstpointer key)
+{
+	const TrackerDBRegex *regex = key;
 
-	text = (gchar *)sqlite3_value_text (argv[0]);
+	return g_str_hash (regex->pattern) ^ regex->flags;
+}
 
-	if (argc == 3)
-		flags = (gchar *)sqlite3_value_text (argv[2]);
+static gboolean
+tracker_db_regex_equal (gconstpointer a,
+                        gconstpointer b)
+{
+	const TrackerDBRegex *regex1 = a, *regex2 = b;
+
+	return (regex1->flags == regex2->flags &&
+	        g_strcmp0 (regex1->pattern, regex2->pattern) == 0);
+}
 
-	if (regex == NULL) {
-		gchar *err_str;
-		GError *error = NULL;
+static void
+flush_literal_run (GString *run,
+                   GString *best)
+{
+	if (run->len > best->len)
+		g_string_assign (best, run->str);
 
-		pattern = (gchar *)sqlite3_value_text (argv[1]);
+	g_string_truncate (run, 0);
+}
 
-		regex_flags = 0;
-		while (*flags) {
-			switch (*flags) {
-			case 's':
-				regex_flags |= G_REGEX_DOTALL;
-				break;
-			case 'm':
-				regex_flags |= G_REGEX_MULTILINE;
-				break;
-			case 'i':
-				regex_flags |= G_REGEX_CASELESS;
-				break;
-			case 'x':
-				regex_flags |= G_REGEX_EXTENDED;
+/* Finds the longest run of plain characters that every match of the
+ * pattern must contain, so non-matching text can be discarded with a
+ * plain substring search. This is deliberately conservative, and
+ * gives up on anything it does not fully understand.
+ */
+static gchar *
+regex_get_required_literal (const gchar        *pattern,
+                            GRegexCompileFlags  flags)
+{
+	GString *run, *best;
+	gsize last_char = 0;
+	const gchar *p;
+
+	/* Case folding and extended syntax change what a literal matches */
+	if ((flags & (G_REGEX_CASELESS | G_REGEX_EXTENDED)) != 0)
+		return NULL;
+
+	/* Any branch may match instead */
+	if (strchr (pattern, '|'))
+		return NULL;
+
+	run = g_string_new (NULL);
+	best = g_string_new (NULL);
+
+	for (p = pattern; *p; p++) {
+		if (*p == '?' || *p == '*' || *p == '{') {
+			/* The previous character is optional */
+			g_string_truncate (run, MIN (last_char, run->len));
+			flush_literal_run (run, best);
+
+			if (*p == '{') {
+				p = strchr (p, '}');
+				if (!p)
+					break;
+			}
+		} else if (*p == '+' || *p == '.' || *p == '^' || *p == '$') {
+			flush_literal_run (run, best);
+		} else if (*p == '\\') {
+			if (p[1] != '\0' && strchr ("dDwWsShHvVbBAzZG", p[1])) {
+				/* Character classes and assertions */
+				flush_literal_run (run, best);
+			} else if (p[1] == '\0' || g_ascii_isalnum (p[1]) || (guchar) p[1] >= 0x80) {
+				/* Anything else that may take arguments */
 				break;
-			default:
-				err_str = g_strdup_printf ("Invalid SPARQL regex flag '%c'", *flags);
-				result_context_function_error (context, fn, err_str);
-				g_free (err_str);
-				return;
+			} else {
+				/* Escaped punctuation is a literal */
+				last_char = run->len;
+				g_string_append_c (run, p[1]);
 			}
-			flags++;
+
+			p++;
+		} else if (strchr ("()[]}", *p)) {
+			/* Groups and classes, stop here */
+			break;
+		} else {
+			gint len = g_utf8_skip[*(guchar *) p];
+
+			if (strnlen (p, len) < (gsize) len)
+				break;
+
+			last_char = run->len;
+			g_string_append_len (run, p, len);
+			p += len - 1;
 		}
+	}
 
-		regex = g_regex_new (pattern, regex_flags, 0, &error);
+	flush_literal_run (run, best);
+	g_string_free (run, TRUE);
 
-		if (error) {
-			result_context_function_error (context, fn, error->message);
-			g_clear_error (&error);
-			return;
+	if (best->len == 0) {
+		g_string_free (best, TRUE);
+		return NULL;
+	}
+
+	return g_string_free (best, FALSE);
+}
+
+static void
+regex_cache_clear (TrackerDBRegexCache *cache)
+{
+	TrackerDBRegex *regex;
+	GList *link;
+
+	while ((link = g_queue_pop_head_link (&cache->lru)) != NULL) {
+		regex = link->data;
+		tracker_db_regex_unref (regex);
+	}
+
+	g_clear_pointer (&cache->regexes, g_hash_table_unref);
+}
+
+static gboolean
+parse_regex_flags (sqlite3_context    *context,
+                   const gchar        *fn,
+                   const gchar        *flags,
+                   GRegexCompileFlags *regex_flags)
+{
+	gchar *err_str;
+
+	*regex_flags = 0;
+
+	for (; flags && *flags; flags++) {
+		switch (*flags) {
+		case 's':
+			*regex_flags |= G_REGEX_DOTALL;
+			break;
+		case 'm':
+			*regex_flags |= G_REGEX_MULTILINE;
+			break;
+		case 'i':
+			*regex_flags |= G_REGEX_CASELESS;
+			break;
+		case 'x':
+			*regex_flags |= G_REGEX_EXTENDED;
+			break;
+		default:
+			err_str = g_strdup_printf ("Invalid SPARQL regex flag '%c'", *flags);
+			result_context_function_error (context, fn, err_str);
+			g_free (err_str);
+			return FALSE;
 		}
+	}
 
-		sqlite3_set_auxdata (context, 1, regex, (void (*) (void*)) g_regex_unref);
+	return TRUE;
+}
+
+/* Returns a new reference to the compiled pattern, compiled patterns are
+ * kept in a per-interface LRU cache so that they outlive single statement
+ * executions (e.g. the same REGEX filter with different bound values).
+ */
+static TrackerDBRegex *
+tracker_db_interface_lookup_regex (TrackerDBInterface  *db_interface,
+                                   const gchar         *pattern,
+                                   GRegexCompileFlags   flags,
+                                   GError             **error)
+{
+	TrackerDBRegexCache *cache = &db_interface->regex_cache;
+	TrackerDBRegex key = { (gchar *) pattern, flags, }, *regex;
+	GRegex *compiled;
+
+	if (!cache->regexes) {
+		cache->regexes = g_hash_table_new (tracker_db_regex_hash,
+		                                   tracker_db_regex_equal);
 	}
 
-	if (text != NULL) {
-		ret = g_regex_match (regex, text, 0, NULL);
+	regex = g_hash_table_lookup (cache->regexes, &key);
+
+	if (regex) {
+		g_queue_unlink (&cache->lru, &regex->link);
+		g_queue_push_head_link (&cache->lru, &regex->link);
+		return tracker_db_regex_ref (regex);
+	}
+
+	/* Cached patterns are reused, make it worth JIT compiling them */
+	compiled = g_regex_new (pattern, flags | G_REGEX_OPTIMIZE, 0, error);
+	if (!compiled)
+		return NULL;
+
+	regex = g_rc_box_new0 (TrackerDBRegex);
+	regex->pattern = g_strdup (pattern);
+	regex->flags = flags;
+	regex->regex = compiled;
+	regex->required_literal = regex_get_required_literal (pattern, flags);
+	regex->matches_empty = g_regex_match (compiled, "", 0, NULL);
+	regex->link.data = regex;
+
+	g_hash_table_add (cache->regexes, regex);
+	g_queue_push_head_link (&cache->lru, &regex->link);
+
+	if (cache->lru.length > TRACKER_DB_REGEX_CACHE_SIZE) {
+		TrackerDBRegex *oldest;
+
+		oldest = g_queue_pop_tail_link (&cache->lru)->data;
+		g_hash_table_remove (cache->regexes, oldest);
+		tracker_db_regex_unref (oldest);
+	}
+
+	return tracker_db_regex_ref (regex);
+}
+
+static inline gboolean
+regex_may_match (TrackerDBRegex *regex,
+                 const gchar    *text)
+{
+	if (!text)
+		return FALSE;
+
+	return (regex->required_literal == NULL ||
+	        strstr (text, regex->required_literal) != NULL);
+}
+
+static TrackerDBRegex *
+get_regex (sqlite3_context  *context,
+           const gchar      *fn,
+           sqlite3_value    *pattern,
+           const gchar      *flags)
+{
+	TrackerDBInterface *db_interface = sqlite3_user_data (context);
+	GRegexCompileFlags regex_flags;
+	TrackerDBRegex *regex;
+	GError *error = NULL;
+
+	regex = sqlite3_get_auxdata (context, 1);
+	if (regex)
+		return tracker_db_regex_ref (regex);
+
+	if (!parse_regex_flags (context, fn, flags, &regex_flags))
+		return NULL;
+
+	regex = tracker_db_interface_lookup_regex (db_interface,
+	                                           sqlite3_value_text (pattern),
+	                                           regex_flags,
+	                                           &error);
+	if (error) {
+		result_context_function_error (context, fn, error->message);
+		g_clear_error (&error);
+		return NULL;
+	}
+
+	/* Keep it around while the pattern argument stays constant */
+	sqlite3_set_auxdata (context, 1, tracker_db_regex_ref (regex),
+	                     (GDestroyNotify) tracker_db_regex_unref);
+
+	return regex;
+}
+
+static void
+function_sparql_regex (sqlite3_context *context,
+                       int              argc,
+                       sqlite3_value   *argv[])
+{
+	const gchar *fn = "fn:matches";
+	gboolean ret;
+	const gchar *text, *flags = "";
+	TrackerDBRegex *regex;
+
+	TRACKER_RETURN_IF_FAIL (argc == 2 || argc == 3, fn, "Invalid argument count");
+
+	text = (gchar *)sqlite3_value_text (argv[0]);
+
+	if (argc == 3)
+		flags = (gchar *)sqlite3_value_text (argv[2]);
+
+	regex = get_regex (context, fn, argv[1], flags);
+	if (!regex)
+		return;
+
+	if (regex_may_match (regex, text)) {
+		ret = g_regex_match (regex->regex, text, 0, NULL);
 	} else {
 		ret = FALSE;
 	}
 
 	sqlite3_result_int (context, ret);
+	tracker_db_regex_unref (regex);
 }
 
 static void
@@ -785,13 +1112,13 @@ function_sparql_replace (sqlite3_context *context,
 	const gchar *fn = "fn:replace";
 	TrackerDBInterface *db_interface = sqlite3_user_data (context);
 	TrackerDBReplaceFuncChecks *checks = &db_interface->replace_func_checks;
-	gboolean store_regex = FALSE, store_replace_regex = FALSE;
-	const gchar *input, *pattern, *replacement, *flags = "";
+	gboolean store_replace_regex = FALSE;
+	const gchar *input, *replacement, *flags = "";
 	gchar *err_str, *output = NULL, *replaced = NULL, *unescaped = NULL;
 	GError *error = NULL;
-	GRegexCompileFlags regex_flags = 0;
-	GRegex *regex, *replace_regex;
-	gint capture_count, i;
+	TrackerDBRegex *regex;
+	GRegex *replace_regex;
+	gint capture_count;
 
 	TRACKER_RETURN_IF_FAIL (argc == 3 || argc == 4, fn, "Invalid argument count");
 
@@ -801,55 +1128,22 @@ function_sparql_replace (sqlite3_context *context,
 		flags = (gchar *)sqlite3_value_text (argv[3]);
 
 	input = (gchar *)sqlite3_value_text (argv[0]);
-	regex = sqlite3_get_auxdata (context, 1);
 	replacement = (gchar *)sqlite3_value_text (argv[2]);
 
-	if (regex == NULL) {
-		pattern = (gchar *)sqlite3_value_text (argv[1]);
-
-		for (i = 0; flags[i]; i++) {
-			switch (flags[i]) {
-			case 's':
-				regex_flags |= G_REGEX_DOTALL;
-				break;
-			case 'm':
-				regex_flags |= G_REGEX_MULTILINE;
-				break;
-			case 'i':
-				regex_flags |= G_REGEX_CASELESS;
-				break;
-			case 'x':
-				regex_flags |= G_REGEX_EXTENDED;
-				break;
-			default:
-				err_str = g_strdup_printf ("Invalid SPARQL regex flag '%c'", flags[i]);
-				result_context_function_error (context, fn, err_str);
-				g_free (err_str);
-				return;
-			}
-		}
-
-		regex = g_regex_new (pattern, regex_flags, 0, &error);
-
-		if (error) {
-			result_context_function_error (context, fn, error->message);
-			g_clear_error (&error);
-			return;
-		}
-
-		/* According to the XPath 2.0 standard, an error shall be raised, if the given
-		 * pattern matches a zero-length string.
-		 */
-		if (g_regex_match (regex, "", 0, NULL)) {
-			err_str = g_strdup_printf ("The given pattern '%s' matches a zero-length string.",
-			                           pattern);
-			result_context_function_error (context, fn, err_str);
-			g_regex_unref (regex);
-			g_free (err_str);
-			return;
-		}
+	regex = get_regex (context, fn, argv[1], flags);
+	if (!regex)
+		return;
 
-		store_regex = TRUE;
+	/* According to the XPath 2.0 standard, an error shall be raised, if the given
+	 * pattern matches a zero-length string.
+	 */
+	if (regex->matches_empty) {
+		err_str = g_strdup_printf ("The given pattern '%s' matches a zero-length string.",
+		                           regex->pattern);
+		result_context_function_error (context, fn, err_str);
+		tracker_db_regex_unref (regex);
+		g_free (err_str);
+		return;
 	}
 
 	/* According to the XPath 2.0 standard, an error shall be raised, if all dollar
@@ -862,6 +1156,7 @@ function_sparql_replace (sqlite3_context *context,
 		                           "not immediately preceded by a \"\\\".",
 		                           replacement);
 		result_context_function_error (context, fn, err_str);
+		tracker_db_regex_unref (regex);
 		g_free (err_str);
 		return;
 	}
@@ -871,7 +1166,7 @@ function_sparql_replace (sqlite3_context *context,
 	 * So the ($) backreferences in the given replacement string are replaced by (\)
 	 * backreferences to support the standard.
 	 */
-	capture_count = g_regex_get_capture_count (regex);
+	capture_count = g_regex_get_capture_count (regex->regex);
 	replace_regex = sqlite3_get_auxdata (context, 2);
 
 	if (capture_count > 9 && !replace_regex) {
@@ -913,22 +1208,24 @@ function_sparql_replace (sqlite3_context *context,
 	}
 
 	if (!error) {
-		output = g_regex_replace (regex, input, -1, 0, unescaped, 0, &error);
+		/* Nothing to replace if the pattern cannot match */
+		if (regex_may_match (regex, input))
+			output = g_regex_replace (regex->regex, input, -1, 0, unescaped, 0, &error);
+		else
+			output = g_strdup (input);
 	}
 
+	if (store_replace_regex)
+		sqlite3_set_auxdata (context, 2, replace_regex, (GDestroyNotify) g_regex_unref);
+
 	if (error) {
 		result_context_function_error (context, fn, error->message);
 		g_clear_error (&error);
-		return;
+	} else {
+		sqlite3_result_text (context, output, -1, g_free);
 	}
 
-	sqlite3_result_text (context, output, -1, g_free);
-
-	if (store_replace_regex)
-		sqlite3_set_auxdata (context, 2, replace_regex, (GDestroyNotify) g_regex_unref);
-	if (store_regex)
-		sqlite3_set_auxdata (context, 1, regex, (GDestroyNotify) g_regex_unref);
-
+	tracker_db_regex_unref (regex);
 	g_free (replaced);
 	g_free (unescaped);
 }
@@ -1005,6 +1302,64 @@ function_sparql_case_fold (sqlite3_context *context,
 	}
 }
 
+static void
+result_sort_key (sqlite3_context *context,
+                 sqlite3_value   *value,
+                 gboolean         title)
+{
+	gpointer collator = sqlite3_user_data (context);
+	const gchar *str;
+	guint8 *key;
+	gsize len;
+
+	/* Only strings are collated, leave other values as is */
+	if (sqlite3_value_type (value) != SQLITE_TEXT) {
+		sqlite3_result_value (context, value);
+		return;
+	}
+
+	str = (const gchar *) sqlite3_value_text (value);
+
+	if (title) {
+		key = tracker_collation_get_title_sort_key (collator,
+		                                            sqlite3_value_bytes (value),
+		                                            str, &len);
+	} else {
+		key = tracker_collation_get_sort_key (collator,
+		                                      sqlite3_value_bytes (value),
+		                                      str, &len);
+	}
+
+	if (key)
+		sqlite3_result_blob64 (context, key, len, g_free);
+	else
+		sqlite3_result_value (context, value);
+}
+
+static void
+function_sparql_sort_key (sqlite3_context *context,
+                          int              argc,
+                          sqlite3_value   *argv[])
+{
+	const gchar *fn = "SparqlSortKey helper";
+
+	TRACKER_RETURN_IF_FAIL (argc == 1, fn, "Invalid argument count");
+
+	result_sort_key (context, argv[0], FALSE);
+}
+
+static void
+function_sparql_title_sort_key (sqlite3_context *context,
+                                int              argc,
+                                sqlite3_value   *argv[])
+{
+	const gchar *fn = "SparqlTitleSortKey helper";
+
+	TRACKER_RETURN_IF_FAIL (argc == 1, fn, "Invalid argument count");
+
+	result_sort_key (context, argv[0], TRUE);
+}
+
 static void
 function_sparql_normalize (sqlite3_context *context,
                            int              argc,
@@ -1534,10 +1889,22 @@ function_sparql_print_value (sqlite3_context *context,
 			struct tm tm;
 			gint64 timestamp;
 			gchar buf[100];
+			gsize len;
 			int retval;
 
 			timestamp = sqlite3_value_int64 (argv[0]);
 
+			/* Fast path for the 1-9999 year range */
+			if (timestamp > -(G_MAXINT64 / G_USEC_PER_SEC) &&
+			    timestamp < G_MAXINT64 / G_USEC_PER_SEC &&
+			    (len = tracker_date_time_to_iso8601 (timestamp * G_USEC_PER_SEC, 0, buf)) > 0) {
+				if (prop_type == TRACKER_PROPERTY_TYPE_DATE)
+					len = strchr (buf, 'T') - buf;
+
+				sqlite3_result_text (context, buf, len, SQLITE_TRANSIENT);
+				break;
+			}
+
 			if (gmtime_r ((time_t *) &timestamp, &tm) == NULL)
 				result_context_function_error (context, fn, "Invalid unix timestamp");
 
@@ -1573,6 +1940,23 @@ function_sparql_print_value (sqlite3_context *context,
 			} else {
 				g_assert_not_reached ();
 			}
+		} else if (sqlite3_value_type (argv[0]) == SQLITE_BLOB) {
+			gchar buf[TRACKER_DATE_TIME_ISO8601_SIZE];
+			gint64 usec;
+			gint32 offset;
+			gsize len;
+
+			if (!value_get_date_time (argv[0], &usec, &offset) ||
+			    (len = tracker_date_time_to_iso8601 (usec, offset, buf)) == 0) {
+				result_context_function_error (context, fn, "Invalid packed date");
+				break;
+			}
+
+			/* Drop time data if we are given a xsd:dateTime as a xsd:date */
+			if (prop_type == TRACKER_PROPERTY_TYPE_DATE)
+				len = strchr (buf, 'T') - buf;
+
+			sqlite3_result_text (context, buf, len, SQLITE_TRANSIENT);
 		} else {
 			result_context_function_error (context, fn, "Invalid value type");
 		}
@@ -1692,6 +2076,8 @@ initialize_functions (TrackerDBInterface *db_interface)
 		  function_sparql_time_zone_substr },
 		{ "SparqlTimezone", 1, SQLITE_ANY | SQLITE_DETERMINISTIC,
 		  function_sparql_time_zone },
+		{ "SparqlPackDateTime", 1, SQLITE_ANY | SQLITE_DETERMINISTIC,
+		  function_sparql_pack_date_time },
 		/* Paths and filenames */
 		{ "SparqlStringFromFilename", 1, SQLITE_ANY | SQLITE_DETERMINISTIC,
 		  function_sparql_string_from_filename },
@@ -1770,6 +2156,20 @@ tracker_db_interface_unlock (TrackerDBInterface *iface)
 	g_mutex_unlock (&iface->mutex);
 }
 
+static inline void
+tracker_db_cursor_lock (TrackerDBCursor *cursor)
+{
+	if (!cursor->exclusive)
+		tracker_db_interface_lock (cursor->ref_stmt->db_interface);
+}
+
+static inline void
+tracker_db_cursor_unlock (TrackerDBCursor *cursor)
+{
+	if (!cursor->exclusive)
+		tracker_db_interface_unlock (cursor->ref_stmt->db_interface);
+}
+
 static void
 open_database (TrackerDBInterface  *db_interface,
                GError             **error)
@@ -1897,6 +2297,8 @@ close_database (TrackerDBInterface *db_interface)
 	if (db_interface->replace_func_checks.unescape)
 		g_regex_unref (db_interface->replace_func_checks.unescape);
 
+	regex_cache_clear (&db_interface->regex_cache);
+
 	if (db_interface->db) {
 		rc = sqlite3_close (db_interface->db);
 		if (rc != SQLITE_OK) {
@@ -1911,11 +2313,14 @@ tracker_db_interface_sqlite_fts_init (TrackerDBInterface     *db_interface,
                                       TrackerDBManagerFlags   fts_flags,
                                       GError                **error)
 {
-	return tracker_tokenizer_initialize (db_interface->db,
-	                                     db_interface,
-	                                     fts_flags,
-	                                     TRACKER_DATA_MANAGER (db_interface->user_data),
-	                                     error);
+	db_interface->fts_tokenizer =
+		tracker_tokenizer_initialize (db_interface->db,
+		                              db_interface,
+		                              fts_flags,
+		                              TRACKER_DATA_MANAGER (db_interface->user_data),
+		                              error);
+
+	return db_interface->fts_tokenizer != NULL;
 }
 
 gboolean
@@ -2007,36 +2412,83 @@ tracker_db_interface_sqlite_fts_insert_text_stmt (TrackerDBInterface  *db_interf
 }
 
 static gchar *
-tracker_db_interface_sqlite_fts_create_delete_query (TrackerDBInterface  *db_interface,
+tracker_db_interface_sqlite_fts_create_delete_query (TrackerDBInterface  *db_interface,
+                                                     const gchar         *database,
+                                                     const gchar        **properties)
+{
+        GString *props_str;
+        gchar *query;
+        gint i;
+
+        props_str = g_string_new (NULL);
+
+        for (i = 0; properties[i] != NULL; i++) {
+		if (i != 0)
+			g_string_append_c (props_str, ',');
+
+                g_string_append_printf (props_str, "\"%s\"", properties[i]);
+        }
+
+        query = g_strdup_printf ("INSERT INTO \"%s\".fts5 (fts5, ROWID, %s) "
+                                 "SELECT 'delete', ROWID, %s FROM \"%s\".fts_view WHERE ROWID = ?",
+                                 database,
+                                 props_str->str,
+                                 props_str->str,
+                                 database);
+        g_string_free (props_str, TRUE);
+
+        return query;
+}
+
+TrackerDBStatement *
+tracker_db_interface_sqlite_fts_delete_text_stmt (TrackerDBInterface  *db_interface,
+                                                  const gchar         *database,
+                                                  const gchar        **properties,
+                                                  GError             **error)
+{
+	TrackerDBStatement *stmt;
+	gchar *query;
+
+	query = tracker_db_interface_sqlite_fts_create_delete_query (db_interface,
+	                                                             database,
+	                                                             properties);
+	stmt = tracker_db_interface_create_statement (db_interface,
+	                                              TRACKER_DB_STATEMENT_CACHE_TYPE_NONE,
+	                                              error,
+	                                              query);
+	g_free (query);
+
+	return stmt;
+}
+
+static gchar *
+tracker_db_interface_sqlite_fts_create_select_query (TrackerDBInterface  *db_interface,
                                                      const gchar         *database,
                                                      const gchar        **properties)
 {
-        GString *props_str;
-        gchar *query;
-        gint i;
+	GString *props_str;
+	gchar *query;
+	gint i;
 
-        props_str = g_string_new (NULL);
+	props_str = g_string_new (NULL);
 
-        for (i = 0; properties[i] != NULL; i++) {
+	for (i = 0; properties[i] != NULL; i++) {
 		if (i != 0)
 			g_string_append_c (props_str, ',');
 
-                g_string_append_printf (props_str, "\"%s\"", properties[i]);
-        }
+		g_string_append_printf (props_str, "\"%s\"", properties[i]);
+	}
 
-        query = g_strdup_printf ("INSERT INTO \"%s\".fts5 (fts5, ROWID, %s) "
-                                 "SELECT 'delete', ROWID, %s FROM \"%s\".fts_view WHERE ROWID = ?",
-                                 database,
-                                 props_str->str,
-                                 props_str->str,
-                                 database);
-        g_string_free (props_str, TRUE);
+	query = g_strdup_printf ("SELECT %s FROM \"%s\".fts_view WHERE ROWID = ?",
+	                         props_str->str,
+	                         database);
+	g_string_free (props_str, TRUE);
 
-        return query;
+	return query;
 }
 
 TrackerDBStatement *
-tracker_db_interface_sqlite_fts_delete_text_stmt (TrackerDBInterface  *db_interface,
+tracker_db_interface_sqlite_fts_select_text_stmt (TrackerDBInterface  *db_interface,
                                                   const gchar         *database,
                                                   const gchar        **properties,
                                                   GError             **error)
@@ -2044,7 +2496,7 @@ tracker_db_interface_sqlite_fts_delete_text_stmt (TrackerDBInterface  *db_interf
 	TrackerDBStatement *stmt;
 	gchar *query;
 
-	query = tracker_db_interface_sqlite_fts_create_delete_query (db_interface,
+	query = tracker_db_interface_sqlite_fts_create_select_query (db_interface,
 	                                                             database,
 	                                                             properties);
 	stmt = tracker_db_interface_create_statement (db_interface,
@@ -2056,6 +2508,80 @@ tracker_db_interface_sqlite_fts_delete_text_stmt (TrackerDBInterface  *db_interf
 	return stmt;
 }
 
+/* Text shorter than this is cheaper to tokenize inline in FTS5 */
+#define FTS_PRETOKENIZE_MIN_LENGTH 512
+
+gboolean
+tracker_db_interface_sqlite_fts_add_documents (TrackerDBInterface  *db_interface,
+                                               TrackerDBStatement  *stmt,
+                                               gint64               id,
+                                               GError             **error)
+{
+	gint result, i, n_columns;
+
+	g_return_val_if_fail (TRACKER_IS_DB_STATEMENT (stmt), FALSE);
+	g_return_val_if_fail (!stmt->stmt_is_used, FALSE);
+
+	if (!db_interface->fts_tokenizer)
+		return TRUE;
+
+	tracker_db_interface_lock (db_interface);
+
+	sqlite3_bind_int64 (stmt->stmt, 1, id);
+	n_columns = sqlite3_column_count (stmt->stmt);
+
+	while ((result = stmt_step (stmt->stmt)) == SQLITE_ROW) {
+		for (i = 0; i < n_columns; i++) {
+			const gchar *text;
+			gint length;
+
+			if (sqlite3_column_type (stmt->stmt, i) != SQLITE_TEXT)
+				continue;
+
+			text = (const gchar *) sqlite3_column_text (stmt->stmt, i);
+			length = sqlite3_column_bytes (stmt->stmt, i);
+
+			if (length >= FTS_PRETOKENIZE_MIN_LENGTH) {
+				tracker_tokenizer_add_document (db_interface->fts_tokenizer,
+				                                text, length);
+			}
+		}
+	}
+
+	if (result != SQLITE_DONE) {
+		g_set_error (error,
+		             TRACKER_DB_INTERFACE_ERROR,
+		             TRACKER_DB_QUERY_ERROR,
+		             "%s", sqlite3_errmsg (db_interface->db));
+	}
+
+	tracker_db_statement_sqlite_reset (stmt);
+	tracker_db_interface_unlock (db_interface);
+
+	return result == SQLITE_DONE;
+}
+
+gboolean
+tracker_db_interface_sqlite_fts_documents_full (TrackerDBInterface *db_interface)
+{
+	return (db_interface->fts_tokenizer &&
+	        tracker_tokenizer_documents_full (db_interface->fts_tokenizer));
+}
+
+void
+tracker_db_interface_sqlite_fts_tokenize_documents (TrackerDBInterface *db_interface)
+{
+	if (db_interface->fts_tokenizer)
+		tracker_tokenizer_tokenize_documents (db_interface->fts_tokenizer);
+}
+
+void
+tracker_db_interface_sqlite_fts_clear_documents (TrackerDBInterface *db_interface)
+{
+	if (db_interface->fts_tokenizer)
+		tracker_tokenizer_clear_documents (db_interface->fts_tokenizer);
+}
+
 gboolean
 tracker_db_interface_sqlite_fts_integrity_check (TrackerDBInterface  *interface,
                                                  const gchar         *database)
@@ -2097,6 +2623,32 @@ tracker_db_interface_sqlite_reset_collator (TrackerDBInterface *db_interface)
 		g_critical ("Couldn't set title collation function: %s",
 		            sqlite3_errmsg (db_interface->db));
 	}
+
+	/* Sort keys compare with memcmp() like the collations above, these
+	 * are computed once per row when sorting, instead of collating
+	 * strings on every comparison.
+	 */
+	if (sqlite3_create_function_v2 (db_interface->db,
+	                                "SparqlSortKey", 1,
+	                                SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+	                                tracker_collation_init (),
+	                                function_sparql_sort_key,
+	                                NULL, NULL,
+	                                tracker_collation_shutdown) != SQLITE_OK) {
+		g_critical ("Couldn't set sort key function: %s",
+		            sqlite3_errmsg (db_interface->db));
+	}
+
+	if (sqlite3_create_function_v2 (db_interface->db,
+	                                "SparqlTitleSortKey", 1,
+	                                SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+	                                tracker_collation_init (),
+	                                function_sparql_title_sort_key,
+	                                NULL, NULL,
+	                                tracker_collation_shutdown) != SQLITE_OK) {
+		g_critical ("Couldn't set title sort key function: %s",
+		            sqlite3_errmsg (db_interface->db));
+	}
 }
 
 gboolean
@@ -2620,6 +3172,14 @@ tracker_db_interface_sqlite_get_last_insert_id (TrackerDBInterface *interface)
 	return (gint64) sqlite3_last_insert_rowid (interface->db);
 }
 
+gint
+tracker_db_interface_sqlite_get_changes (TrackerDBInterface *interface)
+{
+	g_return_val_if_fail (TRACKER_IS_DB_INTERFACE (interface), 0);
+
+	return sqlite3_changes (interface->db);
+}
+
 static void
 tracker_db_statement_finalize (GObject *object)
 {
@@ -2706,6 +3266,12 @@ tracker_db_cursor_close (TrackerSparqlCursor *sparql_cursor)
 
 	tracker_db_interface_lock (iface);
 	g_clear_pointer (&cursor->ref_stmt, tracker_db_statement_sqlite_release);
+
+	if (cursor->exclusive) {
+		iface->exclusive = FALSE;
+		cursor->exclusive = FALSE;
+	}
+
 	tracker_db_interface_unlock (iface);
 
 	tracker_db_interface_unref_use (iface);
@@ -2787,6 +3353,7 @@ tracker_db_cursor_class_init (TrackerDBCursorClass *class)
 	sparql_cursor_class->get_integer = tracker_db_cursor_get_int;
 	sparql_cursor_class->get_double = tracker_db_cursor_get_double;
 	sparql_cursor_class->get_boolean = tracker_db_cursor_get_boolean;
+	sparql_cursor_class->get_values = tracker_db_cursor_get_values;
 }
 
 static TrackerDBCursor *
@@ -2823,6 +3390,22 @@ tracker_db_cursor_sqlite_new (TrackerDBStatement  *ref_stmt,
 	cursor->stmt = ref_stmt->stmt;
 	cursor->ref_stmt = tracker_db_statement_sqlite_grab (ref_stmt);
 
+	/* Pooled interfaces are only handed to other threads through
+	 * tracker_db_interface_try_ref_shared_use(). If the caller that
+	 * obtained the interface is its only other user, claim it for
+	 * this cursor, so rows can be read without taking the lock.
+	 */
+	tracker_db_interface_lock (iface);
+
+	if ((iface->flags & TRACKER_DB_INTERFACE_POOLED) != 0 &&
+	    !iface->exclusive &&
+	    g_atomic_int_get (&iface->n_users) == 2) {
+		iface->exclusive = TRUE;
+		cursor->exclusive = TRUE;
+	}
+
+	tracker_db_interface_unlock (iface);
+
 	return cursor;
 }
 
@@ -2900,6 +3483,37 @@ tracker_db_statement_bind_bytes (TrackerDBStatement         *stmt,
 	tracker_db_interface_unlock (stmt->db_interface);
 }
 
+void
+tracker_db_statement_bind_datetime (TrackerDBStatement *stmt,
+                                    int                 index,
+                                    GDateTime          *value)
+{
+	g_return_if_fail (TRACKER_IS_DB_STATEMENT (stmt));
+
+	g_assert (!stmt->stmt_is_used);
+
+	tracker_db_interface_lock (stmt->db_interface);
+
+	/* Plain UTC times are stored losslessly as unix timestamps,
+	 * anything else (UTC offset, subsecond precision) gets packed.
+	 */
+	if (g_date_time_get_utc_offset (value) == 0 &&
+	    g_date_time_get_microsecond (value) == 0) {
+		sqlite3_bind_int64 (stmt->stmt, index + 1,
+		                    g_date_time_to_unix (value));
+	} else {
+		guint8 buf[TRACKER_DATE_TIME_PACKED_SIZE];
+
+		tracker_date_time_pack (tracker_date_time_get_usec (value),
+		                        tracker_date_time_get_offset (value),
+		                        buf);
+		sqlite3_bind_blob (stmt->stmt, index + 1, buf, sizeof (buf),
+		                   SQLITE_TRANSIENT);
+	}
+
+	tracker_db_interface_unlock (stmt->db_interface);
+}
+
 void
 tracker_db_statement_bind_value (TrackerDBStatement *stmt,
                                  int                 index,
@@ -2941,12 +3555,21 @@ tracker_db_statement_bind_value (TrackerDBStatement *stmt,
 		                   data, len, SQLITE_TRANSIENT);
 	} else if (type == G_TYPE_DATE_TIME) {
 		GDateTime *datetime;
-		gchar *str;
+		gchar str[TRACKER_DATE_TIME_ISO8601_SIZE];
+		gsize len;
 
 		datetime = g_value_get_boxed (value);
-		str = tracker_date_format_iso8601 (datetime);
+		len = tracker_date_time_to_iso8601 (tracker_date_time_get_usec (datetime),
+		                                    tracker_date_time_get_offset (datetime),
+		                                    str);
 		sqlite3_bind_text (stmt->stmt, index + 1,
-		                   str, -1, g_free);
+		                   str, len, SQLITE_TRANSIENT);
+	} else if (type == G_TYPE_ARRAY) {
+		/* Expanded into rows by the tracker_array_values() function */
+		sqlite3_bind_pointer (stmt->stmt, index + 1,
+		                      g_array_ref (g_value_get_boxed (value)),
+		                      TRACKER_VTAB_ARRAY_POINTER_TYPE,
+		                      (GDestroyNotify) g_array_unref);
 	} else {
 		GValue dest = G_VALUE_INIT;
 
@@ -2968,18 +3591,15 @@ void
 tracker_db_cursor_rewind (TrackerSparqlCursor *sparql_cursor)
 {
 	TrackerDBCursor *cursor = TRACKER_DB_CURSOR (sparql_cursor);
-	TrackerDBInterface *iface;
 
 	g_return_if_fail (TRACKER_IS_DB_CURSOR (cursor));
 
-	iface = cursor->ref_stmt->db_interface;
-
-	tracker_db_interface_lock (iface);
+	tracker_db_cursor_lock (cursor);
 
 	sqlite3_reset (cursor->stmt);
 	cursor->finished = FALSE;
 
-	tracker_db_interface_unlock (iface);
+	tracker_db_cursor_unlock (cursor);
 }
 
 gboolean
@@ -3000,7 +3620,7 @@ db_cursor_iter_next (TrackerDBCursor *cursor,
 	TrackerDBInterface *iface = stmt->db_interface;
 	gboolean finished;
 
-	tracker_db_interface_lock (iface);
+	tracker_db_cursor_lock (cursor);
 
 	if (!cursor->finished) {
 		guint result;
@@ -3032,7 +3652,7 @@ db_cursor_iter_next (TrackerDBCursor *cursor,
 
 	finished = cursor->finished;
 
-	tracker_db_interface_unlock (iface);
+	tracker_db_cursor_unlock (cursor);
 
 	return !finished;
 }
@@ -3041,19 +3661,16 @@ gint
 tracker_db_cursor_get_n_columns (TrackerSparqlCursor *sparql_cursor)
 {
 	TrackerDBCursor *cursor = TRACKER_DB_CURSOR (sparql_cursor);
-	TrackerDBInterface *iface;
 	guint n_columns;
 
-	iface = cursor->ref_stmt->db_interface;
-
-	tracker_db_interface_lock (iface);
+	tracker_db_cursor_lock (cursor);
 
 	if (cursor->n_columns == 0)
 		n_columns = sqlite3_column_count (cursor->stmt);
 	else
 		n_columns = cursor->n_columns;
 
-	tracker_db_interface_unlock (iface);
+	tracker_db_cursor_unlock (cursor);
 
 	return n_columns;
 }
@@ -3094,19 +3711,16 @@ tracker_db_cursor_get_int (TrackerSparqlCursor *sparql_cursor,
                            gint                 column)
 {
 	TrackerDBCursor *cursor = TRACKER_DB_CURSOR (sparql_cursor);
-	TrackerDBInterface *iface;
 	gint64 result;
 
 	if (cursor->n_columns > 0 && column >= (gint) cursor->n_columns)
 		return 0;
 
-	iface = cursor->ref_stmt->db_interface;
-
-	tracker_db_interface_lock (iface);
+	tracker_db_cursor_lock (cursor);
 
 	result = (gint64) sqlite3_column_int64 (cursor->stmt, column);
 
-	tracker_db_interface_unlock (iface);
+	tracker_db_cursor_unlock (cursor);
 
 	return result;
 }
@@ -3116,19 +3730,16 @@ tracker_db_cursor_get_double (TrackerSparqlCursor *sparql_cursor,
                               gint                 column)
 {
 	TrackerDBCursor *cursor = TRACKER_DB_CURSOR (sparql_cursor);
-	TrackerDBInterface *iface;
 	gdouble result;
 
 	if (cursor->n_columns > 0 && column >= (gint) cursor->n_columns)
 		return 0;
 
-	iface = cursor->ref_stmt->db_interface;
-
-	tracker_db_interface_lock (iface);
+	tracker_db_cursor_lock (cursor);
 
 	result = (gdouble) sqlite3_column_double (cursor->stmt, column);
 
-	tracker_db_interface_unlock (iface);
+	tracker_db_cursor_unlock (cursor);
 
 	return result;
 }
@@ -3196,19 +3807,13 @@ tracker_db_cursor_get_annotated_value_type (TrackerDBCursor        *cursor,
 	g_assert_not_reached ();
 }
 
-TrackerSparqlValueType
-tracker_db_cursor_get_value_type (TrackerSparqlCursor *sparql_cursor,
-                                  gint                 column)
+static TrackerSparqlValueType
+db_cursor_get_value_type (TrackerDBCursor *cursor,
+                          gint             column)
 {
-	TrackerDBCursor *cursor = TRACKER_DB_CURSOR (sparql_cursor);
-	TrackerDBInterface *iface;
 	gint column_type;
 	TrackerSparqlValueType value_type;
 
-	iface = cursor->ref_stmt->db_interface;
-
-	tracker_db_interface_lock (iface);
-
 	column_type = sqlite3_column_type (cursor->stmt, column);
 
 	if (!tracker_db_cursor_get_annotated_value_type (cursor, column, column_type, &value_type)) {
@@ -3229,7 +3834,19 @@ tracker_db_cursor_get_value_type (TrackerSparqlCursor *sparql_cursor,
 		}
 	}
 
-	tracker_db_interface_unlock (iface);
+	return value_type;
+}
+
+TrackerSparqlValueType
+tracker_db_cursor_get_value_type (TrackerSparqlCursor *sparql_cursor,
+                                  gint                 column)
+{
+	TrackerDBCursor *cursor = TRACKER_DB_CURSOR (sparql_cursor);
+	TrackerSparqlValueType value_type;
+
+	tracker_db_cursor_lock (cursor);
+	value_type = db_cursor_get_value_type (cursor, column);
+	tracker_db_cursor_unlock (cursor);
 
 	return value_type;
 }
@@ -3239,17 +3856,14 @@ tracker_db_cursor_get_variable_name (TrackerSparqlCursor *sparql_cursor,
                                      gint                 column)
 {
 	TrackerDBCursor *cursor = TRACKER_DB_CURSOR (sparql_cursor);
-	TrackerDBInterface *iface;
 	const gchar *result;
 
 	if (cursor->n_columns > 0 && column >= (gint) cursor->n_columns)
 		return NULL;
 
-	iface = cursor->ref_stmt->db_interface;
-
-	tracker_db_interface_lock (iface);
+	tracker_db_cursor_lock (cursor);
 	result = sqlite3_column_name (cursor->stmt, column);
-	tracker_db_interface_unlock (iface);
+	tracker_db_cursor_unlock (cursor);
 
 	if (!result)
 		return NULL;
@@ -3261,30 +3875,16 @@ tracker_db_cursor_get_variable_name (TrackerSparqlCursor *sparql_cursor,
 	return result;
 }
 
-const gchar*
-tracker_db_cursor_get_string (TrackerSparqlCursor  *sparql_cursor,
-                              gint                  column,
-                              const gchar         **langtag,
-                              glong                *length)
+static const gchar *
+db_cursor_get_string (TrackerDBCursor  *cursor,
+                      gint              column,
+                      const gchar     **langtag,
+                      glong            *length)
 {
-	TrackerDBCursor *cursor = TRACKER_DB_CURSOR (sparql_cursor);
-	TrackerDBInterface *iface;
 	const gchar *result = NULL;
 	sqlite3_value *val;
 	int type;
 
-	if (langtag)
-		*langtag = NULL;
-	if (length)
-		*length = 0;
-
-	if (cursor->n_columns > 0 && column >= (gint) cursor->n_columns)
-		return NULL;
-
-	iface = cursor->ref_stmt->db_interface;
-
-	tracker_db_interface_lock (iface);
-
 	val = sqlite3_column_value (cursor->stmt, column);
 	type = sqlite3_value_type (val);
 
@@ -3315,11 +3915,67 @@ tracker_db_cursor_get_string (TrackerSparqlCursor  *sparql_cursor,
 		}
 	}
 
-	tracker_db_interface_unlock (iface);
+	return result;
+}
+
+const gchar*
+tracker_db_cursor_get_string (TrackerSparqlCursor  *sparql_cursor,
+                              gint                  column,
+                              const gchar         **langtag,
+                              glong                *length)
+{
+	TrackerDBCursor *cursor = TRACKER_DB_CURSOR (sparql_cursor);
+	const gchar *result;
+
+	if (langtag)
+		*langtag = NULL;
+	if (length)
+		*length = 0;
+
+	if (cursor->n_columns > 0 && column >= (gint) cursor->n_columns)
+		return NULL;
+
+	tracker_db_cursor_lock (cursor);
+	result = db_cursor_get_string (cursor, column, langtag, length);
+	tracker_db_cursor_unlock (cursor);
 
 	return result;
 }
 
+static gint
+tracker_db_cursor_get_values (TrackerSparqlCursor      *sparql_cursor,
+                              TrackerSparqlCursorValue *values,
+                              gint                      n_values)
+{
+	TrackerDBCursor *cursor = TRACKER_DB_CURSOR (sparql_cursor);
+	gint i, n_columns;
+
+	/* Fetch the whole row with a single lock, instead of taking it
+	 * for every column access.
+	 */
+	tracker_db_cursor_lock (cursor);
+
+	if (cursor->n_columns == 0)
+		n_columns = sqlite3_column_count (cursor->stmt);
+	else
+		n_columns = cursor->n_columns;
+
+	n_columns = MIN (n_columns, n_values);
+
+	for (i = 0; i < n_columns; i++) {
+		values[i].value_type = db_cursor_get_value_type (cursor, i);
+		values[i].langtag = NULL;
+		values[i].length = 0;
+		values[i].str = db_cursor_get_string (cursor, i,
+		                                      &values[i].langtag,
+		                                      &values[i].length);
+	}
+
+	tracker_db_cursor_unlock (cursor);
+
+	return n_columns;
+}
+
 gboolean
 tracker_db_statement_execute (TrackerDBStatement  *stmt,
                               GError             **error)
@@ -3420,6 +4076,12 @@ tracker_db_statement_get_values (TrackerDBStatement   *stmt,
 		case TRACKER_PROPERTY_TYPE_DATETIME:
 			if (sqlite3_column_type (stmt->stmt, 0) == SQLITE_INTEGER) {
 				datetime = g_date_time_new_from_unix_utc (sqlite3_column_int64 (stmt->stmt, 0));
+			} else if (sqlite3_column_type (stmt->stmt, 0) == SQLITE_BLOB) {
+				datetime = tracker_date_new_from_packed (sqlite3_column_blob (stmt->stmt, 0),
+				                                         sqlite3_column_bytes (stmt->stmt, 0),
+				                                         &inner_error);
+				if (!datetime)
+					break;
 			} else {
 				datetime = tracker_date_new_from_iso8601 ((const gchar *) sqlite3_column_text (stmt->stmt, 0),
 				                                          &inner_error);
@@ -3469,6 +4131,21 @@ tracker_db_statement_start_sparql_cursor (TrackerDBStatement  *stmt,
 	return tracker_db_cursor_sqlite_new (stmt, n_columns);
 }
 
+void
+tracker_db_statement_get_status (TrackerDBStatement *stmt,
+                                 gint64             *vm_steps,
+                                 gint64             *fullscan_steps,
+                                 gint64             *sorts,
+                                 gint64             *autoindexes)
+{
+	g_return_if_fail (TRACKER_IS_DB_STATEMENT (stmt));
+
+	*vm_steps = sqlite3_stmt_status (stmt->stmt, SQLITE_STMTSTATUS_VM_STEP, FALSE);
+	*fullscan_steps = sqlite3_stmt_status (stmt->stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, FALSE);
+	*sorts = sqlite3_stmt_status (stmt->stmt, SQLITE_STMTSTATUS_SORT, FALSE);
+	*autoindexes = sqlite3_stmt_status (stmt->stmt, SQLITE_STMTSTATUS_AUTOINDEX, FALSE);
+}
+
 static void
 tracker_db_statement_init (TrackerDBStatement *stmt)
 {
@@ -3506,6 +4183,23 @@ tracker_db_interface_unref_use (TrackerDBInterface *db_interface)
 	return g_atomic_int_dec_and_test (&db_interface->n_users);
 }
 
+gboolean
+tracker_db_interface_try_ref_shared_use (TrackerDBInterface *db_interface)
+{
+	gboolean shared = FALSE;
+
+	tracker_db_interface_lock (db_interface);
+
+	if (!db_interface->exclusive) {
+		g_atomic_int_inc (&db_interface->n_users);
+		shared = TRUE;
+	}
+
+	tracker_db_interface_unlock (db_interface);
+
+	return shared;
+}
+
 gboolean
 tracker_db_interface_get_is_used (TrackerDBInterface *db_interface)
 {
@@ -3515,6 +4209,8 @@ tracker_db_interface_get_is_used (TrackerDBInterface *db_interface)
 void
 tracker_db_interface_init_vtabs (TrackerDBInterface *db_interface)
 {
+	tracker_vtab_array_init (db_interface->db);
+	tracker_vtab_resource_init (db_interface->db);
 	tracker_vtab_triples_init (db_interface->db, (gpointer) db_interface->user_data);
 	tracker_vtab_service_init (db_interface->db, (gpointer) db_interface->user_data);
 }
@@ -3578,6 +4274,47 @@ tracker_db_interface_detach_database (TrackerDBInterface  *db_interface,
 	return retval;
 }
 
+gboolean
+tracker_db_interface_sqlite_can_copy_database (void)
+{
+	/* VACUUM INTO appeared in SQLite 3.27.0 */
+	return sqlite3_libversion_number () >= 3027000;
+}
+
+gboolean
+tracker_db_interface_sqlite_copy_database (TrackerDBInterface  *db_interface,
+                                           const gchar         *database,
+                                           GFile               *file,
+                                           GError             **error)
+{
+	sqlite3_stmt *stmt;
+	gboolean retval;
+	gchar *sql, *path;
+
+	if (!tracker_db_interface_sqlite_can_copy_database ()) {
+		g_set_error (error,
+		             TRACKER_DB_INTERFACE_ERROR,
+		             TRACKER_DB_QUERY_ERROR,
+		             "Copying databases requires SQLite 3.27.0");
+		return FALSE;
+	}
+
+	sql = g_strdup_printf ("VACUUM \"%s\" INTO ?", database);
+	stmt = tracker_db_interface_prepare_stmt (db_interface, sql, error);
+	g_free (sql);
+
+	if (!stmt)
+		return FALSE;
+
+	path = g_file_get_path (file);
+	sqlite3_bind_text (stmt, 1, path, -1, SQLITE_TRANSIENT);
+	g_free (path);
+
+	retval = execute_stmt (db_interface, stmt, NULL, error);
+	sqlite3_finalize (stmt);
+	return retval;
+}
+
 gssize
 tracker_db_interface_sqlite_release_memory (TrackerDBInterface *db_interface)
 {
@@ -37,6 +37,7 @@ typedef void (*TrackerDBWalCallback) (TrackerDBInterface *iface,
 typedef enum {
 	TRACKER_DB_INTERFACE_READONLY  = 1 << 0,
 	TRACKER_DB_INTERFACE_IN_MEMORY = 1 << 2,
+	TRACKER_DB_INTERFACE_POOLED    = 1 << 3,
 } TrackerDBInterfaceFlags;
 
 TrackerDBInterface *tracker_db_interface_sqlite_new                    (const gchar              *filename,
@@ -44,6 +45,7 @@ TrackerDBInterface *tracker_db_interface_sqlite_new                    (const gc
                                                                         TrackerDBInterfaceFlags   flags,
                                                                         GError                  **error);
 gint64              tracker_db_interface_sqlite_get_last_insert_id     (TrackerDBInterface       *interface);
+gint                tracker_db_interface_sqlite_get_changes            (TrackerDBInterface       *interface);
 gboolean            tracker_db_interface_sqlite_fts_init               (TrackerDBInterface       *interface,
                                                                         TrackerDBManagerFlags     fts_flags,
                                                                         GError                  **error);
@@ -76,6 +78,19 @@ TrackerDBStatement * tracker_db_interface_sqlite_fts_delete_text_stmt (TrackerDB
                                                                        const gchar        **properties,
                                                                        GError             **error);
 
+TrackerDBStatement * tracker_db_interface_sqlite_fts_select_text_stmt (TrackerDBInterface  *db_interface,
+                                                                       const gchar         *database,
+                                                                       const gchar        **properties,
+                                                                       GError             **error);
+
+gboolean            tracker_db_interface_sqlite_fts_add_documents   (TrackerDBInterface  *db_interface,
+                                                                     TrackerDBStatement  *stmt,
+                                                                     gint64               id,
+                                                                     GError             **error);
+gboolean            tracker_db_interface_sqlite_fts_documents_full     (TrackerDBInterface *db_interface);
+void                tracker_db_interface_sqlite_fts_tokenize_documents (TrackerDBInterface *db_interface);
+void                tracker_db_interface_sqlite_fts_clear_documents    (TrackerDBInterface *db_interface);
+
 gboolean            tracker_db_interface_sqlite_fts_integrity_check (TrackerDBInterface  *interface,
                                                                      const gchar         *database);
 
@@ -90,10 +105,16 @@ gboolean            tracker_db_interface_attach_database               (TrackerD
 gboolean            tracker_db_interface_detach_database               (TrackerDBInterface       *db_interface,
                                                                         const gchar              *name,
                                                                         GError                  **error);
+gboolean            tracker_db_interface_sqlite_can_copy_database      (void);
+gboolean            tracker_db_interface_sqlite_copy_database          (TrackerDBInterface       *db_interface,
+                                                                        const gchar              *database,
+                                                                        GFile                    *file,
+                                                                        GError                  **error);
 gssize              tracker_db_interface_sqlite_release_memory         (TrackerDBInterface       *db_interface);
 
 void                tracker_db_interface_ref_use   (TrackerDBInterface *db_interface);
 gboolean            tracker_db_interface_unref_use (TrackerDBInterface *db_interface);
+gboolean            tracker_db_interface_try_ref_shared_use (TrackerDBInterface *db_interface);
 
 gboolean tracker_db_interface_found_corruption (TrackerDBInterface *db_interface);
 
@@ -135,6 +135,9 @@ void                    tracker_db_statement_bind_text               (TrackerDBS
 void                    tracker_db_statement_bind_bytes              (TrackerDBStatement         *stmt,
                                                                       int                         index,
                                                                       GBytes                     *value);
+void                    tracker_db_statement_bind_datetime           (TrackerDBStatement         *stmt,
+                                                                      int                         index,
+                                                                      GDateTime                  *value);
 void                    tracker_db_statement_bind_value              (TrackerDBStatement         *stmt,
                                                                       int                         index,
 								      const GValue               *value);
@@ -145,6 +148,11 @@ TrackerDBCursor *       tracker_db_statement_start_cursor            (TrackerDBS
 TrackerDBCursor *       tracker_db_statement_start_sparql_cursor     (TrackerDBStatement         *stmt,
                                                                       guint                       n_columns,
                                                                       GError                    **error);
+void                    tracker_db_statement_get_status              (TrackerDBStatement         *stmt,
+                                                                      gint64                     *vm_steps,
+                                                                      gint64                     *fullscan_steps,
+                                                                      gint64                     *sorts,
+                                                                      gint64                     *autoindexes);
 
 /* Statement caches */
 void tracker_db_statement_mru_init (TrackerDBStatementMru *mru,
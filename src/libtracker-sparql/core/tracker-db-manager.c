@@ -20,6 +20,7 @@
 #include "config.h"
 
 #include <fcntl.h>
+#include <unistd.h>
 
 #include <glib/gstdio.h>
 #include <locale.h>
@@ -41,6 +42,25 @@
 
 #define TRACKER_VACUUM_CHECK_SIZE     ((goffset) 4 * 1024 * 1024 * 1024) /* 4GB */
 
+#define SHADOW_DATABASE_SUFFIX        ".migration"
+
+/* Memory-mapped I/O defaults, the mmap size is a fraction of the
+ * physical memory within these limits.
+ */
+#define TRACKER_DB_MMAP_SIZE_MIN      ((gint64) 32 * 1024 * 1024) /* 32MB */
+#if GLIB_SIZEOF_VOID_P > 4
+#define TRACKER_DB_MMAP_SIZE_MAX      ((gint64) 1024 * 1024 * 1024) /* 1GB */
+#else
+#define TRACKER_DB_MMAP_SIZE_MAX      ((gint64) 64 * 1024 * 1024) /* 64MB */
+#endif
+#define TRACKER_DB_MMAP_SIZE_DEFAULT  ((gint64) 64 * 1024 * 1024) /* 64MB */
+
+/* Page cache budget shared by all readonly interfaces, in KiB */
+#define TRACKER_DB_READER_CACHE_BUDGET_MIN     2048
+#define TRACKER_DB_READER_CACHE_BUDGET_MAX     65536
+#define TRACKER_DB_READER_CACHE_BUDGET_DEFAULT 8192
+#define TRACKER_DB_READER_CACHE_SIZE_MIN       64 /* pages */
+
 #define CORRUPTED_FILENAME            ".meta.corrupted"
 
 #define TOSTRING1(x) #x
@@ -82,6 +102,12 @@ struct _TrackerDBManager {
 	gboolean first_time;
 	TrackerDBVersion db_version;
 
+	/* Tuning */
+	gint64 mmap_size;
+	gint reader_cache_budget;
+	gint writer_cache_size;
+	TrackerDBTempStore temp_store;
+
 	GWeakRef iface_data;
 
 	GAsyncQueue *interfaces;
@@ -115,14 +141,250 @@ tracker_db_manager_get_flags (TrackerDBManager *db_manager)
 	return db_manager->flags;
 }
 
+static guint64
+get_physical_memory (void)
+{
+#if defined (_SC_PHYS_PAGES) && defined (_SC_PAGESIZE)
+	glong n_pages, page_size;
+
+	n_pages = sysconf (_SC_PHYS_PAGES);
+	page_size = sysconf (_SC_PAGESIZE);
+
+	if (n_pages > 0 && page_size > 0)
+		return (guint64) n_pages * page_size;
+#endif
+
+	return 0;
+}
+
+static void
+tracker_db_manager_parse_tuning (TrackerDBManager *db_manager,
+                                 const gchar      *tuning)
+{
+	gchar **options;
+	guint i;
+
+	/* Comma separated list of key=value pairs, e.g.
+	 * "mmap-size=268435456,reader-cache-budget=16384,temp-store=memory"
+	 */
+	options = g_strsplit (tuning, ",", -1);
+
+	for (i = 0; options[i]; i++) {
+		gchar **pair, *end = NULL;
+		gint64 value = 0;
+
+		pair = g_strsplit (g_strstrip (options[i]), "=", 2);
+		if (pair[0] && pair[1])
+			value = g_ascii_strtoll (pair[1], &end, 10);
+
+		if (!pair[0] || !pair[1]) {
+			g_warning ("Ignoring malformed database tuning option '%s'", options[i]);
+		} else if (g_strcmp0 (pair[0], "temp-store") == 0) {
+			if (g_ascii_strcasecmp (pair[1], "memory") == 0)
+				db_manager->temp_store = TRACKER_DB_TEMP_STORE_MEMORY;
+			else if (g_ascii_strcasecmp (pair[1], "file") == 0)
+				db_manager->temp_store = TRACKER_DB_TEMP_STORE_FILE;
+			else
+				db_manager->temp_store = TRACKER_DB_TEMP_STORE_DEFAULT;
+		} else if (end == pair[1] || *end != '\0' || value < 0) {
+			g_warning ("Ignoring invalid value for database tuning option '%s'", pair[0]);
+		} else if (g_strcmp0 (pair[0], "mmap-size") == 0) {
+			db_manager->mmap_size = value;
+		} else if (g_strcmp0 (pair[0], "page-size") == 0) {
+			if (page_size_is_valid (value))
+				db_manager->db.page_size = value;
+			else
+				g_warning ("Ignoring invalid database page size %" G_GINT64_FORMAT, value);
+		} else if (g_strcmp0 (pair[0], "reader-cache-budget") == 0) {
+			db_manager->reader_cache_budget = MIN (value, G_MAXINT);
+		} else if (g_strcmp0 (pair[0], "writer-cache-size") == 0) {
+			db_manager->writer_cache_size = MIN (value, G_MAXINT);
+		} else {
+			g_warning ("Unknown database tuning option '%s'", pair[0]);
+		}
+
+		g_strfreev (pair);
+	}
+
+	g_strfreev (options);
+}
+
+static gboolean
+page_size_is_valid (gint64 page_size)
+{
+	/* SQLite requires a power of two between 512 and 65536 */
+	return (page_size >= 512 && page_size <= 65536 &&
+	        (page_size & (page_size - 1)) == 0);
+}
+
+static gboolean
+tracker_db_manager_apply_options (TrackerDBManager  *db_manager,
+                                  GVariant          *options,
+                                  GError           **error)
+{
+	GVariantIter iter;
+	const gchar *key;
+	GVariant *value;
+
+	g_variant_iter_init (&iter, options);
+
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		gboolean valid = FALSE;
+
+		if (g_strcmp0 (key, "mmap-size") == 0 &&
+		    g_variant_is_of_type (value, G_VARIANT_TYPE_INT64)) {
+			db_manager->mmap_size = g_variant_get_int64 (value);
+			valid = db_manager->mmap_size >= 0;
+		} else if (g_strcmp0 (key, "page-size") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			db_manager->db.page_size = g_variant_get_int32 (value);
+			valid = page_size_is_valid (db_manager->db.page_size);
+		} else if (g_strcmp0 (key, "reader-cache-budget") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			db_manager->reader_cache_budget = g_variant_get_int32 (value);
+			valid = db_manager->reader_cache_budget >= 0;
+		} else if (g_strcmp0 (key, "temp-store") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_STRING)) {
+			const gchar *str = g_variant_get_string (value, NULL);
+
+			valid = TRUE;
+
+			if (g_strcmp0 (str, "memory") == 0)
+				db_manager->temp_store = TRACKER_DB_TEMP_STORE_MEMORY;
+			else if (g_strcmp0 (str, "file") == 0)
+				db_manager->temp_store = TRACKER_DB_TEMP_STORE_FILE;
+			else if (g_strcmp0 (str, "default") == 0)
+				db_manager->temp_store = TRACKER_DB_TEMP_STORE_DEFAULT;
+			else
+				valid = FALSE;
+		}
+
+		g_variant_unref (value);
+
+		if (!valid) {
+			g_set_error (error,
+			             TRACKER_DB_INTERFACE_ERROR,
+			             TRACKER_DB_OPEN_ERROR,
+			             "Invalid database option '%s'", key);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+tracker_db_manager_init_tuning (TrackerDBManager  *db_manager,
+                                GVariant          *options,
+                                GError           **error)
+{
+	const gchar *tuning;
+	guint64 memory;
+
+	/* Set values first, derived values below depend on e.g.
+	 * the page size. Negative values mean "not set".
+	 */
+	db_manager->mmap_size = -1;
+	db_manager->reader_cache_budget = -1;
+	db_manager->writer_cache_size = -1;
+	db_manager->temp_store = TRACKER_DB_TEMP_STORE_DEFAULT;
+
+	if (options && !tracker_db_manager_apply_options (db_manager, options, error))
+		return FALSE;
+
+	/* Debugging override, takes precedence over connection options */
+	tuning = g_getenv ("TRACKER_DB_TUNING");
+	if (tuning)
+		tracker_db_manager_parse_tuning (db_manager, tuning);
+
+	memory = get_physical_memory ();
+
+	/* Memory-mapped reads are served straight from the OS page
+	 * cache, which is shared between all connections and processes.
+	 */
+	if (db_manager->mmap_size >= 0) {
+		/* Set explicitly */
+	} else if ((db_manager->flags & TRACKER_DB_MANAGER_IN_MEMORY) != 0) {
+		db_manager->mmap_size = 0;
+	} else if (memory > 0) {
+		db_manager->mmap_size = CLAMP ((gint64) (memory / 8),
+		                               TRACKER_DB_MMAP_SIZE_MIN,
+		                               TRACKER_DB_MMAP_SIZE_MAX);
+	} else {
+		db_manager->mmap_size = TRACKER_DB_MMAP_SIZE_DEFAULT;
+	}
+
+	if (db_manager->reader_cache_budget < 0 && memory > 0)
+		db_manager->reader_cache_budget = CLAMP ((gint) (memory / 64 / 1024),
+		                                         TRACKER_DB_READER_CACHE_BUDGET_MIN,
+		                                         TRACKER_DB_READER_CACHE_BUDGET_MAX);
+	else if (db_manager->reader_cache_budget < 0)
+		db_manager->reader_cache_budget = TRACKER_DB_READER_CACHE_BUDGET_DEFAULT;
+
+	if (db_manager->writer_cache_size < 0)
+		db_manager->writer_cache_size = TRACKER_DB_CACHE_SIZE_UPDATE * db_manager->db.page_size / 1024;
+
+	TRACKER_NOTE (SQLITE, g_message ("Database tuning: mmap size %" G_GINT64_FORMAT
+	                                 ", page size %d, reader cache budget %dKiB"
+	                                 ", writer cache %dKiB",
+	                                 db_manager->mmap_size,
+	                                 db_manager->db.page_size,
+	                                 db_manager->reader_cache_budget,
+	                                 db_manager->writer_cache_size));
+
+	return TRUE;
+}
+
+static gint
+tracker_db_manager_get_cache_size (TrackerDBManager *db_manager,
+                                   gboolean          readonly)
+{
+	gint cache_size;
+
+	/* In-memory databases keep their historical setting */
+	if ((db_manager->flags & TRACKER_DB_MANAGER_IN_MEMORY) != 0)
+		return db_manager->db.cache_size;
+
+	/* The writer grows its cache during updates, see
+	 * tracker_db_manager_get_update_cache_size().
+	 */
+	if (!readonly)
+		return db_manager->db.cache_size;
+
+	/* Readers split the budget, backed by the shared mmap
+	 * when enabled, otherwise keep the default page count.
+	 */
+	if (db_manager->mmap_size <= 0)
+		return db_manager->db.cache_size;
+
+	cache_size = (gint) (((gint64) db_manager->reader_cache_budget * 1024) /
+	                     db_manager->db.page_size / MAX_INTERFACES);
+
+	return CLAMP (cache_size,
+	              TRACKER_DB_READER_CACHE_SIZE_MIN,
+	              db_manager->db.cache_size);
+}
+
+gint
+tracker_db_manager_get_update_cache_size (TrackerDBManager *db_manager)
+{
+	if ((db_manager->flags & TRACKER_DB_MANAGER_IN_MEMORY) != 0)
+		return TRACKER_DB_CACHE_SIZE_UPDATE;
+
+	/* Negative values are in KiB */
+	return - MAX (db_manager->writer_cache_size, 1);
+}
+
 static void
 iface_set_params (TrackerDBInterface   *iface,
                   gboolean              readonly,
+                  TrackerDBTempStore    temp_store,
                   GError              **error)
 {
 	tracker_db_interface_execute_query (iface, NULL, "PRAGMA encoding = 'UTF-8'");
 
-	if (readonly) {
+	if (temp_store == TRACKER_DB_TEMP_STORE_MEMORY ||
+	    (temp_store == TRACKER_DB_TEMP_STORE_DEFAULT && readonly)) {
 		tracker_db_interface_execute_query (iface, NULL, "PRAGMA temp_store = MEMORY;");
 	} else {
 		tracker_db_interface_execute_query (iface, NULL, "PRAGMA temp_store = FILE;");
@@ -134,6 +396,7 @@ db_set_params (TrackerDBInterface   *iface,
                const gchar          *database,
                gint                  cache_size,
                gint                  page_size,
+               gint64                mmap_size,
                gboolean              enable_wal,
                GError              **error)
 {
@@ -177,6 +440,12 @@ db_set_params (TrackerDBInterface   *iface,
 
 	tracker_db_interface_execute_query (iface, NULL, "PRAGMA \"%s\".cache_size = %d", database, cache_size);
 	TRACKER_NOTE (SQLITE, g_message ("  Setting cache size to %d", cache_size));
+
+	if (mmap_size > 0) {
+		tracker_db_interface_execute_query (iface, NULL, "PRAGMA \"%s\".mmap_size = %" G_GINT64_FORMAT,
+		                                    database, mmap_size);
+		TRACKER_NOTE (SQLITE, g_message ("  Setting mmap size to %" G_GINT64_FORMAT, mmap_size));
+	}
 }
 
 static gboolean
@@ -469,6 +738,7 @@ TrackerDBManager *
 tracker_db_manager_new (TrackerDBManagerFlags   flags,
                         GFile                  *cache_location,
                         guint                   select_cache_size,
+                        GVariant               *options,
                         GObject                *iface_data,
                         GError                **error)
 {
@@ -513,6 +783,11 @@ tracker_db_manager_new (TrackerDBManagerFlags   flags,
 		db_manager->shared_cache_key = tracker_generate_uuid (NULL);
 	}
 
+	if (!tracker_db_manager_init_tuning (db_manager, options, error)) {
+		g_object_unref (db_manager);
+		return NULL;
+	}
+
 	if ((db_manager->flags & TRACKER_DB_MANAGER_IN_MEMORY) != 0) {
 		need_to_create = TRUE;
 	} else if (!g_file_test (db_manager->db.abs_filename, G_FILE_TEST_EXISTS)) {
@@ -582,7 +857,7 @@ tracker_db_manager_new (TrackerDBManagerFlags   flags,
 
 		TRACKER_NOTE (SQLITE, g_message ("Creating database files for %s...", db_manager->db.abs_filename));
 
-		db_manager->db.iface = tracker_db_manager_create_db_interface (db_manager, FALSE, &internal_error);
+		db_manager->db.iface = tracker_db_manager_create_db_interface (db_manager, 0, &internal_error);
 		if (internal_error) {
 			g_propagate_error (error, internal_error);
 			g_object_unref (db_manager);
@@ -593,7 +868,8 @@ tracker_db_manager_new (TrackerDBManagerFlags   flags,
 	}
 
 	resources_iface = tracker_db_manager_create_db_interface (db_manager,
-	                                                          TRUE, &internal_error);
+	                                                          TRACKER_DB_INTERFACE_READONLY,
+	                                                          &internal_error);
 
 	if (internal_error) {
 		g_propagate_error (error, internal_error);
@@ -618,6 +894,20 @@ tracker_db_manager_finalize (GObject *object)
 	g_free (db_manager->db.abs_filename);
 
 	if (db_manager->db.iface) {
+		if (!readonly &&
+		    (db_manager->flags & TRACKER_DB_MANAGER_IN_MEMORY) == 0) {
+			/* Refresh planner statistics of the tables that
+			 * queries on this connection would benefit from, in
+			 * the main and all attached graph databases. Doing
+			 * this on close avoids invalidating prepared
+			 * statements while the store is in use.
+			 */
+			tracker_db_interface_execute_query (db_manager->db.iface, NULL,
+			                                    "PRAGMA analysis_limit = 1000");
+			tracker_db_interface_execute_query (db_manager->db.iface, NULL,
+			                                    "PRAGMA optimize");
+		}
+
 		if (!readonly)
 			tracker_db_interface_sqlite_wal_checkpoint (db_manager->db.iface, TRUE, NULL);
 		g_object_unref (db_manager->db.iface);
@@ -635,17 +925,17 @@ tracker_db_manager_finalize (GObject *object)
 }
 
 static TrackerDBInterface *
-tracker_db_manager_create_db_interface (TrackerDBManager  *db_manager,
-                                        gboolean           readonly,
-                                        GError           **error)
+tracker_db_manager_create_db_interface (TrackerDBManager         *db_manager,
+                                        TrackerDBInterfaceFlags   flags,
+                                        GError                  **error)
 {
 	TrackerDBInterface *connection;
 	GError *internal_error = NULL;
-	TrackerDBInterfaceFlags flags = 0;
+	gboolean readonly;
 	GObject *user_data;
 
-	if (readonly)
-		flags |= TRACKER_DB_INTERFACE_READONLY;
+	readonly = (flags & TRACKER_DB_INTERFACE_READONLY) != 0;
+
 	if (db_manager->flags & TRACKER_DB_MANAGER_IN_MEMORY)
 		flags |= TRACKER_DB_INTERFACE_IN_MEMORY;
 
@@ -666,10 +956,12 @@ tracker_db_manager_create_db_interface (TrackerDBManager  *db_manager,
 
 	iface_set_params (connection,
 	                  readonly,
+	                  db_manager->temp_store,
 	                  &internal_error);
 	db_set_params (connection, "main",
-	               db_manager->db.cache_size,
+	               tracker_db_manager_get_cache_size (db_manager, readonly),
 	               db_manager->db.page_size,
+	               db_manager->mmap_size,
 	               !(db_manager->flags & TRACKER_DB_MANAGER_IN_MEMORY),
 	               &internal_error);
 
@@ -691,6 +983,31 @@ tracker_db_manager_create_db_interface (TrackerDBManager  *db_manager,
 	return connection;
 }
 
+static TrackerDBInterface *
+pop_shared_db_interface (TrackerDBManager *db_manager,
+                         guint             len)
+{
+	TrackerDBInterface *interface;
+	guint i;
+
+	/* Interfaces claimed by a cursor iterating without locks
+	 * must not be handed to other threads, look for the least
+	 * recently used one that can be shared.
+	 */
+	for (i = 0; i < len; i++) {
+		interface = g_async_queue_try_pop_unlocked (db_manager->interfaces);
+
+		if (!interface)
+			break;
+		if (tracker_db_interface_try_ref_shared_use (interface))
+			return interface;
+
+		g_async_queue_push_unlocked (db_manager->interfaces, interface);
+	}
+
+	return NULL;
+}
+
 /**
  * tracker_db_manager_get_db_interface:
  *
@@ -706,6 +1023,7 @@ tracker_db_manager_get_db_interface (TrackerDBManager  *db_manager,
 {
 	GError *internal_error = NULL;
 	TrackerDBInterface *interface = NULL;
+	gboolean shared = FALSE;
 	guint len, i;
 
 	/* The interfaces never actually leave the async queue,
@@ -732,34 +1050,52 @@ tracker_db_manager_get_db_interface (TrackerDBManager  *db_manager,
 		interface = NULL;
 	}
 
-	/* 2nd. If no more interfaces can be created, pick one */
+	/* 2nd. If no more interfaces can be created, pick one that
+	 * is not exclusively owned by a cursor. The interface that
+	 * fills the pool up is never claimed exclusively, so there
+	 * is always one to share.
+	 */
 	if (!interface && len >= MAX_INTERFACES) {
-		interface = g_async_queue_try_pop_unlocked (db_manager->interfaces);
+		interface = pop_shared_db_interface (db_manager, len);
+		g_assert (interface != NULL);
+		shared = TRUE;
 	}
 
 	if (interface) {
 		g_signal_emit (db_manager, signals[UPDATE_INTERFACE], 0, interface);
 	} else {
-		/* 3rd. Create a new interface to satisfy the request */
+		TrackerDBInterfaceFlags flags = TRACKER_DB_INTERFACE_READONLY;
+
+		/* 3rd. Create a new interface to satisfy the request,
+		 * keeping the last one in the pool shareable.
+		 */
+		if (len + 1 < MAX_INTERFACES)
+			flags |= TRACKER_DB_INTERFACE_POOLED;
+
 		interface = tracker_db_manager_create_db_interface (db_manager,
-		                                                    TRUE, &internal_error);
+		                                                    flags,
+		                                                    &internal_error);
 
 		if (interface) {
 			g_signal_emit (db_manager, signals[SETUP_INTERFACE], 0, interface);
 		} else {
-			if (g_async_queue_length_unlocked (db_manager->interfaces) == 0) {
+			/* Fetch an existing interface back. Oh well */
+			interface = pop_shared_db_interface (db_manager,
+			                                     g_async_queue_length_unlocked (db_manager->interfaces));
+			shared = interface != NULL;
+
+			if (!interface) {
 				g_propagate_prefixed_error (error, internal_error, "Error opening database: ");
 				g_async_queue_unlock (db_manager->interfaces);
 				return NULL;
-			} else {
-				g_error_free (internal_error);
-				/* Fetch the first interface back. Oh well */
-				interface = g_async_queue_try_pop_unlocked (db_manager->interfaces);
 			}
+
+			g_error_free (internal_error);
 		}
 	}
 
-	tracker_db_interface_ref_use (interface);
+	if (!shared)
+		tracker_db_interface_ref_use (interface);
 
 	g_async_queue_push_unlocked (db_manager->interfaces, interface);
 	g_async_queue_unlock (db_manager->interfaces);
@@ -806,7 +1142,9 @@ init_writable_db_interface (TrackerDBManager *db_manager)
 
 	/* Honor anyway the DBManager readonly flag */
 	readonly = (db_manager->flags & TRACKER_DB_MANAGER_READONLY) != 0;
-	iface = tracker_db_manager_create_db_interface (db_manager, readonly, &error);
+	iface = tracker_db_manager_create_db_interface (db_manager,
+	                                                readonly ? TRACKER_DB_INTERFACE_READONLY : 0,
+	                                                &error);
 	if (error) {
 		g_critical ("Error opening readwrite database: %s", error->message);
 		g_error_free (error);
@@ -815,6 +1153,25 @@ init_writable_db_interface (TrackerDBManager *db_manager)
 	return iface;
 }
 
+/**
+ * tracker_db_manager_create_writable_db_interface:
+ *
+ * Creates a new writable connection to the database, meant to
+ * modify attached databases from other threads than the one
+ * owning the writable connection. No databases are attached
+ * to it.
+ *
+ * returns: (transfer full): a new database connection
+ **/
+TrackerDBInterface *
+tracker_db_manager_create_writable_db_interface (TrackerDBManager  *db_manager,
+                                                 GError           **error)
+{
+	g_return_val_if_fail ((db_manager->flags & TRACKER_DB_MANAGER_READONLY) == 0, NULL);
+
+	return tracker_db_manager_create_db_interface (db_manager, 0, error);
+}
+
 TrackerDBInterface *
 tracker_db_manager_get_writable_db_interface (TrackerDBManager *db_manager)
 {
@@ -931,7 +1288,7 @@ ensure_create_database_file (TrackerDBManager  *db_manager,
 	if (!iface)
 		return FALSE;
 
-	tracker_db_interface_execute_query (iface, NULL, "PRAGMA cache_size = %d",
+	tracker_db_interface_execute_query (iface, NULL, "PRAGMA page_size = %d",
 	                                    db_manager->db.page_size);
 	tracker_db_interface_execute_query (iface, NULL, "PRAGMA journal_mode = WAL");
 
@@ -939,6 +1296,25 @@ ensure_create_database_file (TrackerDBManager  *db_manager,
 	return TRUE;
 }
 
+GFile *
+tracker_db_manager_get_database_file (TrackerDBManager *db_manager,
+                                      const gchar      *name)
+{
+	gchar *filename, *escaped;
+	GFile *file;
+
+	if (!db_manager->cache_location)
+		return NULL;
+
+	filename = g_strdup_printf ("%s.db", name);
+	escaped = g_uri_escape_string (filename, NULL, FALSE);
+	file = g_file_get_child (db_manager->cache_location, escaped);
+	g_free (filename);
+	g_free (escaped);
+
+	return file;
+}
+
 gboolean
 tracker_db_manager_attach_database (TrackerDBManager    *db_manager,
                                     TrackerDBInterface  *iface,
@@ -946,21 +1322,14 @@ tracker_db_manager_attach_database (TrackerDBManager    *db_manager,
                                     gboolean             create,
                                     GError             **error)
 {
-	gchar *filename, *escaped;
-	GFile *file = NULL;
-
-	if (db_manager->cache_location) {
-		filename = g_strdup_printf ("%s.db", name);
-		escaped = g_uri_escape_string (filename, NULL, FALSE);
-		file = g_file_get_child (db_manager->cache_location, escaped);
-		g_free (filename);
-		g_free (escaped);
-
-		if (create) {
-			if (!ensure_create_database_file (db_manager, file, error)) {
-				g_object_unref (file);
-				return FALSE;
-			}
+	GFile *file;
+
+	file = tracker_db_manager_get_database_file (db_manager, name);
+
+	if (file && create) {
+		if (!ensure_create_database_file (db_manager, file, error)) {
+			g_object_unref (file);
+			return FALSE;
 		}
 	}
 
@@ -971,8 +1340,10 @@ tracker_db_manager_attach_database (TrackerDBManager    *db_manager,
 
 	g_clear_object (&file);
 	db_set_params (iface, name,
-	               db_manager->db.cache_size,
+	               tracker_db_manager_get_cache_size (db_manager,
+	                                                  iface != db_manager->db.iface),
 	               db_manager->db.page_size,
+	               db_manager->mmap_size,
 	               !(db_manager->flags & TRACKER_DB_MANAGER_IN_MEMORY),
 	               error);
 	return TRUE;
@@ -987,6 +1358,209 @@ tracker_db_manager_detach_database (TrackerDBManager    *db_manager,
 	return tracker_db_interface_detach_database (iface, name, error);
 }
 
+static GFile *
+get_sibling_file (GFile       *file,
+                  const gchar *suffix)
+{
+	GFile *sibling;
+	gchar *path;
+
+	path = g_strconcat (g_file_peek_path (file), suffix, NULL);
+	sibling = g_file_new_for_path (path);
+	g_free (path);
+
+	return sibling;
+}
+
+static void
+delete_sibling_file (GFile       *file,
+                     const gchar *suffix)
+{
+	GFile *sibling;
+
+	sibling = get_sibling_file (file, suffix);
+	g_file_delete (sibling, NULL, NULL);
+	g_object_unref (sibling);
+}
+
+/* Ontology changes are applied to a copy of each graph database,
+ * which replaces the original once the changes are committed.
+ */
+gboolean
+tracker_db_manager_supports_shadow_databases (TrackerDBManager *db_manager)
+{
+	if ((db_manager->flags & TRACKER_DB_MANAGER_IN_MEMORY) != 0)
+		return FALSE;
+
+	return tracker_db_interface_sqlite_can_copy_database ();
+}
+
+GFile *
+tracker_db_manager_get_shadow_database_file (TrackerDBManager *db_manager,
+                                             const gchar      *name)
+{
+	GFile *file, *shadow;
+
+	file = tracker_db_manager_get_database_file (db_manager, name);
+	if (!file)
+		return NULL;
+
+	shadow = get_sibling_file (file, SHADOW_DATABASE_SUFFIX);
+	g_object_unref (file);
+
+	return shadow;
+}
+
+gboolean
+tracker_db_manager_create_shadow_database (TrackerDBManager    *db_manager,
+                                           TrackerDBInterface  *iface,
+                                           const gchar         *name,
+                                           GError             **error)
+{
+	GFile *shadow;
+	gboolean retval;
+
+	/* Leftovers of an interrupted migration are never reused */
+	tracker_db_manager_delete_shadow_database (db_manager, name);
+
+	shadow = tracker_db_manager_get_shadow_database_file (db_manager, name);
+	retval = tracker_db_interface_sqlite_copy_database (iface, name, shadow, error);
+	g_object_unref (shadow);
+
+	return retval;
+}
+
+gboolean
+tracker_db_manager_attach_shadow_database (TrackerDBManager    *db_manager,
+                                           TrackerDBInterface  *iface,
+                                           const gchar         *name,
+                                           GError             **error)
+{
+	GError *inner_error = NULL;
+	GFile *shadow;
+
+	shadow = tracker_db_manager_get_shadow_database_file (db_manager, name);
+
+	if (!tracker_db_interface_attach_database (iface, shadow, name, error)) {
+		g_object_unref (shadow);
+		return FALSE;
+	}
+
+	g_object_unref (shadow);
+
+	/* Keep the copy self-contained until it replaces the original,
+	 * WAL mode is enabled again when it is attached as the graph.
+	 */
+	tracker_db_interface_execute_query (iface, &inner_error,
+	                                    "PRAGMA \"%s\".journal_mode = DELETE",
+	                                    name);
+	if (inner_error) {
+		tracker_db_interface_detach_database (iface, name, NULL);
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+gboolean
+tracker_db_manager_swap_shadow_database (TrackerDBManager  *db_manager,
+                                         const gchar       *name,
+                                         GError           **error)
+{
+	GFile *file, *shadow;
+	gboolean retval = TRUE;
+
+	file = tracker_db_manager_get_database_file (db_manager, name);
+	shadow = get_sibling_file (file, SHADOW_DATABASE_SUFFIX);
+
+	/* A missing copy means the database was already replaced */
+	if (g_file_query_exists (shadow, NULL)) {
+		/* The copy includes all committed data, drop the WAL of
+		 * the original so it's not replayed over the new file.
+		 */
+		delete_sibling_file (file, "-wal");
+		delete_sibling_file (file, "-shm");
+
+		retval = g_file_move (shadow, file, G_FILE_COPY_OVERWRITE,
+		                      NULL, NULL, NULL, error);
+	}
+
+	g_object_unref (shadow);
+	g_object_unref (file);
+
+	return retval;
+}
+
+void
+tracker_db_manager_delete_shadow_database (TrackerDBManager *db_manager,
+                                           const gchar      *name)
+{
+	GFile *shadow;
+
+	shadow = tracker_db_manager_get_shadow_database_file (db_manager, name);
+	if (!shadow)
+		return;
+
+	delete_sibling_file (shadow, "-journal");
+	g_file_delete (shadow, NULL, NULL);
+	g_object_unref (shadow);
+}
+
+gboolean
+tracker_db_manager_get_shadow_databases_pending (TrackerDBManager *db_manager)
+{
+	GValue value = G_VALUE_INIT;
+	gboolean pending;
+
+	if (!tracker_db_manager_get_metadata (db_manager, "shadow-databases", &value))
+		return FALSE;
+
+	pending = g_strcmp0 (g_value_get_string (&value), "pending") == 0;
+	g_value_unset (&value);
+
+	return pending;
+}
+
+void
+tracker_db_manager_set_shadow_databases_pending (TrackerDBManager *db_manager,
+                                                 gboolean          pending)
+{
+	GValue value = G_VALUE_INIT;
+
+	g_value_init (&value, G_TYPE_STRING);
+	g_value_set_string (&value, pending ? "pending" : "");
+	tracker_db_manager_set_metadata (db_manager, "shadow-databases", &value);
+	g_value_unset (&value);
+}
+
+gboolean
+tracker_db_manager_get_table_stats_outdated (TrackerDBManager *db_manager)
+{
+	GValue value = G_VALUE_INIT;
+	gboolean outdated;
+
+	if (!tracker_db_manager_get_metadata (db_manager, "table-stats", &value))
+		return FALSE;
+
+	outdated = g_strcmp0 (g_value_get_string (&value), "outdated") == 0;
+	g_value_unset (&value);
+
+	return outdated;
+}
+
+void
+tracker_db_manager_set_table_stats_outdated (TrackerDBManager *db_manager,
+                                             gboolean          outdated)
+{
+	GValue value = G_VALUE_INIT;
+
+	g_value_init (&value, G_TYPE_STRING);
+	g_value_set_string (&value, outdated ? "outdated" : "");
+	tracker_db_manager_set_metadata (db_manager, "table-stats", &value);
+	g_value_unset (&value);
+}
+
 void
 tracker_db_manager_release_memory (TrackerDBManager *db_manager)
 {
@@ -44,8 +44,15 @@ typedef enum {
 	TRACKER_DB_MANAGER_IN_MEMORY             = 1 << 7,
 	TRACKER_DB_MANAGER_SKIP_VERSION_CHECK    = 1 << 8,
 	TRACKER_DB_MANAGER_ANONYMOUS_BNODES      = 1 << 9,
+	TRACKER_DB_MANAGER_COMPRESS_URIS         = 1 << 10,
 } TrackerDBManagerFlags;
 
+typedef enum {
+	TRACKER_DB_TEMP_STORE_DEFAULT,
+	TRACKER_DB_TEMP_STORE_FILE,
+	TRACKER_DB_TEMP_STORE_MEMORY,
+} TrackerDBTempStore;
+
 typedef enum {
 	TRACKER_DB_VERSION_UNKNOWN = 0,
 	/* Starts at 25 because we forgot to clean up */
@@ -53,10 +60,13 @@ typedef enum {
 	TRACKER_DB_VERSION_3_3,      /* Blank nodes */
 	TRACKER_DB_VERSION_3_4,      /* Fixed FTS view */
 	TRACKER_DB_VERSION_3_6,      /* BM25 for FTS ranking */
+	TRACKER_DB_VERSION_3_8,      /* Packed datetimes */
+	TRACKER_DB_VERSION_3_9,      /* Prefix-compressed resource URIs */
+	TRACKER_DB_VERSION_3_10,     /* Table row statistics */
 } TrackerDBVersion;
 
 /* Set current database version we are working with */
-#define TRACKER_DB_VERSION_NOW        TRACKER_DB_VERSION_3_6
+#define TRACKER_DB_VERSION_NOW        TRACKER_DB_VERSION_3_10
 
 void                tracker_db_manager_rollback_db_creation   (TrackerDBManager *db_manager);
 
@@ -65,11 +75,14 @@ gboolean            tracker_db_manager_db_exists              (GFile *cache_loca
 TrackerDBManager   *tracker_db_manager_new                    (TrackerDBManagerFlags   flags,
                                                                GFile                  *cache_location,
                                                                guint                   select_cache_size,
+                                                               GVariant               *options,
                                                                GObject                *iface_data,
                                                                GError                **error);
 TrackerDBInterface *tracker_db_manager_get_db_interface       (TrackerDBManager      *db_manager,
                                                                GError               **error);
 TrackerDBInterface *tracker_db_manager_get_writable_db_interface (TrackerDBManager   *db_manager);
+TrackerDBInterface *tracker_db_manager_create_writable_db_interface (TrackerDBManager  *db_manager,
+                                                                   GError           **error);
 
 gboolean            tracker_db_manager_has_enough_space       (TrackerDBManager      *db_manager);
 
@@ -78,6 +91,8 @@ gboolean            tracker_db_manager_is_first_time          (TrackerDBManager
 TrackerDBManagerFlags
                     tracker_db_manager_get_flags              (TrackerDBManager      *db_manager);
 
+gint                tracker_db_manager_get_update_cache_size  (TrackerDBManager      *db_manager);
+
 gboolean            tracker_db_manager_locale_changed         (TrackerDBManager      *db_manager,
                                                                GError               **error);
 void                tracker_db_manager_set_current_locale     (TrackerDBManager      *db_manager);
@@ -87,6 +102,8 @@ void                tracker_db_manager_tokenizer_update       (TrackerDBManager
 
 void                tracker_db_manager_check_perform_vacuum   (TrackerDBManager      *db_manager);
 
+GFile              *tracker_db_manager_get_database_file      (TrackerDBManager      *db_manager,
+                                                               const gchar           *name);
 gboolean            tracker_db_manager_attach_database        (TrackerDBManager      *db_manager,
                                                                TrackerDBInterface    *iface,
                                                                const gchar           *name,
@@ -96,6 +113,30 @@ gboolean            tracker_db_manager_detach_database        (TrackerDBManager
                                                                TrackerDBInterface    *iface,
                                                                const gchar           *name,
                                                                GError               **error);
+
+gboolean            tracker_db_manager_supports_shadow_databases (TrackerDBManager   *db_manager);
+GFile              *tracker_db_manager_get_shadow_database_file  (TrackerDBManager   *db_manager,
+                                                                  const gchar        *name);
+gboolean            tracker_db_manager_create_shadow_database    (TrackerDBManager   *db_manager,
+                                                                  TrackerDBInterface *iface,
+                                                                  const gchar        *name,
+                                                                  GError            **error);
+gboolean            tracker_db_manager_attach_shadow_database    (TrackerDBManager   *db_manager,
+                                                                  TrackerDBInterface *iface,
+                                                                  const gchar        *name,
+                                                                  GError            **error);
+gboolean            tracker_db_manager_swap_shadow_database      (TrackerDBManager   *db_manager,
+                                                                  const gchar        *name,
+                                                                  GError            **error);
+void                tracker_db_manager_delete_shadow_database    (TrackerDBManager   *db_manager,
+                                                                  const gchar        *name);
+gboolean            tracker_db_manager_get_shadow_databases_pending (TrackerDBManager *db_manager);
+void                tracker_db_manager_set_shadow_databases_pending (TrackerDBManager *db_manager,
+                                                                     gboolean          pending);
+gboolean            tracker_db_manager_get_table_stats_outdated (TrackerDBManager *db_manager);
+void                tracker_db_manager_set_table_stats_outdated (TrackerDBManager *db_manager,
+                                                                 gboolean          outdated);
+
 void                tracker_db_manager_release_memory         (TrackerDBManager      *db_manager);
 
 TrackerDBVersion    tracker_db_manager_get_version            (TrackerDBManager      *db_manager);
@@ -33,12 +33,29 @@
 
 #include "tracker-fts-tokenizer.h"
 
-typedef struct TrackerTokenizerData TrackerTokenizerData;
 typedef struct TrackerTokenizer TrackerTokenizer;
 typedef struct TrackerTokenizerFunctionData TrackerTokenizerFunctionData;
+typedef struct TrackerTokenizerDocument TrackerTokenizerDocument;
+typedef struct TrackerTokenizerToken TrackerTokenizerToken;
+typedef struct TrackerTokenizerReplay TrackerTokenizerReplay;
+typedef struct TrackerTokenizerOffsets TrackerTokenizerOffsets;
 
 struct TrackerTokenizerData {
 	TrackerDBManagerFlags flags;
+	/* Documents tokenized ahead of time, owned by the writer thread */
+	GHashTable *documents;
+	GPtrArray *pending;
+	gsize documents_size;
+	/* Worker threads, kept for the lifetime of the connection */
+	GThreadPool *pool;
+	GMutex mutex;
+	GCond cond;
+	guint n_running;
+	/* Documents recently tokenized for auxiliary functions,
+	 * owned by the thread using the connection */
+	GHashTable *aux_documents;
+	GQueue aux_queue;
+	gsize aux_size;
 };
 
 struct TrackerTokenizer {
@@ -49,12 +66,59 @@ struct TrackerTokenizer {
 struct TrackerTokenizerFunctionData {
 	TrackerDBInterface *interface;
 	TrackerDataManager *data_manager;
+	TrackerTokenizerData *tokenizer_data;
+	TrackerParser *parser;
 	gchar **property_names;
 };
 
+struct TrackerTokenizerToken {
+	gint offset;
+	gint length;
+	gint start;
+	gint end;
+};
+
+struct TrackerTokenizerDocument {
+	gchar *text;
+	gint length;
+	GString *words;
+	GArray *tokens;
+	GList link;
+};
+
+struct TrackerTokenizerOffsets {
+	GArray *offsets;
+	guint n_offsets;
+};
+
 #define MAX_WORD_LENGTH 200
 #define MAX_WORDS 10000
 
+/* Documents tokenized for auxiliary functions (offsets, snippets) are
+ * kept around, as those functions tokenize the same text repeatedly.
+ * Token offsets are not stored in the database, this only avoids
+ * tokenizing a column again for the same row (e.g. fts:snippet and
+ * fts:offsets both used in a query), or text repeated across rows.
+ */
+#define AUX_DOCUMENT_MIN_LENGTH 512
+#define AUX_CACHE_MAX_DOCUMENTS 8
+#define AUX_CACHE_MAX_SIZE (4 * 1024 * 1024)
+
+/* Auxiliary functions tokenize whole columns to locate the hits,
+ * only the leading part of large columns is tokenized for those.
+ * Hits past this point are not reported by fts:offsets, nor
+ * highlighted by fts:snippet.
+ */
+#define AUX_TEXT_MAX_LENGTH (256 * 1024)
+
+/* Text tokenized ahead of time before the tokens are consumed, the
+ * resulting words and offsets take a few times as much memory.
+ */
+#define DOCUMENTS_MAX_SIZE (8 * 1024 * 1024)
+
+/* Parsers used by the threads tokenizing documents ahead of time */
+static GPrivate thread_parser = G_PRIVATE_INIT ((GDestroyNotify) tracker_parser_free);
+
 static int
 tracker_tokenizer_create (void           *data,
                           const char    **argv,
@@ -89,30 +153,25 @@ typedef int (*TokenFunc) (void       *pCtx,    /* Copy of 2nd argument to xToken
                           int         end);    /* Byte offset of end of token within input text */
 
 static int
-tracker_tokenizer_tokenize (Fts5Tokenizer *fts5_tokenizer,
-                            void          *ctx,
-                            int            flags, /* Mask of FTS5_TOKENIZE_* flags */
-                            const char    *text,
-                            int            length,
-                            TokenFunc      token_func)
+tracker_tokenizer_parse (TrackerTokenizerData *data,
+                         TrackerParser        *parser,
+                         void                 *ctx,
+                         const char           *text,
+                         int                   length,
+                         TokenFunc             token_func)
 {
-	TrackerTokenizer *tokenizer = (TrackerTokenizer *) fts5_tokenizer;
-	TrackerTokenizerData *data = tokenizer->data;
 	const gchar *token;
 	int n_tokens = 0, pos, start, end, len;
 	int rc = SQLITE_OK;
 
-	if (length <= 0)
-		return rc;
-
-	tracker_parser_reset (tokenizer->parser, text, length,
+	tracker_parser_reset (parser, text, length,
 			      MAX_WORD_LENGTH,
 			      !!(data->flags & TRACKER_DB_MANAGER_FTS_ENABLE_STEMMER),
 			      !!(data->flags & TRACKER_DB_MANAGER_FTS_ENABLE_UNACCENT),
 			      !!(data->flags & TRACKER_DB_MANAGER_FTS_IGNORE_NUMBERS));
 
 	while (n_tokens < MAX_WORDS) {
-		token = tracker_parser_next (tokenizer->parser,
+		token = tracker_parser_next (parser,
 		                             &pos,
 		                             &start, &end,
 		                             &len);
@@ -131,6 +190,265 @@ tracker_tokenizer_tokenize (Fts5Tokenizer *fts5_tokenizer,
 	return rc;
 }
 
+static guint
+tracker_tokenizer_document_hash (gconstpointer key)
+{
+	const TrackerTokenizerDocument *document = key;
+	guint32 h = 5381;
+	gint i;
+
+	for (i = 0; i < document->length; i++)
+		h = (h << 5) + h + (guchar) document->text[i];
+
+	return h;
+}
+
+static gboolean
+tracker_tokenizer_document_equal (gconstpointer key1,
+                                  gconstpointer key2)
+{
+	const TrackerTokenizerDocument *document1 = key1, *document2 = key2;
+
+	return (document1->length == document2->length &&
+	        memcmp (document1->text, document2->text, document1->length) == 0);
+}
+
+static void
+tracker_tokenizer_document_free (TrackerTokenizerDocument *document)
+{
+	g_free (document->text);
+
+	if (document->words)
+		g_string_free (document->words, TRUE);
+	if (document->tokens)
+		g_array_unref (document->tokens);
+
+	g_free (document);
+}
+
+static int
+document_tokenizer_func (void       *data,
+                         int         flags,
+                         const char *token,
+                         int         n_token,
+                         int         start,
+                         int         end)
+{
+	TrackerTokenizerDocument *document = data;
+	TrackerTokenizerToken t;
+
+	t.offset = document->words->len;
+	t.length = n_token;
+	t.start = start;
+	t.end = end;
+
+	g_string_append_len (document->words, token, n_token);
+	g_array_append_val (document->tokens, t);
+
+	return SQLITE_OK;
+}
+
+struct TrackerTokenizerReplay {
+	TrackerTokenizerDocument *document;
+	void *ctx;
+	TokenFunc token_func;
+};
+
+static int
+tracker_tokenizer_document_replay (TrackerTokenizerDocument *document,
+                                   void                     *ctx,
+                                   TokenFunc                 token_func)
+{
+	int rc = SQLITE_OK;
+	guint i;
+
+	for (i = 0; i < document->tokens->len; i++) {
+		TrackerTokenizerToken *token;
+
+		token = &g_array_index (document->tokens, TrackerTokenizerToken, i);
+		rc = token_func (ctx, 0,
+		                 &document->words->str[token->offset],
+		                 token->length,
+		                 token->start, token->end);
+
+		if (rc != SQLITE_OK)
+			break;
+	}
+
+	return rc;
+}
+
+static gsize
+tracker_tokenizer_document_get_size (TrackerTokenizerDocument *document)
+{
+	return document->length + document->words->len +
+		document->tokens->len * sizeof (TrackerTokenizerToken);
+}
+
+static int
+aux_tokenizer_func (void       *data,
+                    int         flags,
+                    const char *token,
+                    int         n_token,
+                    int         start,
+                    int         end)
+{
+	TrackerTokenizerReplay *replay = data;
+
+	document_tokenizer_func (replay->document, flags, token, n_token, start, end);
+
+	return replay->token_func (replay->ctx, flags, token, n_token, start, end);
+}
+
+static int
+tracker_tokenizer_tokenize_aux (TrackerTokenizer *tokenizer,
+                                void             *ctx,
+                                const char       *text,
+                                int               length,
+                                TokenFunc         token_func)
+{
+	TrackerTokenizerData *data = tokenizer->data;
+	TrackerTokenizerDocument key = { (gchar *) text, length, }, *document;
+	TrackerTokenizerReplay replay;
+	int rc;
+
+	document = g_hash_table_lookup (data->aux_documents, &key);
+
+	if (document) {
+		/* Move to the most recently used end */
+		g_queue_unlink (&data->aux_queue, &document->link);
+		g_queue_push_tail_link (&data->aux_queue, &document->link);
+
+		return tracker_tokenizer_document_replay (document, ctx, token_func);
+	}
+
+	document = g_new0 (TrackerTokenizerDocument, 1);
+	document->text = g_strndup (text, length);
+	document->length = length;
+	document->words = g_string_sized_new (length);
+	document->tokens = g_array_new (FALSE, FALSE, sizeof (TrackerTokenizerToken));
+	document->link.data = document;
+
+	replay.document = document;
+	replay.ctx = ctx;
+	replay.token_func = token_func;
+
+	rc = tracker_tokenizer_parse (data, tokenizer->parser,
+	                              &replay, text, length,
+	                              aux_tokenizer_func);
+
+	/* Only cache complete documents */
+	if (rc != SQLITE_OK) {
+		tracker_tokenizer_document_free (document);
+		return rc;
+	}
+
+	g_hash_table_add (data->aux_documents, document);
+	g_queue_push_tail_link (&data->aux_queue, &document->link);
+	data->aux_size += tracker_tokenizer_document_get_size (document);
+
+	while (data->aux_queue.length > AUX_CACHE_MAX_DOCUMENTS ||
+	       (data->aux_size > AUX_CACHE_MAX_SIZE &&
+	        data->aux_queue.length > 1)) {
+		TrackerTokenizerDocument *oldest;
+
+		oldest = data->aux_queue.head->data;
+		g_queue_unlink (&data->aux_queue, &oldest->link);
+		data->aux_size -= tracker_tokenizer_document_get_size (oldest);
+		g_hash_table_remove (data->aux_documents, oldest);
+	}
+
+	return rc;
+}
+
+static int
+aux_text_length (const char *text,
+                 int         length)
+{
+	const gchar *end;
+
+	if (length <= AUX_TEXT_MAX_LENGTH)
+		return length;
+
+	/* Do not split UTF-8 characters */
+	end = g_utf8_find_prev_char (text, &text[AUX_TEXT_MAX_LENGTH + 1]);
+
+	return end ? end - text : AUX_TEXT_MAX_LENGTH;
+}
+
+/* Tokenizes text for a consumer that may stop early, reusing the
+ * tokens of a cached document if there is one, but not adding any
+ * to the cache since the text might only be partially tokenized.
+ */
+static int
+tracker_tokenizer_tokenize_partial (TrackerTokenizerData *data,
+                                    TrackerParser        *parser,
+                                    void                 *ctx,
+                                    const char           *text,
+                                    int                   length,
+                                    TokenFunc             token_func)
+{
+	if (length <= 0)
+		return SQLITE_OK;
+
+	length = aux_text_length (text, length);
+
+	if (length >= AUX_DOCUMENT_MIN_LENGTH) {
+		TrackerTokenizerDocument key = { (gchar *) text, length, }, *document;
+
+		document = g_hash_table_lookup (data->aux_documents, &key);
+
+		if (document) {
+			g_queue_unlink (&data->aux_queue, &document->link);
+			g_queue_push_tail_link (&data->aux_queue, &document->link);
+
+			return tracker_tokenizer_document_replay (document, ctx, token_func);
+		}
+	}
+
+	return tracker_tokenizer_parse (data, parser, ctx, text, length, token_func);
+}
+
+static int
+tracker_tokenizer_tokenize (Fts5Tokenizer *fts5_tokenizer,
+                            void          *ctx,
+                            int            flags, /* Mask of FTS5_TOKENIZE_* flags */
+                            const char    *text,
+                            int            length,
+                            TokenFunc      token_func)
+{
+	TrackerTokenizer *tokenizer = (TrackerTokenizer *) fts5_tokenizer;
+	TrackerTokenizerData *data = tokenizer->data;
+	int rc = SQLITE_OK;
+
+	if (length <= 0)
+		return rc;
+
+	if ((flags & FTS5_TOKENIZE_DOCUMENT) != 0 &&
+	    g_hash_table_size (data->documents) > 0) {
+		TrackerTokenizerDocument key = { (gchar *) text, length, }, *document;
+
+		document = g_hash_table_lookup (data->documents, &key);
+
+		/* Replay the tokens parsed by a worker thread */
+		if (document)
+			return tracker_tokenizer_document_replay (document, ctx, token_func);
+	}
+
+	if ((flags & FTS5_TOKENIZE_AUX) != 0) {
+		length = aux_text_length (text, length);
+
+		if (length >= AUX_DOCUMENT_MIN_LENGTH) {
+			return tracker_tokenizer_tokenize_aux (tokenizer, ctx,
+			                                       text, length,
+			                                       token_func);
+		}
+	}
+
+	return tracker_tokenizer_parse (data, tokenizer->parser,
+	                                ctx, text, length, token_func);
+}
+
 /* Our custom tokenizer: */
 static const fts5_tokenizer tracker_tokenizer_module = {
 	tracker_tokenizer_create,   /* xCreate   */
@@ -138,6 +456,43 @@ static const fts5_tokenizer tracker_tokenizer_module = {
 	tracker_tokenizer_tokenize, /* xTokenize */
 };
 
+static void
+tokenize_document_thread_func (gpointer data,
+                               gpointer user_data)
+{
+	TrackerTokenizerDocument *document = data;
+	TrackerParser *parser;
+
+	parser = g_private_get (&thread_parser);
+
+	if (!parser) {
+		parser = tracker_parser_new ();
+		g_private_set (&thread_parser, parser);
+	}
+
+	document->words = g_string_sized_new (document->length);
+	document->tokens = g_array_new (FALSE, FALSE, sizeof (TrackerTokenizerToken));
+
+	tracker_tokenizer_parse (user_data, parser, document,
+	                         document->text, document->length,
+	                         document_tokenizer_func);
+}
+
+static void
+tokenize_document_pool_func (gpointer data,
+                             gpointer user_data)
+{
+	TrackerTokenizerData *tokenizer_data = user_data;
+
+	tokenize_document_thread_func (data, user_data);
+
+	g_mutex_lock (&tokenizer_data->mutex);
+	tokenizer_data->n_running--;
+	if (tokenizer_data->n_running == 0)
+		g_cond_signal (&tokenizer_data->cond);
+	g_mutex_unlock (&tokenizer_data->mutex);
+}
+
 static TrackerTokenizerData *
 tracker_tokenizer_data_new (TrackerDBManagerFlags flags)
 {
@@ -145,6 +500,18 @@ tracker_tokenizer_data_new (TrackerDBManagerFlags flags)
 
 	p = g_new0 (TrackerTokenizerData, 1);
 	p->flags = flags;
+	p->documents = g_hash_table_new_full (tracker_tokenizer_document_hash,
+	                                      tracker_tokenizer_document_equal,
+	                                      (GDestroyNotify) tracker_tokenizer_document_free,
+	                                      NULL);
+	p->pending = g_ptr_array_new ();
+	p->aux_documents = g_hash_table_new_full (tracker_tokenizer_document_hash,
+	                                          tracker_tokenizer_document_equal,
+	                                          (GDestroyNotify) tracker_tokenizer_document_free,
+	                                          NULL);
+	g_queue_init (&p->aux_queue);
+	g_mutex_init (&p->mutex);
+	g_cond_init (&p->cond);
 
 	return p;
 }
@@ -154,9 +521,82 @@ tracker_tokenizer_data_free (gpointer user_data)
 {
 	TrackerTokenizerData *data = user_data;
 
+	tracker_tokenizer_clear_documents (data);
+
+	if (data->pool)
+		g_thread_pool_free (data->pool, FALSE, TRUE);
+
+	g_mutex_clear (&data->mutex);
+	g_cond_clear (&data->cond);
+	g_hash_table_unref (data->documents);
+	g_ptr_array_unref (data->pending);
+	g_hash_table_unref (data->aux_documents);
 	g_free (data);
 }
 
+void
+tracker_tokenizer_add_document (TrackerTokenizerData *data,
+                                const gchar          *text,
+                                gint                  length)
+{
+	TrackerTokenizerDocument key = { (gchar *) text, length, }, *document;
+
+	if (length <= 0 || g_hash_table_contains (data->documents, &key))
+		return;
+
+	document = g_new0 (TrackerTokenizerDocument, 1);
+	document->text = g_strndup (text, length);
+	document->length = length;
+	g_hash_table_add (data->documents, document);
+	g_ptr_array_add (data->pending, document);
+	data->documents_size += length;
+}
+
+gboolean
+tracker_tokenizer_documents_full (TrackerTokenizerData *data)
+{
+	return data->documents_size >= DOCUMENTS_MAX_SIZE;
+}
+
+void
+tracker_tokenizer_tokenize_documents (TrackerTokenizerData *data)
+{
+	guint i;
+
+	if (data->pending->len > 1 && g_get_num_processors () > 1) {
+		if (!data->pool) {
+			data->pool = g_thread_pool_new (tokenize_document_pool_func, data,
+			                                g_get_num_processors (),
+			                                FALSE, NULL);
+		}
+
+		g_mutex_lock (&data->mutex);
+		data->n_running = data->pending->len;
+		g_mutex_unlock (&data->mutex);
+
+		for (i = 0; i < data->pending->len; i++)
+			g_thread_pool_push (data->pool, g_ptr_array_index (data->pending, i), NULL);
+
+		g_mutex_lock (&data->mutex);
+		while (data->n_running > 0)
+			g_cond_wait (&data->cond, &data->mutex);
+		g_mutex_unlock (&data->mutex);
+	} else {
+		for (i = 0; i < data->pending->len; i++)
+			tokenize_document_thread_func (g_ptr_array_index (data->pending, i), data);
+	}
+
+	g_ptr_array_set_size (data->pending, 0);
+}
+
+void
+tracker_tokenizer_clear_documents (TrackerTokenizerData *data)
+{
+	g_ptr_array_set_size (data->pending, 0);
+	g_hash_table_remove_all (data->documents);
+	data->documents_size = 0;
+}
+
 static int
 offsets_tokenizer_func (void       *data,
                         int         flags,
@@ -165,8 +605,14 @@ offsets_tokenizer_func (void       *data,
                         int         start,
                         int         end)
 {
-	GArray *offsets = data;
-	g_array_append_val (offsets, start);
+	TrackerTokenizerOffsets *offsets = data;
+
+	g_array_append_val (offsets->offsets, start);
+
+	/* Stop once the last matched token is reached */
+	if (offsets->offsets->len >= offsets->n_offsets)
+		return SQLITE_DONE;
+
 	return SQLITE_OK;
 }
 
@@ -211,7 +657,7 @@ tracker_offsets_function (const Fts5ExtensionApi  *api,
 	TrackerTokenizerFunctionData *data;
 	GString *str;
 	int rc, n_hits, i;
-	GArray *offsets = NULL;
+	TrackerTokenizerOffsets offsets = { NULL, 0 };
 	gint cur_col = -1;
 	gboolean first = TRUE;
 
@@ -245,38 +691,69 @@ tracker_offsets_function (const Fts5ExtensionApi  *api,
 
 		if (first || cur_col != col) {
 			const char *text;
-			int length;
+			int length, j;
 
-			if (offsets)
-				g_array_free (offsets, TRUE);
+			if (offsets.offsets)
+				g_array_free (offsets.offsets, TRUE);
+
+			offsets.offsets = g_array_new (FALSE, FALSE, sizeof (gint));
+
+			/* Hits are sorted by column and position, only tokenize
+			 * the text up to the last one in this column.
+			 */
+			offsets.n_offsets = n_token + 1;
+
+			for (j = i + 1; j < n_hits; j++) {
+				int next_phrase, next_col, next_token;
+
+				rc = api->xInst (fts_ctx, j, &next_phrase, &next_col, &next_token);
+				if (rc != SQLITE_OK || next_col != col)
+					break;
+
+				offsets.n_offsets = MAX (offsets.n_offsets, (guint) next_token + 1);
+			}
 
-			offsets = g_array_new (FALSE, FALSE, sizeof (gint));
-			rc = api->xColumnText (fts_ctx, col, &text, &length);
 			if (rc != SQLITE_OK)
 				break;
 
-			rc = api->xTokenize (fts_ctx, text, length,
-					     offsets, &offsets_tokenizer_func);
+			rc = api->xColumnText (fts_ctx, col, &text, &length);
 			if (rc != SQLITE_OK)
 				break;
 
+			if (!data->parser)
+				data->parser = tracker_parser_new ();
+
+			/* Tokenizing stops at the last hit, so go around the
+			 * auxiliary document cache, which only takes whole
+			 * documents.
+			 */
+			rc = tracker_tokenizer_tokenize_partial (data->tokenizer_data,
+			                                         data->parser,
+			                                         &offsets,
+			                                         text, length,
+			                                         &offsets_tokenizer_func);
+			if (rc == SQLITE_DONE)
+				rc = SQLITE_OK;
+			else if (rc != SQLITE_OK)
+				break;
+
 			cur_col = col;
 		}
 
 		first = FALSE;
 
-		if (offsets->len != 0) {
+		if ((guint) n_token < offsets.offsets->len) {
 			if (str->len != 0)
 				g_string_append_c (str, ',');
 
 			g_string_append_printf (str, "%s,%d",
 						data->property_names[col],
-						g_array_index (offsets, gint, n_token));
+						g_array_index (offsets.offsets, gint, n_token));
 		}
 	}
 
-	if (offsets)
-		g_array_free (offsets, TRUE);
+	if (offsets.offsets)
+		g_array_free (offsets.offsets, TRUE);
 
 	if (rc == SQLITE_OK) {
 		gsize len = str->len;
@@ -334,14 +811,16 @@ error:
 }
 
 static TrackerTokenizerFunctionData *
-tracker_tokenizer_function_data_new (TrackerDBInterface *interface,
-                                     TrackerDataManager *data_manager)
+tracker_tokenizer_function_data_new (TrackerDBInterface   *interface,
+                                     TrackerDataManager   *data_manager,
+                                     TrackerTokenizerData *tokenizer_data)
 {
 	TrackerTokenizerFunctionData *data;
 
 	data = g_new0 (TrackerTokenizerFunctionData, 1);
 	data->interface = interface;
 	data->data_manager = data_manager;
+	data->tokenizer_data = tokenizer_data;
 
 	return data;
 }
@@ -349,11 +828,12 @@ tracker_tokenizer_function_data_new (TrackerDBInterface *interface,
 static void
 tracker_tokenizer_function_data_free (TrackerTokenizerFunctionData *data)
 {
+	g_clear_pointer (&data->parser, tracker_parser_free);
 	g_strfreev (data->property_names);
 	g_free (data);
 }
 
-gboolean
+TrackerTokenizerData *
 tracker_tokenizer_initialize (sqlite3                *db,
                               TrackerDBInterface     *interface,
                               TrackerDBManagerFlags   flags,
@@ -368,7 +848,7 @@ tracker_tokenizer_initialize (sqlite3                *db,
 	api = get_fts5_api (db, error);
 
 	if (!api)
-		return FALSE;
+		return NULL;
 
 	data = tracker_tokenizer_data_new (flags);
 	tokenizer = (fts5_tokenizer *) &tracker_tokenizer_module;
@@ -376,10 +856,10 @@ tracker_tokenizer_initialize (sqlite3                *db,
 	                       tracker_tokenizer_data_free);
 
 	/* Offsets */
-	func_data = tracker_tokenizer_function_data_new (interface, data_manager);
+	func_data = tracker_tokenizer_function_data_new (interface, data_manager, data);
 	api->xCreateFunction (api, "tracker_offsets", func_data,
 	                      &tracker_offsets_function,
 	                      (GDestroyNotify) tracker_tokenizer_function_data_free);
 
-	return TRUE;
+	return data;
 }
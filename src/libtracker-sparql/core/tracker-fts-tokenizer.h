@@ -27,10 +27,19 @@
 #ifndef __TRACKER_FTS_TOKENIZER_H__
 #define __TRACKER_FTS_TOKENIZER_H__
 
-gboolean tracker_tokenizer_initialize (sqlite3                *db,
-                                       TrackerDBInterface     *interface,
-                                       TrackerDBManagerFlags   flags,
-                                       TrackerDataManager     *data_manager,
-                                       GError                **error);
+typedef struct TrackerTokenizerData TrackerTokenizerData;
+
+TrackerTokenizerData * tracker_tokenizer_initialize (sqlite3                *db,
+                                                     TrackerDBInterface     *interface,
+                                                     TrackerDBManagerFlags   flags,
+                                                     TrackerDataManager     *data_manager,
+                                                     GError                **error);
+
+void tracker_tokenizer_add_document (TrackerTokenizerData *data,
+                                     const gchar          *text,
+                                     gint                  length);
+gboolean tracker_tokenizer_documents_full (TrackerTokenizerData *data);
+void tracker_tokenizer_tokenize_documents (TrackerTokenizerData *data);
+void tracker_tokenizer_clear_documents (TrackerTokenizerData *data);
 
 #endif /* __TRACKER_FTS_TOKENIZER_H__ */
@@ -200,8 +200,8 @@ tracker_fts_alter_table (sqlite3            *db,
 	if (!tracker_fts_create_table (db, database, table_name, ontologies, error))
 		return FALSE;
 
-	query = g_strdup_printf ("INSERT INTO \"%s\".%s (rowid) SELECT rowid FROM fts_view",
-				 database, table_name);
+	query = g_strdup_printf ("INSERT INTO \"%s\".%s (rowid) SELECT rowid FROM \"%s\".fts_view",
+				 database, table_name, database);
 	rc = sqlite3_exec (db, query, NULL, NULL, NULL);
 	g_free (query);
 
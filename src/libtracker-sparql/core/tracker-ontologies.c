@@ -641,6 +641,10 @@ tracker_ontologies_write_gvdb (TrackerOntologies  *ontologies,
 			gvdb_hash_table_insert_variant (table, item, uri, "fulltext-indexed", g_variant_new_boolean (TRUE));
 		}
 
+		if (tracker_property_get_closure_indexed (property)) {
+			gvdb_hash_table_insert_variant (table, item, uri, "closure-indexed", g_variant_new_boolean (TRUE));
+		}
+
 		domain_indexes = tracker_property_get_domain_indexes (property);
 		if (domain_indexes) {
 			g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
@@ -76,6 +76,7 @@ struct _TrackerPropertyPrivate {
 	guint          indexed : 1;
 	guint          orig_fulltext_indexed : 1;
 	guint          fulltext_indexed : 1;
+	guint          closure_indexed : 1;
 	guint          multiple_values : 1;
 	guint          last_multiple_values : 1;
 	guint          is_inverse_functional_property : 1;
@@ -252,6 +253,15 @@ tracker_property_maybe_sync_from_gvdb (TrackerProperty *property)
 		priv->fulltext_indexed = FALSE;
 	}
 
+	/* Closure indexed */
+	variant = tracker_ontologies_get_property_value_gvdb (priv->ontologies, priv->uri, "closure-indexed");
+	if (variant != NULL) {
+		priv->closure_indexed = g_variant_get_boolean (variant);
+		g_variant_unref (variant);
+	} else {
+		priv->closure_indexed = FALSE;
+	}
+
 	/* Cardinality */
 	variant = tracker_ontologies_get_property_value_gvdb (priv->ontologies, priv->uri, "max-cardinality");
 	if (variant != NULL) {
@@ -479,6 +489,20 @@ tracker_property_get_fulltext_indexed (TrackerProperty *property)
 	return priv->fulltext_indexed;
 }
 
+gboolean
+tracker_property_get_closure_indexed (TrackerProperty *property)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_val_if_fail (property != NULL, FALSE);
+
+	priv = tracker_property_get_instance_private (property);
+
+	tracker_property_maybe_sync_from_gvdb (property);
+
+	return priv->closure_indexed;
+}
+
 gboolean
 tracker_property_get_orig_fulltext_indexed (TrackerProperty *property)
 {
@@ -984,6 +1008,19 @@ tracker_property_set_fulltext_indexed (TrackerProperty *property,
 	priv->fulltext_indexed = !!value;
 }
 
+void
+tracker_property_set_closure_indexed (TrackerProperty *property,
+                                      gboolean         value)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_PROPERTY (property));
+
+	priv = tracker_property_get_instance_private (property);
+
+	priv->closure_indexed = !!value;
+}
+
 void
 tracker_property_set_multiple_values (TrackerProperty *property,
                                       gboolean         value)
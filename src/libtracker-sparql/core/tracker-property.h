@@ -75,6 +75,7 @@ gboolean            tracker_property_get_indexed             (TrackerProperty
 TrackerProperty *   tracker_property_get_secondary_index     (TrackerProperty      *property);
 gboolean            tracker_property_get_orig_fulltext_indexed(TrackerProperty      *property);
 gboolean            tracker_property_get_fulltext_indexed    (TrackerProperty      *property);
+gboolean            tracker_property_get_closure_indexed     (TrackerProperty      *property);
 gboolean            tracker_property_get_multiple_values     (TrackerProperty      *property);
 gboolean            tracker_property_get_last_multiple_values(TrackerProperty      *property);
 gboolean            tracker_property_get_orig_multiple_values(TrackerProperty      *property);
@@ -113,6 +114,8 @@ void                tracker_property_set_orig_fulltext_indexed(TrackerProperty
                                                                gboolean              value);
 void                tracker_property_set_fulltext_indexed    (TrackerProperty      *property,
                                                               gboolean              value);
+void                tracker_property_set_closure_indexed     (TrackerProperty      *property,
+                                                              gboolean              value);
 void                tracker_property_set_multiple_values     (TrackerProperty      *property,
                                                               gboolean              value);
 void                tracker_property_set_last_multiple_values(TrackerProperty      *property,
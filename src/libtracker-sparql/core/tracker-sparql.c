@@ -43,6 +43,9 @@
 /* FIXME: This should be dependent on SQLITE_LIMIT_VARIABLE_NUMBER */
 #define MAX_VARIABLES 999
 
+/* Largest snippet size accepted by fts:snippet */
+#define MAX_SNIPPET_TOKENS 64
+
 enum {
 	TIME_FORMAT_SECONDS,
 	TIME_FORMAT_MINUTES,
@@ -180,6 +183,8 @@ typedef struct
 	TrackerStringBuilder *construct_query;
 	TrackerParserNode *node;
 	TrackerParserNode *prev_node;
+	/* Innermost group graph pattern being translated */
+	TrackerParserNode *group_pattern;
 
 	TrackerToken graph;
 	TrackerToken subject;
@@ -219,6 +224,7 @@ typedef struct
 	guint graph_op;
 	gint values_idx;
 	gint fts_match_idx;
+	gint path_seed_idx;
 
 	gboolean convert_to_string;
 	gboolean silent;
@@ -254,6 +260,14 @@ struct _TrackerSparql
 	gboolean cacheable;
 	guint generation;
 
+	/* Update translation left out graph tables that did not exist yet */
+	gboolean missing_graph_tables;
+	guint graph_tables_serial;
+
+	/* Timings in microseconds, for tracker_sparql_explain() */
+	gint64 parse_time;
+	gint64 translate_time;
+
 	GMutex mutex;
 
 	TrackerSparqlState *current_state;
@@ -878,6 +892,28 @@ _append_empty_select (TrackerSparql *sparql,
 	_append_string (sparql, "WHERE 0 ");
 }
 
+static gboolean
+tracker_sparql_graph_has_table (TrackerSparql *sparql,
+                                const gchar   *graph,
+                                const gchar   *table_name)
+{
+	gboolean in_transaction, has_table;
+
+	in_transaction = sparql->query_type == TRACKER_SPARQL_QUERY_UPDATE;
+	has_table = tracker_data_manager_graph_has_table (sparql->data_manager,
+	                                                  graph, table_name,
+	                                                  in_transaction);
+
+	/* Translation never creates tables, a missing table is just an
+	 * empty branch. Earlier parts of an update may still create it,
+	 * see apply_update().
+	 */
+	if (!has_table && in_transaction)
+		sparql->missing_graph_tables = TRUE;
+
+	return has_table;
+}
+
 static void
 _append_union_graph_with_clause (TrackerSparql *sparql,
                                  const gchar   *table_name,
@@ -905,6 +941,11 @@ _append_union_graph_with_clause (TrackerSparql *sparql,
 	while (g_hash_table_iter_next (&iter, &graph_name, &value)) {
 		TrackerRowid *graph_id = value;
 
+		/* Skip graphs that never had data of this kind */
+		if (!tracker_sparql_graph_has_table (sparql, graph_name,
+		                                     table_name))
+			continue;
+
 		_append_string_printf (sparql,
 		                       "UNION ALL SELECT ID, %s %" G_GINT64_FORMAT " AS graph FROM \"%s\".\"%s\" ",
 		                       properties,
@@ -1042,6 +1083,64 @@ tracker_sparql_find_graph (TrackerSparql *sparql,
 	                                        in_transaction);
 }
 
+static gchar *
+_build_zero_length_match (TrackerSparql *sparql)
+{
+	const gchar *graph;
+
+	graph = tracker_token_get_idstring (&sparql->current_state->graph);
+
+	if (tracker_token_is_empty (&sparql->current_state->graph) ||
+	    tracker_token_get_variable (&sparql->current_state->graph)) {
+		TrackerOntologies *ontologies;
+		TrackerClass *rdfs_resource;
+
+		ontologies = tracker_data_manager_get_ontologies (sparql->data_manager);
+		rdfs_resource = tracker_ontologies_get_class_by_uri (ontologies, RDFS_NS "Resource");
+		tracker_sparql_add_union_graph_subquery_for_class (sparql,
+		                                                   rdfs_resource);
+
+		return g_strdup_printf ("SELECT ID, ID AS value, graph, %d AS ID_type, %d AS value_type "
+		                        "FROM \"unionGraph_rdfs:Resource\"",
+		                        TRACKER_PROPERTY_TYPE_RESOURCE,
+		                        TRACKER_PROPERTY_TYPE_RESOURCE);
+	} else if (tracker_sparql_find_graph (sparql, graph)) {
+		return g_strdup_printf ("SELECT ID, ID AS value, %" G_GINT64_FORMAT " AS graph, %d AS ID_type, %d AS value_type "
+		                        "FROM \"%s\".\"rdfs:Resource\"",
+		                        tracker_sparql_find_graph (sparql, graph),
+		                        TRACKER_PROPERTY_TYPE_RESOURCE,
+		                        TRACKER_PROPERTY_TYPE_RESOURCE,
+		                        graph);
+	} else {
+		/* Graph does not exist, ensure to come back empty */
+		return g_strdup ("SELECT * FROM (SELECT 0 AS ID, NULL AS value, NULL AS graph, 0 AS ID_type, 0 AS value_type LIMIT 0)");
+	}
+}
+
+static gboolean
+_path_element_uses_closure (TrackerSparql      *sparql,
+                            TrackerPathElement *path_elem)
+{
+	TrackerPathElement *child;
+
+	if (path_elem->op != TRACKER_PATH_OPERATOR_ONEORMORE &&
+	    path_elem->op != TRACKER_PATH_OPERATOR_ZEROORMORE)
+		return FALSE;
+
+	child = path_elem->data.composite.child1;
+
+	if (child->op != TRACKER_PATH_OPERATOR_NONE ||
+	    !tracker_property_get_closure_indexed (child->data.property))
+		return FALSE;
+
+	/* The closure table spans the union of all graphs */
+	if (!tracker_token_is_empty (&sparql->current_state->graph) ||
+	    sparql->policy.graphs || sparql->policy.filter_unnamed_graph)
+		return FALSE;
+
+	return TRUE;
+}
+
 static void
 _prepend_path_element (TrackerSparql      *sparql,
                        TrackerPathElement *path_elem)
@@ -1055,35 +1154,7 @@ _prepend_path_element (TrackerSparql      *sparql,
 		tracker_sparql_add_union_graph_subquery (sparql, path_elem->data.property);
 	} else if (path_elem->op == TRACKER_PATH_OPERATOR_ZEROORONE ||
 	           path_elem->op == TRACKER_PATH_OPERATOR_ZEROORMORE) {
-		const gchar *graph;
-
-		graph = tracker_token_get_idstring (&sparql->current_state->graph);
-
-		if (tracker_token_is_empty (&sparql->current_state->graph) ||
-		    tracker_token_get_variable (&sparql->current_state->graph)) {
-			TrackerOntologies *ontologies;
-			TrackerClass *rdfs_resource;
-
-			ontologies = tracker_data_manager_get_ontologies (sparql->data_manager);
-			rdfs_resource = tracker_ontologies_get_class_by_uri (ontologies, RDFS_NS "Resource");
-			tracker_sparql_add_union_graph_subquery_for_class (sparql,
-			                                                   rdfs_resource);
-
-			zero_length_match = g_strdup_printf ("SELECT ID, ID, graph, %d, %d "
-			                                     "FROM \"unionGraph_rdfs:Resource\"",
-			                                     TRACKER_PROPERTY_TYPE_RESOURCE,
-			                                     TRACKER_PROPERTY_TYPE_RESOURCE);
-		} else if (tracker_sparql_find_graph (sparql, graph)) {
-			zero_length_match = g_strdup_printf ("SELECT ID, ID, %" G_GINT64_FORMAT ", %d, %d "
-			                                     "FROM \"%s\".\"rdfs:Resource\"",
-			                                     tracker_sparql_find_graph (sparql, graph),
-			                                     TRACKER_PROPERTY_TYPE_RESOURCE,
-			                                     TRACKER_PROPERTY_TYPE_RESOURCE,
-			                                     graph);
-		} else {
-			/* Graph does not exist, ensure to come back empty */
-			zero_length_match = g_strdup ("SELECT * FROM (SELECT 0 AS ID, NULL, NULL, 0, 0 LIMIT 0)");
-		}
+		zero_length_match = _build_zero_length_match (sparql);
 	}
 
 	old = tracker_sparql_swap_builder (sparql, sparql->current_state->with_clauses);
@@ -1105,13 +1176,15 @@ _prepend_path_element (TrackerSparql      *sparql,
 
 			graph = tracker_token_get_idstring (&sparql->current_state->graph);
 
-			if (tracker_sparql_find_graph (sparql, graph)) {
+			if (tracker_sparql_find_graph (sparql, graph) &&
+			    tracker_sparql_graph_has_table (sparql, graph,
+			                                    tracker_property_get_table_name (path_elem->data.property))) {
 				table_name = g_strdup_printf ("\"%s\".\"%s\"", graph,
 				                              tracker_property_get_table_name (path_elem->data.property));
 				graph_column = g_strdup_printf ("%" G_GINT64_FORMAT,
 				                                tracker_sparql_find_graph (sparql, graph));
 			} else {
-				/* Graph does not exist, ensure to come back empty */
+				/* Graph or table does not exist, ensure to come back empty */
 				table_name = g_strdup_printf ("(SELECT 0 AS ID, NULL AS \"%s\", NULL, 0, 0 LIMIT 0)",
 							      tracker_property_get_name (path_elem->data.property));
 				graph_column = g_strdup ("0");
@@ -1160,6 +1233,25 @@ _prepend_path_element (TrackerSparql      *sparql,
 		                       path_elem->data.composite.child2->name);
 		break;
 	case TRACKER_PATH_OPERATOR_ZEROORMORE:
+		if (_path_element_uses_closure (sparql, path_elem)) {
+			_append_string_printf (sparql,
+			                       "\"%s\" (ID, value, graph, ID_type, value_type) AS "
+			                       "(SELECT ID, ancestor, NULL, %d, %d "
+			                       "FROM \"main\".\"%s_closure\" "
+			                       "UNION "
+			                       "%s "
+			                       "UNION "
+			                       "SELECT value, value, graph, value_type, value_type "
+			                       "FROM \"%s\") ",
+			                       path_elem->name,
+			                       TRACKER_PROPERTY_TYPE_RESOURCE,
+			                       TRACKER_PROPERTY_TYPE_RESOURCE,
+			                       tracker_property_get_name (path_elem->data.composite.child1->data.property),
+			                       zero_length_match,
+			                       path_elem->data.composite.child1->name);
+			break;
+		}
+
 		_append_string_printf (sparql,
 		                       "\"%s_helper\" (ID, value, graph, ID_type, value_type) AS "
 		                       "(SELECT ID, value, graph, ID_type, value_type "
@@ -1187,6 +1279,18 @@ _prepend_path_element (TrackerSparql      *sparql,
 		                       path_elem->data.composite.child1->name);
 		break;
 	case TRACKER_PATH_OPERATOR_ONEORMORE:
+		if (_path_element_uses_closure (sparql, path_elem)) {
+			_append_string_printf (sparql,
+			                       "\"%s\" (ID, value, graph, ID_type, value_type) AS "
+			                       "(SELECT ID, ancestor, NULL, %d, %d "
+			                       "FROM \"main\".\"%s_closure\") ",
+			                       path_elem->name,
+			                       TRACKER_PROPERTY_TYPE_RESOURCE,
+			                       TRACKER_PROPERTY_TYPE_RESOURCE,
+			                       tracker_property_get_name (path_elem->data.composite.child1->data.property));
+			break;
+		}
+
 		_append_string_printf (sparql,
 		                       "\"%s\" (ID, value, graph, ID_type, value_type) AS "
 		                       "(SELECT ID, value, graph, ID_type, value_type "
@@ -1272,6 +1376,126 @@ _prepend_path_element (TrackerSparql      *sparql,
 	g_free (zero_length_match);
 }
 
+/* Transitive paths are generally evaluated as the full closure of
+ * the path over the graph, and only filtered afterwards. If one of
+ * the ends is bound, this adds a recursive subquery that walks the
+ * path starting from the bound node, so that only the reachable part
+ * of the graph is visited. The UNION in the recursive subquery ensures
+ * already visited nodes are not expanded again.
+ */
+static gchar *
+tracker_sparql_add_seeded_path_subquery (TrackerSparql      *sparql,
+                                         TrackerPathElement *path_elem,
+                                         TrackerToken       *subject,
+                                         TrackerToken       *object)
+{
+	TrackerStringBuilder *old;
+	TrackerPathElement *child;
+	TrackerBinding *binding;
+	TrackerToken *seed;
+	gchar *table_name, *closure_name;
+	gchar *zero_length_match = NULL;
+	gboolean forward;
+
+	if (path_elem->op != TRACKER_PATH_OPERATOR_ONEORMORE &&
+	    path_elem->op != TRACKER_PATH_OPERATOR_ZEROORMORE)
+		return NULL;
+
+	/* Closure tables are already looked up by index */
+	if (_path_element_uses_closure (sparql, path_elem))
+		return NULL;
+
+	if (tracker_token_get_literal (subject) ||
+	    tracker_token_get_parameter (subject)) {
+		forward = TRUE;
+		seed = subject;
+	} else if (path_elem->type == TRACKER_PROPERTY_TYPE_RESOURCE &&
+	           (tracker_token_get_literal (object) ||
+	            tracker_token_get_parameter (object))) {
+		forward = FALSE;
+		seed = object;
+	} else {
+		return NULL;
+	}
+
+	if (tracker_token_get_literal (seed))
+		binding = tracker_literal_binding_new (tracker_token_get_literal (seed), NULL);
+	else
+		binding = tracker_parameter_binding_new (tracker_token_get_parameter (seed), NULL);
+
+	tracker_binding_set_data_type (binding, TRACKER_PROPERTY_TYPE_RESOURCE);
+	tracker_select_context_add_literal_binding (TRACKER_SELECT_CONTEXT (sparql->current_state->top_context),
+	                                            TRACKER_LITERAL_BINDING (binding));
+
+	if (path_elem->op == TRACKER_PATH_OPERATOR_ZEROORMORE)
+		zero_length_match = _build_zero_length_match (sparql);
+
+	child = path_elem->data.composite.child1;
+	table_name = g_strdup_printf ("%s_seed%d", path_elem->name,
+	                              sparql->current_state->path_seed_idx++);
+
+	if (path_elem->op == TRACKER_PATH_OPERATOR_ZEROORMORE)
+		closure_name = g_strdup_printf ("%s_helper", table_name);
+	else
+		closure_name = g_strdup (table_name);
+
+	old = tracker_sparql_swap_builder (sparql, sparql->current_state->with_clauses);
+
+	if (tracker_string_builder_is_empty (sparql->current_state->with_clauses))
+		_append_string (sparql, "WITH ");
+	else
+		_append_string (sparql, ", ");
+
+	_append_string_printf (sparql,
+	                       "\"%s\" (ID, value, graph, ID_type, value_type) AS "
+	                       "(SELECT ID, value, graph, ID_type, value_type "
+	                       "FROM \"%s\" WHERE %s = ",
+	                       closure_name, child->name,
+	                       forward ? "ID" : "value");
+	_append_literal_sql (sparql, TRACKER_LITERAL_BINDING (binding));
+	_append_string (sparql, "UNION ");
+
+	if (forward) {
+		_append_string_printf (sparql,
+		                       "SELECT b.ID, a.value, a.graph, b.ID_type, a.value_type "
+		                       "FROM \"%s\" AS a, \"%s\" AS b "
+		                       "WHERE a.ID = b.value) ",
+		                       child->name, closure_name);
+	} else {
+		_append_string_printf (sparql,
+		                       "SELECT a.ID, b.value, b.graph, a.ID_type, b.value_type "
+		                       "FROM \"%s\" AS a, \"%s\" AS b "
+		                       "WHERE a.value = b.ID) ",
+		                       child->name, closure_name);
+	}
+
+	if (path_elem->op == TRACKER_PATH_OPERATOR_ZEROORMORE) {
+		_append_string_printf (sparql,
+		                       ", \"%s\" (ID, value, graph, ID_type, value_type) AS "
+		                       "(SELECT ID, value, graph, ID_type, value_type "
+		                       "FROM \"%s\" "
+		                       "UNION "
+		                       "SELECT * FROM (%s) WHERE ID = ",
+		                       table_name, closure_name,
+		                       zero_length_match);
+		_append_literal_sql (sparql, TRACKER_LITERAL_BINDING (binding));
+		_append_string_printf (sparql,
+		                       "UNION "
+		                       "SELECT value, value, graph, value_type, value_type "
+		                       "FROM \"%s\" WHERE value = ",
+		                       child->name);
+		_append_literal_sql (sparql, TRACKER_LITERAL_BINDING (binding));
+		_append_string (sparql, ") ");
+	}
+
+	tracker_sparql_swap_builder (sparql, old);
+	g_object_unref (binding);
+	g_free (zero_length_match);
+	g_free (closure_name);
+
+	return table_name;
+}
+
 static inline gchar *
 _extract_node_string (TrackerParserNode *node,
                       TrackerSparql     *sparql)
@@ -1579,6 +1803,11 @@ extract_fts_snippet_parameters (TrackerSparql      *sparql,
 		if (_accept_token (&node, RULE_TYPE_TERMINAL, TERMINAL_TYPE_INTEGER, &val) ||
 		    _accept_token (&node, RULE_TYPE_TERMINAL, TERMINAL_TYPE_INTEGER_POSITIVE, &val)) {
 			*num_tokens = _extract_node_string (val, sparql);
+
+			if (g_ascii_strtoll (*num_tokens, NULL, 10) > MAX_SNIPPET_TOKENS) {
+				_raise (PARSE, "«Num. tokens» argument must not be greater than "
+				        G_STRINGIFY (MAX_SNIPPET_TOKENS), "fts:snippet");
+			}
 		} else {
 			_raise (PARSE, "«Num. tokens» argument expects integer", "fts:snippet");
 		}
@@ -1661,6 +1890,332 @@ introspect_fts_snippet (TrackerSparql         *sparql,
 	return FALSE;
 }
 
+static gboolean
+_node_in_rule (TrackerParserNode       *node,
+               TrackerParserNode       *root,
+               TrackerGrammarNamedRule  named_rule)
+{
+	GNode *iter;
+
+	for (iter = ((GNode *) node)->parent;
+	     iter && iter != (GNode *) root;
+	     iter = iter->parent) {
+		const TrackerGrammarRule *rule;
+
+		rule = tracker_parser_node_get_rule ((TrackerParserNode *) iter);
+		if (tracker_grammar_rule_is_a (rule, RULE_TYPE_RULE, named_rule))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+_node_is_variable (TrackerParserNode *node,
+                   TrackerSparql     *sparql,
+                   TrackerVariable   *variable)
+{
+	const TrackerGrammarRule *rule = tracker_parser_node_get_rule (node);
+	gboolean equal;
+	gchar *str;
+
+	if (!tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_VAR1) &&
+	    !tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_VAR2))
+		return FALSE;
+
+	str = _extract_node_string (node, sparql);
+	equal = g_strcmp0 (str, variable->name) == 0;
+	g_free (str);
+
+	return equal;
+}
+
+static gboolean
+_node_is_iri (TrackerParserNode *node,
+              TrackerSparql     *sparql,
+              const gchar       *iri)
+{
+	const TrackerGrammarRule *rule = tracker_parser_node_get_rule (node);
+	gboolean equal;
+	gchar *str;
+
+	if (!tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_PNAME_LN) &&
+	    !tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_IRIREF))
+		return FALSE;
+
+	str = _extract_node_string (node, sparql);
+	equal = g_strcmp0 (str, iri) == 0;
+	g_free (str);
+
+	return equal;
+}
+
+static TrackerParserNode *
+_node_first_terminal (TrackerParserNode *root)
+{
+	TrackerParserNode *node;
+
+	for (node = tracker_sparql_parser_tree_find_first (root, TRUE);
+	     node;
+	     node = tracker_sparql_parser_tree_find_next (node, TRUE)) {
+		const TrackerGrammarRule *rule;
+
+		if (!g_node_is_ancestor ((GNode *) root, (GNode *) node))
+			break;
+
+		rule = tracker_parser_node_get_rule (node);
+
+		if (!tracker_grammar_rule_is_a (rule, RULE_TYPE_LITERAL, LITERAL_OPEN_PARENS))
+			return node;
+	}
+
+	return NULL;
+}
+
+static TrackerVariable *
+_node_bare_variable (TrackerParserNode *root,
+                     TrackerSparql     *sparql)
+{
+	TrackerParserNode *node, *var_node = NULL;
+
+	for (node = tracker_sparql_parser_tree_find_first (root, TRUE);
+	     node;
+	     node = tracker_sparql_parser_tree_find_next (node, TRUE)) {
+		const TrackerGrammarRule *rule;
+
+		if (!g_node_is_ancestor ((GNode *) root, (GNode *) node))
+			break;
+
+		rule = tracker_parser_node_get_rule (node);
+
+		if (tracker_grammar_rule_is_a (rule, RULE_TYPE_LITERAL, LITERAL_OPEN_PARENS) ||
+		    tracker_grammar_rule_is_a (rule, RULE_TYPE_LITERAL, LITERAL_CLOSE_PARENS))
+			continue;
+
+		if (var_node ||
+		    (!tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_VAR1) &&
+		     !tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_VAR2)))
+			return NULL;
+
+		var_node = node;
+	}
+
+	return var_node ? _extract_node_variable (var_node, sparql) : NULL;
+}
+
+static gboolean
+introspect_fts_limit_pattern (TrackerSparql     *sparql,
+                              TrackerParserNode *where_clause,
+                              TrackerVariable   *subject)
+{
+	TrackerParserNode *node;
+	guint n_terms = 0;
+
+	/* Everything but OPTIONAL {} must be the single
+	 * "?subject fts:match 'terms'" triple, so no rows
+	 * are filtered out after the FTS match.
+	 */
+	for (node = tracker_sparql_parser_tree_find_first (where_clause, TRUE);
+	     node;
+	     node = tracker_sparql_parser_tree_find_next (node, TRUE)) {
+		const TrackerGrammarRule *rule;
+
+		if (!g_node_is_ancestor ((GNode *) where_clause, (GNode *) node))
+			break;
+		if (_node_in_rule (node, where_clause, NAMED_RULE_OptionalGraphPattern))
+			continue;
+
+		rule = tracker_parser_node_get_rule (node);
+
+		if (tracker_grammar_rule_is_a (rule, RULE_TYPE_LITERAL, LITERAL_WHERE) ||
+		    tracker_grammar_rule_is_a (rule, RULE_TYPE_LITERAL, LITERAL_OPEN_BRACE) ||
+		    tracker_grammar_rule_is_a (rule, RULE_TYPE_LITERAL, LITERAL_CLOSE_BRACE) ||
+		    tracker_grammar_rule_is_a (rule, RULE_TYPE_LITERAL, LITERAL_DOT))
+			continue;
+
+		if (n_terms == 0 && _node_is_variable (node, sparql, subject)) {
+			n_terms++;
+		} else if (n_terms == 1 && _node_is_iri (node, sparql, FTS_NS "match")) {
+			n_terms++;
+		} else if (n_terms == 2 &&
+		           (tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_STRING_LITERAL1) ||
+		            tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_STRING_LITERAL2) ||
+		            tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_STRING_LITERAL_LONG1) ||
+		            tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_STRING_LITERAL_LONG2) ||
+		            tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_PARAMETERIZED_VAR))) {
+			n_terms++;
+		} else {
+			return FALSE;
+		}
+	}
+
+	return n_terms == 3;
+}
+
+static gboolean
+introspect_fts_limit_order (TrackerSparql     *sparql,
+                            TrackerParserNode *order_clause,
+                            TrackerVariable   *subject)
+{
+	TrackerParserNode *node, *var = NULL, *iri = NULL;
+	gboolean parens;
+
+	/* ORDER BY DESC (fts:rank(?subject)) must be the only condition */
+	node = tracker_sparql_parser_tree_find_first (order_clause, TRUE);
+
+	if (!_accept_token (&node, RULE_TYPE_LITERAL, LITERAL_ORDER, NULL) ||
+	    !_accept_token (&node, RULE_TYPE_LITERAL, LITERAL_BY, NULL) ||
+	    !_accept_token (&node, RULE_TYPE_LITERAL, LITERAL_DESC, NULL))
+		return FALSE;
+
+	parens = _accept_token (&node, RULE_TYPE_LITERAL, LITERAL_OPEN_PARENS, NULL);
+
+	if (!(_accept_token (&node, RULE_TYPE_TERMINAL, TERMINAL_TYPE_PNAME_LN, &iri) ||
+	      _accept_token (&node, RULE_TYPE_TERMINAL, TERMINAL_TYPE_IRIREF, &iri)) ||
+	    !_node_is_iri (iri, sparql, FTS_NS "rank") ||
+	    !_accept_token (&node, RULE_TYPE_LITERAL, LITERAL_OPEN_PARENS, NULL) ||
+	    !(_accept_token (&node, RULE_TYPE_TERMINAL, TERMINAL_TYPE_VAR1, &var) ||
+	      _accept_token (&node, RULE_TYPE_TERMINAL, TERMINAL_TYPE_VAR2, &var)) ||
+	    !_node_is_variable (var, sparql, subject) ||
+	    !_accept_token (&node, RULE_TYPE_LITERAL, LITERAL_CLOSE_PARENS, NULL))
+		return FALSE;
+
+	if (parens &&
+	    !_accept_token (&node, RULE_TYPE_LITERAL, LITERAL_CLOSE_PARENS, NULL))
+		return FALSE;
+
+	return !node || !g_node_is_ancestor ((GNode *) order_clause, (GNode *) node);
+}
+
+static gboolean
+introspect_fts_limit_value (TrackerSparql     *sparql,
+                            TrackerParserNode *clause,
+                            guint              literal,
+                            gint64            *value)
+{
+	TrackerParserNode *node, *val = NULL;
+	gchar *str;
+
+	node = tracker_sparql_parser_tree_find_first (clause, TRUE);
+
+	/* Parameters are left alone, only plain integers are pushed down */
+	if (!_accept_token (&node, RULE_TYPE_LITERAL, literal, NULL) ||
+	    !_accept_token (&node, RULE_TYPE_TERMINAL, TERMINAL_TYPE_INTEGER, &val))
+		return FALSE;
+
+	str = _extract_node_string (val, sparql);
+	*value = g_ascii_strtoll (str, NULL, 10);
+	g_free (str);
+
+	return *value >= 0 && *value <= G_MAXINT32;
+}
+
+static gboolean
+introspect_fts_limit (TrackerSparql   *sparql,
+                      TrackerVariable *subject,
+                      gint64          *limit)
+{
+	TrackerParserNode *node, *where_clause = NULL, *order_clause = NULL;
+	TrackerParserNode *limit_clause = NULL, *offset_clause = NULL;
+	gboolean select_query = FALSE;
+	gint64 limit_value, offset_value = 0;
+	guint n_matches = 0;
+
+	/* Queries like:
+	 *   SELECT ... { ?u fts:match '...' OPTIONAL { ... } }
+	 *   ORDER BY DESC (fts:rank(?u)) LIMIT n
+	 * only need the n best ranked matches, let FTS5 find those
+	 * instead of sorting all matches after the fact.
+	 */
+	for (node = tracker_node_tree_get_root (sparql->tree);
+	     node;
+	     node = tracker_sparql_parser_tree_find_next (node, FALSE)) {
+		const TrackerGrammarRule *rule;
+
+		if (!tracker_parser_node_get_extents (node, NULL, NULL))
+			continue;
+
+		rule = tracker_parser_node_get_rule (node);
+
+		if (rule->type == RULE_TYPE_RULE) {
+			switch (rule->data.rule) {
+			case NAMED_RULE_SelectQuery:
+				select_query = TRUE;
+				break;
+			case NAMED_RULE_WhereClause:
+				if (!where_clause)
+					where_clause = node;
+				break;
+			case NAMED_RULE_OrderClause:
+				order_clause = node;
+				break;
+			case NAMED_RULE_LimitClause:
+				limit_clause = node;
+				break;
+			case NAMED_RULE_OffsetClause:
+				offset_clause = node;
+				break;
+			case NAMED_RULE_SubSelect:
+			case NAMED_RULE_Aggregate:
+			case NAMED_RULE_GroupClause:
+			case NAMED_RULE_HavingClause:
+			case NAMED_RULE_ValuesClause:
+				return FALSE;
+			default:
+				break;
+			}
+		} else if (tracker_grammar_rule_is_a (rule, RULE_TYPE_LITERAL, LITERAL_DISTINCT) ||
+		           tracker_grammar_rule_is_a (rule, RULE_TYPE_LITERAL, LITERAL_REDUCED)) {
+			return FALSE;
+		} else if (_node_is_iri (node, sparql, FTS_NS "match")) {
+			n_matches++;
+		}
+	}
+
+	if (!select_query || n_matches != 1 ||
+	    !where_clause || !order_clause || !limit_clause)
+		return FALSE;
+
+	if (!introspect_fts_limit_pattern (sparql, where_clause, subject) ||
+	    !introspect_fts_limit_order (sparql, order_clause, subject))
+		return FALSE;
+
+	if (!introspect_fts_limit_value (sparql, limit_clause, LITERAL_LIMIT, &limit_value))
+		return FALSE;
+	if (offset_clause &&
+	    !introspect_fts_limit_value (sparql, offset_clause, LITERAL_OFFSET, &offset_value))
+		return FALSE;
+
+	*limit = limit_value + offset_value;
+
+	return TRUE;
+}
+
+static void
+_append_fts_match_select (TrackerSparql         *sparql,
+                          const gchar           *select_items,
+                          const gchar           *database,
+                          TrackerLiteralBinding *binding,
+                          gint64                 limit)
+{
+	if (limit >= 0)
+		_append_string (sparql, "SELECT * FROM (");
+
+	_append_string_printf (sparql,
+	                       "%s FROM \"%s\".\"fts5\" "
+	                       "WHERE fts5 = SparqlFtsTokenize(",
+	                       select_items,
+	                       database);
+	_append_literal_sql (sparql, binding);
+	_append_string (sparql, ") || '*' ");
+
+	if (limit >= 0) {
+		_append_string_printf (sparql,
+		                       "ORDER BY rank LIMIT %" G_GINT64_FORMAT ") ",
+		                       limit);
+	}
+}
+
 static gchar *
 tracker_sparql_add_fts_subquery (TrackerSparql         *sparql,
                                  TrackerToken          *graph,
@@ -1670,7 +2225,8 @@ tracker_sparql_add_fts_subquery (TrackerSparql         *sparql,
 	TrackerStringBuilder *old;
 	gchar *snippet_expression = NULL;
 	GString *select_items;
-	gchar *table_name;
+	gchar *table_name, *items;
+	gint64 limit = -1;
 	gint n_properties;
 
 	old = tracker_sparql_swap_builder (sparql, sparql->current_state->with_clauses);
@@ -1701,6 +2257,8 @@ tracker_sparql_add_fts_subquery (TrackerSparql         *sparql,
 		} else {
 			g_string_append (select_items, ", NULL ");
 		}
+
+		introspect_fts_limit (sparql, tracker_token_get_variable (subject), &limit);
 	}
 
 	if (!tracker_token_get_literal (graph)) {
@@ -1712,13 +2270,9 @@ tracker_sparql_add_fts_subquery (TrackerSparql         *sparql,
 
 	if (tracker_token_get_literal (graph)) {
 		if (tracker_sparql_find_graph (sparql, tracker_token_get_idstring (graph))) {
-			_append_string_printf (sparql,
-			                       "%s FROM \"%s\".\"fts5\" "
-			                       "WHERE fts5 = SparqlFtsTokenize(",
-			                       select_items->str,
-			                       tracker_token_get_idstring (graph));
-			_append_literal_sql (sparql, binding);
-			_append_string (sparql, ") || '*' ");
+			_append_fts_match_select (sparql, select_items->str,
+			                          tracker_token_get_idstring (graph),
+			                          binding, limit);
 		} else {
 			_append_empty_select (sparql, n_properties);
 		}
@@ -1728,12 +2282,10 @@ tracker_sparql_add_fts_subquery (TrackerSparql         *sparql,
 		GHashTableIter iter;
 
 		if (!sparql->policy.filter_unnamed_graph) {
-			_append_string_printf (sparql,
-			                       "%s, 0 FROM \"main\".\"fts5\" "
-			                       "WHERE fts5 = SparqlFtsTokenize(",
-			                       select_items->str);
-			_append_literal_sql (sparql, binding);
-			_append_string (sparql, ") || '*' ");
+			items = g_strdup_printf ("%s, 0", select_items->str);
+			_append_fts_match_select (sparql, items, "main",
+			                          binding, limit);
+			g_free (items);
 		} else {
 			_append_empty_select (sparql, n_properties);
 		}
@@ -1744,15 +2296,12 @@ tracker_sparql_add_fts_subquery (TrackerSparql         *sparql,
 		while (g_hash_table_iter_next (&iter, &graph_name, &value)) {
 			TrackerRowid *graph_id = value;
 
-			_append_string_printf (sparql,
-			                       "UNION ALL %s, %" G_GINT64_FORMAT " AS graph "
-			                       "FROM \"%s\".\"fts5\" "
-			                       "WHERE fts5 = SparqlFtsTokenize(",
-			                       select_items->str,
-			                       *graph_id,
-			                       (gchar *) graph_name);
-			_append_literal_sql (sparql, binding);
-			_append_string (sparql, ") || '*' ");
+			_append_string (sparql, "UNION ALL ");
+			items = g_strdup_printf ("%s, %" G_GINT64_FORMAT " AS graph",
+			                         select_items->str, *graph_id);
+			_append_fts_match_select (sparql, items, graph_name,
+			                          binding, limit);
+			g_free (items);
 		}
 
 		g_hash_table_unref (graphs);
@@ -1841,7 +2390,9 @@ _add_quad (TrackerSparql  *sparql,
 				return FALSE;
 			}
 
-			if (!graph_db || !tracker_sparql_find_graph (sparql, graph_db))
+			if (!graph_db || !tracker_sparql_find_graph (sparql, graph_db) ||
+			    !tracker_sparql_graph_has_table (sparql, graph_db,
+			                                     tracker_class_get_name (subject_type)))
 				tracker_sparql_add_union_graph_subquery_for_class (sparql, subject_type);
 
 			is_rdf_type = TRUE;
@@ -1905,14 +2456,18 @@ _add_quad (TrackerSparql  *sparql,
 					}
 
 					if (domain_index) {
-						if (!graph_db || !tracker_sparql_find_graph (sparql, graph_db))
+						if (!graph_db || !tracker_sparql_find_graph (sparql, graph_db) ||
+						    !tracker_sparql_graph_has_table (sparql, graph_db,
+						                                     tracker_class_get_name (domain_index)))
 							tracker_sparql_add_union_graph_subquery_for_class (sparql, domain_index);
 						db_table = tracker_class_get_name (domain_index);
 					}
 				}
 			}
 
-			if (!graph_db || !tracker_sparql_find_graph (sparql, graph_db))
+			if (!graph_db || !tracker_sparql_find_graph (sparql, graph_db) ||
+			    !tracker_sparql_graph_has_table (sparql, graph_db,
+			                                     tracker_property_get_table_name (property)))
 				tracker_sparql_add_union_graph_subquery (sparql, property);
 
 			/* We can never share the table with multiple triples for
@@ -1975,11 +2530,18 @@ _add_quad (TrackerSparql  *sparql,
 			g_object_unref (binding);
 		}
 	} else if (tracker_token_get_path (predicate)) {
+		gchar *seeded_table;
+
+		seeded_table = tracker_sparql_add_seeded_path_subquery (sparql,
+		                                                        tracker_token_get_path (predicate),
+		                                                        subject, object);
 		table = tracker_triple_context_add_table (triple_context,
 		                                          graph_db,
+		                                          seeded_table ? seeded_table :
 		                                          tracker_token_get_idstring (predicate));
 		tracker_data_table_set_predicate_path (table, TRUE);
 		new_table = TRUE;
+		g_free (seeded_table);
 
 		/* If subject/object are variable, add variables to hold their type */
 		if (tracker_token_get_variable (subject)) {
@@ -2687,53 +3249,364 @@ convert_expression_to_string (TrackerSparql       *sparql,
 	}
 }
 
-static void
-_append_graph_checks (TrackerSparql *sparql,
-                      const gchar   *column_name,
-                      gboolean       add_unnamed_graph,
-                      GStrv          graphs,
-                      gint           len)
-{
-	gboolean first = TRUE;
-	gint i;
+static void
+_append_graph_checks (TrackerSparql *sparql,
+                      const gchar   *column_name,
+                      gboolean       add_unnamed_graph,
+                      GStrv          graphs,
+                      gint           len)
+{
+	gboolean first = TRUE;
+	gint i;
+
+	_append_string (sparql, "WHERE ");
+
+	if (add_unnamed_graph) {
+		_append_string_printf (sparql, "%s = %d OR ", column_name, 0);
+	}
+
+	_append_string_printf (sparql,
+	                       "(SELECT Uri FROM Resource WHERE ID = %s) ",
+	                       column_name);
+
+	_append_string (sparql, "IN (");
+
+	for (i = 0; i < len; i++) {
+		if (!tracker_sparql_find_graph (sparql, graphs[i]))
+			continue;
+
+		if (!first)
+			_append_string (sparql, ", ");
+
+		_append_string_printf (sparql,
+		                       "'%s' ",
+		                       graphs[i]);
+		first = FALSE;
+	}
+
+	_append_string (sparql, ")");
+}
+
+static TrackerContext *
+_begin_triples_block (TrackerSparql *sparql)
+{
+	TrackerContext *context;
+
+	context = tracker_triple_context_new ();
+	tracker_sparql_push_context (sparql, context);
+
+	return context;
+}
+
+/* Returns the only variable of the triples block referenced by a
+ * FILTER, if any.
+ */
+static TrackerVariable *
+_filter_get_block_variable (TrackerSparql     *sparql,
+                            TrackerParserNode *filter,
+                            GHashTable        *block_variables)
+{
+	TrackerParserNode *node;
+	TrackerVariable *found = NULL;
+
+	for (node = tracker_sparql_parser_tree_find_next (filter, FALSE);
+	     node && g_node_is_ancestor ((GNode *) filter, (GNode *) node);
+	     node = tracker_sparql_parser_tree_find_next (node, FALSE)) {
+		const TrackerGrammarRule *rule;
+		TrackerVariable *var;
+		gchar *name;
+
+		rule = tracker_parser_node_get_rule (node);
+
+		/* (NOT) EXISTS patterns say little about the rows */
+		if (tracker_grammar_rule_is_a (rule, RULE_TYPE_RULE, NAMED_RULE_GroupGraphPattern))
+			return NULL;
+
+		if (!tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_VAR1) &&
+		    !tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL, TERMINAL_TYPE_VAR2))
+			continue;
+
+		name = _extract_node_string (node, sparql);
+		var = g_hash_table_lookup (block_variables, name);
+		g_free (name);
+
+		if (!var)
+			continue;
+		if (found && found != var)
+			return NULL;
+
+		found = var;
+	}
+
+	return found;
+}
+
+/* Returns the variables of the triples block that are constrained on
+ * their own by a FILTER of the enclosing group. Filters of nested
+ * groups (e.g. in OPTIONAL) do not restrict the block.
+ */
+static GHashTable *
+_get_filtered_variables (TrackerSparql        *sparql,
+                         TrackerTripleContext *triple_context)
+{
+	TrackerParserNode *root, *node;
+	GHashTable *block_variables, *filtered;
+	GHashTableIter iter;
+	TrackerVariable *var;
+
+	filtered = g_hash_table_new (NULL, NULL);
+	root = sparql->current_state->group_pattern;
+
+	if (!root)
+		return filtered;
+
+	block_variables = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_iter_init (&iter, triple_context->variable_bindings);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *) &var, NULL))
+		g_hash_table_insert (block_variables, var->name, var);
+
+	for (node = tracker_sparql_parser_tree_find_next (root, FALSE);
+	     node && g_node_is_ancestor ((GNode *) root, (GNode *) node);
+	     node = tracker_sparql_parser_tree_find_next (node, FALSE)) {
+		GNode *parent;
+
+		if (!tracker_grammar_rule_is_a (tracker_parser_node_get_rule (node),
+		                                RULE_TYPE_RULE, NAMED_RULE_Filter))
+			continue;
+
+		for (parent = ((GNode *) node)->parent; parent; parent = parent->parent) {
+			if (parent == (GNode *) root ||
+			    tracker_grammar_rule_is_a (tracker_parser_node_get_rule ((TrackerParserNode *) parent),
+			                               RULE_TYPE_RULE, NAMED_RULE_GroupGraphPattern))
+				break;
+		}
+
+		if (parent != (GNode *) root)
+			continue;
+
+		var = _filter_get_block_variable (sparql, node, block_variables);
+		if (var)
+			g_hash_table_add (filtered, var);
+	}
+
+	g_hash_table_unref (block_variables);
+
+	return filtered;
+}
+
+/* Estimates the rows a table contributes to the join from the row
+ * counts kept by the writer, restricted by the literals and filtered
+ * variables bound to its columns. Returns -1 if unknown.
+ */
+static gint64
+_estimate_table_rows (TrackerSparql        *sparql,
+                      TrackerTripleContext *triple_context,
+                      TrackerDataTable     *table,
+                      GHashTable           *filtered_variables)
+{
+	GHashTableIter iter;
+	TrackerVariable *var;
+	GPtrArray *binding_list;
+	gint64 estimate;
+	guint i;
+
+	if (table->fts)
+		return 0;
+	if (table->predicate_variable || table->predicate_path)
+		return -1;
+
+	if (!tracker_data_manager_get_table_rows (sparql->data_manager,
+	                                          table->graph,
+	                                          table->sql_db_tablename,
+	                                          &estimate))
+		return -1;
+
+	for (i = 0; i < triple_context->literal_bindings->len; i++) {
+		TrackerBinding *binding;
+
+		binding = g_ptr_array_index (triple_context->literal_bindings, i);
+		if (binding->table != table)
+			continue;
+
+		if (g_strcmp0 (binding->sql_db_column_name, "ID") == 0)
+			estimate = MIN (estimate, 1);
+		else if (g_strcmp0 (binding->sql_db_column_name, "graph") != 0)
+			estimate /= 10;
+	}
+
+	g_hash_table_iter_init (&iter, triple_context->variable_bindings);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *) &var, (gpointer *) &binding_list)) {
+		if (!g_hash_table_contains (filtered_variables, var))
+			continue;
+
+		for (i = 0; i < binding_list->len; i++) {
+			TrackerBinding *binding = g_ptr_array_index (binding_list, i);
+
+			if (binding->table == table) {
+				estimate /= 10;
+				break;
+			}
+		}
+	}
+
+	return estimate;
+}
+
+static gboolean
+_table_list_contains (GPtrArray        *tables,
+                      TrackerDataTable *table)
+{
+	guint i;
+
+	for (i = 0; i < tables->len; i++) {
+		if (g_ptr_array_index (tables, i) == table)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Whether a table can be looked up by ID from the tables already
+ * in the join.
+ */
+static gboolean
+_table_joins_by_id (TrackerTripleContext *triple_context,
+                    TrackerDataTable     *table,
+                    GPtrArray            *joined)
+{
+	GHashTableIter iter;
+	GPtrArray *binding_list;
+	guint i;
+
+	g_hash_table_iter_init (&iter, triple_context->variable_bindings);
+
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &binding_list)) {
+		gboolean by_id = FALSE, in_join = FALSE;
+
+		for (i = 0; i < binding_list->len; i++) {
+			TrackerBinding *binding = g_ptr_array_index (binding_list, i);
+
+			if (binding->table == table)
+				by_id |= g_strcmp0 (binding->sql_db_column_name, "ID") == 0;
+			else
+				in_join |= _table_list_contains (joined, binding->table);
+		}
+
+		if (by_id && in_join)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Decides the join order of the tables in a triples block. The table
+ * with the fewest estimated rows drives the join, then tables are
+ * added for as long as one can be looked up by ID from those before,
+ * fewest rows first. These are joined with CROSS JOIN, which SQLite
+ * does not reorder. Tables that can only be reached through other
+ * columns follow, and are left to the SQLite planner.
+ *
+ * Returns the number of tables in fixed order, 0 if there are no
+ * statistics to go by and the original order is kept.
+ */
+static guint
+_order_triple_context_tables (TrackerSparql        *sparql,
+                              TrackerTripleContext *triple_context,
+                              GPtrArray            *tables)
+{
+	GHashTable *filtered_variables;
+	gint64 *estimates;
+	guint i, n_tables, n_fixed = 0;
+	gboolean known = TRUE;
+
+	n_tables = triple_context->sql_tables->len;
+	estimates = g_new0 (gint64, n_tables);
+	filtered_variables = _get_filtered_variables (sparql, triple_context);
+
+	for (i = 0; i < n_tables; i++) {
+		estimates[i] = _estimate_table_rows (sparql, triple_context,
+		                                     g_ptr_array_index (triple_context->sql_tables, i),
+		                                     filtered_variables);
+		if (estimates[i] < 0)
+			known = FALSE;
+	}
+
+	g_hash_table_unref (filtered_variables);
+
+	if (n_tables > 1 && known) {
+		while (TRUE) {
+			gint best = -1;
+
+			for (i = 0; i < n_tables; i++) {
+				TrackerDataTable *table;
+
+				table = g_ptr_array_index (triple_context->sql_tables, i);
+
+				if (_table_list_contains (tables, table))
+					continue;
+				if (tables->len > 0 &&
+				    !_table_joins_by_id (triple_context, table, tables))
+					continue;
+				if (best < 0 || estimates[i] < estimates[best])
+					best = i;
+			}
 
-	_append_string (sparql, "WHERE ");
+			if (best < 0)
+				break;
 
-	if (add_unnamed_graph) {
-		_append_string_printf (sparql, "%s = %d OR ", column_name, 0);
+			g_ptr_array_add (tables, g_ptr_array_index (triple_context->sql_tables, best));
+		}
+
+		n_fixed = tables->len;
 	}
 
-	_append_string_printf (sparql,
-	                       "(SELECT Uri FROM Resource WHERE ID = %s) ",
-	                       column_name);
+	for (i = 0; i < n_tables; i++) {
+		TrackerDataTable *table;
 
-	_append_string (sparql, "IN (");
+		table = g_ptr_array_index (triple_context->sql_tables, i);
 
-	for (i = 0; i < len; i++) {
-		if (!tracker_sparql_find_graph (sparql, graphs[i]))
-			continue;
+		if (!_table_list_contains (tables, table))
+			g_ptr_array_add (tables, table);
+	}
 
-		if (!first)
-			_append_string (sparql, ", ");
+#ifdef G_ENABLE_DEBUG
+	if (TRACKER_DEBUG_CHECK (QUERY_PLAN)) {
+		GString *str = g_string_new (NULL);
 
-		_append_string_printf (sparql,
-		                       "'%s' ",
-		                       graphs[i]);
-		first = FALSE;
-	}
+		for (i = 0; i < tables->len; i++) {
+			TrackerDataTable *table = g_ptr_array_index (tables, i);
+			guint idx;
 
-	_append_string (sparql, ")");
-}
+			if (i > 0)
+				g_string_append (str, i < n_fixed ? " CROSS JOIN " : ", ");
 
-static TrackerContext *
-_begin_triples_block (TrackerSparql *sparql)
-{
-	TrackerContext *context;
+			for (idx = 0; idx < n_tables; idx++) {
+				if (g_ptr_array_index (triple_context->sql_tables, idx) == table)
+					break;
+			}
 
-	context = tracker_triple_context_new ();
-	tracker_sparql_push_context (sparql, context);
+			if (estimates[idx] < 0) {
+				g_string_append_printf (str, "%s (%s, unknown)",
+				                        table->sql_query_tablename,
+				                        table->sql_db_tablename);
+			} else {
+				g_string_append_printf (str, "%s (%s, ~%" G_GINT64_FORMAT " rows)",
+				                        table->sql_query_tablename,
+				                        table->sql_db_tablename,
+				                        estimates[idx]);
+			}
+		}
 
-	return context;
+		g_message ("[Join order] %s", str->str);
+		g_string_free (str, TRUE);
+	}
+#endif
+
+	g_free (estimates);
+
+	return n_fixed;
 }
 
 static gboolean
@@ -2745,8 +3618,9 @@ _end_triples_block (TrackerSparql  *sparql,
 	TrackerVariable *var;
 	TrackerContext *context;
 	GHashTableIter iter;
+	GPtrArray *tables;
 	gboolean first = TRUE;
-	guint i;
+	guint i, n_fixed;
 
 	context = sparql->current_state->context;
 	g_assert (TRACKER_IS_TRIPLE_CONTEXT (context));
@@ -2806,12 +3680,15 @@ _end_triples_block (TrackerSparql  *sparql,
 	_append_string (sparql, "FROM ");
 	first = TRUE;
 
+	tables = g_ptr_array_sized_new (triple_context->sql_tables->len);
+	n_fixed = _order_triple_context_tables (sparql, triple_context, tables);
+
 	/* Add tables */
-	for (i = 0; i < triple_context->sql_tables->len; i++) {
-		TrackerDataTable *table = g_ptr_array_index (triple_context->sql_tables, i);
+	for (i = 0; i < tables->len; i++) {
+		TrackerDataTable *table = g_ptr_array_index (tables, i);
 
 		if (!first)
-			_append_string (sparql, ", ");
+			_append_string (sparql, i < n_fixed ? "CROSS JOIN " : ", ");
 
 		if (table->predicate_variable) {
 			_append_string (sparql,
@@ -2851,7 +3728,9 @@ _end_triples_block (TrackerSparql  *sparql,
 			_append_string_printf (sparql, "\"%s\" ", table->sql_db_tablename);
 		} else {
 			if (table->graph &&
-			    tracker_sparql_find_graph (sparql, table->graph)) {
+			    tracker_sparql_find_graph (sparql, table->graph) &&
+			    tracker_sparql_graph_has_table (sparql, table->graph,
+			                                    table->sql_db_tablename)) {
 				_append_string_printf (sparql, "\"%s\".\"%s\" ",
 				                       table->graph,
 				                       table->sql_db_tablename);
@@ -2896,6 +3775,8 @@ _end_triples_block (TrackerSparql  *sparql,
 		first = FALSE;
 	}
 
+	g_ptr_array_unref (tables);
+
 	g_hash_table_iter_init (&iter, triple_context->variable_bindings);
 
 	where_placeholder = _append_placeholder (sparql);
@@ -4224,13 +5105,40 @@ translate_OrderClause (TrackerSparql  *sparql,
 	return TRUE;
 }
 
+static gboolean
+_variable_has_indexed_column (TrackerSparql   *sparql,
+                              TrackerVariable *variable)
+{
+	TrackerVariableBinding *binding;
+	TrackerDataTable *table;
+
+	binding = tracker_variable_get_sample_binding (variable);
+	if (!binding)
+		return FALSE;
+
+	table = TRACKER_BINDING (binding)->table;
+
+	/* Only tables read directly from a graph database may have an
+	 * index on the column, the unionGraph CTE has none.
+	 */
+	return (table &&
+	        !table->predicate_variable &&
+	        !table->predicate_path &&
+	        !table->fts &&
+	        table->graph &&
+	        tracker_sparql_find_graph (sparql, table->graph) &&
+	        tracker_sparql_graph_has_table (sparql, table->graph,
+	                                        table->sql_db_tablename));
+}
+
 static gboolean
 translate_OrderCondition (TrackerSparql  *sparql,
                           GError        **error)
 {
 	TrackerStringBuilder *str, *old;
 	const gchar *order_str = NULL;
-	TrackerVariable *variable = NULL;
+	TrackerVariable *variable = NULL, *sort_variable = NULL;
+	gboolean is_title_order = FALSE;
 
 	str = _append_placeholder (sparql);
 	old = tracker_sparql_swap_builder (sparql, str);
@@ -4242,13 +5150,22 @@ translate_OrderCondition (TrackerSparql  *sparql,
 	 * plain Expression is also accepted, the last group is:
 	 * ( Constraint | Var | Expression )
 	 */
-	if (_accept (sparql, RULE_TYPE_LITERAL, LITERAL_ASC)) {
-		_call_rule (sparql, NAMED_RULE_Expression, error);
+	if (_accept (sparql, RULE_TYPE_LITERAL, LITERAL_ASC))
 		order_str = "ASC ";
-	} else if (_accept (sparql, RULE_TYPE_LITERAL, LITERAL_DESC)) {
-		_call_rule (sparql, NAMED_RULE_Expression, error);
+	else if (_accept (sparql, RULE_TYPE_LITERAL, LITERAL_DESC))
 		order_str = "DESC ";
+
+	if (order_str) {
+		TrackerParserNode *first;
+
+		first = _node_first_terminal (sparql->current_state->node);
+		is_title_order = first && _node_is_iri (first, sparql, TRACKER_NS "title-order");
+		sort_variable = _node_bare_variable (sparql->current_state->node, sparql);
+		_call_rule (sparql, NAMED_RULE_Expression, error);
 	} else if (_check_in_rule (sparql, NAMED_RULE_Constraint)) {
+		is_title_order =
+			_node_is_iri (tracker_sparql_parser_tree_find_first (sparql->current_state->node, TRUE),
+			              sparql, TRACKER_NS "title-order");
 		_call_rule (sparql, NAMED_RULE_Constraint, error);
 	} else if (_check_in_rule (sparql, NAMED_RULE_Var)) {
 		TrackerVariableBinding *binding;
@@ -4256,6 +5173,7 @@ translate_OrderCondition (TrackerSparql  *sparql,
 		_call_rule (sparql, NAMED_RULE_Var, error);
 
 		variable = _last_node_variable (sparql);
+		sort_variable = variable;
 
 		binding = tracker_variable_get_sample_binding (variable);
 		if (binding) {
@@ -4268,12 +5186,29 @@ translate_OrderCondition (TrackerSparql  *sparql,
 		g_assert_not_reached ();
 	}
 
-	if (sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_STRING ||
-	    sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_LANGSTRING)
+	if (is_title_order) {
+		/* Strip title beginnings and collate once per row */
+		_prepend_string (sparql, "SparqlTitleSortKey(");
+		_append_string (sparql, ") ");
+	} else if (sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_STRING &&
+	           !(sort_variable && _variable_has_indexed_column (sparql, sort_variable))) {
+		/* No index can be used for sorting, collate once per row
+		 * instead of on every comparison.
+		 */
+		_prepend_string (sparql, "SparqlSortKey(");
+		_append_string (sparql, ") ");
+	} else if (sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_STRING ||
+	           sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_LANGSTRING) {
 		_append_string (sparql, "COLLATE " TRACKER_COLLATION_NAME " ");
-	else if (sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_RESOURCE ||
-	         (variable && sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_UNKNOWN))
+	} else if (sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_DATE ||
+	           sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_DATETIME) {
+		/* Sort unix timestamps and packed dates on the same scale */
+		_prepend_string (sparql, "SparqlTimeSort(");
+		_append_string (sparql, ") ");
+	} else if (sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_RESOURCE ||
+	           (variable && sparql->current_state->expression_type == TRACKER_PROPERTY_TYPE_UNKNOWN)) {
 		convert_expression_to_string (sparql, sparql->current_state->expression_type, variable);
+	}
 
 	tracker_sparql_swap_builder (sparql, old);
 
@@ -5103,7 +6038,7 @@ translate_GroupGraphPatternSub (TrackerSparql  *sparql,
                                 GError        **error)
 {
 	TrackerStringBuilder *child, *old;
-	TrackerParserNode *root;
+	TrackerParserNode *root, *old_group_pattern;
 
 	/* GroupGraphPatternSub ::= TriplesBlock? ( GraphPatternNotTriples '.'? TriplesBlock? )*
 	 */
@@ -5111,6 +6046,9 @@ translate_GroupGraphPatternSub (TrackerSparql  *sparql,
 	child = _append_placeholder (sparql);
 	old = tracker_sparql_swap_builder (sparql, child);
 
+	old_group_pattern = sparql->current_state->group_pattern;
+	sparql->current_state->group_pattern = root;
+
 	if (_check_in_rule (sparql, NAMED_RULE_TriplesBlock)) {
 		_begin_triples_block (sparql);
 		_call_rule (sparql, NAMED_RULE_TriplesBlock, error);
@@ -5207,6 +6145,7 @@ translate_GroupGraphPatternSub (TrackerSparql  *sparql,
 	}
 
 	tracker_sparql_swap_builder (sparql, old);
+	sparql->current_state->group_pattern = old_group_pattern;
 
 	return TRUE;
 }
@@ -5747,6 +6686,8 @@ translate_InlineDataOneVar (TrackerSparql  *sparql,
 {
 	TrackerVariable *var;
 	TrackerBinding *binding;
+	TrackerStringBuilder *values_type;
+	gboolean is_parameter = FALSE;
 	gint n_values = 0;
 
 	/* InlineDataOneVar ::= Var '{' DataBlockValue* '}'
@@ -5761,18 +6702,32 @@ translate_InlineDataOneVar (TrackerSparql  *sparql,
 
 	_expect (sparql, RULE_TYPE_LITERAL, LITERAL_OPEN_BRACE);
 
+	values_type = _append_placeholder (sparql);
+
 	while (_check_in_rule (sparql, NAMED_RULE_DataBlockValue)) {
-		if (n_values == 0)
-			_append_string (sparql, "VALUES ");
-		else
+		const TrackerGrammarRule *rule;
+
+		if (n_values != 0)
 			_append_string (sparql, ", ");
 
 		_append_string (sparql, "(");
 		_call_rule (sparql, NAMED_RULE_DataBlockValue, error);
 		_append_string (sparql, ") ");
+
+		rule = tracker_parser_node_get_rule (sparql->current_state->prev_node);
+		is_parameter = tracker_grammar_rule_is_a (rule, RULE_TYPE_TERMINAL,
+		                                          TERMINAL_TYPE_PARAMETERIZED_VAR);
 		n_values++;
 	}
 
+	/* A single parameter may be bound to an array of values, expand
+	 * it into rows through the tracker_array_values() table function.
+	 */
+	if (n_values == 1 && is_parameter)
+		tracker_string_builder_append (values_type, "SELECT * FROM tracker_array_values", -1);
+	else if (n_values > 0)
+		tracker_string_builder_append (values_type, "VALUES ", -1);
+
 	binding = tracker_variable_binding_new (var, NULL, NULL);
 	tracker_variable_set_sample_binding (var, TRACKER_VARIABLE_BINDING (binding));
 
@@ -7895,12 +8850,14 @@ handle_property_function (TrackerSparql    *sparql,
 
 		graph = tracker_token_get_idstring (&sparql->current_state->graph);
 
-		if (tracker_sparql_find_graph (sparql, graph)) {
+		if (tracker_sparql_find_graph (sparql, graph) &&
+		    tracker_sparql_graph_has_table (sparql, graph,
+		                                    tracker_property_get_table_name (property))) {
 			_append_string_printf (sparql, "FROM \"%s\".\"%s\" ",
 			                       graph,
 			                       tracker_property_get_table_name (property));
 		} else {
-			/* Graph does not exist, ensure to come back empty */
+			/* Graph or table does not exist, ensure to come back empty */
 			_append_string_printf (sparql, "FROM (SELECT 0 AS ID, NULL AS \"%s\" LIMIT 0) ",
 			                       tracker_property_get_name (property));
 		}
@@ -9668,10 +10625,13 @@ tracker_sparql_new (TrackerDataManager  *manager,
 {
 	TrackerSparql *sparql;
 	GError *inner_error = NULL;
+	gint64 start_time;
 
 	g_return_val_if_fail (TRACKER_IS_DATA_MANAGER (manager), NULL);
 	g_return_val_if_fail (query != NULL, NULL);
 
+	start_time = g_get_monotonic_time ();
+
 	sparql = g_object_new (TRACKER_TYPE_SPARQL, NULL);
 	sparql->query_type = TRACKER_SPARQL_QUERY_SELECT;
 	sparql->data_manager = g_object_ref (manager);
@@ -9683,6 +10643,7 @@ tracker_sparql_new (TrackerDataManager  *manager,
 
 	sparql->tree = tracker_sparql_parse_query (sparql->sparql, -1, NULL,
 	                                           &inner_error);
+	sparql->parse_time = g_get_monotonic_time () - start_time;
 
 	if (inner_error) {
 		g_propagate_error (error, inner_error);
@@ -9807,6 +10768,77 @@ prepare_query (TrackerSparql         *sparql,
 	return stmt;
 }
 
+static gboolean
+tracker_sparql_translate_select (TrackerSparql  *sparql,
+                                 GError        **error)
+{
+	TrackerSparqlState state = { 0 };
+	TrackerSelectContext *select_context;
+	gint64 start_time;
+	gboolean retval;
+
+	start_time = g_get_monotonic_time ();
+
+	sparql->current_state = &state;
+	tracker_sparql_state_init (&state, sparql);
+	retval = _call_rule_func (sparql, NAMED_RULE_Query, error);
+	sparql->sql_string = tracker_string_builder_to_string (state.result);
+
+	select_context = TRACKER_SELECT_CONTEXT (sparql->current_state->top_context);
+	sparql->n_columns = select_context->n_columns;
+	sparql->literal_bindings =
+		select_context->literal_bindings ?
+		g_ptr_array_ref (select_context->literal_bindings) :
+		NULL;
+	sparql->current_state = NULL;
+	tracker_sparql_state_clear (&state);
+
+	sparql->translate_time = g_get_monotonic_time () - start_time;
+
+	return retval;
+}
+
+#ifdef G_ENABLE_DEBUG
+static void
+log_query_plan (TrackerSparql      *sparql,
+                TrackerDBInterface *iface,
+                GHashTable         *parameters)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor = NULL;
+	GString *str;
+	gchar *sql;
+
+	sql = g_strdup_printf ("EXPLAIN QUERY PLAN %s", sparql->sql_string);
+	stmt = prepare_query (sparql, iface, sql,
+	                      sparql->literal_bindings,
+	                      parameters, FALSE, NULL);
+	g_free (sql);
+
+	if (stmt) {
+		cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, NULL));
+		g_object_unref (stmt);
+	}
+
+	if (!cursor)
+		return;
+
+	str = g_string_new (NULL);
+
+	/* Columns are: id, parent, unused, detail */
+	while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+		g_string_append_printf (str, "\n  %" G_GINT64_FORMAT " %" G_GINT64_FORMAT " %s",
+		                        tracker_sparql_cursor_get_integer (cursor, 0),
+		                        tracker_sparql_cursor_get_integer (cursor, 1),
+		                        tracker_sparql_cursor_get_string (cursor, 3, NULL));
+	}
+
+	g_message ("[Query plan]%s", str->str);
+	g_string_free (str, TRUE);
+	g_object_unref (cursor);
+}
+#endif
+
 TrackerSparqlCursor *
 tracker_sparql_execute_cursor (TrackerSparql  *sparql,
                                GHashTable     *parameters,
@@ -9837,34 +10869,20 @@ tracker_sparql_execute_cursor (TrackerSparql  *sparql,
 	}
 #endif
 
-	if (tracker_sparql_needs_update (sparql)) {
-		TrackerSparqlState state = { 0 };
-		TrackerSelectContext *select_context;
-		gboolean retval;
-
-		sparql->current_state = &state;
-		tracker_sparql_state_init (&state, sparql);
-		retval = _call_rule_func (sparql, NAMED_RULE_Query, error);
-		sparql->sql_string = tracker_string_builder_to_string (state.result);
-
-		select_context = TRACKER_SELECT_CONTEXT (sparql->current_state->top_context);
-		sparql->n_columns = select_context->n_columns;
-		sparql->literal_bindings =
-			select_context->literal_bindings ?
-			g_ptr_array_ref (select_context->literal_bindings) :
-			NULL;
-		sparql->current_state = NULL;
-		tracker_sparql_state_clear (&state);
-
-		if (!retval)
-			goto error;
-	}
+	if (tracker_sparql_needs_update (sparql) &&
+	    !tracker_sparql_translate_select (sparql, error))
+		goto error;
 
 	iface = tracker_data_manager_get_db_interface (sparql->data_manager,
 	                                               error);
 	if (!iface)
 		goto error;
 
+#ifdef G_ENABLE_DEBUG
+	if (TRACKER_DEBUG_CHECK (QUERY_PLAN))
+		log_query_plan (sparql, iface, parameters);
+#endif
+
 	stmt = prepare_query (sparql, iface,
 	                      sparql->sql_string,
 	                      sparql->literal_bindings,
@@ -9888,6 +10906,184 @@ error:
 
 }
 
+static gboolean
+add_query_plan (TrackerSparql    *sparql,
+                TrackerDBInterface *iface,
+                GHashTable       *parameters,
+                GVariantBuilder  *builder,
+                GError          **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor;
+	GVariantBuilder plan;
+	GError *inner_error = NULL;
+	gchar *sql;
+
+	sql = g_strdup_printf ("EXPLAIN QUERY PLAN %s", sparql->sql_string);
+	stmt = prepare_query (sparql, iface, sql,
+	                      sparql->literal_bindings,
+	                      parameters, FALSE, error);
+	g_free (sql);
+
+	if (!stmt)
+		return FALSE;
+
+	cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_cursor (stmt, error));
+	g_object_unref (stmt);
+
+	if (!cursor)
+		return FALSE;
+
+	g_variant_builder_init (&plan, G_VARIANT_TYPE ("a(xxs)"));
+
+	/* Columns are: id, parent, unused, detail */
+	while (tracker_sparql_cursor_next (cursor, NULL, &inner_error)) {
+		g_variant_builder_add (&plan, "(xxs)",
+		                       tracker_sparql_cursor_get_integer (cursor, 0),
+		                       tracker_sparql_cursor_get_integer (cursor, 1),
+		                       tracker_sparql_cursor_get_string (cursor, 3, NULL));
+	}
+
+	g_object_unref (cursor);
+
+	if (inner_error) {
+		g_variant_builder_clear (&plan);
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	g_variant_builder_add (builder, "{sv}", "plan",
+	                       g_variant_builder_end (&plan));
+	return TRUE;
+}
+
+static gboolean
+add_query_profile (TrackerSparql       *sparql,
+                   TrackerDBInterface  *iface,
+                   GHashTable          *parameters,
+                   GVariantBuilder     *builder,
+                   GCancellable        *cancellable,
+                   GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerSparqlCursor *cursor;
+	GError *inner_error = NULL;
+	gint64 start_time, prepare_time, step_time, n_rows = 0;
+	gint64 vm_steps, fullscan_steps, sorts, autoindexes;
+
+	start_time = g_get_monotonic_time ();
+	/* Not cached, so the statement counters only reflect this run */
+	stmt = prepare_query (sparql, iface,
+	                      sparql->sql_string,
+	                      sparql->literal_bindings,
+	                      parameters, FALSE, error);
+	prepare_time = g_get_monotonic_time () - start_time;
+
+	if (!stmt)
+		return FALSE;
+
+	cursor = TRACKER_SPARQL_CURSOR (tracker_db_statement_start_sparql_cursor (stmt,
+	                                                                         sparql->n_columns,
+	                                                                         error));
+	if (!cursor) {
+		g_object_unref (stmt);
+		return FALSE;
+	}
+
+	start_time = g_get_monotonic_time ();
+
+	while (tracker_sparql_cursor_next (cursor, cancellable, &inner_error))
+		n_rows++;
+
+	step_time = g_get_monotonic_time () - start_time;
+
+	tracker_db_statement_get_status (stmt, &vm_steps, &fullscan_steps,
+	                                 &sorts, &autoindexes);
+	g_object_unref (cursor);
+	g_object_unref (stmt);
+
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	g_variant_builder_add (builder, "{sv}", "prepare-time", g_variant_new_int64 (prepare_time));
+	g_variant_builder_add (builder, "{sv}", "step-time", g_variant_new_int64 (step_time));
+	g_variant_builder_add (builder, "{sv}", "rows", g_variant_new_int64 (n_rows));
+	g_variant_builder_add (builder, "{sv}", "vm-steps", g_variant_new_int64 (vm_steps));
+	g_variant_builder_add (builder, "{sv}", "fullscan-steps", g_variant_new_int64 (fullscan_steps));
+	g_variant_builder_add (builder, "{sv}", "sorts", g_variant_new_int64 (sorts));
+	g_variant_builder_add (builder, "{sv}", "autoindexes", g_variant_new_int64 (autoindexes));
+
+	return TRUE;
+}
+
+GVariant *
+tracker_sparql_explain (TrackerSparql        *sparql,
+                        GHashTable           *parameters,
+                        TrackerExplainFlags   flags,
+                        GCancellable         *cancellable,
+                        GError              **error)
+{
+	TrackerDBInterface *iface = NULL;
+	GVariantBuilder builder;
+	gboolean retval = FALSE;
+
+	if (sparql->query_type != TRACKER_SPARQL_QUERY_SELECT) {
+		g_set_error (error,
+		             TRACKER_SPARQL_ERROR,
+		             TRACKER_SPARQL_ERROR_QUERY_FAILED,
+		             "Not a select query");
+		return NULL;
+	}
+
+	g_mutex_lock (&sparql->mutex);
+
+	/* Always translate again, so the translation time is meaningful */
+	g_clear_pointer (&sparql->sql_string, g_free);
+	g_clear_pointer (&sparql->literal_bindings, g_ptr_array_unref);
+	sparql->generation = tracker_data_manager_get_generation (sparql->data_manager);
+
+	if (!tracker_sparql_translate_select (sparql, error)) {
+		/* Force translation on next execution */
+		sparql->generation = 0;
+		goto out;
+	}
+
+	iface = tracker_data_manager_get_db_interface (sparql->data_manager,
+	                                               error);
+	if (!iface)
+		goto out;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "sparql", g_variant_new_string (sparql->sparql));
+	g_variant_builder_add (&builder, "{sv}", "sql", g_variant_new_string (sparql->sql_string));
+	g_variant_builder_add (&builder, "{sv}", "parse-time", g_variant_new_int64 (sparql->parse_time));
+	g_variant_builder_add (&builder, "{sv}", "translate-time", g_variant_new_int64 (sparql->translate_time));
+
+	if (!add_query_plan (sparql, iface, parameters, &builder, error))
+		goto out;
+
+	if ((flags & TRACKER_EXPLAIN_FLAGS_PROFILE) != 0 &&
+	    !add_query_profile (sparql, iface, parameters, &builder,
+	                        cancellable, error))
+		goto out;
+
+	retval = TRUE;
+out:
+	if (iface)
+		tracker_db_interface_unref_use (iface);
+	g_mutex_unlock (&sparql->mutex);
+
+	if (!retval) {
+		if (iface)
+			g_variant_builder_clear (&builder);
+		return NULL;
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
 TrackerSparql *
 tracker_sparql_new_update (TrackerDataManager  *manager,
                            const gchar         *query,
@@ -10004,6 +11200,8 @@ init_literal_token_from_gvalue (TrackerToken *resolved_out,
 
 		data = g_bytes_get_data (g_value_get_boxed (value), &len);
 		tracker_token_literal_init (resolved_out, data, len);
+	} else if (G_VALUE_TYPE (value) == G_TYPE_ARRAY) {
+		/* Arrays may only be expanded in VALUES, leave unresolved */
 	} else if (G_VALUE_TYPE (value) != G_TYPE_INVALID) {
 		g_assert_not_reached ();
 	}
@@ -10336,6 +11534,32 @@ apply_update_op (TrackerSparql    *sparql,
 	return TRUE;
 }
 
+static gboolean
+tracker_sparql_translate_update (TrackerSparql  *sparql,
+                                 GError        **error)
+{
+	TrackerSparqlState state = { 0 };
+	gboolean retval;
+
+	g_array_set_size (sparql->update_ops, 0);
+	g_array_set_size (sparql->update_groups, 0);
+	g_clear_pointer (&sparql->policy.graphs, g_ptr_array_unref);
+	g_clear_pointer (&sparql->policy.services, g_ptr_array_unref);
+	g_clear_pointer (&sparql->policy.filtered_graphs, g_hash_table_unref);
+
+	sparql->missing_graph_tables = FALSE;
+	sparql->graph_tables_serial =
+		tracker_data_manager_get_graph_tables_serial (sparql->data_manager);
+
+	sparql->current_state = &state;
+	tracker_sparql_state_init (&state, sparql);
+	retval = _call_rule_func (sparql, NAMED_RULE_Update, error);
+	sparql->current_state = NULL;
+	tracker_sparql_state_clear (&state);
+
+	return retval;
+}
+
 static gboolean
 apply_update (TrackerSparql    *sparql,
               GHashTable       *parameters,
@@ -10391,6 +11615,20 @@ apply_update (TrackerSparql    *sparql,
 			if (inner_error)
 				goto out;
 
+			/* Earlier parts of this update may have created graph
+			 * tables that this WHERE clause left out, translate again.
+			 */
+			if (sparql->missing_graph_tables &&
+			    sparql->graph_tables_serial !=
+			    tracker_data_manager_get_graph_tables_serial (sparql->data_manager)) {
+				if (!tracker_sparql_translate_update (sparql, &inner_error))
+					goto out;
+
+				update_group = &g_array_index (sparql->update_groups,
+				                               TrackerUpdateOpGroup,
+				                               cur_update_group);
+			}
+
 			iface = tracker_data_manager_get_writable_db_interface (sparql->data_manager);
 			stmt = prepare_query (sparql, iface,
 			                      update_group->where_clause_sql,
@@ -10490,23 +11728,10 @@ tracker_sparql_execute_update (TrackerSparql  *sparql,
 	if (update_bnodes)
 		g_variant_builder_init (&variant_builder, G_VARIANT_TYPE ("aaa{ss}"));
 
-	if (tracker_sparql_needs_update (sparql)) {
-		TrackerSparqlState state = { 0 };
-
-		g_array_set_size (sparql->update_ops, 0);
-		g_array_set_size (sparql->update_groups, 0);
-		g_clear_pointer (&sparql->policy.graphs, g_ptr_array_unref);
-		g_clear_pointer (&sparql->policy.services, g_ptr_array_unref);
-		g_clear_pointer (&sparql->policy.filtered_graphs, g_hash_table_unref);
-
-		sparql->current_state = &state;
-		tracker_sparql_state_init (&state, sparql);
-		retval = _call_rule_func (sparql, NAMED_RULE_Update, error);
-		sparql->current_state = NULL;
-		tracker_sparql_state_clear (&state);
-
-		if (!retval)
-			goto out;
+	if (tracker_sparql_needs_update (sparql) &&
+	    !tracker_sparql_translate_update (sparql, error)) {
+		retval = FALSE;
+		goto out;
 	}
 
 	if (!apply_update (sparql, parameters, bnode_map,
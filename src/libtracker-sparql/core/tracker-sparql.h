@@ -22,6 +22,7 @@
 #define __TRACKER_SPARQL_H__
 
 #include <glib.h>
+#include <libtracker-sparql/tracker-enums.h>
 #include "tracker-data-manager.h"
 
 #define TRACKER_TYPE_SPARQL (tracker_sparql_get_type ())
@@ -38,6 +39,12 @@ TrackerSparqlCursor * tracker_sparql_execute_cursor (TrackerSparql  *sparql,
                                                      GHashTable     *parameters,
                                                      GError        **error);
 
+GVariant * tracker_sparql_explain (TrackerSparql        *sparql,
+                                   GHashTable           *parameters,
+                                   TrackerExplainFlags   flags,
+                                   GCancellable         *cancellable,
+                                   GError              **error);
+
 TrackerSparql * tracker_sparql_new_update (TrackerDataManager  *manager,
                                            const gchar         *query,
                                            GError             **error);
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2024, Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Table-valued function expanding a bound array parameter into rows:
+ *
+ *   SELECT value FROM tracker_array_values(?)
+ *
+ * If the argument is a GArray bound as a pointer value, one row is
+ * returned per array element. Any other value is returned as a single
+ * row, so plain scalar parameters keep working.
+ */
+
+#include "config.h"
+
+#include "tracker-vtab-array.h"
+
+#define COL_VALUE 0
+#define COL_ARRAY 1
+
+typedef struct {
+	struct sqlite3_vtab parent;
+} TrackerArrayVTab;
+
+typedef struct {
+	struct sqlite3_vtab_cursor parent;
+	GArray *array;
+	sqlite3_value *value;
+	gint64 rowid;
+	gint64 n_rows;
+} TrackerArrayCursor;
+
+static void
+tracker_array_cursor_reset (TrackerArrayCursor *cursor)
+{
+	g_clear_pointer (&cursor->array, g_array_unref);
+	g_clear_pointer (&cursor->value, sqlite3_value_free);
+	cursor->rowid = 0;
+	cursor->n_rows = 0;
+}
+
+static int
+array_connect (sqlite3            *db,
+               gpointer            data,
+               int                 argc,
+               const char *const  *argv,
+               sqlite3_vtab      **vtab_out,
+               char              **err_out)
+{
+	TrackerArrayVTab *vtab;
+	int rc;
+
+	rc = sqlite3_declare_vtab (db, "CREATE TABLE x(value, array HIDDEN)");
+	if (rc != SQLITE_OK)
+		return rc;
+
+	vtab = g_new0 (TrackerArrayVTab, 1);
+	*vtab_out = &vtab->parent;
+
+	return SQLITE_OK;
+}
+
+static int
+array_best_index (sqlite3_vtab       *vtab,
+                  sqlite3_index_info *info)
+{
+	int i;
+
+	for (i = 0; i < info->nConstraint; i++) {
+		if (!info->aConstraint[i].usable)
+			continue;
+		if (info->aConstraint[i].iColumn != COL_ARRAY ||
+		    info->aConstraint[i].op != SQLITE_INDEX_CONSTRAINT_EQ)
+			continue;
+
+		info->aConstraintUsage[i].argvIndex = 1;
+		info->aConstraintUsage[i].omit = TRUE;
+		info->idxNum = 1;
+		info->estimatedCost = 1;
+		return SQLITE_OK;
+	}
+
+	/* Without an array argument, there is nothing to return */
+	info->idxNum = 0;
+	info->estimatedCost = 2147483647;
+
+	return SQLITE_OK;
+}
+
+static int
+array_disconnect (sqlite3_vtab *vtab)
+{
+	g_free (vtab);
+	return SQLITE_OK;
+}
+
+static int
+array_open (sqlite3_vtab         *vtab,
+            sqlite3_vtab_cursor **cursor_ret)
+{
+	TrackerArrayCursor *cursor;
+
+	cursor = g_new0 (TrackerArrayCursor, 1);
+	*cursor_ret = &cursor->parent;
+
+	return SQLITE_OK;
+}
+
+static int
+array_close (sqlite3_vtab_cursor *vtab_cursor)
+{
+	TrackerArrayCursor *cursor = (TrackerArrayCursor *) vtab_cursor;
+
+	tracker_array_cursor_reset (cursor);
+	g_free (cursor);
+
+	return SQLITE_OK;
+}
+
+static int
+array_filter (sqlite3_vtab_cursor  *vtab_cursor,
+              int                   idx,
+              const char           *idx_str,
+              int                   argc,
+              sqlite3_value       **argv)
+{
+	TrackerArrayCursor *cursor = (TrackerArrayCursor *) vtab_cursor;
+	GArray *array;
+
+	tracker_array_cursor_reset (cursor);
+
+	if (idx == 0 || argc < 1)
+		return SQLITE_OK;
+
+	array = sqlite3_value_pointer (argv[0], TRACKER_VTAB_ARRAY_POINTER_TYPE);
+
+	if (array) {
+		cursor->array = g_array_ref (array);
+		cursor->n_rows = array->len;
+	} else {
+		cursor->value = sqlite3_value_dup (argv[0]);
+		if (!cursor->value)
+			return SQLITE_NOMEM;
+		cursor->n_rows = 1;
+	}
+
+	return SQLITE_OK;
+}
+
+static int
+array_next (sqlite3_vtab_cursor *vtab_cursor)
+{
+	TrackerArrayCursor *cursor = (TrackerArrayCursor *) vtab_cursor;
+
+	cursor->rowid++;
+	return SQLITE_OK;
+}
+
+static int
+array_eof (sqlite3_vtab_cursor *vtab_cursor)
+{
+	TrackerArrayCursor *cursor = (TrackerArrayCursor *) vtab_cursor;
+
+	return cursor->rowid >= cursor->n_rows;
+}
+
+static int
+array_column (sqlite3_vtab_cursor *vtab_cursor,
+              sqlite3_context     *context,
+              int                  n_col)
+{
+	TrackerArrayCursor *cursor = (TrackerArrayCursor *) vtab_cursor;
+
+	if (n_col != COL_VALUE)
+		sqlite3_result_null (context);
+	else if (cursor->array)
+		sqlite3_result_int64 (context, g_array_index (cursor->array, gint64, cursor->rowid));
+	else if (cursor->value)
+		sqlite3_result_value (context, cursor->value);
+	else
+		sqlite3_result_null (context);
+
+	return SQLITE_OK;
+}
+
+static int
+array_rowid (sqlite3_vtab_cursor *vtab_cursor,
+             sqlite_int64        *rowid_out)
+{
+	TrackerArrayCursor *cursor = (TrackerArrayCursor *) vtab_cursor;
+
+	*rowid_out = cursor->rowid;
+	return SQLITE_OK;
+}
+
+void
+tracker_vtab_array_init (sqlite3 *db)
+{
+	static const sqlite3_module array_module = {
+		2, /* version */
+		NULL, /* create, eponymous-only */
+		array_connect,
+		array_best_index,
+		array_disconnect,
+		array_disconnect,
+		array_open,
+		array_close,
+		array_filter,
+		array_next,
+		array_eof,
+		array_column,
+		array_rowid,
+		NULL, /* update */
+		NULL, /* begin */
+		NULL, /* sync */
+		NULL, /* commit */
+		NULL, /* rollback */
+		NULL, /* find function */
+		NULL, /* rename */
+		NULL, /* savepoint */
+		NULL, /* release */
+		NULL, /* rollback to */
+	};
+
+	sqlite3_create_module_v2 (db, "tracker_array_values", &array_module,
+	                          NULL, NULL);
+}
@@ -0,0 +1,499 @@
+/*
+ * Copyright (C) 2024, Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Virtual table for prefix-compressed resource URIs.
+ *
+ * Databases created with TRACKER_DB_MANAGER_COMPRESS_URIS store URIs
+ * split into an entry in the ResourcePrefix dictionary and a suffix in
+ * the ResourceData table. The Resource table is then a virtual table
+ * on top of those, so it can be queried and modified with the same
+ * (ID, Uri, BlankNode) columns as the plain table, including efficient
+ * lookups by ID and by Uri.
+ */
+
+#include "config.h"
+
+#include "tracker-vtab-resource.h"
+
+#define COL_ID 0
+#define COL_URI 1
+#define COL_BLANK_NODE 2
+
+#define IDX_FULL_SCAN 0
+#define IDX_BY_ID 1
+#define IDX_BY_URI 2
+#define N_IDX 3
+
+#define RESOURCE_SELECT \
+	"SELECT R.ID, P.Prefix || R.Suffix, R.BlankNode " \
+	"FROM ResourceData AS R " \
+	"LEFT JOIN ResourcePrefix AS P ON P.ID = R.Prefix "
+
+static const gchar *select_queries[N_IDX] = {
+	RESOURCE_SELECT,
+	RESOURCE_SELECT "WHERE R.ID = ?1",
+	RESOURCE_SELECT "WHERE R.Suffix = ?2 AND "
+	"R.Prefix = (SELECT ID FROM ResourcePrefix WHERE Prefix = ?1)",
+};
+
+typedef struct {
+	struct sqlite3_vtab parent;
+	sqlite3 *db;
+	/* Idle select statements, taken by cursors while in use */
+	sqlite3_stmt *select_stmts[N_IDX];
+	sqlite3_stmt *insert_prefix;
+	sqlite3_stmt *insert_resource;
+	sqlite3_stmt *delete_resource;
+} TrackerResourceVTab;
+
+typedef struct {
+	struct sqlite3_vtab_cursor parent;
+	TrackerResourceVTab *vtab;
+	sqlite3_stmt *stmt;
+	int stmt_idx;
+	guint finished : 1;
+} TrackerResourceCursor;
+
+static gsize
+uri_get_prefix_length (const gchar *uri,
+                       gsize        len)
+{
+	gsize i;
+
+	/* The prefix extends to the last path, fragment or
+	 * scheme separator, e.g. "file:///home/user/", or "urn:uuid:".
+	 */
+	for (i = len; i > 0; i--) {
+		if (uri[i - 1] == '/' || uri[i - 1] == '#' || uri[i - 1] == ':')
+			return i;
+	}
+
+	return 0;
+}
+
+static void
+tracker_resource_vtab_set_error (TrackerResourceVTab *vtab)
+{
+	if (vtab->parent.zErrMsg)
+		sqlite3_free (vtab->parent.zErrMsg);
+	vtab->parent.zErrMsg = sqlite3_mprintf ("%s", sqlite3_errmsg (vtab->db));
+}
+
+static int
+resource_connect (sqlite3            *db,
+                  gpointer            data,
+                  int                 argc,
+                  const char *const  *argv,
+                  sqlite3_vtab      **vtab_out,
+                  char              **err_out)
+{
+	TrackerResourceVTab *vtab;
+	int rc;
+
+	rc = sqlite3_declare_vtab (db, "CREATE TABLE x(ID INTEGER, Uri TEXT, BlankNode INTEGER)");
+	if (rc != SQLITE_OK)
+		return rc;
+
+	vtab = g_new0 (TrackerResourceVTab, 1);
+	vtab->db = db;
+	*vtab_out = &vtab->parent;
+
+	return SQLITE_OK;
+}
+
+static int
+resource_best_index (sqlite3_vtab       *vtab,
+                     sqlite3_index_info *info)
+{
+	int i, id_constraint = -1, uri_constraint = -1;
+
+	for (i = 0; i < info->nConstraint; i++) {
+		if (!info->aConstraint[i].usable)
+			continue;
+		if (info->aConstraint[i].op != SQLITE_INDEX_CONSTRAINT_EQ)
+			continue;
+
+		if (info->aConstraint[i].iColumn == COL_ID ||
+		    info->aConstraint[i].iColumn == -1)
+			id_constraint = i;
+		else if (info->aConstraint[i].iColumn == COL_URI)
+			uri_constraint = i;
+	}
+
+	if (id_constraint >= 0) {
+		info->aConstraintUsage[id_constraint].argvIndex = 1;
+		info->aConstraintUsage[id_constraint].omit = TRUE;
+		info->idxNum = IDX_BY_ID;
+		info->estimatedCost = 1;
+		info->estimatedRows = 1;
+		info->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+	} else if (uri_constraint >= 0) {
+		info->aConstraintUsage[uri_constraint].argvIndex = 1;
+		info->aConstraintUsage[uri_constraint].omit = TRUE;
+		info->idxNum = IDX_BY_URI;
+		info->estimatedCost = 2;
+		info->estimatedRows = 1;
+		info->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+	} else {
+		info->idxNum = IDX_FULL_SCAN;
+		info->estimatedCost = 1000000;
+		info->estimatedRows = 1000000;
+	}
+
+	return SQLITE_OK;
+}
+
+static int
+resource_disconnect (sqlite3_vtab *vtab)
+{
+	TrackerResourceVTab *resource_vtab = (TrackerResourceVTab *) vtab;
+	guint i;
+
+	for (i = 0; i < N_IDX; i++)
+		g_clear_pointer (&resource_vtab->select_stmts[i], sqlite3_finalize);
+
+	g_clear_pointer (&resource_vtab->insert_prefix, sqlite3_finalize);
+	g_clear_pointer (&resource_vtab->insert_resource, sqlite3_finalize);
+	g_clear_pointer (&resource_vtab->delete_resource, sqlite3_finalize);
+	g_free (resource_vtab);
+
+	return SQLITE_OK;
+}
+
+static int
+resource_open (sqlite3_vtab         *vtab,
+               sqlite3_vtab_cursor **cursor_ret)
+{
+	TrackerResourceCursor *cursor;
+
+	cursor = g_new0 (TrackerResourceCursor, 1);
+	cursor->vtab = (TrackerResourceVTab *) vtab;
+	*cursor_ret = &cursor->parent;
+
+	return SQLITE_OK;
+}
+
+static void
+resource_release_stmt (TrackerResourceCursor *cursor)
+{
+	TrackerResourceVTab *vtab = cursor->vtab;
+
+	if (!cursor->stmt)
+		return;
+
+	sqlite3_reset (cursor->stmt);
+	sqlite3_clear_bindings (cursor->stmt);
+
+	/* Give the statement back for other cursors, unless
+	 * another one already did.
+	 */
+	if (!vtab->select_stmts[cursor->stmt_idx])
+		vtab->select_stmts[cursor->stmt_idx] = cursor->stmt;
+	else
+		sqlite3_finalize (cursor->stmt);
+
+	cursor->stmt = NULL;
+}
+
+static int
+resource_close (sqlite3_vtab_cursor *vtab_cursor)
+{
+	TrackerResourceCursor *cursor = (TrackerResourceCursor *) vtab_cursor;
+
+	resource_release_stmt (cursor);
+	g_free (cursor);
+
+	return SQLITE_OK;
+}
+
+static int
+resource_step (TrackerResourceCursor *cursor)
+{
+	int rc;
+
+	rc = sqlite3_step (cursor->stmt);
+
+	if (rc == SQLITE_ROW)
+		return SQLITE_OK;
+
+	cursor->finished = TRUE;
+
+	if (rc == SQLITE_DONE)
+		return SQLITE_OK;
+
+	tracker_resource_vtab_set_error (cursor->vtab);
+
+	return rc;
+}
+
+static int
+resource_filter (sqlite3_vtab_cursor  *vtab_cursor,
+                 int                   idx,
+                 const char           *idx_str,
+                 int                   argc,
+                 sqlite3_value       **argv)
+{
+	TrackerResourceCursor *cursor = (TrackerResourceCursor *) vtab_cursor;
+	int rc;
+
+	cursor->finished = FALSE;
+
+	if (idx < 0 || idx >= N_IDX)
+		return SQLITE_ERROR;
+
+	/* Statements are prepared once per virtual table, cursors
+	 * keep the one they use until the next filter or close.
+	 */
+	if (!cursor->stmt || cursor->stmt_idx != idx) {
+		resource_release_stmt (cursor);
+
+		cursor->stmt = g_steal_pointer (&cursor->vtab->select_stmts[idx]);
+		cursor->stmt_idx = idx;
+
+		if (!cursor->stmt) {
+			rc = sqlite3_prepare_v2 (cursor->vtab->db, select_queries[idx],
+			                         -1, &cursor->stmt, NULL);
+			if (rc != SQLITE_OK) {
+				tracker_resource_vtab_set_error (cursor->vtab);
+				return rc;
+			}
+		}
+	} else {
+		sqlite3_reset (cursor->stmt);
+		sqlite3_clear_bindings (cursor->stmt);
+	}
+
+	if (idx == IDX_BY_ID) {
+		sqlite3_bind_value (cursor->stmt, 1, argv[0]);
+	} else if (idx == IDX_BY_URI) {
+		const gchar *uri;
+		gsize len, prefix_len;
+
+		uri = (const gchar *) sqlite3_value_text (argv[0]);
+		if (!uri) {
+			cursor->finished = TRUE;
+			return SQLITE_OK;
+		}
+
+		len = sqlite3_value_bytes (argv[0]);
+		prefix_len = uri_get_prefix_length (uri, len);
+		sqlite3_bind_text (cursor->stmt, 1, uri, prefix_len, SQLITE_TRANSIENT);
+		sqlite3_bind_text (cursor->stmt, 2, &uri[prefix_len], len - prefix_len,
+		                   SQLITE_TRANSIENT);
+	}
+
+	return resource_step (cursor);
+}
+
+static int
+resource_next (sqlite3_vtab_cursor *vtab_cursor)
+{
+	TrackerResourceCursor *cursor = (TrackerResourceCursor *) vtab_cursor;
+
+	return resource_step (cursor);
+}
+
+static int
+resource_eof (sqlite3_vtab_cursor *vtab_cursor)
+{
+	TrackerResourceCursor *cursor = (TrackerResourceCursor *) vtab_cursor;
+
+	return cursor->finished;
+}
+
+static int
+resource_column (sqlite3_vtab_cursor *vtab_cursor,
+                 sqlite3_context     *context,
+                 int                  n_col)
+{
+	TrackerResourceCursor *cursor = (TrackerResourceCursor *) vtab_cursor;
+
+	sqlite3_result_value (context, sqlite3_column_value (cursor->stmt, n_col));
+
+	return SQLITE_OK;
+}
+
+static int
+resource_rowid (sqlite3_vtab_cursor *vtab_cursor,
+                sqlite_int64        *rowid_out)
+{
+	TrackerResourceCursor *cursor = (TrackerResourceCursor *) vtab_cursor;
+
+	*rowid_out = sqlite3_column_int64 (cursor->stmt, COL_ID);
+	return SQLITE_OK;
+}
+
+static gboolean
+ensure_stmt (TrackerResourceVTab  *vtab,
+             sqlite3_stmt        **stmt,
+             const gchar          *sql)
+{
+	if (*stmt)
+		return TRUE;
+
+	if (sqlite3_prepare_v2 (vtab->db, sql, -1, stmt, NULL) != SQLITE_OK) {
+		tracker_resource_vtab_set_error (vtab);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static int
+resource_delete (TrackerResourceVTab *vtab,
+                 sqlite3_value       *rowid)
+{
+	int rc;
+
+	if (!ensure_stmt (vtab, &vtab->delete_resource,
+	                  "DELETE FROM ResourceData WHERE ID = ?"))
+		return SQLITE_ERROR;
+
+	sqlite3_bind_value (vtab->delete_resource, 1, rowid);
+	rc = sqlite3_step (vtab->delete_resource);
+	sqlite3_reset (vtab->delete_resource);
+
+	if (rc != SQLITE_DONE) {
+		tracker_resource_vtab_set_error (vtab);
+		return rc;
+	}
+
+	return SQLITE_OK;
+}
+
+static int
+resource_insert (TrackerResourceVTab  *vtab,
+                 sqlite3_value        *id,
+                 sqlite3_value        *uri_value,
+                 sqlite3_value        *blank_node,
+                 sqlite_int64         *rowid_out)
+{
+	const gchar *uri;
+	gsize len = 0, prefix_len = 0;
+	int rc;
+
+	if (!ensure_stmt (vtab, &vtab->insert_prefix,
+	                  "INSERT OR IGNORE INTO ResourcePrefix (Prefix) VALUES (?)") ||
+	    !ensure_stmt (vtab, &vtab->insert_resource,
+	                  "INSERT INTO ResourceData (ID, Prefix, Suffix, BlankNode) "
+	                  "VALUES (?1, (SELECT ID FROM ResourcePrefix WHERE Prefix = ?2), ?3, ?4)"))
+		return SQLITE_ERROR;
+
+	uri = (const gchar *) sqlite3_value_text (uri_value);
+
+	if (uri) {
+		len = sqlite3_value_bytes (uri_value);
+		prefix_len = uri_get_prefix_length (uri, len);
+
+		sqlite3_bind_text (vtab->insert_prefix, 1, uri, prefix_len, SQLITE_STATIC);
+		rc = sqlite3_step (vtab->insert_prefix);
+		sqlite3_reset (vtab->insert_prefix);
+
+		if (rc != SQLITE_DONE) {
+			tracker_resource_vtab_set_error (vtab);
+			return rc;
+		}
+
+		sqlite3_bind_text (vtab->insert_resource, 2, uri, prefix_len, SQLITE_STATIC);
+		sqlite3_bind_text (vtab->insert_resource, 3, &uri[prefix_len], len - prefix_len,
+		                   SQLITE_STATIC);
+	} else {
+		sqlite3_bind_null (vtab->insert_resource, 2);
+		sqlite3_bind_null (vtab->insert_resource, 3);
+	}
+
+	sqlite3_bind_value (vtab->insert_resource, 1, id);
+	sqlite3_bind_value (vtab->insert_resource, 4, blank_node);
+
+	rc = sqlite3_step (vtab->insert_resource);
+
+	if (rc == SQLITE_DONE) {
+		*rowid_out = sqlite3_last_insert_rowid (vtab->db);
+		rc = SQLITE_OK;
+	} else {
+		tracker_resource_vtab_set_error (vtab);
+	}
+
+	sqlite3_reset (vtab->insert_resource);
+	sqlite3_clear_bindings (vtab->insert_resource);
+
+	return rc;
+}
+
+static int
+resource_update (sqlite3_vtab   *vtab,
+                 int             argc,
+                 sqlite3_value **argv,
+                 sqlite_int64   *rowid_out)
+{
+	TrackerResourceVTab *resource_vtab = (TrackerResourceVTab *) vtab;
+	sqlite3_value *id;
+
+	if (argc == 1)
+		return resource_delete (resource_vtab, argv[0]);
+
+	if (sqlite3_value_type (argv[0]) != SQLITE_NULL) {
+		if (vtab->zErrMsg)
+			sqlite3_free (vtab->zErrMsg);
+		vtab->zErrMsg = sqlite3_mprintf ("Resources cannot be modified in place");
+		return SQLITE_ERROR;
+	}
+
+	/* argv[1] is the rowid, argv[2] onwards are the declared columns */
+	id = sqlite3_value_type (argv[2 + COL_ID]) != SQLITE_NULL ?
+		argv[2 + COL_ID] : argv[1];
+
+	return resource_insert (resource_vtab, id,
+	                        argv[2 + COL_URI],
+	                        argv[2 + COL_BLANK_NODE],
+	                        rowid_out);
+}
+
+void
+tracker_vtab_resource_init (sqlite3 *db)
+{
+	static const sqlite3_module resource_module = {
+		2, /* version */
+		resource_connect,
+		resource_connect,
+		resource_best_index,
+		resource_disconnect,
+		resource_disconnect,
+		resource_open,
+		resource_close,
+		resource_filter,
+		resource_next,
+		resource_eof,
+		resource_column,
+		resource_rowid,
+		resource_update,
+		NULL, /* begin */
+		NULL, /* sync */
+		NULL, /* commit */
+		NULL, /* rollback */
+		NULL, /* find function */
+		NULL, /* rename */
+		NULL, /* savepoint */
+		NULL, /* release */
+		NULL, /* rollback to */
+	};
+
+	sqlite3_create_module_v2 (db, "tracker_resource", &resource_module,
+	                          NULL, NULL);
+}
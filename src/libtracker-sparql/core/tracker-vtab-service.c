@@ -21,6 +21,7 @@
 #include "config.h"
 
 #include "libtracker-common/tracker-utils.h"
+#include "tracker-vtab-array.h"
 #include "tracker-vtab-service.h"
 #include <libtracker-sparql/tracker-connection.h>
 
@@ -238,6 +239,17 @@ apply_to_statement (TrackerSparqlStatement *statement,
                     const gchar            *name,
                     sqlite3_value          *value)
 {
+	GArray *array;
+
+	array = sqlite3_value_pointer (value, TRACKER_VTAB_ARRAY_POINTER_TYPE);
+	if (array) {
+		tracker_sparql_statement_bind_int_array (statement,
+		                                         name,
+		                                         (const gint64 *) array->data,
+		                                         array->len);
+		return;
+	}
+
 	switch (sqlite3_value_type (value)) {
 	case SQLITE_INTEGER:
 		tracker_sparql_statement_bind_int (statement,
@@ -91,6 +91,7 @@ typedef struct {
 	} match;
 
 	GHashTable *query_graphs;
+	GHashTable *graph_tables;
 	GList *properties;
 	GList *classes;
 	GList *graphs;
@@ -133,6 +134,7 @@ tracker_triples_cursor_reset (TrackerTriplesCursor *cursor)
 	g_clear_pointer (&cursor->classes, g_list_free);
 	g_clear_pointer (&cursor->graphs, g_list_free);
 	g_clear_pointer (&cursor->query_graphs, g_hash_table_unref);
+	g_clear_pointer (&cursor->graph_tables, g_hash_table_unref);
 	cursor->match.idxFlags = 0;
 	cursor->rowid = 0;
 	cursor->finished = FALSE;
@@ -443,6 +445,54 @@ get_column_property (TrackerTriplesCursor *cursor,
 	return property;
 }
 
+static gboolean
+graph_has_table (TrackerTriplesCursor *cursor,
+                 const gchar          *graph,
+                 const gchar          *table_name)
+{
+	GHashTable *tables;
+
+	/* Named graphs only have tables for the data they hold */
+	if (g_strcmp0 (graph, "main") == 0)
+		return TRUE;
+
+	if (!cursor->graph_tables) {
+		cursor->graph_tables =
+			g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+			                       (GDestroyNotify) g_hash_table_unref);
+	}
+
+	tables = g_hash_table_lookup (cursor->graph_tables, graph);
+
+	if (!tables) {
+		sqlite3_stmt *stmt;
+		gchar *sql;
+		int rc;
+
+		tables = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_insert (cursor->graph_tables, g_strdup (graph), tables);
+
+		sql = g_strdup_printf ("SELECT name FROM \"%s\".sqlite_master "
+		                       "WHERE type = 'table'",
+		                       graph);
+		rc = sqlite3_prepare_v2 (cursor->vtab->module->db,
+		                         sql, -1, &stmt, 0);
+		g_free (sql);
+
+		if (rc != SQLITE_OK)
+			return FALSE;
+
+		while (sqlite3_step (stmt) == SQLITE_ROW) {
+			g_hash_table_add (tables,
+			                  g_strdup ((const gchar *) sqlite3_column_text (stmt, 0)));
+		}
+
+		sqlite3_finalize (stmt);
+	}
+
+	return g_hash_table_contains (tables, table_name);
+}
+
 static gboolean
 iterate_next_stmt (TrackerTriplesCursor  *cursor,
                    const gchar          **graph,
@@ -502,6 +552,12 @@ init_stmt (TrackerTriplesCursor *cursor)
 	while (iterate_next_stmt (cursor, &graph, &graph_id, &class, &property)) {
 		GString *sql;
 
+		if (!graph_has_table (cursor, graph,
+		                      class ?
+		                      tracker_class_get_name (class) :
+		                      tracker_property_get_table_name (property)))
+			continue;
+
 		sql = g_string_new (NULL);
 
 		if (class) {
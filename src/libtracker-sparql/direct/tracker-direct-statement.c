@@ -135,6 +135,22 @@ tracker_direct_statement_bind_langstring (TrackerSparqlStatement *stmt,
 	g_value_take_boxed (gvalue, bytes);
 }
 
+static void
+tracker_direct_statement_bind_int_array (TrackerSparqlStatement *stmt,
+                                         const gchar            *name,
+                                         const gint64           *values,
+                                         gsize                   n_values)
+{
+	GValue *gvalue;
+	GArray *array;
+
+	array = g_array_sized_new (FALSE, FALSE, sizeof (gint64), n_values);
+	g_array_append_vals (array, values, n_values);
+
+	gvalue = insert_value (TRACKER_DIRECT_STATEMENT (stmt), name, G_TYPE_ARRAY);
+	g_value_take_boxed (gvalue, array);
+}
+
 static void
 tracker_direct_statement_clear_bindings (TrackerSparqlStatement *stmt)
 {
@@ -162,6 +178,26 @@ tracker_direct_statement_execute (TrackerSparqlStatement  *stmt,
 	return cursor;
 }
 
+static GVariant *
+tracker_direct_statement_explain (TrackerSparqlStatement  *stmt,
+                                  TrackerExplainFlags      flags,
+                                  GCancellable            *cancellable,
+                                  GError                 **error)
+{
+	TrackerDirectStatementPrivate *priv;
+	GVariant *result;
+	GError *inner_error = NULL;
+
+	priv = tracker_direct_statement_get_instance_private (TRACKER_DIRECT_STATEMENT (stmt));
+
+	result = tracker_sparql_explain (priv->sparql, priv->values, flags,
+	                                 cancellable, &inner_error);
+	if (inner_error)
+		g_propagate_error (error, _translate_internal_error (inner_error));
+
+	return result;
+}
+
 static void
 free_gvalue (gpointer data)
 {
@@ -380,6 +416,7 @@ tracker_direct_statement_class_init (TrackerDirectStatementClass *klass)
 	stmt_class->bind_string = tracker_direct_statement_bind_string;
 	stmt_class->bind_datetime = tracker_direct_statement_bind_datetime;
 	stmt_class->bind_langstring = tracker_direct_statement_bind_langstring;
+	stmt_class->bind_int_array = tracker_direct_statement_bind_int_array;
 	stmt_class->clear_bindings = tracker_direct_statement_clear_bindings;
 	stmt_class->execute = tracker_direct_statement_execute;
 	stmt_class->execute_async = tracker_direct_statement_execute_async;
@@ -389,6 +426,7 @@ tracker_direct_statement_class_init (TrackerDirectStatementClass *klass)
 	stmt_class->update = tracker_direct_statement_update;
 	stmt_class->update_async = tracker_direct_statement_update_async;
 	stmt_class->update_finish = tracker_direct_statement_update_finish;
+	stmt_class->explain = tracker_direct_statement_explain;
 }
 
 static void
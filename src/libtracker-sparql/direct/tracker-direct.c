@@ -37,6 +37,7 @@ struct _TrackerDirectConnectionPrivate
 	TrackerSparqlConnectionFlags flags;
 	GFile *store;
 	GFile *ontology;
+	GVariant *options;
 
 	TrackerNamespaceManager *namespace_manager;
 	TrackerDataManager *data_manager;
@@ -115,6 +116,7 @@ enum {
 	PROP_FLAGS,
 	PROP_STORE_LOCATION,
 	PROP_ONTOLOGY_LOCATION,
+	PROP_OPTIONS,
 	N_PROPS
 };
 
@@ -545,6 +547,8 @@ translate_flags (TrackerSparqlConnectionFlags flags)
 		db_flags |= TRACKER_DB_MANAGER_FTS_IGNORE_NUMBERS;
 	if ((flags & TRACKER_SPARQL_CONNECTION_FLAGS_ANONYMOUS_BNODES) != 0)
 		db_flags |= TRACKER_DB_MANAGER_ANONYMOUS_BNODES;
+	if ((flags & TRACKER_SPARQL_CONNECTION_FLAGS_COMPRESS_URIS) != 0)
+		db_flags |= TRACKER_DB_MANAGER_COMPRESS_URIS;
 
 	return db_flags;
 }
@@ -576,7 +580,7 @@ tracker_direct_connection_initable_init (GInitable     *initable,
 
 	priv->data_manager = tracker_data_manager_new (db_flags, priv->store,
 	                                               priv->ontology,
-	                                               100);
+	                                               100, priv->options);
 	if (!g_initable_init (G_INITABLE (priv->data_manager), cancellable, &inner_error)) {
 		g_propagate_error (error, _translate_internal_error (inner_error));
 		g_clear_object (&priv->data_manager);
@@ -715,10 +719,14 @@ insert_statement_cb (const gchar  *graph,
 	TrackerProperty *rdf_type = tracker_ontologies_get_rdf_type (ontologies);
 	TrackerNotifierEventCache *cache;
 	TrackerClass *new_class = NULL;
+	gboolean property_matches;
 	guint i;
 
 	cache = lookup_event_cache (notifier, graph);
 
+	if (!tracker_notifier_event_cache_match_graph (cache))
+		return;
+
 	if (predicate_id == tracker_property_get_id (rdf_type)) {
 		const gchar *uri;
 
@@ -726,6 +734,10 @@ insert_statement_cb (const gchar  *graph,
 		new_class = tracker_ontologies_get_class_by_uri (ontologies, uri);
 	}
 
+	property_matches =
+		tracker_notifier_event_cache_match_property (cache,
+		                                             tracker_ontologies_get_uri_by_id (ontologies, predicate_id));
+
 	for (i = 0; i < rdf_types->len; i++) {
 		TrackerClass *class = g_ptr_array_index (rdf_types, i);
 		TrackerNotifierEventType event_type;
@@ -733,10 +745,15 @@ insert_statement_cb (const gchar  *graph,
 		if (!tracker_class_get_notify (class))
 			continue;
 
+		if (!tracker_notifier_event_cache_match_class (cache, tracker_class_get_uri (class)))
+			continue;
+
 		if (class == new_class)
 			event_type = TRACKER_NOTIFIER_EVENT_CREATE;
-		else
+		else if (property_matches)
 			event_type = TRACKER_NOTIFIER_EVENT_UPDATE;
+		else
+			continue;
 
 		_tracker_notifier_event_cache_push_event (cache, subject_id, event_type);
 	}
@@ -758,10 +775,14 @@ delete_statement_cb (const gchar  *graph,
 	TrackerProperty *rdf_type = tracker_ontologies_get_rdf_type (ontologies);
 	TrackerNotifierEventCache *cache;
 	TrackerClass *class_being_removed = NULL;
+	gboolean property_matches;
 	guint i;
 
 	cache = lookup_event_cache (notifier, graph);
 
+	if (!tracker_notifier_event_cache_match_graph (cache))
+		return;
+
 	if (predicate_id == tracker_property_get_id (rdf_type)) {
 		const gchar *uri;
 
@@ -769,6 +790,10 @@ delete_statement_cb (const gchar  *graph,
 		class_being_removed = tracker_ontologies_get_class_by_uri (ontologies, uri);
 	}
 
+	property_matches =
+		tracker_notifier_event_cache_match_property (cache,
+		                                             tracker_ontologies_get_uri_by_id (ontologies, predicate_id));
+
 	for (i = 0; i < rdf_types->len; i++) {
 		TrackerClass *class = g_ptr_array_index (rdf_types, i);
 		TrackerNotifierEventType event_type;
@@ -776,10 +801,15 @@ delete_statement_cb (const gchar  *graph,
 		if (!tracker_class_get_notify (class))
 			continue;
 
+		if (!tracker_notifier_event_cache_match_class (cache, tracker_class_get_uri (class)))
+			continue;
+
 		if (class_being_removed && class == class_being_removed) {
 			event_type = TRACKER_NOTIFIER_EVENT_DELETE;
-		} else {
+		} else if (property_matches) {
 			event_type = TRACKER_NOTIFIER_EVENT_UPDATE;
+		} else {
+			continue;
 		}
 
 		_tracker_notifier_event_cache_push_event (cache, subject_id, event_type);
@@ -862,6 +892,7 @@ tracker_direct_connection_finalize (GObject *object)
 
 	g_clear_object (&priv->store);
 	g_clear_object (&priv->ontology);
+	g_clear_pointer (&priv->options, g_variant_unref);
 	g_clear_object (&priv->namespace_manager);
 
 	G_OBJECT_CLASS (tracker_direct_connection_parent_class)->finalize (object);
@@ -889,6 +920,9 @@ tracker_direct_connection_set_property (GObject      *object,
 	case PROP_ONTOLOGY_LOCATION:
 		priv->ontology = g_value_dup_object (value);
 		break;
+	case PROP_OPTIONS:
+		priv->options = g_value_dup_variant (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -917,6 +951,9 @@ tracker_direct_connection_get_property (GObject    *object,
 	case PROP_ONTOLOGY_LOCATION:
 		g_value_set_object (value, priv->ontology);
 		break;
+	case PROP_OPTIONS:
+		g_value_set_variant (value, priv->options);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -1586,6 +1623,14 @@ tracker_direct_connection_class_init (TrackerDirectConnectionClass *klass)
 		                     G_TYPE_FILE,
 		                     G_PARAM_READWRITE |
 		                     G_PARAM_CONSTRUCT_ONLY);
+	props[PROP_OPTIONS] =
+		g_param_spec_variant ("options",
+		                      "Options",
+		                      "Database tuning options",
+		                      G_VARIANT_TYPE_VARDICT,
+		                      NULL,
+		                      G_PARAM_READWRITE |
+		                      G_PARAM_CONSTRUCT_ONLY);
 
 	g_object_class_install_properties (object_class, N_PROPS, props);
 }
@@ -1594,6 +1639,7 @@ TrackerSparqlConnection *
 tracker_direct_connection_new (TrackerSparqlConnectionFlags   flags,
                                GFile                         *store,
                                GFile                         *ontology,
+                               GVariant                      *options,
                                GError                       **error)
 {
 	return g_initable_new (TRACKER_TYPE_DIRECT_CONNECTION,
@@ -1601,6 +1647,7 @@ tracker_direct_connection_new (TrackerSparqlConnectionFlags   flags,
 	                       "flags", flags,
 	                       "store-location", store,
 	                       "ontology-location", ontology,
+	                       "options", options,
 	                       NULL);
 }
 
@@ -52,6 +52,7 @@ GType tracker_direct_connection_get_type (void) G_GNUC_CONST;
 TrackerSparqlConnection *tracker_direct_connection_new (TrackerSparqlConnectionFlags   flags,
                                                         GFile                         *store,
                                                         GFile                         *ontology,
+                                                        GVariant                      *options,
                                                         GError                       **error);
 void tracker_direct_connection_new_async (TrackerSparqlConnectionFlags  flags,
                                           GFile                        *store,
@@ -154,6 +154,28 @@ tracker_remote_statement_bind_langstring (TrackerSparqlStatement *stmt,
 	                     val);
 }
 
+static void
+tracker_remote_statement_bind_int_array (TrackerSparqlStatement *stmt,
+                                         const gchar            *name,
+                                         const gint64           *values,
+                                         gsize                   n_values)
+{
+	TrackerRemoteStatement *remote_stmt = TRACKER_REMOTE_STATEMENT (stmt);
+	GArray *array;
+	GValue *val;
+
+	array = g_array_sized_new (FALSE, FALSE, sizeof (gint64), n_values);
+	g_array_append_vals (array, values, n_values);
+
+	val = g_new0 (GValue, 1);
+	g_value_init (val, G_TYPE_ARRAY);
+	g_value_take_boxed (val, array);
+
+	g_hash_table_insert (remote_stmt->bindings,
+	                     g_strdup (name),
+	                     val);
+}
+
 static void
 append_gvalue (GString *str,
                const GValue  *value)
@@ -192,6 +214,19 @@ append_gvalue (GString *str,
 			langtag = &data[str_len + 1];
 			g_string_append_printf (str, "@%s", langtag);
 		}
+	} else if (G_VALUE_TYPE (value) == G_TYPE_ARRAY) {
+		GArray *array;
+		guint i;
+
+		/* Expands to a list of values, as used in VALUES */
+		array = g_value_get_boxed (value);
+
+		for (i = 0; i < array->len; i++) {
+			if (i != 0)
+				g_string_append_c (str, ' ');
+			g_string_append_printf (str, "%" G_GINT64_FORMAT,
+			                        g_array_index (array, gint64, i));
+		}
 	} else if (G_VALUE_HOLDS_STRING (value)) {
 		const gchar *val = g_value_get_string (value);
 		int len = strlen (val);
@@ -479,6 +514,7 @@ tracker_remote_statement_class_init (TrackerRemoteStatementClass *klass)
 	stmt_class->bind_double = tracker_remote_statement_bind_double;
 	stmt_class->bind_datetime = tracker_remote_statement_bind_datetime;
 	stmt_class->bind_langstring = tracker_remote_statement_bind_langstring;
+	stmt_class->bind_int_array = tracker_remote_statement_bind_int_array;
 	stmt_class->execute = tracker_remote_statement_execute;
 	stmt_class->execute_async = tracker_remote_statement_execute_async;
 	stmt_class->execute_finish = tracker_remote_statement_execute_finish;
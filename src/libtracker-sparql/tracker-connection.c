@@ -1199,7 +1199,57 @@ tracker_sparql_connection_new (TrackerSparqlConnectionFlags   flags,
 	g_return_val_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable), NULL);
 	g_return_val_if_fail (!error || !*error, NULL);
 
-	return tracker_direct_connection_new (flags, store, ontology, error);
+	return tracker_direct_connection_new (flags, store, ontology, NULL, error);
+}
+
+/**
+ * tracker_sparql_connection_new_with_options:
+ * @flags: Connection flags to define the SPARQL connection behavior
+ * @store: (nullable): The directory that contains the database as a [iface@Gio.File], or %NULL
+ * @ontology: (nullable): The directory that contains the database schemas as a [iface@Gio.File], or %NULL
+ * @options: (nullable): A `a{sv}` [struct@GLib.Variant] dictionary of database options, or %NULL
+ * @cancellable: (nullable): Optional [type@Gio.Cancellable]
+ * @error: Error location
+ *
+ * Creates or opens a process-local database, with explicit settings
+ * for the underlying database. See [ctor@Tracker.SparqlConnection.new]
+ * for more information.
+ *
+ * The following @options are accepted, options not given default to
+ * values derived from the available memory:
+ *
+ * - `mmap-size` (`x`): Bytes of the database files that are memory-mapped,
+ *   0 disables memory-mapped I/O.
+ * - `page-size` (`i`): Page size in bytes, a power of two between 512 and
+ *   65536. This only has an effect on newly created databases.
+ * - `reader-cache-budget` (`i`): Total KiB of page cache shared by the
+ *   connections used for queries.
+ * - `temp-store` (`s`): Where temporary tables and indices are kept, one
+ *   of `memory`, `file` or `default`.
+ *
+ * An error is raised for unknown options, and values of the wrong type
+ * or out of range.
+ *
+ * Returns: (transfer full): a new `TrackerSparqlConnection`.
+ *
+ * Since: 3.8
+ */
+TrackerSparqlConnection *
+tracker_sparql_connection_new_with_options (TrackerSparqlConnectionFlags   flags,
+                                            GFile                         *store,
+                                            GFile                         *ontology,
+                                            GVariant                      *options,
+                                            GCancellable                  *cancellable,
+                                            GError                       **error)
+{
+	g_return_val_if_fail (!store || G_IS_FILE (store), NULL);
+	g_return_val_if_fail (!ontology || G_IS_FILE (ontology), NULL);
+	g_return_val_if_fail (!options ||
+	                      g_variant_is_of_type (options, G_VARIANT_TYPE_VARDICT), NULL);
+	g_return_val_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (!error || !*error, NULL);
+
+	return tracker_direct_connection_new (flags, store, ontology, options, error);
 }
 
 static void
@@ -42,6 +42,9 @@ G_BEGIN_DECLS
  * @TRACKER_SPARQL_CONNECTION_FLAGS_FTS_IGNORE_NUMBERS: Ignore numbers in FTS search terms.
  * @TRACKER_SPARQL_CONNECTION_FLAGS_ANONYMOUS_BNODES: Treat blank nodes as specified in
  *   SPARQL 1.1 syntax. Namely, they cannot be used as URIs. This flag is available since Tracker 3.3.
+ * @TRACKER_SPARQL_CONNECTION_FLAGS_COMPRESS_URIS: Store resource URIs split into a prefix shared
+ *   between resources and a suffix, reducing the database size when URIs share long prefixes. This
+ *   flag only has an effect when the database is created. This flag is available since Tracker 3.8.
  *
  * Connection flags to modify #TrackerSparqlConnection behavior.
  */
@@ -53,6 +56,7 @@ typedef enum {
 	TRACKER_SPARQL_CONNECTION_FLAGS_FTS_ENABLE_STOP_WORDS = 1 << 3,
 	TRACKER_SPARQL_CONNECTION_FLAGS_FTS_IGNORE_NUMBERS    = 1 << 4,
 	TRACKER_SPARQL_CONNECTION_FLAGS_ANONYMOUS_BNODES      = 1 << 5,
+	TRACKER_SPARQL_CONNECTION_FLAGS_COMPRESS_URIS         = 1 << 6,
 } TrackerSparqlConnectionFlags;
 
 /**
@@ -107,6 +111,14 @@ TRACKER_AVAILABLE_IN_ALL
 TrackerSparqlConnection * tracker_sparql_connection_new_finish (GAsyncResult  *result,
                                                                 GError       **error);
 
+TRACKER_AVAILABLE_IN_3_8
+TrackerSparqlConnection * tracker_sparql_connection_new_with_options (TrackerSparqlConnectionFlags   flags,
+                                                                      GFile                         *store,
+                                                                      GFile                         *ontology,
+                                                                      GVariant                      *options,
+                                                                      GCancellable                  *cancellable,
+                                                                      GError                       **error);
+
 TRACKER_AVAILABLE_IN_ALL
 TrackerSparqlConnection * tracker_sparql_connection_bus_new (const gchar      *service_name,
                                                              const gchar      *object_path,
@@ -47,6 +47,8 @@
  */
 #include "config.h"
 
+#include <libtracker-common/tracker-common.h>
+
 #include "tracker-cursor.h"
 #include "tracker-private.h"
 
@@ -126,11 +128,36 @@ tracker_sparql_cursor_real_get_datetime (TrackerSparqlCursor *cursor,
 	g_return_val_if_fail (tracker_sparql_cursor_real_is_bound (cursor, column), NULL);
 
 	text = tracker_sparql_cursor_get_string (cursor, column, NULL);
-	date_time = g_date_time_new_from_iso8601 (text, NULL);
+	if (!text)
+		return NULL;
+
+	date_time = tracker_date_new_from_iso8601 (text, NULL);
 
 	return date_time;
 }
 
+static gint
+tracker_sparql_cursor_real_get_values (TrackerSparqlCursor      *cursor,
+                                       TrackerSparqlCursorValue *values,
+                                       gint                      n_values)
+{
+	TrackerSparqlCursorClass *klass = TRACKER_SPARQL_CURSOR_GET_CLASS (cursor);
+	gint i, n_columns;
+
+	n_columns = MIN (n_values, klass->get_n_columns (cursor));
+
+	for (i = 0; i < n_columns; i++) {
+		values[i].value_type = klass->get_value_type (cursor, i);
+		values[i].langtag = NULL;
+		values[i].length = 0;
+		values[i].str = klass->get_string (cursor, i,
+		                                   &values[i].langtag,
+		                                   &values[i].length);
+	}
+
+	return n_columns;
+}
+
 static void
 tracker_sparql_cursor_finalize (GObject *object)
 {
@@ -194,6 +221,7 @@ tracker_sparql_cursor_class_init (TrackerSparqlCursorClass *klass)
 	klass->get_boolean = tracker_sparql_cursor_real_get_boolean;
 	klass->get_datetime = tracker_sparql_cursor_real_get_datetime;
 	klass->is_bound = tracker_sparql_cursor_real_is_bound;
+	klass->get_values = tracker_sparql_cursor_real_get_values;
 
 	/**
 	 * TrackerSparqlCursor:connection:
@@ -257,6 +285,37 @@ tracker_sparql_cursor_set_connection (TrackerSparqlCursor     *cursor,
 	g_set_object (&priv->connection, connection);
 }
 
+/*
+ * tracker_sparql_cursor_get_values:
+ * @cursor: a `TrackerSparqlCursor`
+ * @values: (out caller-allocates): array to fill with the current row
+ * @n_values: number of elements in @values
+ *
+ * Retrieves the value type, string, language tag and length of every
+ * column in the current row at once. This is equivalent to calling
+ * tracker_sparql_cursor_get_value_type() and
+ * tracker_sparql_cursor_get_langstring() on each column, but
+ * implementations may fetch the whole row in one go, e.g. holding
+ * their locks once per row rather than once per column access.
+ *
+ * Strings are owned by the cursor and stay valid until the next call
+ * to tracker_sparql_cursor_next().
+ *
+ * Returns: the number of elements filled in @values.
+ */
+gint
+tracker_sparql_cursor_get_values (TrackerSparqlCursor      *cursor,
+                                  TrackerSparqlCursorValue *values,
+                                  gint                      n_values)
+{
+	g_return_val_if_fail (TRACKER_IS_SPARQL_CURSOR (cursor), 0);
+	g_return_val_if_fail (values != NULL || n_values == 0, 0);
+
+	return TRACKER_SPARQL_CURSOR_GET_CLASS (cursor)->get_values (cursor,
+	                                                             values,
+	                                                             n_values);
+}
+
 /**
  * tracker_sparql_cursor_get_n_columns:
  * @cursor: a `TrackerSparqlCursor`
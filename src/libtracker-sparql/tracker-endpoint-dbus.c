@@ -96,12 +96,21 @@ static const gchar introspection_xml[] =
 	"      <arg type='i' name='format' direction='in' />"
 	"      <arg type='a{sv}' name='arguments' direction='in' />"
 	"    </method>"
+	"    <method name='Explain'>"
+	"      <arg type='s' name='query' direction='in' />"
+	"      <arg type='a{sv}' name='arguments' direction='in' />"
+	"      <arg type='u' name='flags' direction='in' />"
+	"      <arg type='a{sv}' name='result' direction='out' />"
+	"    </method>"
 	"    <method name='Update'>"
 	"      <arg type='h' name='input_stream' direction='in' />"
 	"    </method>"
 	"    <method name='UpdateArray'>"
 	"      <arg type='h' name='input_stream' direction='in' />"
 	"    </method>"
+	"    <method name='UpdateBatch'>"
+	"      <arg type='h' name='input_stream' direction='in' />"
+	"    </method>"
 	"    <method name='UpdateBlank'>"
 	"      <arg type='h' name='input_stream' direction='in' />"
 	"      <arg type='aaa{ss}' name='result' direction='out' />"
@@ -113,9 +122,21 @@ static const gchar introspection_xml[] =
 	"      <arg type='s' name='default_graph' direction='in' />"
 	"      <arg type='a{sv}' name='arguments' direction='in' />"
 	"    </method>"
+	"    <method name='SubscribeFiltered'>"
+	"      <arg type='s' name='graph' direction='in' />"
+	"      <arg type='as' name='classes' direction='in' />"
+	"      <arg type='as' name='properties' direction='in' />"
+	"      <arg type='u' name='subscription' direction='out' />"
+	"    </method>"
+	"    <method name='UnsubscribeFiltered'>"
+	"      <arg type='u' name='subscription' direction='in' />"
+	"    </method>"
 	"    <signal name='GraphUpdated'>"
 	"      <arg type='sa{ii}' name='updates' />"
 	"    </signal>"
+	"    <signal name='FilteredGraphUpdated'>"
+	"      <arg type='usa{ii}' name='updates' />"
+	"    </signal>"
 	"  </interface>"
 	"</node>";
 
@@ -148,6 +169,14 @@ typedef struct {
 	gchar *query;
 } UpdateRequest;
 
+typedef struct {
+	TrackerEndpointDBus *endpoint;
+	TrackerNotifier *notifier;
+	gchar *sender;
+	guint id;
+	guint watch_id;
+} FilteredSubscription;
+
 static GParamSpec *props[N_PROPS] = { 0, };
 
 static guint signals[N_SIGNALS] = { 0, };
@@ -371,14 +400,13 @@ write_cursor (QueryRequest          *request,
               TrackerSparqlCursor   *cursor,
               GError               **error)
 {
-	const gchar **values = NULL, **langtags = NULL;
+	TrackerSparqlCursorValue *values = NULL;
 	glong *offsets = NULL;
 	gint i, n_columns = 0;
 	GError *inner_error = NULL;
 
 	n_columns = tracker_sparql_cursor_get_n_columns (cursor);
-	values = g_new0 (const char *, n_columns);
-	langtags = g_new0 (const gchar *, n_columns);
+	values = g_new0 (TrackerSparqlCursorValue, n_columns);
 	offsets = g_new0 (glong, n_columns);
 
 	while (tracker_sparql_cursor_next (cursor, request->cancellable, &inner_error)) {
@@ -389,19 +417,20 @@ write_cursor (QueryRequest          *request,
 		                                     &inner_error))
 			break;
 
+		tracker_sparql_cursor_get_values (cursor, values, n_columns);
+
 		for (i = 0; i < n_columns; i++) {
 			glong len;
 
 			if (!g_data_output_stream_put_int32 (request->data_stream,
-			                                     tracker_sparql_cursor_get_value_type (cursor, i),
+			                                     values[i].value_type,
 			                                     request->cancellable,
 			                                     &inner_error))
 				goto out;
 
-			values[i] = tracker_sparql_cursor_get_langstring (cursor, i, &langtags[i], &len);
-
-			if (langtags[i])
-				len += strlen (langtags[i]) + 1;
+			len = values[i].length;
+			if (values[i].langtag)
+				len += strlen (values[i].langtag) + 1;
 			len++;
 			cur_offset += len;
 			offsets[i] = cur_offset;
@@ -417,19 +446,19 @@ write_cursor (QueryRequest          *request,
 
 		for (i = 0; i < n_columns; i++) {
 			if (!g_data_output_stream_put_string (request->data_stream,
-			                                      values[i] ? values[i] : "",
+			                                      values[i].str ? values[i].str : "",
 			                                      request->cancellable,
 			                                      &inner_error))
 				goto out;
 
-			if (langtags[i]) {
+			if (values[i].langtag) {
 				if (!g_data_output_stream_put_byte (request->data_stream, 0,
 				                                    request->cancellable,
 				                                    &inner_error))
 					goto out;
 
 				if (!g_data_output_stream_put_string (request->data_stream,
-				                                      langtags[i],
+				                                      values[i].langtag,
 				                                      request->cancellable,
 				                                      &inner_error))
 					goto out;
@@ -446,7 +475,6 @@ out:
 
 	g_free (values);
 	g_free (offsets);
-	g_free (langtags);
 
 	if (inner_error) {
 		g_propagate_error (error, inner_error);
@@ -709,6 +737,47 @@ deserialize_cb (GObject      *object,
 	g_dbus_method_invocation_return_value (invocation, NULL);
 }
 
+static void
+handle_explain (GTask        *task,
+                gpointer      source_object,
+                gpointer      task_data,
+                GCancellable *cancellable)
+{
+	TrackerSparqlStatement *stmt = source_object;
+	GVariant *result;
+	GError *error = NULL;
+
+	result = tracker_sparql_statement_explain (stmt,
+	                                           GPOINTER_TO_UINT (task_data),
+	                                           cancellable,
+	                                           &error);
+	if (result)
+		g_task_return_pointer (task, result, (GDestroyNotify) g_variant_unref);
+	else
+		g_task_return_error (task, error);
+}
+
+static void
+explain_cb (GObject      *object,
+            GAsyncResult *res,
+            gpointer      user_data)
+{
+	GDBusMethodInvocation *invocation = user_data;
+	GVariant *result;
+	GError *error = NULL;
+
+	result = g_task_propagate_pointer (G_TASK (res), &error);
+
+	if (result) {
+		g_dbus_method_invocation_return_value (invocation,
+		                                       g_variant_new ("(@a{sv})", result));
+		g_variant_unref (result);
+	} else {
+		g_dbus_method_invocation_return_gerror (invocation, error);
+		g_error_free (error);
+	}
+}
+
 static void
 bind_arguments (TrackerSparqlStatement *stmt,
                 GVariantIter           *arguments)
@@ -740,6 +809,12 @@ bind_arguments (TrackerSparqlStatement *stmt,
 				langtag = &data[str_len + 1];
 
 			tracker_sparql_statement_bind_langstring (stmt, arg, data, langtag);
+		} else if (g_variant_is_of_type (value, G_VARIANT_TYPE ("ax"))) {
+			const gint64 *values;
+			gsize n_values;
+
+			values = g_variant_get_fixed_array (value, &n_values, sizeof (gint64));
+			tracker_sparql_statement_bind_int_array (stmt, arg, values, n_values);
 		} else {
 			g_warning ("Unhandled type '%s' for argument %s",
 			           g_variant_get_type_string (value),
@@ -748,6 +823,130 @@ bind_arguments (TrackerSparqlStatement *stmt,
 	}
 }
 
+static void
+add_events (GVariantBuilder *builder,
+            const gchar     *graph,
+            GPtrArray       *events)
+{
+	guint i;
+
+	g_variant_builder_add (builder, "s", graph ? graph : "");
+	g_variant_builder_open (builder, G_VARIANT_TYPE ("a{ii}"));
+
+	for (i = 0; i < events->len; i++) {
+		TrackerNotifierEvent *event;
+		gint event_type, id;
+
+		event = g_ptr_array_index (events, i);
+		event_type = tracker_notifier_event_get_event_type (event);
+		id = tracker_notifier_event_get_id (event);
+		g_variant_builder_add (builder, "{ii}", event_type, id);
+	}
+
+	g_variant_builder_close (builder);
+}
+
+static void
+filtered_events_cb (TrackerNotifier *notifier,
+                    const gchar     *service,
+                    const gchar     *graph,
+                    GPtrArray       *events,
+                    gpointer         user_data)
+{
+	FilteredSubscription *subscription = user_data;
+	TrackerEndpointDBus *endpoint_dbus = subscription->endpoint;
+	GVariantBuilder builder;
+	GError *error = NULL;
+
+	if (tracker_endpoint_is_graph_filtered (TRACKER_ENDPOINT (endpoint_dbus), graph))
+		return;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("(usa{ii})"));
+	g_variant_builder_add (&builder, "u", subscription->id);
+	add_events (&builder, graph, events);
+
+	/* Only sent to the subscriber */
+	if (!g_dbus_connection_emit_signal (endpoint_dbus->dbus_connection,
+	                                    subscription->sender,
+	                                    endpoint_dbus->object_path,
+	                                    "org.freedesktop.Tracker3.Endpoint",
+	                                    "FilteredGraphUpdated",
+	                                    g_variant_builder_end (&builder),
+	                                    &error)) {
+		g_warning ("Could not emit FilteredGraphUpdated signal: %s", error->message);
+		g_error_free (error);
+	}
+}
+
+static void
+filtered_subscription_free (FilteredSubscription *subscription)
+{
+	if (subscription->watch_id)
+		g_bus_unwatch_name (subscription->watch_id);
+
+	g_signal_handlers_disconnect_by_data (subscription->notifier, subscription);
+	g_object_unref (subscription->notifier);
+	g_free (subscription->sender);
+	g_free (subscription);
+}
+
+static void
+subscriber_vanished_cb (GDBusConnection *connection,
+                        const gchar     *name,
+                        gpointer         user_data)
+{
+	FilteredSubscription *subscription = user_data;
+
+	g_hash_table_remove (subscription->endpoint->filtered_subscriptions,
+	                     GUINT_TO_POINTER (subscription->id));
+}
+
+static guint
+tracker_endpoint_dbus_subscribe_filtered (TrackerEndpointDBus *endpoint_dbus,
+                                          const gchar         *sender,
+                                          const gchar         *graph,
+                                          const gchar * const *classes,
+                                          const gchar * const *properties)
+{
+	FilteredSubscription *subscription;
+	TrackerSparqlConnection *conn;
+
+	conn = tracker_endpoint_get_sparql_connection (TRACKER_ENDPOINT (endpoint_dbus));
+
+	subscription = g_new0 (FilteredSubscription, 1);
+	subscription->endpoint = endpoint_dbus;
+	subscription->sender = g_strdup (sender);
+	subscription->id = ++endpoint_dbus->last_subscription_id;
+
+	/* Each subscriber gets its own notifier, so the filter is
+	 * evaluated as changes are written, and the bus only carries
+	 * the events each subscriber is interested in.
+	 */
+	subscription->notifier = tracker_sparql_connection_create_notifier (conn);
+	tracker_notifier_disable_urn_query (subscription->notifier);
+	tracker_notifier_set_filter (subscription->notifier,
+	                             graph && *graph ? graph : NULL,
+	                             classes, properties);
+	g_signal_connect (subscription->notifier, "events",
+	                  G_CALLBACK (filtered_events_cb), subscription);
+
+	if (sender) {
+		subscription->watch_id =
+			g_bus_watch_name_on_connection (endpoint_dbus->dbus_connection,
+			                                sender,
+			                                G_BUS_NAME_WATCHER_FLAGS_NONE,
+			                                NULL,
+			                                subscriber_vanished_cb,
+			                                subscription, NULL);
+	}
+
+	g_hash_table_insert (endpoint_dbus->filtered_subscriptions,
+	                     GUINT_TO_POINTER (subscription->id),
+	                     subscription);
+
+	return subscription->id;
+}
+
 static void
 endpoint_dbus_iface_method_call (GDBusConnection       *connection,
                                  const gchar           *sender,
@@ -867,7 +1066,45 @@ endpoint_dbus_iface_method_call (GDBusConnection       *connection,
 		}
 
 		g_free (query);
-	} else if (g_strcmp0 (method_name, "UpdateArray") == 0) {
+	} else if (g_strcmp0 (method_name, "Explain") == 0) {
+		TrackerSparqlStatement *stmt;
+		TrackerExplainFlags flags;
+
+		g_variant_get (parameters, "(sa{sv}u)", &query, &arguments, &flags);
+
+		tracker_endpoint_rewrite_query (TRACKER_ENDPOINT (endpoint_dbus),
+		                                &query);
+
+		stmt = tracker_endpoint_cache_select_sparql (TRACKER_ENDPOINT (endpoint_dbus),
+		                                             query,
+		                                             endpoint_dbus->cancellable,
+		                                             &error);
+
+		if (stmt) {
+			GTask *task;
+
+			if (arguments)
+				bind_arguments (stmt, arguments);
+
+			task = g_task_new (stmt, endpoint_dbus->cancellable,
+			                   explain_cb, invocation);
+			g_task_set_task_data (task, GUINT_TO_POINTER (flags), NULL);
+			g_task_run_in_thread (task, handle_explain);
+			g_object_unref (task);
+			g_object_unref (stmt);
+		} else {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			g_error_free (error);
+		}
+
+		g_variant_iter_free (arguments);
+		g_free (query);
+	} else if (g_strcmp0 (method_name, "UpdateArray") == 0 ||
+	           g_strcmp0 (method_name, "UpdateBatch") == 0) {
+		/* UpdateBatch is an UpdateArray that may contain resource
+		 * and statement operations, it exists so clients can detect
+		 * support for these.
+		 */
 		if (tracker_endpoint_get_readonly (TRACKER_ENDPOINT (endpoint_dbus))) {
 			g_dbus_method_invocation_return_error (invocation,
 			                                       G_DBUS_ERROR,
@@ -937,6 +1174,37 @@ endpoint_dbus_iface_method_call (GDBusConnection       *connection,
 			g_task_run_in_thread (task, handle_read_update);
 			g_object_unref (task);
 		}
+	} else if (g_strcmp0 (method_name, "SubscribeFiltered") == 0) {
+		const gchar *graph, **classes, **properties;
+		guint id;
+
+		g_variant_get (parameters, "(&s^a&s^a&s)", &graph, &classes, &properties);
+
+		id = tracker_endpoint_dbus_subscribe_filtered (endpoint_dbus, sender,
+		                                               graph, classes, properties);
+		g_dbus_method_invocation_return_value (invocation,
+		                                       g_variant_new ("(u)", id));
+		g_free (classes);
+		g_free (properties);
+	} else if (g_strcmp0 (method_name, "UnsubscribeFiltered") == 0) {
+		FilteredSubscription *subscription;
+		guint id;
+
+		g_variant_get (parameters, "(u)", &id);
+
+		subscription = g_hash_table_lookup (endpoint_dbus->filtered_subscriptions,
+		                                    GUINT_TO_POINTER (id));
+
+		if (!subscription || g_strcmp0 (subscription->sender, sender) != 0) {
+			g_dbus_method_invocation_return_error (invocation,
+			                                       G_DBUS_ERROR,
+			                                       G_DBUS_ERROR_INVALID_ARGS,
+			                                       "Unknown subscription %u", id);
+		} else {
+			g_hash_table_remove (endpoint_dbus->filtered_subscriptions,
+			                     GUINT_TO_POINTER (id));
+			g_dbus_method_invocation_return_value (invocation, NULL);
+		}
 	} else if (g_strcmp0 (method_name, "Deserialize") == 0) {
 		TrackerDeserializeFlags flags;
 		TrackerRdfFormat format;
@@ -998,26 +1266,12 @@ notifier_events_cb (TrackerNotifier *notifier,
 	TrackerEndpointDBus *endpoint_dbus = user_data;
 	GVariantBuilder builder;
 	GError *error = NULL;
-	guint i;
 
 	if (tracker_endpoint_is_graph_filtered (TRACKER_ENDPOINT (endpoint_dbus), graph))
 		return;
 
 	g_variant_builder_init (&builder, G_VARIANT_TYPE ("(sa{ii})"));
-	g_variant_builder_add (&builder, "s", graph ? graph : "");
-	g_variant_builder_open (&builder, G_VARIANT_TYPE ("a{ii}"));
-
-	for (i = 0; i < events->len; i++) {
-		TrackerNotifierEvent *event;
-		gint event_type, id;
-
-		event = g_ptr_array_index (events, i);
-		event_type = tracker_notifier_event_get_event_type (event);
-		id = tracker_notifier_event_get_id (event);
-		g_variant_builder_add (&builder, "{ii}", event_type, id);
-	}
-
-	g_variant_builder_close (&builder);
+	add_events (&builder, graph, events);
 
 	if (!g_dbus_connection_emit_signal (endpoint_dbus->dbus_connection,
 	                                    NULL,
@@ -1086,6 +1340,7 @@ tracker_endpoint_dbus_finalize (GObject *object)
 		endpoint_dbus->register_id = 0;
 	}
 
+	g_clear_pointer (&endpoint_dbus->filtered_subscriptions, g_hash_table_unref);
 	g_clear_object (&endpoint_dbus->notifier);
 	g_clear_object (&endpoint_dbus->cancellable);
 	g_clear_object (&endpoint_dbus->dbus_connection);
@@ -1196,6 +1451,9 @@ static void
 tracker_endpoint_dbus_init (TrackerEndpointDBus *endpoint)
 {
 	endpoint->cancellable = g_cancellable_new ();
+	endpoint->filtered_subscriptions =
+		g_hash_table_new_full (NULL, NULL, NULL,
+		                       (GDestroyNotify) filtered_subscription_free);
 }
 
 /**
@@ -44,4 +44,19 @@ typedef enum {
 
 #define TRACKER_N_RDF_FORMATS TRACKER_RDF_FORMAT_LAST
 
+/**
+ * TrackerExplainFlags:
+ * @TRACKER_EXPLAIN_FLAGS_NONE: Only translate the query and gather its query plan.
+ * @TRACKER_EXPLAIN_FLAGS_PROFILE: Also run the query to completion, and
+ *   gather timing and execution counters.
+ *
+ * Flags affecting [method@Tracker.SparqlStatement.explain].
+ *
+ * Since: 3.8
+ */
+typedef enum {
+	TRACKER_EXPLAIN_FLAGS_NONE = 0,
+	TRACKER_EXPLAIN_FLAGS_PROFILE = 1 << 0,
+} TrackerExplainFlags;
+
 #endif /* TRACKER_ENUMS_H */
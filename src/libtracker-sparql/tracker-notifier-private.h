@@ -42,6 +42,12 @@ void _tracker_notifier_event_cache_flush_events (TrackerNotifier           *noti
 
 const gchar * tracker_notifier_event_cache_get_graph (TrackerNotifierEventCache *cache);
 
+gboolean tracker_notifier_event_cache_match_graph (TrackerNotifierEventCache *cache);
+gboolean tracker_notifier_event_cache_match_class (TrackerNotifierEventCache *cache,
+                                                   const gchar               *class_uri);
+gboolean tracker_notifier_event_cache_match_property (TrackerNotifierEventCache *cache,
+                                                      const gchar               *property_uri);
+
 void tracker_notifier_disable_urn_query (TrackerNotifier *notifier);
 
 #endif /* __TRACKER_NOTIFIER_PRIVATE_H__ */
@@ -51,6 +51,18 @@
  *
  * The [signal@Tracker.Notifier::events] signal is emitted in the thread-default
  * main context of the thread where the `TrackerNotifier` instance was created.
+ *
+ * Notifiers may be narrowed down to the graphs, classes and properties
+ * of interest through [method@Tracker.Notifier.set_filter]. On local
+ * connections the filter is evaluated as the changes are written, so
+ * no work is spent on events that would be discarded. D-Bus endpoints
+ * are handed the filter, so that they only send the matching events.
+ *
+ * Applications observing frequently changing data may set the
+ * [property@Tracker.Notifier:coalesce-interval] property, so that
+ * events happening within that time window are merged together and
+ * delivered in a single [signal@Tracker.Notifier::events] emission per
+ * graph.
  */
 
 #include "config.h"
@@ -65,6 +77,14 @@
 
 typedef struct _TrackerNotifierPrivate TrackerNotifierPrivate;
 typedef struct _TrackerNotifierSubscription TrackerNotifierSubscription;
+typedef struct _TrackerNotifierFilter TrackerNotifierFilter;
+
+struct _TrackerNotifierFilter {
+	gchar *graph;
+	GHashTable *classes;
+	GHashTable *properties;
+	guint ref_count;
+};
 
 struct _TrackerNotifierSubscription {
 	GDBusConnection *connection;
@@ -73,7 +93,15 @@ struct _TrackerNotifierSubscription {
 	gint n_statement_slots;
 	gchar *service;
 	gchar *object_path;
+	gchar *dbus_name;
+	gchar *dbus_path;
+	gchar *graph;
+	GCancellable *cancellable;
+	guint id;
 	guint handler_id;
+	guint filtered_handler_id;
+	guint filter_id;
+	guint filter_unsupported : 1;
 };
 
 struct _TrackerNotifierPrivate {
@@ -84,6 +112,11 @@ struct _TrackerNotifierPrivate {
 	GAsyncQueue *queue;
 	GMainContext *main_context;
 	gint n_local_statement_slots;
+	TrackerNotifierFilter *filter;
+	GHashTable *pending; /* service+graph -> TrackerNotifierEventCache */
+	GSource *coalesce_source;
+	guint coalesce_interval;
+	guint last_subscription_id;
 	guint querying : 1;
 	guint urn_query_disabled : 1;
 	GMutex mutex;
@@ -95,8 +128,11 @@ struct _TrackerNotifierEventCache {
 	GWeakRef notifier;
 	GCancellable *cancellable;
 	TrackerSparqlStatement *stmt;
+	TrackerNotifierFilter *filter;
 	GSequence *sequence;
 	GSequenceIter *first;
+	GSequenceIter *last;
+	guint use_slots : 1;
 };
 
 struct _TrackerNotifierEvent {
@@ -109,6 +145,7 @@ struct _TrackerNotifierEvent {
 enum {
 	PROP_0,
 	PROP_CONNECTION,
+	PROP_COALESCE_INTERVAL,
 	N_PROPS
 };
 
@@ -135,6 +172,102 @@ static gchar * get_service_name (TrackerNotifier             *notifier,
 static TrackerSparqlStatement * ensure_extra_info_statement (TrackerNotifier             *notifier,
                                                              TrackerNotifierSubscription *subscription);
 
+static gboolean extra_info_uses_slots (TrackerNotifier             *notifier,
+                                       TrackerNotifierSubscription *subscription);
+
+static GHashTable *
+uri_set_new (TrackerNotifier     *notifier,
+             const gchar * const *uris)
+{
+	TrackerNotifierPrivate *priv;
+	TrackerNamespaceManager *namespaces;
+	GHashTable *set;
+	gint i;
+
+	if (!uris || !uris[0])
+		return NULL;
+
+	priv = tracker_notifier_get_instance_private (notifier);
+	namespaces = tracker_sparql_connection_get_namespace_manager (priv->connection);
+	set = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (i = 0; uris[i]; i++) {
+		gchar *expanded = NULL;
+
+		if (namespaces)
+			expanded = tracker_namespace_manager_expand_uri (namespaces, uris[i]);
+		if (!expanded)
+			expanded = g_strdup (uris[i]);
+
+		g_hash_table_add (set, expanded);
+	}
+
+	return set;
+}
+
+static TrackerNotifierFilter *
+tracker_notifier_filter_new (TrackerNotifier     *notifier,
+                             const gchar         *graph,
+                             const gchar * const *classes,
+                             const gchar * const *properties)
+{
+	TrackerNotifierPrivate *priv;
+	TrackerNotifierFilter *filter;
+
+	priv = tracker_notifier_get_instance_private (notifier);
+
+	filter = g_new0 (TrackerNotifierFilter, 1);
+	filter->ref_count = 1;
+	filter->classes = uri_set_new (notifier, classes);
+	filter->properties = uri_set_new (notifier, properties);
+
+	if (graph) {
+		TrackerNamespaceManager *namespaces;
+
+		namespaces = tracker_sparql_connection_get_namespace_manager (priv->connection);
+		if (namespaces)
+			filter->graph = tracker_namespace_manager_expand_uri (namespaces, graph);
+		if (!filter->graph)
+			filter->graph = g_strdup (graph);
+	}
+
+	return filter;
+}
+
+static TrackerNotifierFilter *
+tracker_notifier_filter_ref (TrackerNotifierFilter *filter)
+{
+	g_atomic_int_inc (&filter->ref_count);
+	return filter;
+}
+
+static void
+tracker_notifier_filter_unref (TrackerNotifierFilter *filter)
+{
+	if (g_atomic_int_dec_and_test (&filter->ref_count)) {
+		g_clear_pointer (&filter->classes, g_hash_table_unref);
+		g_clear_pointer (&filter->properties, g_hash_table_unref);
+		g_free (filter->graph);
+		g_free (filter);
+	}
+}
+
+static TrackerNotifierFilter *
+tracker_notifier_dup_filter (TrackerNotifier *notifier)
+{
+	TrackerNotifierPrivate *priv;
+	TrackerNotifierFilter *filter = NULL;
+
+	priv = tracker_notifier_get_instance_private (notifier);
+
+	g_mutex_lock (&priv->mutex);
+	if (priv->filter)
+		filter = tracker_notifier_filter_ref (priv->filter);
+	g_mutex_unlock (&priv->mutex);
+
+	return filter;
+}
+
 static TrackerNotifierSubscription *
 tracker_notifier_subscription_new (TrackerNotifier *notifier,
                                    GDBusConnection *connection,
@@ -152,15 +285,47 @@ tracker_notifier_subscription_new (TrackerNotifier *notifier,
 	return subscription;
 }
 
+static void
+tracker_notifier_subscription_unsubscribe_filtered (TrackerNotifierSubscription *subscription)
+{
+	if (subscription->filter_id == 0)
+		return;
+
+	g_dbus_connection_call (subscription->connection,
+	                        subscription->dbus_name,
+	                        subscription->dbus_path,
+	                        "org.freedesktop.Tracker3.Endpoint",
+	                        "UnsubscribeFiltered",
+	                        g_variant_new ("(u)", subscription->filter_id),
+	                        NULL,
+	                        G_DBUS_CALL_FLAGS_NO_AUTO_START,
+	                        -1, NULL, NULL, NULL);
+	subscription->filter_id = 0;
+}
+
 static void
 tracker_notifier_subscription_free (TrackerNotifierSubscription *subscription)
 {
-	g_dbus_connection_signal_unsubscribe (subscription->connection,
-	                                      subscription->handler_id);
+	g_cancellable_cancel (subscription->cancellable);
+	tracker_notifier_subscription_unsubscribe_filtered (subscription);
+
+	if (subscription->handler_id) {
+		g_dbus_connection_signal_unsubscribe (subscription->connection,
+		                                      subscription->handler_id);
+	}
+	if (subscription->filtered_handler_id) {
+		g_dbus_connection_signal_unsubscribe (subscription->connection,
+		                                      subscription->filtered_handler_id);
+	}
+
 	g_object_unref (subscription->connection);
 	g_clear_object (&subscription->statement);
+	g_clear_object (&subscription->cancellable);
 	g_free (subscription->service);
 	g_free (subscription->object_path);
+	g_free (subscription->dbus_name);
+	g_free (subscription->dbus_path);
+	g_free (subscription->graph);
 	g_free (subscription);
 }
 
@@ -222,6 +387,8 @@ _tracker_notifier_event_cache_new_full (TrackerNotifier             *notifier,
 	event_cache->cancellable = g_object_ref (priv->cancellable);
 	event_cache->sequence = g_sequence_new ((GDestroyNotify) tracker_notifier_event_unref);
 	event_cache->stmt = ensure_extra_info_statement (notifier, subscription);
+	event_cache->use_slots = extra_info_uses_slots (notifier, subscription);
+	event_cache->filter = tracker_notifier_dup_filter (notifier);
 
 	if (subscription)
 		event_cache->service = get_service_name (notifier, subscription);
@@ -242,6 +409,7 @@ _tracker_notifier_event_cache_free (TrackerNotifierEventCache *event_cache)
 	g_sequence_free (event_cache->sequence);
 	g_weak_ref_clear (&event_cache->notifier);
 	g_object_unref (event_cache->cancellable);
+	g_clear_pointer (&event_cache->filter, tracker_notifier_filter_unref);
 	g_free (event_cache->service);
 	g_free (event_cache->graph);
 	g_free (event_cache);
@@ -295,6 +463,38 @@ tracker_notifier_event_cache_get_graph (TrackerNotifierEventCache *cache)
 	return cache->graph ? cache->graph : "";
 }
 
+/* The filter is snapshot on event cache creation, so these may be
+ * used from the writer thread without further locking.
+ */
+gboolean
+tracker_notifier_event_cache_match_graph (TrackerNotifierEventCache *cache)
+{
+	if (!cache->filter || !cache->filter->graph)
+		return TRUE;
+
+	return g_strcmp0 (cache->filter->graph, cache->graph) == 0;
+}
+
+gboolean
+tracker_notifier_event_cache_match_class (TrackerNotifierEventCache *cache,
+                                          const gchar               *class_uri)
+{
+	if (!cache->filter || !cache->filter->classes)
+		return TRUE;
+
+	return g_hash_table_contains (cache->filter->classes, class_uri);
+}
+
+gboolean
+tracker_notifier_event_cache_match_property (TrackerNotifierEventCache *cache,
+                                             const gchar               *property_uri)
+{
+	if (!cache->filter || !cache->filter->properties)
+		return TRUE;
+
+	return g_hash_table_contains (cache->filter->properties, property_uri);
+}
+
 static void
 handle_events (TrackerNotifier           *notifier,
                TrackerNotifierEventCache *cache,
@@ -379,6 +579,38 @@ get_service_name (TrackerNotifier             *notifier,
 	return compose_uri (subscription->service, subscription->object_path);
 }
 
+static gboolean
+is_dbus_connection (TrackerNotifier *notifier)
+{
+	TrackerNotifierPrivate *priv;
+
+	priv = tracker_notifier_get_instance_private (notifier);
+
+	/* Same hack as get_service_name() */
+	return g_object_class_find_property (G_OBJECT_GET_CLASS (priv->connection),
+	                                     "bus-name") != NULL;
+}
+
+/* Endpoints from earlier releases do not handle array parameters,
+ * so queries going through D-Bus bind the IDs in fixed slots.
+ */
+static gboolean
+extra_info_uses_slots (TrackerNotifier             *notifier,
+                       TrackerNotifierSubscription *subscription)
+{
+	gchar *service;
+	gboolean use_slots;
+
+	if (is_dbus_connection (notifier))
+		return TRUE;
+
+	service = get_service_name (notifier, subscription);
+	use_slots = service != NULL;
+	g_free (service);
+
+	return use_slots;
+}
+
 static gboolean
 tracker_notifier_emit_events (TrackerNotifierEventCache *cache)
 {
@@ -438,14 +670,18 @@ create_extra_info_query (TrackerNotifier             *notifier,
 		                        service);
 	}
 
-	g_string_append (sparql, "{ VALUES ?id { ");
+	if (extra_info_uses_slots (notifier, subscription)) {
+		g_string_append (sparql, "{ VALUES ?id { ");
+
+		for (i = 0; i < N_SLOTS; i++)
+			g_string_append_printf (sparql, "~arg%d ", i + 1);
 
-	for (i = 0; i < N_SLOTS; i++) {
-		g_string_append_printf (sparql, "~arg%d ", i + 1);
+		g_string_append (sparql, "} .");
+	} else {
+		g_string_append (sparql, "{ VALUES ?id { ~ids } .");
 	}
 
 	g_string_append (sparql,
-	                 "  } ."
 	                 "  BIND (tracker:uri(xsd:integer(?id)) AS ?uri) ."
 	                 "  FILTER (?id > 0) ."
 	                 "} ");
@@ -507,29 +743,35 @@ handle_cursor (GTask        *task,
 	TrackerSparqlCursor *cursor = source_object;
 	TrackerNotifier *notifier;
 	TrackerNotifierPrivate *priv;
-	TrackerNotifierEvent *event;
+	TrackerNotifierEvent *event = NULL;
+	TrackerNotifierEventCache *next;
 	GSequenceIter *iter;
 	gint64 id;
 
 	iter = cache->first;
 
-	/* We rely here in both the GPtrArray and the query items being
-	 * sorted by tracker:id, the former will be so because the way it's
-	 * extracted from the GSequence, the latter because of the ORDER BY
-	 * clause.
+	/* We rely here in both the GSequence and the query items being
+	 * sorted by tracker:id, the former will be so because of the
+	 * insertion order, the latter because of the ORDER BY clause.
 	 */
 	while (tracker_sparql_cursor_next (cursor, cancellable, NULL)) {
 		id = tracker_sparql_cursor_get_integer (cursor, 0);
-		event = g_sequence_get (iter);
-		iter = g_sequence_iter_next (iter);
 
-		if (!event || event->id != id) {
+		while (!g_sequence_iter_is_end (iter)) {
+			event = g_sequence_get (iter);
+			if (event->id >= id)
+				break;
+			iter = g_sequence_iter_next (iter);
+		}
+
+		if (g_sequence_iter_is_end (iter) || event->id != id) {
 			g_critical ("Queried for id %" G_GINT64_FORMAT " but it is not "
 			            "found, bailing out", id);
 			break;
 		}
 
 		event->urn = g_strdup (tracker_sparql_cursor_get_string (cursor, 1, NULL));
+		iter = g_sequence_iter_next (iter);
 	}
 
 	tracker_sparql_cursor_close (cursor);
@@ -546,24 +788,26 @@ handle_cursor (GTask        *task,
 	}
 
 	priv = tracker_notifier_get_instance_private (notifier);
-	cache->first = iter;
-
-	if (g_sequence_iter_is_end (cache->first)) {
-		TrackerNotifierEventCache *next;
 
-		tracker_notifier_emit_events_in_idle (notifier, cache);
-
-		g_async_queue_lock (priv->queue);
-		next = g_async_queue_try_pop_unlocked (priv->queue);
-		if (next)
-			tracker_notifier_query_extra_info (notifier, next);
-		else
-			priv->querying = FALSE;
-		g_async_queue_unlock (priv->queue);
-	} else {
+	if (cache->use_slots && !g_sequence_iter_is_end (cache->last)) {
+		/* Query the next batch of slots */
+		cache->first = cache->last;
 		tracker_notifier_query_extra_info (notifier, cache);
+		g_task_return_boolean (task, TRUE);
+		g_object_unref (notifier);
+		return;
 	}
 
+	tracker_notifier_emit_events_in_idle (notifier, cache);
+
+	g_async_queue_lock (priv->queue);
+	next = g_async_queue_try_pop_unlocked (priv->queue);
+	if (next)
+		tracker_notifier_query_extra_info (notifier, next);
+	else
+		priv->querying = FALSE;
+	g_async_queue_unlock (priv->queue);
+
 	g_task_return_boolean (task, TRUE);
 	g_object_unref (notifier);
 }
@@ -621,8 +865,8 @@ query_extra_info_cb (GObject      *object,
 }
 
 static void
-bind_arguments (TrackerSparqlStatement    *statement,
-                TrackerNotifierEventCache *cache)
+bind_slot_arguments (TrackerSparqlStatement    *statement,
+                     TrackerNotifierEventCache *cache)
 {
 	GSequenceIter *iter;
 	gchar *arg_name;
@@ -643,6 +887,8 @@ bind_arguments (TrackerSparqlStatement    *statement,
 		i++;
 	}
 
+	cache->last = iter;
+
 	/* Fill in missing slots with 0's */
 	while (i < N_SLOTS) {
 		arg_name = g_strdup_printf ("arg%d", i + 1);
@@ -652,6 +898,39 @@ bind_arguments (TrackerSparqlStatement    *statement,
 	}
 }
 
+static void
+bind_arguments (TrackerSparqlStatement    *statement,
+                TrackerNotifierEventCache *cache)
+{
+	GSequenceIter *iter;
+	GArray *ids;
+
+	if (cache->use_slots) {
+		bind_slot_arguments (statement, cache);
+		return;
+	}
+
+	ids = g_array_sized_new (FALSE, FALSE, sizeof (gint64),
+	                         g_sequence_get_length (cache->sequence));
+
+	for (iter = g_sequence_get_begin_iter (cache->sequence);
+	     !g_sequence_iter_is_end (iter);
+	     iter = g_sequence_iter_next (iter)) {
+		TrackerNotifierEvent *event;
+
+		event = g_sequence_get (iter);
+		g_array_append_val (ids, event->id);
+	}
+
+	tracker_sparql_statement_clear_bindings (statement);
+	tracker_sparql_statement_bind_int_array (statement, "ids",
+	                                         (const gint64 *) ids->data,
+	                                         ids->len);
+	g_array_unref (ids);
+
+	cache->last = iter;
+}
+
 static void
 tracker_notifier_query_extra_info (TrackerNotifier           *notifier,
                                    TrackerNotifierEventCache *cache)
@@ -671,17 +950,12 @@ tracker_notifier_query_extra_info (TrackerNotifier           *notifier,
 	g_mutex_unlock (&priv->mutex);
 }
 
-void
-_tracker_notifier_event_cache_flush_events (TrackerNotifier           *notifier,
-                                            TrackerNotifierEventCache *cache)
+static void
+tracker_notifier_dispatch_events (TrackerNotifier           *notifier,
+                                  TrackerNotifierEventCache *cache)
 {
 	TrackerNotifierPrivate *priv = tracker_notifier_get_instance_private (notifier);
 
-	if (g_sequence_is_empty (cache->sequence)) {
-		_tracker_notifier_event_cache_free (cache);
-		return;
-	}
-
 	cache->first = g_sequence_get_begin_iter (cache->sequence);
 
 	g_async_queue_lock (priv->queue);
@@ -696,6 +970,104 @@ _tracker_notifier_event_cache_flush_events (TrackerNotifier           *notifier,
 	g_async_queue_unlock (priv->queue);
 }
 
+static gboolean
+coalesce_timeout_cb (gpointer user_data)
+{
+	TrackerNotifier *notifier = user_data;
+	TrackerNotifierPrivate *priv = tracker_notifier_get_instance_private (notifier);
+	TrackerNotifierEventCache *cache;
+	GHashTable *pending;
+	GHashTableIter iter;
+
+	g_mutex_lock (&priv->mutex);
+	pending = g_steal_pointer (&priv->pending);
+	g_clear_pointer (&priv->coalesce_source, g_source_unref);
+	g_mutex_unlock (&priv->mutex);
+
+	if (pending) {
+		g_hash_table_iter_init (&iter, pending);
+
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &cache)) {
+			g_hash_table_iter_steal (&iter);
+			tracker_notifier_dispatch_events (notifier, cache);
+		}
+
+		g_hash_table_unref (pending);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Merges the events into the ones pending for the same service and
+ * graph, a single emission (and URN query) happens for all of them
+ * once the coalesce interval elapses.
+ */
+static void
+tracker_notifier_coalesce_events (TrackerNotifier           *notifier,
+                                  TrackerNotifierEventCache *cache)
+{
+	TrackerNotifierPrivate *priv = tracker_notifier_get_instance_private (notifier);
+	TrackerNotifierEventCache *pending_cache;
+	gchar *key;
+
+	key = g_strconcat (cache->service ? cache->service : "", " ",
+	                   tracker_notifier_event_cache_get_graph (cache), NULL);
+
+	g_mutex_lock (&priv->mutex);
+
+	if (!priv->pending) {
+		priv->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+		                                       (GDestroyNotify) _tracker_notifier_event_cache_free);
+	}
+
+	pending_cache = g_hash_table_lookup (priv->pending, key);
+
+	if (pending_cache) {
+		GSequenceIter *iter;
+
+		for (iter = g_sequence_get_begin_iter (cache->sequence);
+		     !g_sequence_iter_is_end (iter);
+		     iter = g_sequence_iter_next (iter)) {
+			TrackerNotifierEvent *event = g_sequence_get (iter);
+
+			_tracker_notifier_event_cache_push_event (pending_cache,
+			                                          event->id,
+			                                          event->type);
+		}
+
+		_tracker_notifier_event_cache_free (cache);
+		g_free (key);
+	} else {
+		g_hash_table_insert (priv->pending, key, cache);
+	}
+
+	if (!priv->coalesce_source) {
+		priv->coalesce_source = g_timeout_source_new (priv->coalesce_interval);
+		g_source_set_callback (priv->coalesce_source,
+		                       coalesce_timeout_cb, notifier, NULL);
+		g_source_attach (priv->coalesce_source, priv->main_context);
+	}
+
+	g_mutex_unlock (&priv->mutex);
+}
+
+void
+_tracker_notifier_event_cache_flush_events (TrackerNotifier           *notifier,
+                                            TrackerNotifierEventCache *cache)
+{
+	TrackerNotifierPrivate *priv = tracker_notifier_get_instance_private (notifier);
+
+	if (g_sequence_is_empty (cache->sequence)) {
+		_tracker_notifier_event_cache_free (cache);
+		return;
+	}
+
+	if (priv->coalesce_interval > 0)
+		tracker_notifier_coalesce_events (notifier, cache);
+	else
+		tracker_notifier_dispatch_events (notifier, cache);
+}
+
 static void
 graph_updated_cb (GDBusConnection *connection,
                   const gchar     *sender_name,
@@ -719,12 +1091,189 @@ graph_updated_cb (GDBusConnection *connection,
 	g_variant_get (parameters, "(&sa{ii})", &graph, &events);
 
 	cache = _tracker_notifier_event_cache_new_full (notifier, subscription, graph);
-	handle_events (notifier, cache, events);
+
+	/* D-Bus events carry no class or property information, only
+	 * the graph filter can be honored here. This is only used for
+	 * endpoints that do not support filtered subscriptions.
+	 */
+	if (tracker_notifier_event_cache_match_graph (cache))
+		handle_events (notifier, cache, events);
+
 	g_variant_iter_free (events);
 
 	_tracker_notifier_event_cache_flush_events (notifier, cache);
 }
 
+static void
+filtered_graph_updated_cb (GDBusConnection *connection,
+                           const gchar     *sender_name,
+                           const gchar     *object_path,
+                           const gchar     *interface_name,
+                           const gchar     *signal_name,
+                           GVariant        *parameters,
+                           gpointer         user_data)
+{
+	TrackerNotifierSubscription *subscription = user_data;
+	TrackerNotifier *notifier = subscription->notifier;
+	TrackerNotifierPrivate *priv =
+		tracker_notifier_get_instance_private (notifier);
+	TrackerNotifierEventCache *cache;
+	GVariantIter *events;
+	const gchar *graph;
+	guint filter_id;
+
+	if (g_cancellable_is_cancelled (priv->cancellable))
+		return;
+
+	g_variant_get (parameters, "(u&sa{ii})", &filter_id, &graph, &events);
+
+	/* Events for other (or former) subscriptions of this process */
+	if (filter_id == 0 || filter_id != subscription->filter_id) {
+		g_variant_iter_free (events);
+		return;
+	}
+
+	/* The endpoint already applied the filter */
+	if (!subscription->graph || g_strcmp0 (subscription->graph, graph) == 0) {
+		cache = _tracker_notifier_event_cache_new_full (notifier, subscription, graph);
+		handle_events (notifier, cache, events);
+		_tracker_notifier_event_cache_flush_events (notifier, cache);
+	}
+
+	g_variant_iter_free (events);
+}
+
+static void
+tracker_notifier_subscription_subscribe_broadcast (TrackerNotifierSubscription *subscription)
+{
+	if (subscription->handler_id)
+		return;
+
+	subscription->handler_id =
+		g_dbus_connection_signal_subscribe (subscription->connection,
+		                                    subscription->dbus_name,
+		                                    "org.freedesktop.Tracker3.Endpoint",
+		                                    "GraphUpdated",
+		                                    subscription->dbus_path,
+		                                    subscription->graph,
+		                                    G_DBUS_SIGNAL_FLAGS_NONE,
+		                                    graph_updated_cb,
+		                                    subscription, NULL);
+}
+
+static void
+subscribe_filtered_cb (GObject      *source,
+                       GAsyncResult *res,
+                       gpointer      user_data)
+{
+	TrackerNotifierSubscription *subscription;
+	GVariant *reply;
+	GError *error = NULL;
+
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source),
+	                                       res, &error);
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_error_free (error);
+		return;
+	}
+
+	subscription = user_data;
+
+	if (error) {
+		/* Older endpoints, keep listening to all events */
+		if (!g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+			g_warning ("Could not subscribe to filtered events: %s", error->message);
+
+		subscription->filter_unsupported = TRUE;
+		g_error_free (error);
+		return;
+	}
+
+	g_variant_get (reply, "(u)", &subscription->filter_id);
+	g_variant_unref (reply);
+
+	/* The broadcast signal was kept until now, so no events are
+	 * missed while the subscription was being set up.
+	 */
+	if (subscription->handler_id) {
+		g_dbus_connection_signal_unsubscribe (subscription->connection,
+		                                      subscription->handler_id);
+		subscription->handler_id = 0;
+	}
+}
+
+static GVariant *
+uri_set_to_variant (GHashTable *set)
+{
+	GVariantBuilder builder;
+	GHashTableIter iter;
+	gpointer key;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
+
+	if (set) {
+		g_hash_table_iter_init (&iter, set);
+		while (g_hash_table_iter_next (&iter, &key, NULL))
+			g_variant_builder_add (&builder, "s", key);
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+static void
+tracker_notifier_subscription_update_filter (TrackerNotifierSubscription *subscription,
+                                             TrackerNotifierFilter       *filter)
+{
+	const gchar *graph = NULL;
+
+	if (subscription->cancellable) {
+		g_cancellable_cancel (subscription->cancellable);
+		g_clear_object (&subscription->cancellable);
+	}
+
+	tracker_notifier_subscription_unsubscribe_filtered (subscription);
+	tracker_notifier_subscription_subscribe_broadcast (subscription);
+
+	if (!filter || subscription->filter_unsupported)
+		return;
+
+	if (!subscription->filtered_handler_id) {
+		subscription->filtered_handler_id =
+			g_dbus_connection_signal_subscribe (subscription->connection,
+			                                    subscription->dbus_name,
+			                                    "org.freedesktop.Tracker3.Endpoint",
+			                                    "FilteredGraphUpdated",
+			                                    subscription->dbus_path,
+			                                    NULL,
+			                                    G_DBUS_SIGNAL_FLAGS_NONE,
+			                                    filtered_graph_updated_cb,
+			                                    subscription, NULL);
+	}
+
+	if (filter->graph)
+		graph = filter->graph;
+	else if (subscription->graph)
+		graph = subscription->graph;
+
+	subscription->cancellable = g_cancellable_new ();
+	g_dbus_connection_call (subscription->connection,
+	                        subscription->dbus_name,
+	                        subscription->dbus_path,
+	                        "org.freedesktop.Tracker3.Endpoint",
+	                        "SubscribeFiltered",
+	                        g_variant_new ("(s@as@as)",
+	                                       graph ? graph : "",
+	                                       uri_set_to_variant (filter->classes),
+	                                       uri_set_to_variant (filter->properties)),
+	                        G_VARIANT_TYPE ("(u)"),
+	                        G_DBUS_CALL_FLAGS_NO_AUTO_START,
+	                        -1,
+	                        subscription->cancellable,
+	                        subscribe_filtered_cb,
+	                        subscription);
+}
+
 static void
 tracker_notifier_set_property (GObject      *object,
                                guint         prop_id,
@@ -738,6 +1287,9 @@ tracker_notifier_set_property (GObject      *object,
 	case PROP_CONNECTION:
 		priv->connection = g_value_dup_object (value);
 		break;
+	case PROP_COALESCE_INTERVAL:
+		priv->coalesce_interval = g_value_get_uint (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -757,6 +1309,9 @@ tracker_notifier_get_property (GObject    *object,
 	case PROP_CONNECTION:
 		g_value_set_object (value, priv->connection);
 		break;
+	case PROP_COALESCE_INTERVAL:
+		g_value_set_uint (value, priv->coalesce_interval);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -771,8 +1326,16 @@ tracker_notifier_finalize (GObject *object)
 	priv = tracker_notifier_get_instance_private (TRACKER_NOTIFIER (object));
 
 	g_cancellable_cancel (priv->cancellable);
+
+	if (priv->coalesce_source) {
+		g_source_destroy (priv->coalesce_source);
+		g_clear_pointer (&priv->coalesce_source, g_source_unref);
+	}
+
+	g_clear_pointer (&priv->pending, g_hash_table_unref);
 	g_clear_object (&priv->cancellable);
 	g_clear_object (&priv->local_statement);
+	g_clear_pointer (&priv->filter, tracker_notifier_filter_unref);
 	g_async_queue_unref (priv->queue);
 
 	if (priv->connection)
@@ -825,6 +1388,25 @@ tracker_notifier_class_init (TrackerNotifierClass *klass)
 		                     G_PARAM_READWRITE |
 		                     G_PARAM_STATIC_STRINGS |
 		                     G_PARAM_CONSTRUCT_ONLY);
+	/**
+	 * TrackerNotifier:coalesce-interval:
+	 *
+	 * Time window in milliseconds during which events are accumulated
+	 * before being emitted. Events on the same resource happening within
+	 * the window are merged into one, keeping the latest event type
+	 * (updates following a creation are still notified as a creation).
+	 *
+	 * The default value of 0 emits events as soon as changes are committed.
+	 *
+	 * Since: 3.8
+	 */
+	pspecs[PROP_COALESCE_INTERVAL] =
+		g_param_spec_uint ("coalesce-interval",
+		                   "Coalesce interval",
+		                   "Coalesce interval",
+		                   0, G_MAXUINT, 0,
+		                   G_PARAM_READWRITE |
+		                   G_PARAM_STATIC_STRINGS);
 
 	g_object_class_install_properties (object_class, N_PROPS, pspecs);
 }
@@ -877,6 +1459,7 @@ tracker_notifier_signal_subscribe (TrackerNotifier *notifier,
                                    const gchar     *graph)
 {
 	TrackerNotifierSubscription *subscription;
+	TrackerNotifierFilter *filter;
 	TrackerNotifierPrivate *priv;
 	gchar *dbus_name = NULL, *dbus_path = NULL, *full_graph = NULL;
 
@@ -910,26 +1493,20 @@ tracker_notifier_signal_subscribe (TrackerNotifier *notifier,
 	subscription = tracker_notifier_subscription_new (notifier, connection,
 	                                                  service, object_path);
 
-	subscription->handler_id =
-		g_dbus_connection_signal_subscribe (connection,
-		                                    dbus_name ? dbus_name : service,
-		                                    "org.freedesktop.Tracker3.Endpoint",
-		                                    "GraphUpdated",
-		                                    dbus_path ? dbus_path : object_path,
-		                                    full_graph ? full_graph : graph,
-		                                    G_DBUS_SIGNAL_FLAGS_NONE,
-		                                    graph_updated_cb,
-		                                    subscription, NULL);
+	subscription->id = ++priv->last_subscription_id;
+	subscription->dbus_name = dbus_name ? dbus_name : g_strdup (service);
+	subscription->dbus_path = dbus_path ? dbus_path : g_strdup (object_path);
+	subscription->graph = full_graph ? full_graph : g_strdup (graph);
+
+	filter = tracker_notifier_dup_filter (notifier);
+	tracker_notifier_subscription_update_filter (subscription, filter);
+	g_clear_pointer (&filter, tracker_notifier_filter_unref);
 
 	g_hash_table_insert (priv->subscriptions,
-	                     GUINT_TO_POINTER (subscription->handler_id),
+	                     GUINT_TO_POINTER (subscription->id),
 	                     subscription);
 
-	g_free (dbus_name);
-	g_free (dbus_path);
-	g_free (full_graph);
-
-	return subscription->handler_id;
+	return subscription->id;
 }
 
 /**
@@ -955,6 +1532,63 @@ tracker_notifier_signal_unsubscribe (TrackerNotifier *notifier,
 	g_hash_table_remove (priv->subscriptions, GUINT_TO_POINTER (handler_id));
 }
 
+/**
+ * tracker_notifier_set_filter:
+ * @notifier: A `TrackerNotifier`
+ * @graph: (nullable): Graph to listen events for, or %NULL
+ * @classes: (nullable) (array zero-terminated=1): Classes to listen events for, or %NULL
+ * @properties: (nullable) (array zero-terminated=1): Properties to listen updates for, or %NULL
+ *
+ * Restricts the events notified by @notifier to those happening on @graph,
+ * on resources of any of the given @classes, and, for
+ * %TRACKER_NOTIFIER_EVENT_UPDATE events, on changes to any of the given
+ * @properties. Creation and deletion of resources is always notified if
+ * the other criteria match. Prefixed names may be used for all arguments.
+ *
+ * A %NULL or empty filter criteria matches everything. Classes still
+ * need the [nrl:notify](nrl-ontology.html#nrl:notify) property in order
+ * to be notified upon.
+ *
+ * On local connections, the filter is applied as changes are written to
+ * the database, so events that do not match are never generated. For
+ * D-Bus subscriptions, the filter is handed over to the endpoint, so that
+ * only the matching events are sent over the bus. Endpoints that do not support
+ * filtered subscriptions send all events, and only the @graph criteria can
+ * be applied to those.
+ *
+ * The filter applies to changes happening after this call, and replaces
+ * any previous filter.
+ *
+ * Since: 3.8
+ **/
+void
+tracker_notifier_set_filter (TrackerNotifier     *notifier,
+                             const gchar         *graph,
+                             const gchar * const *classes,
+                             const gchar * const *properties)
+{
+	TrackerNotifierPrivate *priv;
+	TrackerNotifierFilter *filter = NULL;
+	TrackerNotifierSubscription *subscription;
+	GHashTableIter iter;
+
+	g_return_if_fail (TRACKER_IS_NOTIFIER (notifier));
+
+	priv = tracker_notifier_get_instance_private (notifier);
+
+	if (graph || (classes && classes[0]) || (properties && properties[0]))
+		filter = tracker_notifier_filter_new (notifier, graph, classes, properties);
+
+	g_mutex_lock (&priv->mutex);
+	g_clear_pointer (&priv->filter, tracker_notifier_filter_unref);
+	priv->filter = filter;
+	g_mutex_unlock (&priv->mutex);
+
+	g_hash_table_iter_init (&iter, priv->subscriptions);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &subscription))
+		tracker_notifier_subscription_update_filter (subscription, filter);
+}
+
 gpointer
 _tracker_notifier_get_connection (TrackerNotifier *notifier)
 {
@@ -67,6 +67,12 @@ TRACKER_AVAILABLE_IN_ALL
 void  tracker_notifier_signal_unsubscribe (TrackerNotifier *notifier,
                                            guint            handler_id);
 
+TRACKER_AVAILABLE_IN_3_8
+void  tracker_notifier_set_filter         (TrackerNotifier     *notifier,
+                                           const gchar         *graph,
+                                           const gchar * const *classes,
+                                           const gchar * const *properties);
+
 TRACKER_AVAILABLE_IN_ALL
 GType tracker_notifier_event_get_type (void) G_GNUC_CONST;
 
@@ -143,6 +143,13 @@ struct _TrackerSparqlConnectionClass
 	                         TrackerSparqlConnection  *service_connection);
 };
 
+typedef struct {
+	TrackerSparqlValueType value_type;
+	const gchar *str;
+	const gchar *langtag;
+	glong length;
+} TrackerSparqlCursorValue;
+
 struct _TrackerSparqlCursorClass
 {
 	GObjectClass parent_class;
@@ -178,6 +185,9 @@ struct _TrackerSparqlCursorClass
         gboolean (* is_bound) (TrackerSparqlCursor *cursor,
                                gint                 column);
         gint (* get_n_columns) (TrackerSparqlCursor *cursor);
+        gint (* get_values) (TrackerSparqlCursor      *cursor,
+                             TrackerSparqlCursorValue *values,
+                             gint                      n_values);
 };
 
 struct _TrackerEndpointClass {
@@ -192,6 +202,8 @@ struct _TrackerEndpointDBus {
 	GDBusNodeInfo *node_info;
 	GCancellable *cancellable;
 	TrackerNotifier *notifier;
+	GHashTable *filtered_subscriptions; /* guint -> FilteredSubscription */
+	guint last_subscription_id;
 };
 
 typedef struct _TrackerEndpointDBusClass TrackerEndpointDBusClass;
@@ -234,6 +246,10 @@ struct _TrackerSparqlStatementClass
 	                          const gchar            *name,
 	                          const gchar            *value,
 	                          const gchar            *langtag);
+	void (* bind_int_array) (TrackerSparqlStatement *stmt,
+	                         const gchar            *name,
+	                         const gint64           *values,
+	                         gsize                   n_values);
 
         TrackerSparqlCursor * (* execute) (TrackerSparqlStatement  *stmt,
                                            GCancellable            *cancellable,
@@ -267,6 +283,10 @@ struct _TrackerSparqlStatementClass
         gboolean (* update_finish) (TrackerSparqlStatement  *stmt,
                                     GAsyncResult            *res,
                                     GError                 **error);
+	GVariant * (* explain) (TrackerSparqlStatement  *stmt,
+	                        TrackerExplainFlags      flags,
+	                        GCancellable            *cancellable,
+	                        GError                 **error);
 };
 
 struct _TrackerNotifierClass {
@@ -340,6 +360,9 @@ tracker_sparql_connection_lookup_dbus_service (TrackerSparqlConnection  *connect
                                                gchar                   **path);
 void tracker_sparql_cursor_set_connection (TrackerSparqlCursor     *cursor,
                                            TrackerSparqlConnection *connection);
+gint tracker_sparql_cursor_get_values (TrackerSparqlCursor      *cursor,
+                                       TrackerSparqlCursorValue *values,
+                                       gint                      n_values);
 GError * _translate_internal_error (GError *error);
 
 void tracker_namespace_manager_seal (TrackerNamespaceManager *namespaces);
@@ -352,6 +375,10 @@ gboolean tracker_resource_iterator_next (TrackerResourceIterator  *iter,
 const gchar * tracker_resource_get_identifier_internal (TrackerResource *resource);
 gboolean tracker_resource_is_blank_node (TrackerResource *resource);
 
+GBytes * tracker_resource_serialize_graph (TrackerResource *resource);
+GPtrArray * tracker_resource_deserialize_graph (GBytes  *bytes,
+                                                GError **error);
+
 void tracker_endpoint_rewrite_query (TrackerEndpoint  *endpoint,
                                      gchar           **query);
 
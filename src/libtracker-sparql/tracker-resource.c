@@ -24,6 +24,8 @@
 
 #include <string.h>
 
+#include <libtracker-common/tracker-common.h>
+
 #include <tracker-deserializer-resource.h>
 #include <tracker-uri.h>
 #include <tracker-resource.h>
@@ -2058,3 +2060,357 @@ tracker_resource_is_blank_node (TrackerResource *resource)
 
 	return strncmp (priv->identifier, "_:", 2) == 0;
 }
+
+/* Lossless encoding of a resource tree, used for transferring resources
+ * in bus batches. Unlike tracker_resource_serialize(), it preserves blank
+ * node labels, overwrite flags, date-times, and relations that are shared
+ * or cyclic.
+ *
+ * The resource tree is flattened into an array of nodes, the first one
+ * being the root resource. Each node contains its identifier (empty for
+ * anonymous blank nodes) and the list of properties, each of these with
+ * its overwrite flag and values. Relations are stored as "u" indexes in
+ * the node array, URIs as bytestrings, and date-times as a "(s)" tuple
+ * holding an ISO 8601 string.
+ */
+#define RESOURCE_NODE_TYPE "(sa(sbav))"
+#define RESOURCE_GRAPH_TYPE "a" RESOURCE_NODE_TYPE
+
+static gboolean
+serialize_graph_value (GVariantBuilder *builder,
+                       const GValue    *value,
+                       GHashTable      *indexes,
+                       GPtrArray       *nodes)
+{
+	GVariant *variant;
+
+	if (G_VALUE_HOLDS_BOOLEAN (value)) {
+		variant = g_variant_new_boolean (g_value_get_boolean (value));
+	} else if (G_VALUE_HOLDS_INT (value)) {
+		variant = g_variant_new_int32 (g_value_get_int (value));
+	} else if (G_VALUE_HOLDS_INT64 (value)) {
+		variant = g_variant_new_int64 (g_value_get_int64 (value));
+	} else if (G_VALUE_HOLDS_DOUBLE (value)) {
+		variant = g_variant_new_double (g_value_get_double (value));
+	} else if (G_VALUE_HOLDS (value, TRACKER_TYPE_URI)) {
+		variant = g_variant_new_bytestring (g_value_get_string (value));
+	} else if (G_VALUE_HOLDS_STRING (value)) {
+		const gchar *str = g_value_get_string (value);
+
+		if (!str || !g_utf8_validate (str, -1, NULL))
+			return FALSE;
+
+		variant = g_variant_new_string (str);
+	} else if (G_VALUE_HOLDS (value, G_TYPE_DATE_TIME)) {
+		gchar *str;
+
+		str = tracker_date_format_iso8601 (g_value_get_boxed (value));
+		variant = g_variant_new ("(s)", str);
+		g_free (str);
+	} else if (G_VALUE_HOLDS (value, TRACKER_TYPE_RESOURCE)) {
+		TrackerResource *child = g_value_get_object (value);
+		guint idx;
+
+		idx = GPOINTER_TO_UINT (g_hash_table_lookup (indexes, child));
+
+		if (idx == 0) {
+			g_ptr_array_add (nodes, child);
+			idx = nodes->len;
+			g_hash_table_insert (indexes, child, GUINT_TO_POINTER (idx));
+		}
+
+		variant = g_variant_new_uint32 (idx - 1);
+	} else {
+		return FALSE;
+	}
+
+	g_variant_builder_add (builder, "v", variant);
+
+	return TRUE;
+}
+
+/*
+ * tracker_resource_serialize_graph:
+ * @resource: a `TrackerResource`
+ *
+ * Serializes @resource and all resources reachable from it. Returns
+ * %NULL if a value cannot be represented in the compact encoding, in
+ * which case callers should fall back to a textual RDF format.
+ *
+ * Returns: (transfer full) (nullable): the serialized data.
+ */
+GBytes *
+tracker_resource_serialize_graph (TrackerResource *resource)
+{
+	GVariantBuilder builder;
+	GHashTable *indexes;
+	GPtrArray *nodes;
+	GVariant *variant;
+	GBytes *bytes = NULL;
+	guint i;
+
+	g_return_val_if_fail (TRACKER_IS_RESOURCE (resource), NULL);
+
+	/* Node indexes are stored 1-based, so lookups may tell apart
+	 * unseen resources.
+	 */
+	indexes = g_hash_table_new (NULL, NULL);
+	nodes = g_ptr_array_new ();
+	g_ptr_array_add (nodes, resource);
+	g_hash_table_insert (indexes, resource, GUINT_TO_POINTER (1));
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE (RESOURCE_GRAPH_TYPE));
+
+	for (i = 0; i < nodes->len; i++) {
+		TrackerResourcePrivate *priv;
+		GHashTableIter iter;
+		gpointer key, value;
+
+		priv = GET_PRIVATE (g_ptr_array_index (nodes, i));
+
+		g_variant_builder_open (&builder, G_VARIANT_TYPE (RESOURCE_NODE_TYPE));
+		g_variant_builder_add (&builder, "s",
+		                       priv->identifier ? priv->identifier : "");
+		g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(sbav)"));
+
+		g_hash_table_iter_init (&iter, priv->properties);
+
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			g_variant_builder_open (&builder, G_VARIANT_TYPE ("(sbav)"));
+			g_variant_builder_add (&builder, "s", key);
+			g_variant_builder_add (&builder, "b",
+			                       g_hash_table_contains (priv->overwrite, key));
+			g_variant_builder_open (&builder, G_VARIANT_TYPE ("av"));
+
+			if (G_VALUE_HOLDS (value, G_TYPE_PTR_ARRAY)) {
+				GPtrArray *array = g_value_get_boxed (value);
+				guint j;
+
+				for (j = 0; j < array->len; j++) {
+					if (!serialize_graph_value (&builder,
+					                            g_ptr_array_index (array, j),
+					                            indexes, nodes))
+						goto out;
+				}
+			} else if (!serialize_graph_value (&builder, value,
+			                                   indexes, nodes)) {
+				goto out;
+			}
+
+			g_variant_builder_close (&builder);
+			g_variant_builder_close (&builder);
+		}
+
+		g_variant_builder_close (&builder);
+		g_variant_builder_close (&builder);
+	}
+
+	variant = g_variant_ref_sink (g_variant_builder_end (&builder));
+	bytes = g_variant_get_data_as_bytes (variant);
+	g_variant_unref (variant);
+ out:
+	if (!bytes)
+		g_variant_builder_clear (&builder);
+
+	g_hash_table_unref (indexes);
+	g_ptr_array_unref (nodes);
+
+	return bytes;
+}
+
+static GValue *
+deserialize_graph_value (GVariant         *variant,
+                         TrackerResource **nodes,
+                         gsize             n_nodes)
+{
+	GValue *value;
+
+	value = g_slice_new0 (GValue);
+
+	if (g_variant_is_of_type (variant, G_VARIANT_TYPE_BOOLEAN)) {
+		g_value_init (value, G_TYPE_BOOLEAN);
+		g_value_set_boolean (value, g_variant_get_boolean (variant));
+	} else if (g_variant_is_of_type (variant, G_VARIANT_TYPE_INT32)) {
+		g_value_init (value, G_TYPE_INT);
+		g_value_set_int (value, g_variant_get_int32 (variant));
+	} else if (g_variant_is_of_type (variant, G_VARIANT_TYPE_INT64)) {
+		g_value_init (value, G_TYPE_INT64);
+		g_value_set_int64 (value, g_variant_get_int64 (variant));
+	} else if (g_variant_is_of_type (variant, G_VARIANT_TYPE_DOUBLE)) {
+		g_value_init (value, G_TYPE_DOUBLE);
+		g_value_set_double (value, g_variant_get_double (variant));
+	} else if (g_variant_is_of_type (variant, G_VARIANT_TYPE_BYTESTRING)) {
+		g_value_init (value, TRACKER_TYPE_URI);
+		g_value_set_string (value, g_variant_get_bytestring (variant));
+	} else if (g_variant_is_of_type (variant, G_VARIANT_TYPE_STRING)) {
+		g_value_init (value, G_TYPE_STRING);
+		g_value_set_string (value, g_variant_get_string (variant, NULL));
+	} else if (g_variant_is_of_type (variant, G_VARIANT_TYPE ("(s)"))) {
+		GDateTime *datetime;
+		const gchar *str;
+
+		g_variant_get (variant, "(&s)", &str);
+		datetime = tracker_date_new_from_iso8601 (str, NULL);
+		if (!datetime)
+			goto error;
+
+		g_value_init (value, G_TYPE_DATE_TIME);
+		g_value_take_boxed (value, datetime);
+	} else if (g_variant_is_of_type (variant, G_VARIANT_TYPE_UINT32)) {
+		guint32 idx = g_variant_get_uint32 (variant);
+
+		if (idx >= n_nodes)
+			goto error;
+
+		g_value_init (value, TRACKER_TYPE_RESOURCE);
+		g_value_set_object (value, nodes[idx]);
+	} else {
+		goto error;
+	}
+
+	return value;
+ error:
+	g_slice_free (GValue, value);
+	return NULL;
+}
+
+static void
+release_graph_node (TrackerResource *resource)
+{
+	TrackerResourcePrivate *priv = GET_PRIVATE (resource);
+
+	/* Drop relations first, the graph may be cyclic */
+	g_hash_table_remove_all (priv->properties);
+	g_hash_table_remove_all (priv->overwrite);
+	g_object_unref (resource);
+}
+
+/*
+ * tracker_resource_deserialize_graph:
+ * @bytes: data produced by tracker_resource_serialize_graph()
+ * @error: return location for errors
+ *
+ * Rebuilds the resource tree serialized in @bytes. Relations between
+ * the nodes hold strong references, so freeing the returned array
+ * clears all nodes to release cyclic graphs. The nodes must not be
+ * used after that.
+ *
+ * Returns: (transfer full) (nullable) (element-type TrackerResource):
+ *   all nodes of the tree, the root resource first.
+ */
+GPtrArray *
+tracker_resource_deserialize_graph (GBytes  *bytes,
+                                    GError **error)
+{
+	TrackerResource **nodes;
+	GPtrArray *graph;
+	GVariant *variant;
+	gsize n_nodes, i;
+
+	variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (RESOURCE_GRAPH_TYPE),
+	                                                        bytes, FALSE));
+	n_nodes = g_variant_n_children (variant);
+
+	if (n_nodes == 0) {
+		g_variant_unref (variant);
+		g_set_error (error,
+		             TRACKER_SPARQL_ERROR,
+		             TRACKER_SPARQL_ERROR_PARSE,
+		             "Malformed resource data");
+		return NULL;
+	}
+
+	/* Create all nodes first, so relations can be resolved
+	 * regardless of their position in the array.
+	 */
+	graph = g_ptr_array_new_full (n_nodes, (GDestroyNotify) release_graph_node);
+
+	for (i = 0; i < n_nodes; i++) {
+		TrackerResource *node;
+		TrackerResourcePrivate *priv;
+		const gchar *identifier;
+
+		node = tracker_resource_new (NULL);
+		g_ptr_array_add (graph, node);
+		priv = GET_PRIVATE (node);
+		g_variant_get_child (variant, i, "(&s@a(sbav))", &identifier, NULL);
+
+		if (*identifier)
+			priv->identifier = g_strdup (identifier);
+	}
+
+	nodes = (TrackerResource **) graph->pdata;
+
+	for (i = 0; i < n_nodes; i++) {
+		TrackerResourcePrivate *priv = GET_PRIVATE (nodes[i]);
+		GVariant *properties, *values;
+		GVariantIter iter;
+		const gchar *property;
+		gboolean overwrite;
+
+		g_variant_get_child (variant, i, "(&s@a(sbav))", NULL, &properties);
+		g_variant_iter_init (&iter, properties);
+
+		while (g_variant_iter_next (&iter, "(&sb@av)", &property, &overwrite, &values)) {
+			gsize n_values, j;
+			GPtrArray *array = NULL;
+			GValue *value = NULL;
+
+			n_values = g_variant_n_children (values);
+
+			if (n_values > 1) {
+				array = g_ptr_array_new_with_free_func ((GDestroyNotify) free_value);
+				value = g_slice_new0 (GValue);
+				g_value_init (value, G_TYPE_PTR_ARRAY);
+				g_value_take_boxed (value, array);
+			}
+
+			for (j = 0; j < n_values; j++) {
+				GVariant *child, *inner;
+				GValue *child_value;
+
+				child = g_variant_get_child_value (values, j);
+				inner = g_variant_get_variant (child);
+				child_value = deserialize_graph_value (inner, nodes, n_nodes);
+				g_variant_unref (inner);
+				g_variant_unref (child);
+
+				if (!child_value) {
+					g_set_error (error,
+					             TRACKER_SPARQL_ERROR,
+					             TRACKER_SPARQL_ERROR_PARSE,
+					             "Malformed value for property '%s'",
+					             property);
+					g_clear_pointer (&value, free_value);
+					g_variant_unref (values);
+					g_variant_unref (properties);
+					g_clear_pointer (&graph, g_ptr_array_unref);
+					goto out;
+				}
+
+				if (array)
+					g_ptr_array_add (array, child_value);
+				else
+					value = child_value;
+			}
+
+			if (value) {
+				g_hash_table_insert (priv->properties, g_strdup (property), value);
+
+				if (overwrite) {
+					g_hash_table_insert (priv->overwrite, g_strdup (property),
+					                     GINT_TO_POINTER (TRUE));
+				}
+			}
+
+			g_variant_unref (values);
+		}
+
+		g_variant_unref (properties);
+	}
+
+ out:
+	g_variant_unref (variant);
+
+	return graph;
+}
@@ -26,6 +26,7 @@
 #include "config.h"
 
 #include "tracker-serializer-json-ld.h"
+#include "tracker-private.h"
 
 #include <json-glib/json-glib.h>
 
@@ -198,7 +199,8 @@ serialize_up_to_position (TrackerSerializerJsonLD  *serializer_json_ld,
 		g_string_append (serializer_json_ld->data, "{");
 
 	while (!serializer_json_ld->cursor_finished) {
-		const gchar *graph, *subject, *predicate, *langtag;
+		TrackerSparqlCursorValue values[4] = { 0, };
+		const gchar *graph, *subject, *predicate;
 		gboolean graph_changed, subject_changed;
 		TrackerSparqlValueType subject_type, object_type;
 		JsonNode *value = NULL;
@@ -220,11 +222,13 @@ serialize_up_to_position (TrackerSerializerJsonLD  *serializer_json_ld,
 			}
 		}
 
-		subject = tracker_sparql_cursor_get_string (cursor, 0, NULL);
-		subject_type = tracker_sparql_cursor_get_value_type (cursor, 0);
-		predicate = tracker_sparql_cursor_get_string (cursor, 1, NULL);
-		object_type = tracker_sparql_cursor_get_value_type (cursor, 2);
-		graph = tracker_sparql_cursor_get_string (cursor, 3, NULL);
+		tracker_sparql_cursor_get_values (cursor, values, G_N_ELEMENTS (values));
+
+		subject = values[0].str;
+		subject_type = values[0].value_type;
+		predicate = values[1].str;
+		object_type = values[2].value_type;
+		graph = values[3].str;
 
 		graph_changed = g_strcmp0 (graph, serializer_json_ld->cur_graph) != 0;
 		subject_changed = g_strcmp0 (subject, serializer_json_ld->cur_subject) != 0;
@@ -306,7 +310,7 @@ serialize_up_to_position (TrackerSerializerJsonLD  *serializer_json_ld,
 			const gchar *type;
 			gchar *compressed;
 
-			type = tracker_sparql_cursor_get_string (cursor, 2, NULL);
+			type = values[2].str;
 			compressed = tracker_namespace_manager_compress_uri (namespaces, type);
 
 			prop = g_strdup ("@type");
@@ -324,7 +328,7 @@ serialize_up_to_position (TrackerSerializerJsonLD  *serializer_json_ld,
 			switch (object_type) {
 			case TRACKER_SPARQL_VALUE_TYPE_URI:
 			case TRACKER_SPARQL_VALUE_TYPE_BLANK_NODE:
-				res = tracker_sparql_cursor_get_string (cursor, 2, NULL);
+				res = values[2].str;
 
 				node = g_hash_table_lookup (serializer_json_ld->resources,
 				                            res);
@@ -343,13 +347,13 @@ serialize_up_to_position (TrackerSerializerJsonLD  *serializer_json_ld,
 				}
 				break;
 			case TRACKER_SPARQL_VALUE_TYPE_DATETIME:
-				res = tracker_sparql_cursor_get_string (cursor, 2, NULL);
+				res = values[2].str;
 				value = create_value_object (res, NULL, TRACKER_PREFIX_XSD "dateTime");
 				break;
 			case TRACKER_SPARQL_VALUE_TYPE_STRING:
-				res = tracker_sparql_cursor_get_langstring (cursor, 2, &langtag, NULL);
-				if (langtag) {
-					value = create_value_object (res, langtag, TRACKER_PREFIX_RDF "langString");
+				res = values[2].str;
+				if (values[2].langtag) {
+					value = create_value_object (res, values[2].langtag, TRACKER_PREFIX_RDF "langString");
 				} else {
 					value = json_node_alloc ();
 					json_node_init_string (value, res);
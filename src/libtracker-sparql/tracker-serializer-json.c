@@ -26,6 +26,7 @@
 #include "config.h"
 
 #include "tracker-serializer-json.h"
+#include "tracker-private.h"
 
 #include <json-glib/json-glib.h>
 
@@ -35,6 +36,7 @@ struct _TrackerSerializerJson
 	JsonGenerator *generator;
 	GString *data;
 	GPtrArray *vars;
+	TrackerSparqlCursorValue *values;
 	gsize current_pos;
 	guint stream_closed : 1;
 	guint cursor_started : 1;
@@ -63,7 +65,7 @@ serialize_up_to_position (TrackerSerializerJson  *serializer_json,
 	GError *inner_error = NULL;
 	JsonBuilder *builder;
 	JsonNode *node;
-	gint i;
+	gint i, n_columns;
 
 	if (!serializer_json->data)
 		serializer_json->data = g_string_new (NULL);
@@ -111,6 +113,8 @@ serialize_up_to_position (TrackerSerializerJson  *serializer_json,
 		g_string_append_printf (serializer_json->data,
 		                        ",\"results\":{\"bindings\":[");
 
+		serializer_json->values = g_new0 (TrackerSparqlCursorValue,
+		                                  serializer_json->vars->len);
 		serializer_json->head_printed = TRUE;
 	}
 
@@ -136,10 +140,14 @@ serialize_up_to_position (TrackerSerializerJson  *serializer_json,
 		json_builder_reset (builder);
 		json_builder_begin_object (builder);
 
-		for (i = 0; i < tracker_sparql_cursor_get_n_columns (cursor); i++) {
-			const gchar *var, *str, *type = NULL, *datatype = NULL, *langtag = NULL;
+		n_columns = tracker_sparql_cursor_get_values (cursor,
+		                                              serializer_json->values,
+		                                              serializer_json->vars->len);
+
+		for (i = 0; i < n_columns; i++) {
+			const gchar *var, *str, *type = NULL, *datatype = NULL, *langtag;
 
-			switch (tracker_sparql_cursor_get_value_type (cursor, i)) {
+			switch (serializer_json->values[i].value_type) {
 			case TRACKER_SPARQL_VALUE_TYPE_URI:
 				type = "uri";
 				break;
@@ -175,7 +183,8 @@ serialize_up_to_position (TrackerSerializerJson  *serializer_json,
 			json_builder_set_member_name (builder, "type");
 			json_builder_add_string_value (builder, type);
 
-			str = tracker_sparql_cursor_get_langstring (cursor, i, &langtag, NULL);
+			str = serializer_json->values[i].str;
+			langtag = serializer_json->values[i].langtag;
 
 			if (langtag) {
 				datatype = TRACKER_PREFIX_RDF "langString";
@@ -190,8 +199,7 @@ serialize_up_to_position (TrackerSerializerJson  *serializer_json,
 
 			if (str) {
 				json_builder_set_member_name (builder, "value");
-				json_builder_add_string_value (builder,
-				                               tracker_sparql_cursor_get_string (cursor, i, NULL));
+				json_builder_add_string_value (builder, str);
 				json_builder_end_object (builder);
 			}
 		}
@@ -257,6 +265,7 @@ tracker_serializer_json_close (GInputStream  *istream,
 	g_clear_object (&serializer_json->generator);
 	serializer_json->stream_closed = TRUE;
 	g_clear_pointer (&serializer_json->vars, g_ptr_array_unref);
+	g_clear_pointer (&serializer_json->values, g_free);
 
 	return TRUE;
 }
@@ -26,6 +26,7 @@
 #include "config.h"
 
 #include "tracker-serializer-trig.h"
+#include "tracker-private.h"
 
 typedef struct _TrackerQuad TrackerQuad;
 
@@ -68,17 +69,21 @@ static void
 tracker_quad_init_from_cursor (TrackerQuad         *quad,
                                TrackerSparqlCursor *cursor)
 {
-	const gchar *langtag;
+	TrackerSparqlCursorValue values[4] = { 0, };
+	gint n_columns;
 
-	quad->subject_type = tracker_sparql_cursor_get_value_type (cursor, 0);
-	quad->object_type = tracker_sparql_cursor_get_value_type (cursor, 2);
-	quad->subject = g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL));
-	quad->predicate = g_strdup (tracker_sparql_cursor_get_string (cursor, 1, NULL));
-	quad->object = g_strdup (tracker_sparql_cursor_get_langstring (cursor, 2, &langtag, NULL));
-	quad->object_langtag = g_strdup (langtag);
+	n_columns = tracker_sparql_cursor_get_values (cursor, values,
+	                                              G_N_ELEMENTS (values));
 
-	if (tracker_sparql_cursor_get_n_columns (cursor) >= 4)
-		quad->graph = g_strdup (tracker_sparql_cursor_get_string (cursor, 3, NULL));
+	quad->subject_type = values[0].value_type;
+	quad->object_type = values[2].value_type;
+	quad->subject = g_strdup (values[0].str);
+	quad->predicate = g_strdup (values[1].str);
+	quad->object = g_strdup (values[2].str);
+	quad->object_langtag = g_strdup (values[2].langtag);
+
+	if (n_columns >= 4)
+		quad->graph = g_strdup (values[3].str);
 	else
 		quad->graph = NULL;
 
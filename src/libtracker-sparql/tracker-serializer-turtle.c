@@ -26,6 +26,7 @@
 #include "config.h"
 
 #include "tracker-serializer-turtle.h"
+#include "tracker-private.h"
 
 typedef struct _TrackerTriple TrackerTriple;
 
@@ -66,14 +67,16 @@ static void
 tracker_triple_init_from_cursor (TrackerTriple       *triple,
                                  TrackerSparqlCursor *cursor)
 {
-	const gchar *langtag;
-
-	triple->subject_type = tracker_sparql_cursor_get_value_type (cursor, 0);
-	triple->object_type = tracker_sparql_cursor_get_value_type (cursor, 2);
-	triple->subject = g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL));
-	triple->predicate = g_strdup (tracker_sparql_cursor_get_string (cursor, 1, NULL));
-	triple->object = g_strdup (tracker_sparql_cursor_get_langstring (cursor, 2, &langtag, NULL));
-	triple->object_langtag = g_strdup (langtag);
+	TrackerSparqlCursorValue values[3] = { 0, };
+
+	tracker_sparql_cursor_get_values (cursor, values, G_N_ELEMENTS (values));
+
+	triple->subject_type = values[0].value_type;
+	triple->object_type = values[2].value_type;
+	triple->subject = g_strdup (values[0].str);
+	triple->predicate = g_strdup (values[1].str);
+	triple->object = g_strdup (values[2].str);
+	triple->object_langtag = g_strdup (values[2].langtag);
 
 	if (triple->subject_type == TRACKER_SPARQL_VALUE_TYPE_STRING) {
 		if (g_str_has_prefix (triple->subject, "urn:bnode:")) {
@@ -26,6 +26,7 @@
 #include "config.h"
 
 #include "tracker-serializer-xml.h"
+#include "tracker-private.h"
 
 #include <libxml/xmlwriter.h>
 
@@ -38,6 +39,7 @@ struct _TrackerSerializerXml
 	xmlBufferPtr buffer;
 	xmlTextWriterPtr writer;
 	GPtrArray *vars;
+	TrackerSparqlCursorValue *values;
 	gssize current_pos;
 
 	guint stream_closed : 1;
@@ -65,7 +67,7 @@ serialize_up_to_position (TrackerSerializerXml  *serializer_xml,
 {
 	TrackerSparqlCursor *cursor;
 	GError *inner_error = NULL;
-	gint i;
+	gint i, n_columns;
 
 	if (!serializer_xml->buffer)
 		serializer_xml->buffer = xmlBufferCreate ();
@@ -115,6 +117,8 @@ serialize_up_to_position (TrackerSerializerXml  *serializer_xml,
 		if (xmlTextWriterStartElement (serializer_xml->writer, XML ("results")) < 0)
 			goto error;
 
+		serializer_xml->values = g_new0 (TrackerSparqlCursorValue,
+		                                 serializer_xml->vars->len);
 		serializer_xml->head_printed = TRUE;
 	}
 
@@ -138,10 +142,14 @@ serialize_up_to_position (TrackerSerializerXml  *serializer_xml,
 		if (xmlTextWriterStartElement (serializer_xml->writer, XML ("result")) < 0)
 			goto error;
 
-		for (i = 0; i < tracker_sparql_cursor_get_n_columns (cursor); i++) {
-			const gchar *var, *str, *type = NULL, *datatype = NULL, *langtag = NULL;
+		n_columns = tracker_sparql_cursor_get_values (cursor,
+		                                              serializer_xml->values,
+		                                              serializer_xml->vars->len);
+
+		for (i = 0; i < n_columns; i++) {
+			const gchar *var, *str, *type = NULL, *datatype = NULL, *langtag;
 
-			switch (tracker_sparql_cursor_get_value_type (cursor, i)) {
+			switch (serializer_xml->values[i].value_type) {
 			case TRACKER_SPARQL_VALUE_TYPE_URI:
 				type = "uri";
 				break;
@@ -183,7 +191,8 @@ serialize_up_to_position (TrackerSerializerXml  *serializer_xml,
 			if (xmlTextWriterStartElement (serializer_xml->writer, XML (type)) < 0)
 				goto error;
 
-			str = tracker_sparql_cursor_get_langstring (cursor, i, &langtag, NULL);
+			str = serializer_xml->values[i].str;
+			langtag = serializer_xml->values[i].langtag;
 
 			if (langtag) {
 				datatype = TRACKER_PREFIX_RDF "langString";
@@ -271,6 +280,7 @@ tracker_serializer_xml_close (GInputStream  *istream,
 	serializer_xml->stream_closed = TRUE;
 	g_clear_pointer (&serializer_xml->buffer, xmlBufferFree);
 	g_clear_pointer (&serializer_xml->writer, xmlFreeTextWriter);
+	g_clear_pointer (&serializer_xml->values, g_free);
 
 	return TRUE;
 }
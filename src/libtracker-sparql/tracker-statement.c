@@ -349,6 +349,48 @@ tracker_sparql_statement_bind_langstring (TrackerSparqlStatement *stmt,
 	                                                            langtag);
 }
 
+/**
+ * tracker_sparql_statement_bind_int_array:
+ * @stmt: a `TrackerSparqlStatement`
+ * @name: variable name
+ * @values: (array length=n_values): integer values
+ * @n_values: number of elements in @values
+ *
+ * Binds the integer array @values to the parameterized variable given
+ * by @name.
+ *
+ * Array parameters are expanded into one solution per element when used
+ * as the only value of a single-variable `VALUES` block, e.g.:
+ *
+ * ```sparql
+ * SELECT ?id ?urn {
+ *   VALUES ?id { ~ids }
+ *   BIND (tracker:uri(xsd:integer(?id)) AS ?urn)
+ * }
+ * ```
+ *
+ * This allows looking up an arbitrary number of elements with a single
+ * statement execution. Array parameters are not supported elsewhere in
+ * the query.
+ *
+ * Since: 3.8
+ **/
+void
+tracker_sparql_statement_bind_int_array (TrackerSparqlStatement *stmt,
+                                         const gchar            *name,
+                                         const gint64           *values,
+                                         gsize                   n_values)
+{
+	g_return_if_fail (TRACKER_IS_SPARQL_STATEMENT (stmt));
+	g_return_if_fail (name != NULL);
+	g_return_if_fail (values != NULL || n_values == 0);
+
+	TRACKER_SPARQL_STATEMENT_GET_CLASS (stmt)->bind_int_array (stmt,
+	                                                           name,
+	                                                           values,
+	                                                           n_values);
+}
+
 /**
  * tracker_sparql_statement_execute:
  * @stmt: a `TrackerSparqlStatement`
@@ -643,3 +685,70 @@ tracker_sparql_statement_serialize_finish (TrackerSparqlStatement  *stmt,
 	                                                                    result,
 	                                                                    error);
 }
+
+/**
+ * tracker_sparql_statement_explain:
+ * @stmt: a `TrackerSparqlStatement`
+ * @flags: flags affecting the gathered information
+ * @cancellable: (nullable): Optional [type@Gio.Cancellable]
+ * @error: Error location
+ *
+ * Describes how the `SELECT` query @stmt was created from is executed,
+ * with the currently bound values. This is meant for diagnosing slow
+ * queries, the format of the information may change between versions.
+ *
+ * The returned dictionary contains the following keys:
+ *
+ * - `sparql` (`s`): The SPARQL query
+ * - `sql` (`s`): The SQL the query was translated to
+ * - `plan` (`a(xxs)`): The SQLite query plan, as (id, parent id, detail) rows
+ * - `parse-time`, `translate-time` (`x`): Time in microseconds spent parsing
+ *   and translating the query
+ *
+ * If @flags contains %TRACKER_EXPLAIN_FLAGS_PROFILE, the query is also
+ * run to completion, and the dictionary additionally contains:
+ *
+ * - `prepare-time`, `step-time` (`x`): Time in microseconds spent compiling
+ *   the SQL, and fetching all rows
+ * - `rows` (`x`): The number of rows returned
+ * - `vm-steps` (`x`): The number of SQLite virtual machine operations
+ * - `fullscan-steps` (`x`): The number of steps done in full table scans
+ * - `sorts` (`x`): The number of sort operations
+ * - `autoindexes` (`x`): The number of rows inserted into automatic indexes
+ *
+ * Not all connections support this operation, an error will be raised
+ * in that case.
+ *
+ * Returns: (transfer full): a `a{sv}` dictionary describing the query execution
+ *
+ * Since: 3.8
+ **/
+GVariant *
+tracker_sparql_statement_explain (TrackerSparqlStatement  *stmt,
+                                  TrackerExplainFlags      flags,
+                                  GCancellable            *cancellable,
+                                  GError                 **error)
+{
+	GVariant *result;
+
+	g_return_val_if_fail (TRACKER_IS_SPARQL_STATEMENT (stmt), NULL);
+	g_return_val_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (!error || !*error, NULL);
+
+	if (!TRACKER_SPARQL_STATEMENT_GET_CLASS (stmt)->explain) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             G_IO_ERROR_NOT_SUPPORTED,
+		             "Query introspection is not supported by this connection");
+		return NULL;
+	}
+
+	result = TRACKER_SPARQL_STATEMENT_GET_CLASS (stmt)->explain (stmt,
+	                                                             flags,
+	                                                             cancellable,
+	                                                             error);
+	if (result)
+		g_variant_take_ref (result);
+
+	return result;
+}
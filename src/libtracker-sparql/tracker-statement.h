@@ -74,6 +74,12 @@ void tracker_sparql_statement_bind_langstring (TrackerSparqlStatement *stmt,
                                                const gchar            *value,
                                                const gchar            *langtag);
 
+TRACKER_AVAILABLE_IN_3_8
+void tracker_sparql_statement_bind_int_array (TrackerSparqlStatement *stmt,
+                                              const gchar            *name,
+                                              const gint64           *values,
+                                              gsize                   n_values);
+
 TRACKER_AVAILABLE_IN_ALL
 TrackerSparqlCursor * tracker_sparql_statement_execute (TrackerSparqlStatement  *stmt,
                                                         GCancellable            *cancellable,
@@ -122,6 +128,12 @@ gboolean tracker_sparql_statement_update_finish (TrackerSparqlStatement  *stmt,
                                                  GAsyncResult            *result,
                                                  GError                 **error);
 
+TRACKER_AVAILABLE_IN_3_8
+GVariant * tracker_sparql_statement_explain (TrackerSparqlStatement  *stmt,
+                                             TrackerExplainFlags      flags,
+                                             GCancellable            *cancellable,
+                                             GError                 **error);
+
 G_END_DECLS
 
 #endif /* __TRACKER_SPARQL_STATEMENT_H__ */
@@ -107,6 +107,8 @@ static gchar *database_path;
 static gchar *dbus_service;
 static gchar *remote_service;
 static gchar **args;
+static gboolean explain;
+static gboolean profile;
 
 static GOptionEntry entries[] = {
 	{ "database", 'd', 0, G_OPTION_ARG_FILENAME, &database_path,
@@ -177,6 +179,14 @@ static GOptionEntry entries[] = {
 	  N_("Provides an argument for a query parameter."),
 	  N_("PARAMETER:TYPE:VALUE"),
 	},
+	{ "explain", 0, 0, G_OPTION_ARG_NONE, &explain,
+	  N_("Show the SQL and query plan of a query instead of its results"),
+	  NULL,
+	},
+	{ "profile", 0, 0, G_OPTION_ARG_NONE, &profile,
+	  N_("Like --explain, also runs the query and shows timings and counters"),
+	  NULL,
+	},
 	{ NULL }
 };
 
@@ -1055,6 +1065,72 @@ bind_arguments (TrackerSparqlStatement  *stmt,
 	return TRUE;
 }
 
+static void
+print_explain (GVariant *info)
+{
+	GHashTable *depths;
+	GVariantIter *plan;
+	const gchar *str, *detail;
+	gint64 id, parent, value;
+	guint i;
+	const struct {
+		const gchar *key;
+		const gchar *label;
+	} timings[] = {
+		{ "parse-time", N_("Parse") },
+		{ "translate-time", N_("Translate") },
+		{ "prepare-time", N_("Prepare") },
+		{ "step-time", N_("Step") },
+	}, counters[] = {
+		{ "rows", N_("Rows") },
+		{ "vm-steps", N_("Virtual machine steps") },
+		{ "fullscan-steps", N_("Full scan steps") },
+		{ "sorts", N_("Sorts") },
+		{ "autoindexes", N_("Automatic index rows") },
+	};
+
+	if (g_variant_lookup (info, "sql", "&s", &str))
+		g_print ("%s:\n  %s\n\n", _("SQL"), str);
+
+	if (g_variant_lookup (info, "plan", "a(xxs)", &plan)) {
+		g_print ("%s:\n", _("Query plan"));
+		depths = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+
+		/* Rows come after their parents, nest them accordingly */
+		while (g_variant_iter_loop (plan, "(xx&s)", &id, &parent, &detail)) {
+			gint64 *key;
+			guint depth;
+
+			depth = GPOINTER_TO_UINT (g_hash_table_lookup (depths, &parent)) + 1;
+			key = g_memdup2 (&id, sizeof (gint64));
+			g_hash_table_insert (depths, key, GUINT_TO_POINTER (depth));
+
+			g_print ("%*s%s\n", depth * 2, "", detail);
+		}
+
+		g_hash_table_unref (depths);
+		g_variant_iter_free (plan);
+		g_print ("\n");
+	}
+
+	g_print ("%s:\n", _("Timings"));
+
+	for (i = 0; i < G_N_ELEMENTS (timings); i++) {
+		if (g_variant_lookup (info, timings[i].key, "x", &value))
+			g_print ("  %s: %.3f ms\n", _(timings[i].label), value / 1000.0);
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (counters); i++) {
+		if (!g_variant_lookup (info, counters[i].key, "x", &value))
+			continue;
+
+		if (i == 0)
+			g_print ("\n%s:\n", _("Counters"));
+
+		g_print ("  %s: %" G_GINT64_FORMAT "\n", _(counters[i].label), value);
+	}
+}
+
 static int
 sparql_run (void)
 {
@@ -1326,7 +1402,21 @@ sparql_run (void)
 					goto out;
 				}
 
-				cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+				if (explain || profile) {
+					GVariant *info;
+
+					info = tracker_sparql_statement_explain (stmt,
+					                                         profile ?
+					                                         TRACKER_EXPLAIN_FLAGS_PROFILE :
+					                                         TRACKER_EXPLAIN_FLAGS_NONE,
+					                                         NULL, &error);
+					if (info) {
+						print_explain (info);
+						g_variant_unref (info);
+					}
+				} else {
+					cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+				}
 			}
 
 			if (error) {
@@ -1339,10 +1429,13 @@ sparql_run (void)
 				goto out;
 			}
 
-			if (G_UNLIKELY (strstr (query, "fts:offsets")))
+			if (explain || profile) {
+				/* Explanation was already printed */
+			} else if (G_UNLIKELY (strstr (query, "fts:offsets"))) {
 				print_cursor_with_ftsoffsets (cursor, _("No results found matching your query"), _("Results"), FALSE);
-			else
+			} else {
 				print_cursor (cursor, _("No results found matching your query"), _("Results"), FALSE);
+			}
 		}
 	}
 
@@ -1401,6 +1494,8 @@ main (int argc, const char **argv)
 		failed = _("File and query can not be used together");
 	} else if (list_properties && list_properties[0] == '\0' && !tree) {
 		failed = _("The --list-properties argument can only be empty when used with the --tree argument");
+	} else if ((explain || profile) && update) {
+		failed = _("The --explain and --profile arguments can not be used with --update");
 	} else {
 		failed = NULL;
 	}
@@ -21,6 +21,7 @@
 
 #include <libtracker-sparql/tracker-sparql.h>
 #include <locale.h>
+#include <sqlite3.h>
 
 typedef void (*InitTestFunc) (const gchar *data_dir);
 
@@ -163,6 +164,451 @@ version_test (gconstpointer context)
 	g_free (xz_command);
 }
 
+static void
+assert_ask (TrackerSparqlConnection *conn,
+            const gchar             *query)
+{
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+
+	cursor = tracker_sparql_connection_query (conn, query, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (tracker_sparql_cursor_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_true (tracker_sparql_cursor_get_boolean (cursor, 0));
+	g_object_unref (cursor);
+}
+
+static sqlite3 *
+open_database_file (const gchar *data_dir,
+                    const gchar *name,
+                    gint         flags)
+{
+	gchar *filename, *escaped, *path;
+	sqlite3 *db = NULL;
+
+	filename = g_strdup_printf ("%s.db", name);
+	escaped = g_uri_escape_string (filename, NULL, FALSE);
+	path = g_build_filename (data_dir, escaped, NULL);
+
+	g_assert_true (g_file_test (path, G_FILE_TEST_EXISTS));
+	g_assert_cmpint (sqlite3_open_v2 (path, &db, flags, NULL), ==, SQLITE_OK);
+
+	g_free (filename);
+	g_free (escaped);
+	g_free (path);
+
+	return db;
+}
+
+static gint
+count_tables (sqlite3     *db,
+              const gchar *like)
+{
+	sqlite3_stmt *stmt;
+	gint count;
+
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+	                                     "SELECT COUNT(*) FROM sqlite_master "
+	                                     "WHERE type = 'table' AND name LIKE ?",
+	                                     -1, &stmt, NULL), ==, SQLITE_OK);
+	sqlite3_bind_text (stmt, 1, like, -1, SQLITE_STATIC);
+	g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_ROW);
+	count = sqlite3_column_int (stmt, 0);
+	sqlite3_finalize (stmt);
+
+	return count;
+}
+
+static void
+graph_template_test (void)
+{
+	gchar *prefix, *data_dir, *ontology_dir;
+	GError *error = NULL;
+	GFile *data_location, *test_schemas;
+	TrackerSparqlConnection *conn;
+	const gchar *graphs[] = { "http://example/g0", "http://example/g1", "http://example/g2" };
+	sqlite3 *db;
+	guint i;
+
+	prefix = g_build_filename (TOP_SRCDIR, "tests", "core", NULL);
+	ontology_dir = g_build_filename (prefix, "initialization/fts", NULL);
+	test_schemas = g_file_new_for_path (ontology_dir);
+	g_free (ontology_dir);
+
+	data_dir = g_build_filename (g_get_tmp_dir (), "tracker-initialization-test-XXXXXX", NULL);
+	data_dir = g_mkdtemp_full (data_dir, 0700);
+	data_location = g_file_new_for_path (data_dir);
+
+	conn = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+	                                      data_location,
+	                                      test_schemas,
+	                                      NULL, &error);
+	g_assert_no_error (error);
+
+	/* The first graph is created from scratch, further ones are
+	 * copied from the schema template.
+	 */
+	for (i = 0; i < G_N_ELEMENTS (graphs); i++) {
+		gchar *query;
+
+		query = g_strdup_printf ("INSERT DATA { GRAPH <%s> { "
+		                         "  <http://example/b%u> a example:B ; example:s2 'hello' "
+		                         "} }",
+		                         graphs[i], i);
+		tracker_sparql_connection_update (conn, query, NULL, &error);
+		g_assert_no_error (error);
+		g_free (query);
+
+		if (i == 0) {
+			/* Tag the template, so graphs created from it can
+			 * be told apart from graphs created from scratch.
+			 */
+			db = open_database_file (data_dir, ".graph-template", SQLITE_OPEN_READWRITE);
+			g_assert_cmpint (sqlite3_exec (db, "CREATE TABLE template_marker (x)",
+			                               NULL, NULL, NULL), ==, SQLITE_OK);
+			sqlite3_close (db);
+		}
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (graphs); i++) {
+		gchar *query;
+
+		query = g_strdup_printf ("ASK { GRAPH <%s> { "
+		                         "  <http://example/b%u> a example:B ; <http://tracker.api.gnome.org/ontology/v3/fts#match> 'hello' "
+		                         "} }",
+		                         graphs[i], i);
+		assert_ask (conn, query);
+		g_free (query);
+	}
+
+	g_clear_object (&conn);
+
+	conn = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+	                                      data_location,
+	                                      NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	assert_ask (conn, "ASK { GRAPH <http://example/g2> { <http://example/b2> example:s2 'hello' } }");
+
+	g_object_unref (conn);
+
+	for (i = 0; i < G_N_ELEMENTS (graphs); i++) {
+		db = open_database_file (data_dir, graphs[i], SQLITE_OPEN_READONLY);
+		g_assert_cmpint (count_tables (db, "template_marker"), ==, i == 0 ? 0 : 1);
+		sqlite3_close (db);
+	}
+	g_object_unref (test_schemas);
+	g_object_unref (data_location);
+	g_free (data_dir);
+	g_free (prefix);
+}
+
+static void
+lazy_graph_tables_test (void)
+{
+	gchar *prefix, *ontology_dir;
+	GError *error = NULL;
+	GFile *test_schemas;
+	TrackerSparqlConnection *conn;
+
+	prefix = g_build_filename (TOP_SRCDIR, "tests", "core", NULL);
+	ontology_dir = g_build_filename (prefix, "initialization/fts", NULL);
+	test_schemas = g_file_new_for_path (ontology_dir);
+	g_free (ontology_dir);
+
+	conn = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+	                                      NULL, test_schemas, NULL, &error);
+	g_assert_no_error (error);
+
+	tracker_sparql_connection_update (conn,
+	                                  "INSERT DATA { GRAPH <http://example/g> { "
+	                                  "  <http://example/b> a example:B ; example:s2 'foo' "
+	                                  "} }",
+	                                  NULL, &error);
+	g_assert_no_error (error);
+
+	/* The graph has no tables for example:A yet */
+	assert_ask (conn, "ASK { FILTER NOT EXISTS { GRAPH <http://example/g> { ?a example:i0 ?i } } }");
+	assert_ask (conn, "ASK { FILTER NOT EXISTS { GRAPH <http://example/g> { ?a a example:A } } }");
+	assert_ask (conn, "ASK { FILTER NOT EXISTS { ?a example:m1 ?m } }");
+
+	tracker_sparql_connection_update (conn,
+	                                  "DELETE WHERE { GRAPH <http://example/g> { ?a example:i0 ?i } } ; "
+	                                  "INSERT DATA { GRAPH <http://example/g> { "
+	                                  "  <http://example/a> a example:A ; example:i0 1 ; example:m1 2 "
+	                                  "} }",
+	                                  NULL, &error);
+	g_assert_no_error (error);
+
+	assert_ask (conn, "ASK { GRAPH <http://example/g> { <http://example/a> example:i0 1 ; example:m1 2 } }");
+	assert_ask (conn, "ASK { <http://example/a> a example:A ; example:m1 2 }");
+	assert_ask (conn, "ASK { GRAPH <http://example/g> { <http://example/b> example:s2 'foo' } }");
+
+	g_object_unref (conn);
+	g_object_unref (test_schemas);
+	g_free (prefix);
+}
+
+static void
+lazy_graph_tables_update_test (void)
+{
+	gchar *prefix, *data_dir, *ontology_dir;
+	GError *error = NULL;
+	GFile *data_location, *test_schemas;
+	TrackerSparqlConnection *conn;
+	sqlite3 *db;
+	gint n_tables;
+
+	prefix = g_build_filename (TOP_SRCDIR, "tests", "core", NULL);
+	ontology_dir = g_build_filename (prefix, "initialization/fts", NULL);
+	test_schemas = g_file_new_for_path (ontology_dir);
+	g_free (ontology_dir);
+
+	data_dir = g_build_filename (g_get_tmp_dir (), "tracker-initialization-test-XXXXXX", NULL);
+	data_dir = g_mkdtemp_full (data_dir, 0700);
+	data_location = g_file_new_for_path (data_dir);
+
+	conn = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+	                                      data_location, test_schemas, NULL, &error);
+	g_assert_no_error (error);
+
+	tracker_sparql_connection_update (conn,
+	                                  "INSERT DATA { "
+	                                  "  GRAPH <http://example/g1> { <http://example/b1> a example:B } "
+	                                  "  GRAPH <http://example/g2> { <http://example/b2> a example:B } "
+	                                  "}",
+	                                  NULL, &error);
+	g_assert_no_error (error);
+
+	db = open_database_file (data_dir, "http://example/g2", SQLITE_OPEN_READONLY);
+	n_tables = count_tables (db, "%");
+	g_assert_cmpint (count_tables (db, "example:A"), ==, 0);
+	sqlite3_close (db);
+
+	/* The WHERE clause runs over the union graph, and needs the
+	 * example:A table created in g1 by the first part of the update.
+	 */
+	tracker_sparql_connection_update (conn,
+	                                  "INSERT DATA { GRAPH <http://example/g1> { "
+	                                  "  <http://example/a> a example:A ; example:i0 1 "
+	                                  "} } ; "
+	                                  "INSERT { GRAPH <http://example/g1> { ?a example:i1 2 } } "
+	                                  "WHERE { ?a example:i0 1 }",
+	                                  NULL, &error);
+	g_assert_no_error (error);
+
+	assert_ask (conn, "ASK { GRAPH <http://example/g1> { <http://example/a> example:i0 1 ; example:i1 2 } }");
+
+	g_object_unref (conn);
+
+	/* Unrelated graphs did not get tables created */
+	db = open_database_file (data_dir, "http://example/g2", SQLITE_OPEN_READONLY);
+	g_assert_cmpint (count_tables (db, "%"), ==, n_tables);
+	g_assert_cmpint (count_tables (db, "example:A"), ==, 0);
+	sqlite3_close (db);
+
+	g_object_unref (test_schemas);
+	g_object_unref (data_location);
+	g_free (data_dir);
+	g_free (prefix);
+}
+
+static gchar *
+list_indexes (const gchar *data_dir,
+              const gchar *database)
+{
+	GString *str = g_string_new (NULL);
+	sqlite3_stmt *stmt;
+	sqlite3 *db;
+
+	db = open_database_file (data_dir, database, SQLITE_OPEN_READONLY);
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+	                                     "SELECT name, sql FROM sqlite_master "
+	                                     "WHERE type = 'index' AND sql IS NOT NULL "
+	                                     "ORDER BY name",
+	                                     -1, &stmt, NULL), ==, SQLITE_OK);
+
+	while (sqlite3_step (stmt) == SQLITE_ROW) {
+		g_string_append_printf (str, "%s: %s\n",
+		                        sqlite3_column_text (stmt, 0),
+		                        sqlite3_column_text (stmt, 1));
+	}
+
+	sqlite3_finalize (stmt);
+	sqlite3_close (db);
+
+	return g_string_free (str, FALSE);
+}
+
+static void
+locale_change_graphs_test (void)
+{
+	gchar *prefix, *data_dir, *ontology_dir;
+	GError *error = NULL;
+	GFile *data_location, *test_schemas;
+	TrackerSparqlConnection *conn;
+	gchar *indexes[4];
+	guint i;
+
+	prefix = g_build_filename (TOP_SRCDIR, "tests", "core", NULL);
+	ontology_dir = g_build_filename (prefix, "initialization/fts", NULL);
+	test_schemas = g_file_new_for_path (ontology_dir);
+	g_free (ontology_dir);
+
+	data_dir = g_build_filename (g_get_tmp_dir (), "tracker-initialization-test-XXXXXX", NULL);
+	data_dir = g_mkdtemp_full (data_dir, 0700);
+	data_location = g_file_new_for_path (data_dir);
+
+	reset_locale (data_dir);
+
+	conn = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+	                                      data_location,
+	                                      test_schemas,
+	                                      NULL, &error);
+	g_assert_no_error (error);
+
+	/* Indexes in several graphs are recreated in parallel */
+	for (i = 0; i < 4; i++) {
+		gchar *query;
+
+		query = g_strdup_printf ("INSERT DATA { GRAPH <http://example/g%u> { "
+		                         "  <http://example/a%u> a example:DomA ; example:i1 %u ; example:i2 %u "
+		                         "} }",
+		                         i, i, i, i);
+		tracker_sparql_connection_update (conn, query, NULL, &error);
+		g_assert_no_error (error);
+		g_free (query);
+	}
+
+	g_clear_object (&conn);
+
+	for (i = 0; i < G_N_ELEMENTS (indexes); i++) {
+		gchar *graph;
+
+		graph = g_strdup_printf ("http://example/g%u", i);
+		indexes[i] = list_indexes (data_dir, graph);
+		g_assert_cmpstr (indexes[i], !=, "");
+		g_free (graph);
+	}
+
+	change_locale (data_dir);
+
+	conn = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+	                                      data_location,
+	                                      test_schemas,
+	                                      NULL, &error);
+	g_assert_no_error (error);
+
+	for (i = 0; i < 4; i++) {
+		gchar *query;
+
+		query = g_strdup_printf ("ASK { GRAPH <http://example/g%u> { "
+		                         "  <http://example/a%u> example:i1 %u ; example:i2 %u "
+		                         "} }",
+		                         i, i, i, i);
+		assert_ask (conn, query);
+		g_free (query);
+	}
+
+	g_object_unref (conn);
+
+	/* Every index is back in place after being recreated */
+	for (i = 0; i < G_N_ELEMENTS (indexes); i++) {
+		gchar *graph, *recreated;
+
+		graph = g_strdup_printf ("http://example/g%u", i);
+		recreated = list_indexes (data_dir, graph);
+		g_assert_cmpstr (recreated, ==, indexes[i]);
+		g_free (recreated);
+		g_free (indexes[i]);
+		g_free (graph);
+	}
+
+	g_object_unref (test_schemas);
+	g_object_unref (data_location);
+	g_free (data_dir);
+	g_free (prefix);
+}
+
+static void
+ontology_snapshot_test (void)
+{
+	gchar *prefix, *data_dir, *ontology_dir, *snapshot_path, *contents;
+	GError *error = NULL;
+	GFile *data_location, *test_schemas;
+	TrackerSparqlConnection *conn;
+	guint i;
+
+	prefix = g_build_filename (TOP_SRCDIR, "tests", "core", NULL);
+	ontology_dir = g_build_filename (prefix, "initialization/fts", NULL);
+	test_schemas = g_file_new_for_path (ontology_dir);
+	g_free (ontology_dir);
+
+	data_dir = g_build_filename (g_get_tmp_dir (), "tracker-initialization-test-XXXXXX", NULL);
+	data_dir = g_mkdtemp_full (data_dir, 0700);
+	data_location = g_file_new_for_path (data_dir);
+	snapshot_path = g_build_filename (data_dir, "ontologies.snapshot", NULL);
+
+	conn = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+	                                      data_location,
+	                                      test_schemas,
+	                                      NULL, &error);
+	g_assert_no_error (error);
+	g_clear_object (&conn);
+
+	g_assert_true (g_file_test (snapshot_path, G_FILE_TEST_EXISTS));
+
+	/* Open from the snapshot first, then from a corrupted one that
+	 * must be ignored, domain indexes and FTS must work in both.
+	 */
+	for (i = 0; i < 2; i++) {
+		gchar *query;
+
+		if (i == 1) {
+			g_file_set_contents (snapshot_path, "garbage", -1, &error);
+			g_assert_no_error (error);
+		}
+
+		conn = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+		                                      data_location,
+		                                      test_schemas,
+		                                      NULL, &error);
+		g_assert_no_error (error);
+
+		query = g_strdup_printf ("INSERT DATA { "
+		                         "  <http://example/a%u> a example:DomA ; example:i1 %u . "
+		                         "  <http://example/b%u> a example:B ; example:s2 'hello' "
+		                         "}",
+		                         i, i, i);
+		tracker_sparql_connection_update (conn, query, NULL, &error);
+		g_assert_no_error (error);
+		g_free (query);
+
+		query = g_strdup_printf ("ASK { <http://example/a%u> a example:DomA ; example:i1 %u }", i, i);
+		assert_ask (conn, query);
+		g_free (query);
+
+		query = g_strdup_printf ("ASK { <http://example/b%u> <http://tracker.api.gnome.org/ontology/v3/fts#match> 'hello' }", i);
+		assert_ask (conn, query);
+		g_free (query);
+
+		g_clear_object (&conn);
+	}
+
+	/* The corrupted snapshot got replaced */
+	g_file_get_contents (snapshot_path, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, !=, "garbage");
+	g_free (contents);
+
+	g_object_unref (test_schemas);
+	g_object_unref (data_location);
+	g_free (snapshot_path);
+	g_free (data_dir);
+	g_free (prefix);
+}
+
 const InitTest init_tests[] = {
 	{ "/core/initialization-test/integrity-check", "initialization/fts", NULL, fool_integrity_check },
 	{ "/core/initialization-test/locale-change-fts", "initialization/fts", reset_locale, change_locale },
@@ -195,6 +641,12 @@ main (int argc, char *argv[])
 	for (i = 0; i < G_N_ELEMENTS (version_tests); i++)
 		g_test_add_data_func (version_tests[i].name, &version_tests[i], version_test);
 
+	g_test_add_func ("/core/initialization-test/graph-template", graph_template_test);
+	g_test_add_func ("/core/initialization-test/lazy-graph-tables", lazy_graph_tables_test);
+	g_test_add_func ("/core/initialization-test/lazy-graph-tables-update", lazy_graph_tables_update_test);
+	g_test_add_func ("/core/initialization-test/locale-change-graphs", locale_change_graphs_test);
+	g_test_add_func ("/core/initialization-test/ontology-snapshot", ontology_snapshot_test);
+
 	result = g_test_run ();
 
 	return result;
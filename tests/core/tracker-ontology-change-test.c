@@ -807,6 +807,29 @@ handle_updates (TrackerSparqlConnection *conn,
 	}
 }
 
+static void
+assert_no_shadow_databases (GFile *data_location)
+{
+	GFileEnumerator *enumerator;
+	GFileInfo *info;
+	GError *error = NULL;
+
+	enumerator = g_file_enumerate_children (data_location,
+	                                        G_FILE_ATTRIBUTE_STANDARD_NAME,
+	                                        G_FILE_QUERY_INFO_NONE,
+	                                        NULL, &error);
+	g_assert_no_error (error);
+
+	/* Migrated graph databases must have replaced the originals */
+	while ((info = g_file_enumerator_next_file (enumerator, NULL, &error)) != NULL) {
+		g_assert_false (g_str_has_suffix (g_file_info_get_name (info), ".migration"));
+		g_object_unref (info);
+	}
+
+	g_assert_no_error (error);
+	g_object_unref (enumerator);
+}
+
 static void
 test_ontology_change (gconstpointer context)
 {
@@ -880,6 +903,8 @@ test_ontology_change (gconstpointer context)
 
 		g_clear_object (&conn);
 		g_clear_error (&error);
+
+		assert_no_shadow_databases (data_location);
 	}
 
 	/* Test opening for a last time */
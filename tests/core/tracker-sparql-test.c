@@ -119,6 +119,8 @@ const TestInfo tests[] = {
 	{ "datetime/filter-3", "datetime/data-1", FALSE },
 	{ "datetime/filter-4", "datetime/data-1", FALSE },
 	{ "datetime/filter-5", "datetime/data-1", FALSE },
+	{ "datetime/filter-6", "datetime/data-6", FALSE },
+	{ "datetime/order-1", "datetime/data-6", FALSE },
 	{ "describe/describe-single", "describe/data", FALSE },
 	{ "describe/describe-non-existent", "describe/data", FALSE },
 	{ "describe/describe-pattern", "describe/data", FALSE },
@@ -288,6 +290,8 @@ const TestInfo tests[] = {
 	{ "regex/regex-query-005", "regex/regex-data-01", FALSE },
 	{ "regex/regex-query-006", "regex/regex-data-01", FALSE },
 	{ "regex/regex-query-007", "regex/regex-data-01", TRUE },
+	{ "regex/regex-query-008", "regex/regex-data-01", FALSE },
+	{ "regex/regex-query-009", "regex/regex-data-01", FALSE },
 	{ "sort/query-sort-1", "sort/data-sort-1", FALSE },
 	{ "sort/query-sort-2", "sort/data-sort-1", FALSE },
 	{ "sort/query-sort-3", "sort/data-sort-3", FALSE },
@@ -297,7 +301,9 @@ const TestInfo tests[] = {
 	{ "sort/query-sort-7", "sort/data-sort-1", FALSE },
 	{ "sort/query-sort-8", "sort/data-sort-5", FALSE },
 	{ "sort/query-sort-9", "sort/data-sort-5", FALSE },
+	{ "sort/query-sort-10", "sort/data-sort-5", FALSE },
 	{ "sort/query-title-sort-1", "sort/data-title-sort-1", FALSE },
+	{ "sort/query-title-sort-2", "sort/data-title-sort-1", FALSE },
 	{ "subqueries/subqueries-1", "subqueries/data-1", FALSE },
 	{ "subqueries/subqueries-union-1", "subqueries/data-1", FALSE },
 	{ "subqueries/subqueries-union-2", "subqueries/data-1", FALSE },
@@ -344,6 +350,8 @@ const TestInfo tests[] = {
 	{ "property-paths/recursive-path-1", "property-paths/data", FALSE },
 	{ "property-paths/recursive-path-2", "property-paths/data", FALSE },
 	{ "property-paths/recursive-path-3", "property-paths/data", FALSE },
+	{ "property-paths/recursive-path-4", "property-paths/data-2", FALSE },
+	{ "property-paths/recursive-path-5", "property-paths/data-2", FALSE },
 	{ "property-paths/alternative-path-1", "property-paths/data", FALSE },
 	{ "property-paths/alternative-path-2", "property-paths/data", FALSE },
 	{ "property-paths/alternative-path-3", "property-paths/data", FALSE },
@@ -374,6 +382,9 @@ const TestInfo tests[] = {
 	{ "property-paths/mixed-optional-and-sequence-1", "property-paths/data-2", FALSE },
 	{ "property-paths/mixed-optional-and-sequence-2", "property-paths/data-2", FALSE },
 	{ "property-paths/mixed-graphs", "property-paths/data-3", FALSE },
+	{ "closure/descendants", "closure/data", FALSE },
+	{ "closure/ancestors", "closure/data", FALSE },
+	{ "closure/update-query", "closure/update", FALSE },
 	/* Update tests */
 	{ "update/insert-data-query-1", "update/insert-data-1", FALSE, FALSE },
 	{ "update/insert-data-query-2", "update/insert-data-2", FALSE, TRUE },
@@ -524,8 +535,8 @@ check_result (TrackerSparqlCursor *cursor,
 }
 
 static void
-test_sparql_query (TestInfo      *test_info,
-                   gconstpointer  context)
+run_sparql_query (TestInfo                     *test_info,
+                  TrackerSparqlConnectionFlags  flags)
 {
 	TrackerSparqlCursor *cursor;
 	GError *error = NULL;
@@ -547,8 +558,7 @@ test_sparql_query (TestInfo      *test_info,
 	test_schemas = g_file_get_parent (file);
 	g_object_unref (file);
 
-	conn = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
-	                                      NULL, test_schemas, NULL, &error);
+	conn = tracker_sparql_connection_new (flags, NULL, test_schemas, NULL, &error);
 	g_assert_no_error (error);
 
 	/* data_path = g_build_path (G_DIR_SEPARATOR_S, TOP_SRCDIR, "tests", "core", NULL); */
@@ -629,6 +639,20 @@ test_sparql_query (TestInfo      *test_info,
 	g_object_unref (conn);
 }
 
+static void
+test_sparql_query (TestInfo      *test_info,
+                   gconstpointer  context)
+{
+	run_sparql_query (test_info, TRACKER_SPARQL_CONNECTION_FLAGS_NONE);
+}
+
+static void
+test_sparql_query_compressed_uris (TestInfo      *test_info,
+                                   gconstpointer  context)
+{
+	run_sparql_query (test_info, TRACKER_SPARQL_CONNECTION_FLAGS_COMPRESS_URIS);
+}
+
 static void
 setup (TestInfo      *info,
        gconstpointer  context)
@@ -661,6 +685,10 @@ main (int argc, char **argv)
 		testpath = g_strconcat ("/core/sparql/", tests[i].test_name, NULL);
 		g_test_add (testpath, TestInfo, &tests[i], setup, test_sparql_query, teardown);
 		g_free (testpath);
+
+		testpath = g_strconcat ("/core/sparql/compressed-uris/", tests[i].test_name, NULL);
+		g_test_add (testpath, TestInfo, &tests[i], setup, test_sparql_query_compressed_uris, teardown);
+		g_free (testpath);
 	}
 
 	/* run tests */
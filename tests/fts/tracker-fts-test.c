@@ -38,13 +38,16 @@ const TestInfo tests[] = {
 	{ "fts3ae", 1 },
 	{ "consistency/partial-update", 2 },
 	{ "consistency/insert-or-replace", 2 },
+	{ "consistency/large-documents", 3 },
 	{ "prefix/fts3prefix", 3 },
 	{ "limits/fts3limits", 4 },
 	{ "input/fts3input", 3 },
 	{ "input/object-variable", 2, TRUE },
-	{ "functions/rank", 5 },
+	{ "functions/rank", 7 },
 	{ "functions/offsets", 3 },
-	{ "functions/snippet", 4 },
+	{ "functions/snippet", 5 },
+	{ "functions/snippet-limits", 1, TRUE },
+	{ "functions/large-documents", 3 },
 	{ NULL }
 };
 
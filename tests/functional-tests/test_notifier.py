@@ -176,6 +176,132 @@ class TrackerLocalNotifierTest(fixtures.TrackerSparqlDirectTest, TrackerNotifier
         self.base_setup()
 
 
+class TrackerNotifierFilterTests:
+    """
+    Test cases for TrackerNotifier filters.
+
+    Local connections apply the filter as changes are written, D-Bus
+    endpoints apply the filter before sending the events.
+    """
+
+    def filter_setup(self):
+        self.loop = trackertestutils.mainloop.MainLoop()
+        self.results = []
+
+        self.notifier = self.conn.create_notifier()
+        self.notifier.connect("events", self.__signal_received_cb)
+
+    def __signal_received_cb(self, notifier, service, graph, events):
+        for event in events:
+            self.results.append((event.get_event_type(), event.get_urn()))
+        self.loop.quit()
+
+    def __wait_for_signal(self):
+        timeout_id = GLib.timeout_add_seconds(
+            configuration.DEFAULT_TIMEOUT, self.loop.quit
+        )
+        self.loop.run_checked()
+        GLib.source_remove(timeout_id)
+
+    def test_01_class_filter(self):
+        self.notifier.set_filter(None, ["nco:PersonContact"], None)
+
+        self.tracker.update("INSERT { <test://filter-class-1> a nmm:MusicPiece }")
+        self.tracker.update("INSERT { <test://filter-class-2> a nco:PersonContact }")
+        self.__wait_for_signal()
+
+        self.assertEqual(
+            self.results,
+            [(Tracker.NotifierEventType.CREATE, "test://filter-class-2")],
+        )
+
+    def test_02_property_filter(self):
+        self.notifier.set_filter(None, None, ["nco:fullname"])
+
+        self.tracker.update("INSERT { <test://filter-property> a nco:PersonContact }")
+        self.__wait_for_signal()
+        self.tracker.update(
+            "INSERT { <test://filter-property> nco:nameGiven 'ignored' }"
+        )
+        self.tracker.update("INSERT { <test://filter-property> nco:fullname 'notified' }")
+        self.__wait_for_signal()
+
+        self.assertEqual(
+            self.results,
+            [
+                (Tracker.NotifierEventType.CREATE, "test://filter-property"),
+                (Tracker.NotifierEventType.UPDATE, "test://filter-property"),
+            ],
+        )
+
+    def test_03_graph_filter(self):
+        self.notifier.set_filter("test://filter-graph-b", None, None)
+
+        self.tracker.update(
+            "INSERT { GRAPH <test://filter-graph-a> { <test://filter-graph-1> a nco:PersonContact } }"
+        )
+        self.tracker.update(
+            "INSERT { GRAPH <test://filter-graph-b> { <test://filter-graph-2> a nco:PersonContact } }"
+        )
+        self.__wait_for_signal()
+
+        self.assertEqual(
+            self.results,
+            [(Tracker.NotifierEventType.CREATE, "test://filter-graph-2")],
+        )
+
+
+class TrackerLocalNotifierFilterTest(
+    fixtures.TrackerSparqlDirectTest, TrackerNotifierFilterTests
+):
+    """
+    Check that notifier filters are applied on local connections.
+    """
+
+    def setUp(self):
+        self.filter_setup()
+
+
+class TrackerLocalNotifierCoalesceTest(fixtures.TrackerSparqlDirectTest):
+    """
+    Check that events are merged within the notifier coalesce interval.
+    """
+
+    def setUp(self):
+        self.loop = trackertestutils.mainloop.MainLoop()
+        self.n_signals = 0
+        self.results = []
+
+        self.notifier = self.conn.create_notifier()
+        self.notifier.props.coalesce_interval = 500
+        self.notifier.connect("events", self.__signal_received_cb)
+
+    def __signal_received_cb(self, notifier, service, graph, events):
+        self.n_signals += 1
+        for event in events:
+            self.results.append(event.get_event_type())
+        self.loop.quit()
+
+    def test_01_coalesce_commits(self):
+        timeout_id = GLib.timeout_add_seconds(
+            configuration.DEFAULT_TIMEOUT, self.loop.quit
+        )
+
+        self.tracker.update("INSERT { <test://coalesce-1> a nco:PersonContact }")
+        self.tracker.update("INSERT { <test://coalesce-2> a nco:PersonContact }")
+        self.tracker.update("INSERT { <test://coalesce-1> nco:fullname 'foo' }")
+        self.tracker.update("DELETE { <test://coalesce-2> a rdfs:Resource }")
+        self.loop.run_checked()
+        GLib.source_remove(timeout_id)
+
+        self.assertEqual(self.n_signals, 1)
+        # Both resources get a single event, with the latest event type
+        self.assertEqual(
+            sorted(self.results),
+            [Tracker.NotifierEventType.CREATE, Tracker.NotifierEventType.DELETE],
+        )
+
+
 class TrackerBusNotifierTest(fixtures.TrackerSparqlBusTest, TrackerNotifierTests):
     """
     Insert/update/remove instances from nco:PersonContact
@@ -186,5 +312,16 @@ class TrackerBusNotifierTest(fixtures.TrackerSparqlBusTest, TrackerNotifierTests
         self.base_setup()
 
 
+class TrackerBusNotifierFilterTest(
+    fixtures.TrackerSparqlBusTest, TrackerNotifierFilterTests
+):
+    """
+    Check that notifier filters are handed over to D-Bus endpoints.
+    """
+
+    def setUp(self):
+        self.filter_setup()
+
+
 if __name__ == "__main__":
     fixtures.tracker_test_main()
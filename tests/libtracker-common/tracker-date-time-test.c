@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2024, Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <libtracker-common/tracker-date-time.h>
+
+#define N_BENCHMARK_ITERATIONS 1000000
+
+static const gchar *dates[] = {
+	"2001-02-03T10:11:12Z",
+	"2004-05-06T13:14:15+02:00",
+	"1960-01-01T00:00:00.250000-05:00",
+	"1969-12-31T23:59:59.500000Z",
+	"0001-01-01T00:00:00Z",
+	"9999-12-31T23:59:59.999999Z",
+	"2020-02-29T12:00:00+05:30",
+};
+
+static void
+test_parse (void)
+{
+	GDateTime *datetime;
+	gint64 usec;
+	gint32 offset;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (dates); i++) {
+		datetime = g_date_time_new_from_iso8601 (dates[i], NULL);
+		g_assert_nonnull (datetime);
+
+		g_assert_true (tracker_date_time_from_iso8601 (dates[i], &usec, &offset));
+		g_assert_cmpint (usec, ==, tracker_date_time_get_usec (datetime));
+		g_assert_cmpint (offset, ==, tracker_date_time_get_offset (datetime));
+		g_date_time_unref (datetime);
+	}
+
+	/* Local time, handled through the GDateTime fallback */
+	g_assert_true (tracker_date_time_from_iso8601 ("2004-05-06T13:14:15", &usec, &offset));
+
+	g_assert_false (tracker_date_time_from_iso8601 ("2021-02-29T00:00:00Z", &usec, &offset));
+	g_assert_false (tracker_date_time_from_iso8601 ("2021-02-28T00:00:00+", &usec, &offset));
+	g_assert_false (tracker_date_time_from_iso8601 ("", &usec, &offset));
+	g_assert_false (tracker_date_time_from_iso8601 (NULL, &usec, &offset));
+}
+
+static void
+test_format (void)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (dates); i++) {
+		gchar buf[TRACKER_DATE_TIME_ISO8601_SIZE];
+		GDateTime *datetime;
+		gchar *str;
+
+		datetime = tracker_date_new_from_iso8601 (dates[i], NULL);
+		g_assert_nonnull (datetime);
+
+		str = tracker_date_format_iso8601 (datetime);
+		g_assert_cmpstr (str, ==, dates[i]);
+		g_free (str);
+
+		g_assert_cmpuint (tracker_date_time_to_iso8601 (tracker_date_time_get_usec (datetime),
+		                                                tracker_date_time_get_offset (datetime),
+		                                                buf),
+		                  ==, strlen (dates[i]));
+		g_assert_cmpstr (buf, ==, dates[i]);
+		g_date_time_unref (datetime);
+	}
+}
+
+static void
+test_packed (void)
+{
+	guint8 prev[TRACKER_DATE_TIME_PACKED_SIZE];
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (dates); i++) {
+		guint8 buf[TRACKER_DATE_TIME_PACKED_SIZE];
+		GDateTime *datetime;
+		gint64 usec, unpacked_usec;
+		gint32 offset, unpacked_offset;
+		gchar *str;
+
+		g_assert_true (tracker_date_time_from_iso8601 (dates[i], &usec, &offset));
+		tracker_date_time_pack (usec, offset, buf);
+
+		g_assert_true (tracker_date_time_unpack (buf, sizeof (buf),
+		                                         &unpacked_usec,
+		                                         &unpacked_offset));
+		g_assert_cmpint (usec, ==, unpacked_usec);
+		g_assert_cmpint (offset, ==, unpacked_offset);
+
+		datetime = tracker_date_new_from_packed (buf, sizeof (buf), NULL);
+		g_assert_nonnull (datetime);
+		str = tracker_date_format_iso8601 (datetime);
+		g_assert_cmpstr (str, ==, dates[i]);
+		g_free (str);
+		g_date_time_unref (datetime);
+
+		/* Byte order must follow chronological order */
+		if (i == 2)
+			g_assert_cmpint (memcmp (prev, buf, sizeof (buf)), >, 0);
+		else if (i == 3)
+			g_assert_cmpint (memcmp (prev, buf, sizeof (buf)), <, 0);
+
+		memcpy (prev, buf, sizeof (buf));
+	}
+
+	g_assert_false (tracker_date_time_unpack (prev, sizeof (prev) - 1, NULL, NULL));
+}
+
+static void
+test_benchmark (void)
+{
+	GDateTime *datetime;
+	GTimeZone *tz;
+	gdouble elapsed;
+	GTimer *timer;
+	gint64 usec = 0;
+	gint32 offset = 0;
+	gchar *str;
+	guint i;
+
+	if (!g_test_perf ())
+		return;
+
+	timer = g_timer_new ();
+	tz = g_time_zone_new_local ();
+
+	for (i = 0; i < N_BENCHMARK_ITERATIONS; i++) {
+		datetime = g_date_time_new_from_iso8601 (dates[i % G_N_ELEMENTS (dates)], tz);
+		usec += g_date_time_to_unix (datetime);
+		g_date_time_unref (datetime);
+	}
+
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_message ("GDateTime parse: %.1f ns/call",
+	                elapsed * G_NSEC_PER_SEC / N_BENCHMARK_ITERATIONS);
+
+	g_timer_start (timer);
+
+	for (i = 0; i < N_BENCHMARK_ITERATIONS; i++)
+		tracker_date_time_from_iso8601 (dates[i % G_N_ELEMENTS (dates)], &usec, &offset);
+
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_minimized_result (elapsed * G_NSEC_PER_SEC / N_BENCHMARK_ITERATIONS,
+	                         "Stack parse: %.1f ns/call",
+	                         elapsed * G_NSEC_PER_SEC / N_BENCHMARK_ITERATIONS);
+
+	datetime = g_date_time_new_from_iso8601 (dates[2], tz);
+	g_timer_start (timer);
+
+	for (i = 0; i < N_BENCHMARK_ITERATIONS; i++) {
+		str = g_date_time_format (datetime, "%C%y-%m-%dT%H:%M:%S.%f%:z");
+		g_free (str);
+	}
+
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_message ("GDateTime format: %.1f ns/call",
+	                elapsed * G_NSEC_PER_SEC / N_BENCHMARK_ITERATIONS);
+
+	g_timer_start (timer);
+
+	for (i = 0; i < N_BENCHMARK_ITERATIONS; i++) {
+		gchar buf[TRACKER_DATE_TIME_ISO8601_SIZE];
+
+		tracker_date_time_to_iso8601 (usec, offset, buf);
+	}
+
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_minimized_result (elapsed * G_NSEC_PER_SEC / N_BENCHMARK_ITERATIONS,
+	                         "Stack format: %.1f ns/call",
+	                         elapsed * G_NSEC_PER_SEC / N_BENCHMARK_ITERATIONS);
+
+	g_date_time_unref (datetime);
+	g_time_zone_unref (tz);
+	g_timer_destroy (timer);
+}
+
+int
+main (int argc, char **argv)
+{
+	gboolean ret;
+
+	g_test_init (&argc, &argv, NULL);
+
+	setlocale (LC_ALL, "");
+
+	g_test_add_func ("/libtracker-common/tracker-date-time/parse",
+	                 test_parse);
+	g_test_add_func ("/libtracker-common/tracker-date-time/format",
+	                 test_format);
+	g_test_add_func ("/libtracker-common/tracker-date-time/packed",
+	                 test_packed);
+	g_test_add_func ("/libtracker-common/tracker-date-time/benchmark",
+	                 test_benchmark);
+
+	ret = g_test_run ();
+
+	return ret;
+}
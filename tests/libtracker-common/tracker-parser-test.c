@@ -199,6 +199,155 @@ test_unac (TrackerParserTestFixture *fixture,
 #endif
 }
 
+/* -------------- EXPECTED WORDS TESTS ----------------- */
+
+typedef struct {
+	const gchar *word;
+	gint byte_offset_start;
+	gint byte_offset_end;
+} TestWord;
+
+/* Test struct for the expected-words tests */
+typedef struct TestDataExpectedWords TestDataExpectedWords;
+struct TestDataExpectedWords {
+	const gchar *str;
+	TestWord words[20];
+};
+
+/* Common expected_words test method */
+static void
+expected_words_check (TrackerParserTestFixture *fixture,
+                      gconstpointer             data)
+{
+	const TestDataExpectedWords *testdata = data;
+	const gchar *word;
+	gint position;
+	gint byte_offset_start;
+	gint byte_offset_end;
+	gint word_length;
+	guint i = 0;
+
+	/* Reset the parser with the test string */
+	tracker_parser_reset (fixture->parser,
+	                      testdata->str,
+	                      strlen (testdata->str),
+	                      fixture->max_word_length,
+	                      FALSE,
+	                      FALSE,
+	                      FALSE);
+
+	while ((word = tracker_parser_next (fixture->parser,
+	                                    &position,
+	                                    &byte_offset_start,
+	                                    &byte_offset_end,
+	                                    &word_length)) != NULL) {
+		const TestWord *expected = &testdata->words[i];
+		gchar *expected_nfkd;
+
+		g_assert_nonnull (expected->word);
+
+		/* Expected word MUST always be in NFKD normalization */
+		expected_nfkd = g_utf8_normalize (expected->word,
+		                                  -1,
+		                                  G_NORMALIZE_NFKD);
+
+		g_assert_cmpstr (word, ==, expected_nfkd);
+		g_assert_cmpint (word_length, ==, strlen (expected_nfkd));
+		g_assert_cmpint (byte_offset_start, ==, expected->byte_offset_start);
+		g_assert_cmpint (byte_offset_end, ==, expected->byte_offset_end);
+		g_assert_cmpint (position, ==, i + 1);
+
+		g_free (expected_nfkd);
+		i++;
+	}
+
+	g_assert_null (testdata->words[i].word);
+}
+
+/* -------------- ASCII FAST PATH PARITY TESTS ----------------- */
+
+static void
+parity_check (const gchar *str,
+              gboolean     enable_stemmer,
+              gboolean     enable_unaccent,
+              gboolean     ignore_numbers)
+{
+	TrackerParser *parser, *icu_parser;
+	const gchar *word, *icu_word;
+	gint position, icu_position;
+	gint byte_offset_start, icu_byte_offset_start;
+	gint byte_offset_end, icu_byte_offset_end;
+	gint word_length, icu_word_length;
+
+	parser = tracker_parser_new ();
+	icu_parser = tracker_parser_new ();
+	tracker_parser_set_ascii_fast_path (icu_parser, FALSE);
+
+	tracker_parser_reset (parser, str, strlen (str), 50,
+	                      enable_stemmer, enable_unaccent, ignore_numbers);
+	tracker_parser_reset (icu_parser, str, strlen (str), 50,
+	                      enable_stemmer, enable_unaccent, ignore_numbers);
+
+	do {
+		word = tracker_parser_next (parser,
+		                            &position,
+		                            &byte_offset_start,
+		                            &byte_offset_end,
+		                            &word_length);
+		icu_word = tracker_parser_next (icu_parser,
+		                                &icu_position,
+		                                &icu_byte_offset_start,
+		                                &icu_byte_offset_end,
+		                                &icu_word_length);
+
+		g_assert_cmpstr (word, ==, icu_word);
+
+		if (word) {
+			g_assert_cmpint (position, ==, icu_position);
+			g_assert_cmpint (byte_offset_start, ==, icu_byte_offset_start);
+			g_assert_cmpint (byte_offset_end, ==, icu_byte_offset_end);
+			g_assert_cmpint (word_length, ==, icu_word_length);
+		}
+	} while (word);
+
+	tracker_parser_free (parser);
+	tracker_parser_free (icu_parser);
+}
+
+/* The fast path must split and lowercase text exactly as the
+ * ICU word break iterator does */
+static void
+test_ascii_fast_path_parity (gconstpointer data)
+{
+#ifdef HAVE_LIBICU
+	const gchar *str = data;
+	guint i;
+
+	for (i = 0; i < 8; i++)
+		parity_check (str, (i & 1) != 0, (i & 2) != 0, (i & 4) != 0);
+#else
+	g_test_skip ("Built without libicu");
+#endif
+}
+
+static const gchar *test_data_parity[] = {
+	"The quick (\"brown\") fox can't jump 32.3 feet, right?",
+	"Hello, World! It's 1,000;5 items_list, 3.14159 and 2,5 or 1.2.3",
+	"file-name_2024.tar.gz /home/user/Report.PDF C:\\Users\\me\\x_y.txt",
+	"user@example.com http://www.example.org/path?q=a&b=c#frag mailto:a@b",
+	"Don't stop: it's O'Neil's 'quoted' text -- dashes--and---more ... ellipsis",
+	"a1b2 12ab ab12 1_2 _under_ __init__ v2.0-rc1 #hash $100 50% 3x4 1e10",
+	"MiXeD CaSe WORDS with TABS\tand\nnewlines\r\nand   spaces",
+	"café Crème brûlée menu, naïve approach, ASCII then Ελληνικά and back",
+	"Résumé: the quick brown fox jumps over the lazy dog, twice or thrice, then once more Ωmega end",
+	"ホモ・サピエンス 喂人类 katakana, chinese, english and some more ASCII words after them",
+	"Американские суда находятся в международных водах. Then plain ASCII text 2024, 10:30am",
+	"The long ASCII prefix is here to get past the minimum segment length, 123 456: Bần chỉ là một anh nghèo xác, then ASCII again until the end",
+	"e" "\xCC\x81" "cole SCHOOL e" "\xCC\x81" "CO" "\xCC\x81" "LE",
+	"groß GROSS ﬁle ﬂow Ǆemal İstanbul",
+	NULL
+};
+
 /* -------------- LIST OF TESTS ----------------- */
 
 /* Normalization-related tests (unaccenting) */
@@ -270,6 +419,36 @@ static const TestDataExpectedNWords test_data_nwords[] = {
 	{ NULL,                                                     FALSE,  0, 0 }
 };
 
+/* Words and offsets, mixing ASCII and non-ASCII text so both the
+ * ASCII fast path and the Unicode word breaking get exercised, as
+ * well as the transitions between them */
+static const TestDataExpectedWords test_data_words[] = {
+	{ "Hello, World! It's 1,000;5 items_list",
+	  { { "hello", 0, 5 }, { "world", 7, 12 }, { "it's", 14, 18 },
+	    { "1,000;5", 19, 26 }, { "items_list", 27, 37 } } },
+	{ "file-name_2024.tar.gz /home/user/Report.PDF",
+	  { { "file", 0, 4 }, { "name_2024", 5, 14 }, { "tar", 15, 18 },
+	    { "gz", 19, 21 }, { "home", 23, 27 }, { "user", 28, 32 },
+	    { "report", 33, 39 }, { "pdf", 40, 43 } } },
+	{ "café Crème brûlée menu",
+	  { { "café", 0, 5 }, { "crème", 6, 12 }, { "brûlée", 13, 21 },
+	    { "menu", 22, 26 } } },
+	{ "naïve approach, ASCII then Ελληνικά and back",
+	  { { "naïve", 0, 6 }, { "approach", 7, 15 }, { "ascii", 17, 22 },
+	    { "then", 23, 27 }, { "ελληνικά", 28, 44 }, { "and", 45, 48 },
+	    { "back", 49, 53 } } },
+	{ "Résumé: the quick brown fox jumps over the lazy dog, twice or thrice, then once more Ωmega end",
+	  { { "résumé", 0, 8 }, { "the", 10, 13 }, { "quick", 14, 19 },
+	    { "brown", 20, 25 }, { "fox", 26, 29 }, { "jumps", 30, 35 },
+	    { "over", 36, 40 }, { "the", 41, 44 }, { "lazy", 45, 49 },
+	    { "dog", 50, 53 }, { "twice", 55, 60 }, { "or", 61, 63 },
+	    { "thrice", 64, 70 }, { "then", 72, 76 }, { "once", 77, 81 },
+	    { "more", 82, 86 }, { "ωmega", 87, 93 }, { "end", 94, 97 } } },
+	{ "e" "\xCC\x81" "cole SCHOOL",
+	  { { "école", 0, 7 }, { "school", 8, 14 } } },
+	{ NULL }
+};
+
 int
 main (int argc, char **argv)
 {
@@ -347,5 +526,30 @@ main (int argc, char **argv)
 		g_free (testpath);
 	}
 
+	/* Add expected words checks */
+	for (i = 0; test_data_words[i].str != NULL; i++) {
+		gchar *testpath;
+
+		testpath = g_strdup_printf ("/libtracker-fts/parser/words_%d", i);
+		g_test_add (testpath,
+		            TrackerParserTestFixture,
+		            &test_data_words[i],
+		            test_common_setup,
+		            expected_words_check,
+		            test_common_teardown);
+		g_free (testpath);
+	}
+
+	/* Add ASCII fast path parity checks */
+	for (i = 0; test_data_parity[i] != NULL; i++) {
+		gchar *testpath;
+
+		testpath = g_strdup_printf ("/libtracker-fts/parser/ascii_fast_path_parity_%d", i);
+		g_test_add_data_func (testpath,
+		                      test_data_parity[i],
+		                      test_ascii_fast_path_parity);
+		g_free (testpath);
+	}
+
 	return g_test_run ();
 }
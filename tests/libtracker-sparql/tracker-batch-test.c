@@ -636,6 +636,119 @@ batch_resource_bnodes_same_batch (TestFixture   *test_fixture,
 	assert_count_bnodes (test_fixture, 1);
 }
 
+static void
+batch_resource_shared_relation (TestFixture   *test_fixture,
+                                gconstpointer  context)
+{
+	TrackerSparqlCursor *cursor;
+	TrackerBatch *batch;
+	TrackerResource *resource, *contact;
+	GError *error = NULL;
+
+	/* The same anonymous blank node referenced twice
+	 * must result in a single resource.
+	 */
+	contact = tracker_resource_new (NULL);
+	tracker_resource_set_uri (contact, "rdf:type", "nco:Contact");
+	tracker_resource_set_string (contact, "nco:fullname", "John Doe");
+
+	resource = tracker_resource_new ("http://example.com/m");
+	tracker_resource_set_uri (resource, "rdf:type", "nmm:Photo");
+	tracker_resource_set_relation (resource, "nco:creator", contact);
+	tracker_resource_set_relation (resource, "nco:contributor", contact);
+
+	batch = tracker_sparql_connection_create_batch (test_fixture->conn);
+	tracker_batch_add_resource (batch, NULL, resource);
+	tracker_batch_execute (batch, NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (batch);
+	g_object_unref (resource);
+	g_object_unref (contact);
+
+	cursor = tracker_sparql_connection_query (test_fixture->conn,
+	                                          "ASK { <http://example.com/m> nco:creator ?c ; nco:contributor ?c . "
+	                                          "      ?c nco:fullname 'John Doe' }",
+	                                          NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (tracker_sparql_cursor_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_true (tracker_sparql_cursor_get_boolean (cursor, 0));
+	g_object_unref (cursor);
+}
+
+static void
+assert_count_keywords (TestFixture *test_fixture,
+                       const gchar *iri,
+                       gint         count)
+{
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+
+	stmt = tracker_sparql_connection_query_statement (test_fixture->conn,
+	                                                  "SELECT COUNT (?k) { ~iri nie:keyword ?k }",
+	                                                  NULL, &error);
+	g_assert_no_error (error);
+
+	tracker_sparql_statement_bind_string (stmt, "iri", iri);
+	cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+	g_assert_no_error (error);
+
+	g_assert_true (tracker_sparql_cursor_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpint (tracker_sparql_cursor_get_integer (cursor, 0), ==, count);
+
+	g_object_unref (cursor);
+}
+
+static void
+batch_resource_add_values (TestFixture   *test_fixture,
+                           gconstpointer  context)
+{
+	TrackerBatch *batch;
+	TrackerResource *resource;
+	GError *error = NULL;
+
+	resource = tracker_resource_new ("http://example.com/n");
+	tracker_resource_set_uri (resource, "rdf:type", "nmm:Photo");
+	tracker_resource_set_string (resource, "nie:keyword", "a");
+
+	batch = tracker_sparql_connection_create_batch (test_fixture->conn);
+	tracker_batch_add_resource (batch, NULL, resource);
+	tracker_batch_execute (batch, NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (batch);
+	g_object_unref (resource);
+
+	assert_count_keywords (test_fixture, "http://example.com/n", 1);
+
+	/* Added values must not replace the existing ones */
+	resource = tracker_resource_new ("http://example.com/n");
+	tracker_resource_add_string (resource, "nie:keyword", "b");
+
+	batch = tracker_sparql_connection_create_batch (test_fixture->conn);
+	tracker_batch_add_resource (batch, NULL, resource);
+	tracker_batch_execute (batch, NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (batch);
+	g_object_unref (resource);
+
+	assert_count_keywords (test_fixture, "http://example.com/n", 2);
+
+	/* Set values do */
+	resource = tracker_resource_new ("http://example.com/n");
+	tracker_resource_set_string (resource, "nie:keyword", "c");
+
+	batch = tracker_sparql_connection_create_batch (test_fixture->conn);
+	tracker_batch_add_resource (batch, NULL, resource);
+	tracker_batch_execute (batch, NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (batch);
+	g_object_unref (resource);
+
+	assert_count_keywords (test_fixture, "http://example.com/n", 1);
+}
+
 static void
 batch_statement_insert (TestFixture   *test_fixture,
                         gconstpointer  context)
@@ -752,6 +865,62 @@ batch_statement_update_same_batch (TestFixture   *test_fixture,
 	g_date_time_unref (date);
 }
 
+static void
+batch_statement_repeated (TestFixture   *test_fixture,
+                          gconstpointer  context)
+{
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	TrackerBatch *batch;
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+	GDateTime *date;
+	gint i;
+
+	date = g_date_time_new_from_iso8601 ("2022-12-04T01:01:01Z", NULL);
+	stmt = create_photo_stmt (test_fixture);
+
+	/* Interleave executions of the same statement with other
+	 * updates, all of them must be applied in order.
+	 */
+	batch = tracker_sparql_connection_create_batch (test_fixture->conn);
+
+	for (i = 0; i < 100; i++) {
+		gchar *iri;
+
+		iri = g_strdup_printf ("http://example.com/repeated%d", i);
+		tracker_batch_add_statement (batch, stmt,
+		                             "iri", G_TYPE_STRING, iri,
+		                             "codec", G_TYPE_STRING, "png",
+		                             "interlaced", G_TYPE_BOOLEAN, FALSE,
+		                             "exposure", G_TYPE_DOUBLE, 0.12345678901,
+		                             "resolution", G_TYPE_INT64, (gint64) i,
+		                             "created", G_TYPE_DATE_TIME, date,
+		                             NULL);
+		g_free (iri);
+
+		if (i % 10 == 0)
+			tracker_batch_add_sparql (batch, PHOTO_INSERT_SPARQL);
+	}
+
+	tracker_batch_execute (batch, NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (batch);
+
+	assert_photo (test_fixture, "http://example.com/a", "png", date, FALSE, 123, 0.12345678901);
+	assert_photo (test_fixture, "http://example.com/repeated99", "png", date, FALSE, 99, 0.12345678901);
+
+	cursor = tracker_sparql_connection_query (test_fixture->conn,
+	                                          "SELECT COUNT (?u) { ?u a nmm:Photo ; nfo:codec 'png' }",
+	                                          NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (tracker_sparql_cursor_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpint (tracker_sparql_cursor_get_integer (cursor, 0), ==, 101);
+	g_object_unref (cursor);
+
+	g_date_time_unref (date);
+}
+
 static void
 batch_statement_delete (TestFixture   *test_fixture,
                         gconstpointer  context)
@@ -1282,9 +1451,12 @@ TestInfo tests[] = {
 	{ "resource/update-same-batch", batch_resource_update_same_batch },
 	{ "resource/bnodes", batch_resource_bnodes },
 	{ "resource/bnodes-same-batch", batch_resource_bnodes_same_batch },
+	{ "resource/shared-relation", batch_resource_shared_relation },
+	{ "resource/add-values", batch_resource_add_values },
 	{ "statement/insert", batch_statement_insert },
 	{ "statement/update", batch_statement_update },
 	{ "statement/update-same-batch", batch_statement_update_same_batch },
+	{ "statement/repeated", batch_statement_repeated },
 	{ "statement/delete", batch_statement_delete },
 	{ "statement/delete-same-batch", batch_statement_delete_same_batch },
 	{ "statement/bnodes", batch_statement_bnodes },
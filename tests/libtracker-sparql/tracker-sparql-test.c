@@ -98,6 +98,74 @@ test_tracker_sparql_connection_no_ontology (void)
 	g_error_free (error);
 }
 
+static TrackerSparqlConnection *
+create_connection_with_options (GVariant  *options,
+                                GError   **error)
+{
+	TrackerSparqlConnection *conn;
+	GFile *store, *ontology;
+	gchar *path;
+
+	path = g_build_filename (g_get_tmp_dir (), "libtracker-sparql-test-XXXXXX", NULL);
+	g_mkdtemp_full (path, 0700);
+	store = g_file_new_for_path (path);
+	g_free (path);
+
+	ontology = tracker_sparql_get_ontology_nepomuk ();
+
+	conn = tracker_sparql_connection_new_with_options (0, store, ontology,
+	                                                   options, NULL, error);
+	g_object_unref (store);
+	g_object_unref (ontology);
+
+	return conn;
+}
+
+static void
+test_tracker_sparql_connection_new_with_options (void)
+{
+	TrackerSparqlConnection *connection;
+	TrackerSparqlCursor *cursor;
+	GVariantBuilder builder;
+	GError *error = NULL;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "mmap-size", g_variant_new_int64 (0));
+	g_variant_builder_add (&builder, "{sv}", "page-size", g_variant_new_int32 (4096));
+	g_variant_builder_add (&builder, "{sv}", "reader-cache-budget", g_variant_new_int32 (1024));
+	g_variant_builder_add (&builder, "{sv}", "temp-store", g_variant_new_string ("memory"));
+
+	connection = create_connection_with_options (g_variant_builder_end (&builder), &error);
+	g_assert_no_error (error);
+
+	cursor = tracker_sparql_connection_query (connection,
+	                                          "SELECT ?u { ?u a rdfs:Resource }",
+	                                          NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (tracker_sparql_cursor_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+
+	g_object_unref (cursor);
+	g_object_unref (connection);
+
+	/* Page sizes must be a power of two */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "page-size", g_variant_new_int32 (1000));
+
+	connection = create_connection_with_options (g_variant_builder_end (&builder), &error);
+	g_assert_null (connection);
+	g_assert_nonnull (error);
+	g_clear_error (&error);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "unknown-option", g_variant_new_int32 (1));
+
+	connection = create_connection_with_options (g_variant_builder_end (&builder), &error);
+	g_assert_null (connection);
+	g_assert_nonnull (error);
+	g_clear_error (&error);
+}
+
 static void
 test_tracker_sparql_connection_interleaved (void)
 {
@@ -275,6 +343,8 @@ main (gint argc, gchar **argv)
 	                 test_tracker_sparql_escape_uri_vprintf);
 	g_test_add_func ("/libtracker-sparql/tracker-sparql/tracker_sparql_connection_no_ontology",
 	                 test_tracker_sparql_connection_no_ontology);
+	g_test_add_func ("/libtracker-sparql/tracker-sparql/tracker_sparql_connection_new_with_options",
+	                 test_tracker_sparql_connection_new_with_options);
 	g_test_add_func ("/libtracker-sparql/tracker-sparql/tracker_sparql_connection_interleaved",
 	                 test_tracker_sparql_connection_interleaved);
 	g_test_add_func ("/libtracker-sparql/tracker-sparql/tracker_sparql_connection_new_async",
@@ -531,6 +531,100 @@ stmt_fts (TestFixture   *test_fixture,
 	g_clear_object (&stmt);
 }
 
+static void
+stmt_int_array (TestFixture   *test_fixture,
+                gconstpointer  context)
+{
+	TrackerSparqlStatement *stmt;
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+	const gint64 values[] = { 3, 1, 2 };
+	gint64 expected = 1;
+
+	stmt = tracker_sparql_connection_query_statement (test_fixture->conn,
+	                                                  "SELECT ?id { VALUES ?id { ~ids } } ORDER BY ?id",
+	                                                  NULL,
+	                                                  &error);
+	g_assert_no_error (error);
+
+	tracker_sparql_statement_bind_int_array (stmt, "ids", values, G_N_ELEMENTS (values));
+	cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+	g_assert_no_error (error);
+
+	while (tracker_sparql_cursor_next (cursor, NULL, &error)) {
+		g_assert_cmpint (tracker_sparql_cursor_get_integer (cursor, 0), ==, expected);
+		expected++;
+	}
+
+	g_assert_no_error (error);
+	g_assert_cmpint (expected, ==, G_N_ELEMENTS (values) + 1);
+	g_clear_object (&cursor);
+
+	/* Rebinding a different array must replace the previous one */
+	tracker_sparql_statement_bind_int_array (stmt, "ids", &values[1], 1);
+	cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (tracker_sparql_cursor_next (cursor, NULL, &error));
+	g_assert_cmpint (tracker_sparql_cursor_get_integer (cursor, 0), ==, 1);
+	g_assert_false (tracker_sparql_cursor_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+	g_clear_object (&cursor);
+
+	g_clear_object (&stmt);
+}
+
+static void
+stmt_explain (TestFixture   *test_fixture,
+              gconstpointer  context)
+{
+	TrackerSparqlStatement *stmt;
+	GVariant *info, *plan;
+	GError *error = NULL;
+	const gchar *sql;
+	gint64 rows;
+
+	stmt = tracker_sparql_connection_query_statement (test_fixture->conn,
+	                                                  "SELECT ?id { VALUES ?id { ~ids } }",
+	                                                  NULL,
+	                                                  &error);
+	g_assert_no_error (error);
+
+	tracker_sparql_statement_bind_int_array (stmt, "ids", (gint64[]) { 1, 2 }, 2);
+	info = tracker_sparql_statement_explain (stmt, TRACKER_EXPLAIN_FLAGS_PROFILE,
+	                                         NULL, &error);
+
+	if (strstr (G_OBJECT_TYPE_NAME (test_fixture->conn), "Remote") != NULL) {
+		g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+		g_assert_null (info);
+		g_clear_error (&error);
+		g_clear_object (&stmt);
+		return;
+	}
+
+	g_assert_no_error (error);
+	g_assert_nonnull (info);
+
+	g_assert_true (g_variant_lookup (info, "sql", "&s", &sql));
+	g_assert_nonnull (strstr (sql, "SELECT"));
+	plan = g_variant_lookup_value (info, "plan", G_VARIANT_TYPE ("a(xxs)"));
+	g_assert_nonnull (plan);
+	g_assert_cmpuint (g_variant_n_children (plan), >, 0);
+	g_variant_unref (plan);
+	g_assert_true (g_variant_lookup (info, "rows", "x", &rows));
+	g_assert_cmpint (rows, ==, 2);
+	g_variant_unref (info);
+
+	/* Without profiling the query is not run */
+	info = tracker_sparql_statement_explain (stmt, TRACKER_EXPLAIN_FLAGS_NONE,
+	                                         NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (g_variant_lookup (info, "translate-time", "x", &rows));
+	g_assert_false (g_variant_lookup (info, "rows", "x", &rows));
+	g_variant_unref (info);
+
+	g_clear_object (&stmt);
+}
+
 TrackerSparqlConnection *
 create_local_connection (GError **error)
 {
@@ -622,6 +716,8 @@ TestFuncData test_funcs[] = {
 	{ "update", stmt_update },
 	{ "update_async", stmt_update_async },
 	{ "fts", stmt_fts },
+	{ "int_array", stmt_int_array },
+	{ "explain", stmt_explain },
 };
 
 static void
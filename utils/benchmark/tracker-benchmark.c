@@ -152,6 +152,12 @@ create_query (void)
 	return g_strdup ("SELECT ?u { ?u a rdfs:Resource } limit 1");
 }
 
+static inline gpointer
+create_scan_query (void)
+{
+	return g_strdup ("SELECT ?u ?l { ?u a rdfs:Resource . OPTIONAL { ?u rdfs:label ?l } } LIMIT 1000000");
+}
+
 static inline TrackerBatch *
 create_batch (TrackerSparqlConnection *conn,
               DataCreateFunc           data_func,
@@ -262,6 +268,36 @@ consume_cursor (TrackerSparqlCursor *cursor)
 	return magic;
 }
 
+static int
+scan_cursor (TrackerSparqlCursor *cursor,
+             int                 *magic)
+{
+	GError *error = NULL;
+	int n_columns, i, rows = 0;
+
+	n_columns = tracker_sparql_cursor_get_n_columns (cursor);
+
+	while (tracker_sparql_cursor_next (cursor, NULL, &error)) {
+		for (i = 0; i < n_columns; i++) {
+			const gchar *str;
+
+			if (tracker_sparql_cursor_get_value_type (cursor, i) ==
+			    TRACKER_SPARQL_VALUE_TYPE_UNBOUND)
+				continue;
+
+			str = tracker_sparql_cursor_get_string (cursor, i, NULL);
+			*magic ^= str[0] == 'h';
+		}
+
+		rows++;
+	}
+
+	g_assert_no_error (error);
+	tracker_sparql_cursor_close (cursor);
+
+	return rows;
+}
+
 static void
 benchmark_update_batch (TrackerSparqlConnection *conn,
                         DataCreateFunc           data_func,
@@ -530,6 +566,49 @@ benchmark_query_sparql (TrackerSparqlConnection *conn,
 	g_free (query);
 }
 
+static void
+benchmark_query_scan (TrackerSparqlConnection *conn,
+                      DataCreateFunc           data_func,
+                      double                  *elapsed,
+                      int                     *elems,
+                      double                  *min,
+                      double                  *max)
+{
+	GTimer *timer;
+	GError *error = NULL;
+	gchar *query;
+	int magic = 0;
+
+	timer = g_timer_new ();
+	query = data_func ();
+
+	while (*elapsed < duration) {
+		TrackerSparqlCursor *cursor;
+		double query_elapsed;
+		int rows;
+
+		cursor = tracker_sparql_connection_query (conn, query,
+		                                          NULL, &error);
+		g_assert_no_error (error);
+		rows = scan_cursor (cursor, &magic);
+		g_object_unref (cursor);
+
+		if (rows == 0)
+			break;
+
+		/* Elements are rows, report per-row times */
+		query_elapsed = g_timer_elapsed (timer, NULL);
+		*min = MIN (*min, query_elapsed / rows);
+		*max = MAX (*max, query_elapsed / rows);
+		*elapsed += query_elapsed;
+		*elems += rows;
+		g_timer_reset (timer);
+	}
+
+	g_timer_destroy (timer);
+	g_free (query);
+}
+
 struct {
 	const gchar *desc;
 	BenchmarkFunc func;
@@ -543,8 +622,36 @@ struct {
 	{ "Resource insert + SPARQL delete (sync)", benchmark_update_insert_delete, NULL },
 	{ "Prepared statement query (sync)", benchmark_query_statement, create_query },
 	{ "SPARQL query (sync)", benchmark_query_sparql, create_query },
+	{ "Cursor scan, up to 1M rows (sync)", benchmark_query_scan, create_scan_query },
 };
 
+static void
+print_results (double elapsed,
+               int    elems,
+               double min,
+               double max)
+{
+	double adjusted, avg;
+
+	if (elapsed > duration) {
+		/* To avoid explaining how long did the benchmark
+		 * actually take to run. Adjust the output to the
+		 * specified time limit.
+		 */
+		adjusted = elems * ((double) duration / elapsed);
+	} else {
+		adjusted = elems;
+	}
+
+	avg = elapsed / elems;
+	g_print ("%.3f\t%.3f\t%.3f %s\t%.3f %s\t%3.3f %s\n",
+	         adjusted,
+	         elems / elapsed,
+	         transform_unit (min), unit_string (min),
+	         transform_unit (max), unit_string (max),
+	         transform_unit (avg), unit_string (avg));
+}
+
 static void
 run_benchmarks (TrackerSparqlConnection *conn)
 {
@@ -558,31 +665,84 @@ run_benchmarks (TrackerSparqlConnection *conn)
 	         max_len, "Test");
 
 	for (i = 0; i < G_N_ELEMENTS (benchmarks); i++) {
-		double elapsed = 0, min = G_MAXDOUBLE, max = -G_MAXDOUBLE, adjusted, avg;
+		double elapsed = 0, min = G_MAXDOUBLE, max = -G_MAXDOUBLE;
 		int elems = 0;
 
 		g_print ("%*s\t\t", max_len, benchmarks[i].desc);
 
 		benchmarks[i].func (conn, benchmarks[i].data_func,
 		                    &elapsed, &elems, &min, &max);
+		print_results (elapsed, elems, min, max);
+	}
+}
 
-		if (elapsed > duration) {
-			/* To avoid explaining how long did the benchmark
-			 * actually take to run. Adjust the output to the
-			 * specified time limit.
-			 */
-			adjusted = elems * ((double) duration / elapsed);
-		} else {
-			adjusted = elems;
-		}
+static void
+benchmark_open (GFile   *db,
+                gboolean warm,
+                double  *elapsed,
+                int     *elems,
+                double  *min,
+                double  *max)
+{
+	GFile *snapshot;
+	GTimer *timer;
+	GError *error = NULL;
 
-		avg = elapsed / elems;
-		g_print ("%.3f\t%.3f\t%.3f %s\t%.3f %s\t%3.3f %s\n",
-		         adjusted,
-		         elems / elapsed,
-		         transform_unit (min), unit_string (min),
-		         transform_unit (max), unit_string (max),
-		         transform_unit (avg), unit_string (avg));
+	snapshot = g_file_get_child (db, "ontologies.snapshot");
+	timer = g_timer_new ();
+
+	while (*elapsed < duration) {
+		TrackerSparqlConnection *conn;
+		double open_elapsed;
+
+		/* A cold open has to load the ontology from the database */
+		if (!warm)
+			g_file_delete (snapshot, NULL, NULL);
+
+		g_timer_reset (timer);
+		conn = tracker_sparql_connection_new (0, db,
+		                                      tracker_sparql_get_ontology_nepomuk (),
+		                                      NULL, &error);
+		g_assert_no_error (error);
+		open_elapsed = g_timer_elapsed (timer, NULL);
+		tracker_sparql_connection_close (conn);
+		g_object_unref (conn);
+
+		*min = MIN (*min, open_elapsed);
+		*max = MAX (*max, open_elapsed);
+		*elapsed += open_elapsed;
+		*elems += 1;
+	}
+
+	g_timer_destroy (timer);
+	g_object_unref (snapshot);
+}
+
+static void
+run_open_benchmarks (GFile *db)
+{
+	struct {
+		const gchar *desc;
+		gboolean warm;
+	} open_benchmarks[] = {
+		{ "Cold writable open (sync)", FALSE },
+		{ "Warm writable open (sync)", TRUE },
+	};
+	guint i;
+	guint max_len = 0;
+
+	for (i = 0; i < G_N_ELEMENTS (open_benchmarks); i++)
+		max_len = MAX (max_len, strlen (open_benchmarks[i].desc));
+
+	for (i = 0; i < G_N_ELEMENTS (open_benchmarks); i++) {
+		double elapsed = 0, min = G_MAXDOUBLE, max = -G_MAXDOUBLE;
+		int elems = 0;
+
+		g_print ("%*s\t\t", max_len, open_benchmarks[i].desc);
+
+		benchmark_open (db, open_benchmarks[i].warm,
+		                &elapsed, &elems, &min, &max);
+		print_results (elapsed, elems, min, max);
 	}
 }
 
@@ -632,6 +792,11 @@ main (int argc, char *argv[])
 	run_benchmarks (conn);
 
 	g_object_unref (conn);
+
+	/* Opening times are only meaningful with a database on disk */
+	if (db)
+		run_open_benchmarks (db);
+
 	g_clear_object (&db);
 
 	return EXIT_SUCCESS;